@@ -0,0 +1,530 @@
+// Microbenchmarks for the SQLEngine operators on synthetic in-memory tables.
+//
+// Example:
+//   ./tpch_bench --rows 10000,100000 --dist uniform,zipf --selectivity 0.01,0.5 --threads 1,4
+//   ./tpch_bench --bench join --repetitions 10 --csv join.csv
+//
+// Every benchmark reports the median of --repetitions runs (after one warmup
+// run) as rows/s and bytes/s of the operator input.
+
+#include "../include/sqlhelper.hpp"
+#include "../include/columnar.hpp"
+#include "../include/utilities.hpp"
+#include "../include/fastparse.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using namespace SQLEngine;
+
+namespace {
+
+struct BenchConfig {
+    size_t rows;
+    std::string dist;     // uniform, zipf or sequential key distribution
+    double selectivity;   // fraction of rows that qualify / find a match
+    int threads;
+};
+
+struct BenchResult {
+    std::string name;
+    BenchConfig config;
+    double median_ms;
+    uint64_t rows;
+    uint64_t bytes;
+};
+
+// Draws keys in [1, domain] following the requested distribution
+class KeyGenerator {
+public:
+    KeyGenerator(const std::string& dist, uint64_t domain, uint64_t seed)
+        : dist_(dist), domain_(std::max<uint64_t>(domain, 1)), rng_(seed), uniform_(1, domain_) {
+        if (dist_ == "zipf") {
+            // Zipf with exponent 1: cdf over all ranks, sampled by binary search
+            cdf_.resize(domain_);
+            double sum = 0.0;
+            for (uint64_t i = 0; i < domain_; i++) {
+                sum += 1.0 / (i + 1);
+                cdf_[i] = sum;
+            }
+            for (auto& c : cdf_) c /= sum;
+        }
+    }
+
+    uint64_t next() {
+        if (dist_ == "zipf") {
+            double u = std::uniform_real_distribution<double>(0.0, 1.0)(rng_);
+            return std::lower_bound(cdf_.begin(), cdf_.end(), u) - cdf_.begin() + 1;
+        }
+        if (dist_ == "sequential") return sequence_++ % domain_ + 1;
+        return uniform_(rng_);
+    }
+
+private:
+    std::string dist_;
+    uint64_t domain_;
+    std::mt19937_64 rng_;
+    std::uniform_int_distribution<uint64_t> uniform_;
+    std::vector<double> cdf_;
+    uint64_t sequence_ = 0;
+};
+
+uint64_t tableBytes(const Table& table) {
+    uint64_t bytes = 0;
+    for (const auto& row : table)
+        for (const auto& [k, v] : row) bytes += k.size() + v.size();
+    return bytes;
+}
+
+std::string formatDate(int day) {
+    // 1992-01-01 plus day offset, 28-day months keep the strings ordered
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "%04d-%02d-%02d", 1992 + day / 336, day / 28 % 12 + 1, day % 28 + 1);
+    return buf;
+}
+
+// Probe side: keys drawn from [1, domain] with probability `selectivity`,
+// from a disjoint range otherwise. Also carries a date, a price and a payload.
+Table makeProbeTable(const BenchConfig& cfg, uint64_t domain, uint64_t seed) {
+    KeyGenerator keys(cfg.dist, domain, seed);
+    std::mt19937_64 rng(seed + 1);
+    std::uniform_real_distribution<double> coin(0.0, 1.0);
+    std::uniform_int_distribution<int> day(0, 7 * 336 - 1);
+    std::uniform_int_distribution<int> cents(90000, 10000000);
+
+    Table table;
+    table.reserve(cfg.rows);
+    for (size_t i = 0; i < cfg.rows; i++) {
+        uint64_t key = keys.next();
+        if (coin(rng) >= cfg.selectivity) key += domain;
+        Row row;
+        row["P_KEY"] = std::to_string(key);
+        row["P_DATE"] = formatDate(day(rng));
+        row["P_PRICE"] = std::to_string(cents(rng) / 100) + "." + std::to_string(10 + cents(rng) % 90);
+        row["P_COMMENT"] = "synthetic probe row payload";
+        table.push_back(std::move(row));
+    }
+    return table;
+}
+
+// Build side: unique keys 1..domain
+Table makeBuildTable(uint64_t domain) {
+    Table table;
+    table.reserve(domain);
+    for (uint64_t key = 1; key <= domain; key++) {
+        Row row;
+        row["B_KEY"] = std::to_string(key);
+        row["B_NAME"] = "Build#" + std::to_string(key);
+        table.push_back(std::move(row));
+    }
+    return table;
+}
+
+// Short CHAR(10) values like L_SHIPMODE: "TRUCK" with probability
+// `selectivity`, one of the other ship modes otherwise
+Table makeModeTable(const BenchConfig& cfg, uint64_t seed) {
+    static const char* OTHER_MODES[] = {"REG AIR", "AIR", "RAIL", "SHIP", "MAIL", "FOB"};
+    std::mt19937_64 rng(seed);
+    std::uniform_real_distribution<double> coin(0.0, 1.0);
+    std::uniform_int_distribution<int> other(0, 5);
+
+    Table table;
+    table.reserve(cfg.rows);
+    for (size_t i = 0; i < cfg.rows; i++) {
+        Row row;
+        row["P_KEY"] = std::to_string(i + 1);
+        row["P_MODE"] = coin(rng) < cfg.selectivity ? "TRUCK" : OTHER_MODES[other(rng)];
+        table.push_back(std::move(row));
+    }
+    return table;
+}
+
+std::vector<std::string> makeLines(const Table& table) {
+    std::vector<std::string> lines;
+    lines.reserve(table.size());
+    for (const auto& row : table) {
+        std::string line;
+        for (const auto& [k, v] : row) line += v + "|";
+        lines.push_back(std::move(line));
+    }
+    return lines;
+}
+
+template <typename Fn>
+double medianMs(int repetitions, Fn&& fn) {
+    fn();  // warmup
+    std::vector<double> times;
+    for (int r = 0; r < repetitions; r++) {
+        auto start = std::chrono::steady_clock::now();
+        fn();
+        auto end = std::chrono::steady_clock::now();
+        times.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+    }
+    std::sort(times.begin(), times.end());
+    return times[times.size() / 2];
+}
+
+// Date cut-off such that roughly `selectivity` of the probe rows qualify
+std::string dateCutoff(double selectivity) {
+    return formatDate(static_cast<int>(selectivity * 7 * 336));
+}
+
+volatile size_t sink;
+
+}
+
+int main(int argc, char* argv[]) {
+    std::unordered_map<std::string, std::string> options = {
+        {"bench", "tokenize,join,where_eq,where_range,group_sum,sort,char,encoded,bitmap,parse"},
+        {"rows", "10000,100000"},
+        {"dist", "uniform,zipf"},
+        {"selectivity", "0.1,0.5"},
+        {"threads", "1,2,4"},
+        {"repetitions", "5"},
+    };
+    if ((argc - 1) % 2 != 0) {
+        std::cerr << "Options must be given as --key value pairs." << std::endl;
+        return 1;
+    }
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string key(argv[i]);
+        if (key.size() < 3 || key.substr(0, 2) != "--") {
+            std::cerr << "Unexpected argument: " << key << std::endl;
+            return 1;
+        }
+        options[key.substr(2)] = argv[i + 1];
+    }
+
+    std::vector<std::string> benches = split(options["bench"], ',');
+    std::vector<std::string> dists = split(options["dist"], ',');
+    std::vector<size_t> row_counts;
+    std::vector<double> selectivities;
+    std::vector<int> thread_counts;
+    int repetitions;
+    try {
+        for (const auto& v : split(options["rows"], ',')) row_counts.push_back(std::stoul(v));
+        for (const auto& v : split(options["selectivity"], ',')) selectivities.push_back(std::stod(v));
+        for (const auto& v : split(options["threads"], ',')) thread_counts.push_back(std::stoi(v));
+        repetitions = std::max(1, std::stoi(options["repetitions"]));
+    } catch (...) {
+        std::cerr << "Invalid numeric option." << std::endl;
+        return 1;
+    }
+    if (std::any_of(thread_counts.begin(), thread_counts.end(), [](int t) { return t < 1; })) {
+        std::cerr << "--threads values must be at least 1." << std::endl;
+        return 1;
+    }
+    Tracing::setEnabled(false);
+
+    auto wanted = [&](const std::string& name) {
+        return std::find(benches.begin(), benches.end(), name) != benches.end();
+    };
+
+    std::vector<BenchResult> results;
+    auto report = [&](const std::string& name, const BenchConfig& cfg, double ms, uint64_t rows, uint64_t bytes) {
+        results.push_back({name, cfg, ms, rows, bytes});
+        double seconds = ms / 1000.0;
+        std::printf("%-12s rows=%-9zu dist=%-10s sel=%-5.3f threads=%-3d %10.3f ms %12.0f rows/s %10.1f MB/s\n",
+                    name.c_str(), cfg.rows, cfg.dist.c_str(), cfg.selectivity, cfg.threads, ms,
+                    rows / seconds, bytes / seconds / 1e6);
+        std::fflush(stdout);
+    };
+
+    for (size_t rows : row_counts) {
+        for (const auto& dist : dists) {
+            for (double selectivity : selectivities) {
+                BenchConfig cfg{rows, dist, selectivity, 1};
+                uint64_t domain = std::max<size_t>(rows / 4, 1);
+                Table probe = makeProbeTable(cfg, domain, 42);
+                uint64_t probe_bytes = tableBytes(probe);
+
+                if (wanted("tokenize")) {
+                    std::vector<std::string> lines = makeLines(probe);
+                    uint64_t line_bytes = 0;
+                    for (const auto& l : lines) line_bytes += l.size();
+                    double ms = medianMs(repetitions, [&] {
+                        size_t fields = 0;
+                        for (const auto& line : lines) fields += splitPipe(line).size();
+                        sink = fields;
+                    });
+                    report("tokenize", cfg, ms, rows, line_bytes);
+                }
+
+                if (wanted("join")) {
+                    Table build = makeBuildTable(domain);
+                    uint64_t bytes = probe_bytes + tableBytes(build);
+                    for (int threads : thread_counts) {
+                        BenchConfig join_cfg = cfg;
+                        join_cfg.threads = threads;
+                        double ms = medianMs(repetitions, [&] {
+                            sink = INNER_JOIN(probe, build, "P_KEY", "B_KEY", threads).size();
+                        });
+                        report("join", join_cfg, ms, probe.size() + build.size(), bytes);
+                    }
+                }
+
+                if (wanted("where_eq")) {
+                    // Equality on the most frequent key; selectivity follows the distribution
+                    Predicate pred = EQUALS("P_KEY", "1");
+                    double ms = medianMs(repetitions, [&] { sink = WHERE(probe, pred).size(); });
+                    report("where_eq", cfg, ms, rows, probe_bytes);
+                }
+
+                if (wanted("where_range")) {
+                    std::string low = formatDate(0);
+                    std::string high = dateCutoff(selectivity);
+                    Predicate pred = [&low, &high](const Row& row) {
+                        const std::string& date = row.at("P_DATE");
+                        return date >= low && date < high;
+                    };
+                    double ms = medianMs(repetitions, [&] { sink = WHERE(probe, pred).size(); });
+                    report("where_range", cfg, ms, rows, probe_bytes);
+                }
+
+                if (wanted("group_sum")) {
+                    double ms = medianMs(repetitions, [&] {
+                        auto groups = GROUP_BY(probe, "P_KEY");
+                        double total = 0.0;
+                        for (const auto& [key, group] : groups) total += SUM(group, "P_PRICE");
+                        sink = static_cast<size_t>(total);
+                    });
+                    report("group_sum", cfg, ms, rows, probe_bytes);
+                }
+
+                if (wanted("sort")) {
+                    double ms = medianMs(repetitions, [&] { sink = ORDER_BY_DESC(probe, "P_PRICE").size(); });
+                    report("sort", cfg, ms, rows, probe_bytes);
+                }
+
+                if (wanted("char")) {
+                    // Short-string equality, prefix and grouping: row maps vs a fixed-width column
+                    Table modes = makeModeTable(cfg, 7);
+                    uint64_t mode_bytes = tableBytes(modes);
+                    double ms = medianMs(repetitions, [&] { sink = CharColumn(modes, "P_MODE").size(); });
+                    report("char_build", cfg, ms, rows, mode_bytes);
+                    CharColumn mode_column(modes, "P_MODE");
+
+                    Predicate eq = EQUALS("P_MODE", "TRUCK");
+                    ms = medianMs(repetitions, [&] { sink = WHERE(modes, eq).size(); });
+                    report("char_eq_map", cfg, ms, rows, mode_bytes);
+                    ms = medianMs(repetitions, [&] { sink = WHERE_EQUALS(modes, mode_column, "TRUCK").size(); });
+                    report("char_eq", cfg, ms, rows, mode_bytes);
+
+                    Predicate prefix = [](const Row& row) { return row.at("P_MODE").compare(0, 3, "TRU") == 0; };
+                    ms = medianMs(repetitions, [&] { sink = WHERE(modes, prefix).size(); });
+                    report("char_pfx_map", cfg, ms, rows, mode_bytes);
+                    ms = medianMs(repetitions, [&] { sink = WHERE_PREFIX(modes, mode_column, "TRU").size(); });
+                    report("char_prefix", cfg, ms, rows, mode_bytes);
+
+                    ms = medianMs(repetitions, [&] { sink = GROUP_BY(modes, "P_MODE").size(); });
+                    report("char_grp_map", cfg, ms, rows, mode_bytes);
+                    ms = medianMs(repetitions, [&] { sink = GROUP_BY(modes, mode_column).size(); });
+                    report("char_group", cfg, ms, rows, mode_bytes);
+                }
+
+                if (wanted("bitmap")) {
+                    // IN predicates on low-cardinality columns and their conjunction:
+                    // row predicates vs ORing / ANDing bitmap indexes
+                    Table modes = makeModeTable(cfg, 7);
+                    static const char* FLAGS[] = {"A", "N", "R"};
+                    for (size_t i = 0; i < modes.size(); i++) modes[i]["P_FLAG"] = FLAGS[(i * 7919) % 3];
+                    uint64_t mode_bytes = tableBytes(modes);
+                    double ms = medianMs(repetitions, [&] { sink = BitmapIndex(modes, "P_MODE").distinctValues(); });
+                    report("bitmap_build", cfg, ms, rows, mode_bytes);
+                    BitmapIndex mode_index(modes, "P_MODE");
+                    BitmapIndex flag_index(modes, "P_FLAG");
+                    const std::vector<std::string> wanted_modes = {"TRUCK", "MAIL"};
+                    const std::vector<std::string> wanted_flags = {"R"};
+
+                    Predicate in_modes = [](const Row& row) {
+                        const std::string& mode = row.at("P_MODE");
+                        return mode == "TRUCK" || mode == "MAIL";
+                    };
+                    ms = medianMs(repetitions, [&] { sink = WHERE(modes, in_modes).size(); });
+                    report("bitmap_in_map", cfg, ms, rows, mode_bytes);
+                    ms = medianMs(repetitions, [&] { sink = WHERE_IN(modes, mode_index, wanted_modes).size(); });
+                    report("bitmap_in", cfg, ms, rows, mode_bytes);
+
+                    Predicate in_flags = EQUALS("P_FLAG", "R");
+                    ms = medianMs(repetitions, [&] { sink = WHERE(WHERE(modes, in_modes), in_flags).size(); });
+                    report("bitmap_and_map", cfg, ms, rows, mode_bytes);
+                    ms = medianMs(repetitions, [&] {
+                        RoaringBitmap both = mode_index.anyOf(wanted_modes);
+                        both &= flag_index.anyOf(wanted_flags);
+                        sink = both.positions().size();
+                    });
+                    report("bitmap_and", cfg, ms, rows, mode_bytes);
+                }
+
+                if (wanted("parse")) {
+                    // Integer keys, NNNN.NN prices and dates: libc vs the FastParse kernels,
+                    // which must agree with it on every value
+                    std::vector<std::string> keys, prices, dates;
+                    uint64_t key_bytes = 0, price_bytes = 0, date_bytes = 0;
+                    for (const auto& row : probe) {
+                        keys.push_back(row.at("P_KEY"));
+                        prices.push_back(row.at("P_PRICE"));
+                        dates.push_back(row.at("P_DATE"));
+                        key_bytes += keys.back().size();
+                        price_bytes += prices.back().size();
+                        date_bytes += dates.back().size();
+                    }
+                    auto libcDate = [](const std::string& date) {
+                        return FastParse::daysFromCivil(std::stoi(date.substr(0, 4)), std::stoi(date.substr(5, 2)),
+                                                        std::stoi(date.substr(8, 2)));
+                    };
+                    for (size_t i = 0; i < probe.size(); i++) {
+                        int64_t key = 0, cents = 0;
+                        int32_t day = 0;
+                        if (!FastParse::parseInt(keys[i], key) || key != std::stoll(keys[i]) ||
+                            !FastParse::parseFixed(prices[i], 2, cents) || cents != std::llround(std::stod(prices[i]) * 100) ||
+                            FastParse::toDouble(prices[i]) != std::stod(prices[i]) ||
+                            !FastParse::parseDate(dates[i], day) || day != libcDate(dates[i])) {
+                            std::cerr << "FastParse disagrees with libc on row " << i << std::endl;
+                            return 1;
+                        }
+                    }
+
+                    double ms = medianMs(repetitions, [&] {
+                        int64_t total = 0;
+                        for (const auto& key : keys) total += std::stoll(key);
+                        sink = static_cast<size_t>(total);
+                    });
+                    report("parse_int_libc", cfg, ms, rows, key_bytes);
+                    ms = medianMs(repetitions, [&] {
+                        int64_t total = 0, key = 0;
+                        for (const auto& text : keys) total += FastParse::parseInt(text, key) ? key : 0;
+                        sink = static_cast<size_t>(total);
+                    });
+                    report("parse_int", cfg, ms, rows, key_bytes);
+
+                    ms = medianMs(repetitions, [&] {
+                        double total = 0;
+                        for (const auto& price : prices) total += std::stod(price);
+                        sink = static_cast<size_t>(total);
+                    });
+                    report("parse_dec_libc", cfg, ms, rows, price_bytes);
+                    ms = medianMs(repetitions, [&] {
+                        int64_t total = 0, cents = 0;
+                        for (const auto& price : prices) total += FastParse::parseFixed(price, 2, cents) ? cents : 0;
+                        sink = static_cast<size_t>(total);
+                    });
+                    report("parse_dec", cfg, ms, rows, price_bytes);
+                    ms = medianMs(repetitions, [&] {
+                        double total = 0;
+                        for (const auto& price : prices) total += FastParse::toDouble(price);
+                        sink = static_cast<size_t>(total);
+                    });
+                    report("parse_double", cfg, ms, rows, price_bytes);
+
+                    ms = medianMs(repetitions, [&] {
+                        int64_t total = 0;
+                        for (const auto& date : dates) total += libcDate(date);
+                        sink = static_cast<size_t>(total);
+                    });
+                    report("parse_date_libc", cfg, ms, rows, date_bytes);
+                    ms = medianMs(repetitions, [&] {
+                        int64_t total = 0;
+                        int32_t day = 0;
+                        for (const auto& date : dates) total += FastParse::parseDate(date, day) ? day : 0;
+                        sink = static_cast<size_t>(total);
+                    });
+                    report("parse_date", cfg, ms, rows, date_bytes);
+                }
+
+                if (wanted("encoded")) {
+                    // Date range filter and price sum over a .col file: decode every row
+                    // and filter the maps vs evaluate both on the encoded chunks
+                    std::error_code ec;
+                    std::filesystem::path directory = std::filesystem::temp_directory_path(ec);
+                    if (ec) {
+                        std::cerr << "No temporary directory: " << ec.message() << std::endl;
+                        return 1;
+                    }
+                    std::string path = (directory / "tpch_bench_encoded.col").string();
+                    std::vector<std::string> columns = {"P_DATE", "P_PRICE"};
+                    if (!Columnar::writeTable(path, columns, probe)) {
+                        std::cerr << "Failed to write " << path << std::endl;
+                        std::filesystem::remove(path, ec);
+                        return 1;
+                    }
+                    uint64_t file_bytes = std::filesystem::file_size(path);
+                    Buffer::Pool pool(file_bytes * 2 + (8u << 20));
+                    std::string low = formatDate(0);
+                    std::string high = dateCutoff(selectivity);
+                    Predicate in_range = [&low, &high](const Row& row) {
+                        const std::string& date = row.at("P_DATE");
+                        return date >= low && date < high;
+                    };
+                    Columnar::Filter filter;
+                    filter.column = "P_DATE";
+                    filter.low = low;
+                    filter.high = high;
+                    // Set by a run whose read or scan failed; its timing means nothing
+                    bool failed = false;
+
+                    double ms = medianMs(repetitions, [&] {
+                        Table table;
+                        failed |= !Columnar::readTable(path, columns, table);
+                        sink = WHERE(table, in_range).size();
+                    });
+                    report("enc_where_dec", cfg, ms, rows, file_bytes);
+                    ms = medianMs(repetitions, [&] {
+                        Columnar::Scanner scanner;
+                        failed |= !scanner.open(path, {"P_PRICE"}, pool, {filter});
+                        Table group;
+                        size_t count = 0;
+                        while (scanner.next(group)) count += group.size();
+                        failed |= scanner.failed();
+                        sink = count;
+                    });
+                    report("enc_where", cfg, ms, rows, file_bytes);
+
+                    ms = medianMs(repetitions, [&] {
+                        Table table;
+                        failed |= !Columnar::readTable(path, columns, table);
+                        sink = static_cast<size_t>(SUM(WHERE(table, in_range), "P_PRICE"));
+                    });
+                    report("enc_sum_dec", cfg, ms, rows, file_bytes);
+                    ms = medianMs(repetitions, [&] {
+                        Columnar::Scanner scanner;
+                        double total = 0.0;
+                        failed |= !scanner.open(path, {}, pool, {filter}) || !scanner.sum("P_PRICE", total);
+                        sink = static_cast<size_t>(total);
+                    });
+                    report("enc_sum", cfg, ms, rows, file_bytes);
+                    std::filesystem::remove(path);
+                    if (failed) {
+                        std::cerr << "Failed to read " << path << std::endl;
+                        return 1;
+                    }
+                }
+            }
+        }
+    }
+
+    if (options.count("csv")) {
+        std::ofstream csv(options["csv"]);
+        if (!csv.is_open()) {
+            std::cerr << "Failed to open CSV file: " << options["csv"] << std::endl;
+            return 1;
+        }
+        csv << "benchmark,rows,dist,selectivity,threads,median_ms,rows_per_s,bytes_per_s" << std::endl;
+        for (const auto& r : results) {
+            double seconds = r.median_ms / 1000.0;
+            csv << r.name << "," << r.config.rows << "," << r.config.dist << "," << r.config.selectivity << ","
+                << r.config.threads << "," << r.median_ms << "," << r.rows / seconds << "," << r.bytes / seconds << std::endl;
+        }
+    }
+    return 0;
+}
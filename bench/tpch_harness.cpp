@@ -0,0 +1,411 @@
+// Benchmark harness for whole queries.
+//
+// Sweep mode runs a query over a grid of thread counts and scale factors and
+// reports the median, spread, speedup and parallel efficiency of every cell:
+//
+//   ./tpch_harness --threads 1,2,4,8 --scales 0.1,1 --warmup 1 --repetitions 5 --csv sweep.csv
+//
+// Tables come from --table_path, where "{sf}" is replaced by the scale factor
+// (e.g. /data/sf{sf}); without it they are generated in memory. Instead of an
+// in-process query, --command times any program; "{threads}", "{sf}" and
+// "{table_path}" are substituted in the command line:
+//
+//   ./tpch_harness --command "./tpch_query5 --r_name ASIA ... --threads {threads} --table_path /data/sf{sf} ..."
+//
+// --validate on checks the answer of every run, warmup and timed, before any
+// timing is reported and stops at the first mismatch. The expected answer is
+// the bundled TPC-H answer (SF1 on dbgen data only) or the --reference file
+// ("{sf}" substituted, outputResults format). With --command
+// the answer is read from --result_path, which is also substituted.
+//
+// --baseline_store keeps the raw samples of every run in a local JSON file,
+// keyed by commit and machine, and compares the run with the latest one of
+// another commit on the same machine (or --baseline_commit). Metrics are the
+// query time per cell, its pipelines, its operators (profiling builds) and
+// the table load (--load_repetitions, MIN_SAMPLES by default). A metric
+// that is slower by more than --threshold with Mann-Whitney p < --alpha fails
+// the run with exit code 3.
+
+#include "../include/query5.hpp"
+#include "../include/baseline.hpp"
+#include "../include/datagen.hpp"
+#include "../include/profile.hpp"
+#include "../include/trace.hpp"
+#include "../include/utilities.hpp"
+#include "../include/validation.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+using Table = std::vector<std::map<std::string, std::string>>;
+
+struct Tables {
+    Table customer, orders, lineitem, supplier, nation, region;
+};
+
+// A query the harness can run in-process
+struct QuerySpec {
+    std::string name;
+    std::function<bool(int num_threads, const Tables& tables, std::map<std::string, double>& results)> run;
+};
+
+// Queries run with the validation parameters of the TPC-H specification
+std::vector<QuerySpec> queries() {
+    return {
+        {"q5", [](int num_threads, const Tables& t, std::map<std::string, double>& results) {
+            return executeQuery5("ASIA", "1994-01-01", "1995-01-01", num_threads, t.customer, t.orders,
+                                 t.lineitem, t.supplier, t.nation, t.region, results);
+        }},
+    };
+}
+
+struct Summary {
+    double median = 0, min = 0, max = 0, p25 = 0, p75 = 0, stddev = 0;
+};
+
+double percentile(const std::vector<double>& sorted, double p) {
+    double pos = p * (sorted.size() - 1);
+    size_t lo = static_cast<size_t>(pos);
+    size_t hi = std::min(lo + 1, sorted.size() - 1);
+    return sorted[lo] + (sorted[hi] - sorted[lo]) * (pos - lo);
+}
+
+Summary summarize(std::vector<double> samples) {
+    Summary s;
+    std::sort(samples.begin(), samples.end());
+    s.median = percentile(samples, 0.5);
+    s.p25 = percentile(samples, 0.25);
+    s.p75 = percentile(samples, 0.75);
+    s.min = samples.front();
+    s.max = samples.back();
+    double mean = 0;
+    for (double v : samples) mean += v;
+    mean /= samples.size();
+    for (double v : samples) s.stddev += (v - mean) * (v - mean);
+    s.stddev = samples.size() > 1 ? std::sqrt(s.stddev / (samples.size() - 1)) : 0.0;
+    return s;
+}
+
+std::string substitute(std::string text, const std::string& key, const std::string& value) {
+    for (size_t pos = text.find(key); pos != std::string::npos; pos = text.find(key, pos + value.size()))
+        text.replace(pos, key.size(), value);
+    return text;
+}
+
+std::string formatScale(double sf) {
+    std::ostringstream out;
+    out << sf;
+    return out.str();
+}
+
+struct Cell {
+    double scale_factor;
+    int threads;
+    Summary time_ms;
+    double speedup = 0, efficiency = 0, karp_flatt = 0;
+};
+
+}
+
+int main(int argc, char* argv[]) {
+    std::unordered_map<std::string, std::string> options = {
+        {"query", "q5"}, {"threads", "1,2,4"}, {"scales", "0.1"},
+        {"warmup", "1"}, {"repetitions", "5"}, {"seed", "19920101"}, {"validate", "off"},
+        {"threshold", "0.05"}, {"alpha", "0.05"}, {"save_baseline", "on"},
+    };
+    if ((argc - 1) % 2 != 0) {
+        std::cerr << "Options must be given as --key value pairs." << std::endl;
+        return 1;
+    }
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string key(argv[i]);
+        if (key.size() < 3 || key.substr(0, 2) != "--") {
+            std::cerr << "Unexpected argument: " << key << std::endl;
+            return 1;
+        }
+        options[key.substr(2)] = argv[i + 1];
+    }
+
+    std::vector<int> thread_counts;
+    std::vector<double> scales;
+    int warmup, repetitions, load_repetitions;
+    uint64_t seed;
+    double threshold, alpha;
+    try {
+        for (const auto& v : split(options["threads"], ',')) thread_counts.push_back(std::stoi(v));
+        for (const auto& v : split(options["scales"], ',')) scales.push_back(std::stod(v));
+        warmup = std::max(0, std::stoi(options["warmup"]));
+        repetitions = std::max(1, std::stoi(options["repetitions"]));
+        seed = std::stoull(options["seed"]);
+        // Loads are slow, so they are only repeated when a baseline compares them
+        load_repetitions = options.count("load_repetitions") ? std::max(1, std::stoi(options["load_repetitions"]))
+                         : options.count("baseline_store") ? static_cast<int>(Baseline::MIN_SAMPLES) : 1;
+        threshold = std::stod(options["threshold"]);
+        alpha = std::stod(options["alpha"]);
+    } catch (...) {
+        std::cerr << "Invalid numeric option." << std::endl;
+        return 1;
+    }
+    if (thread_counts.empty() || scales.empty()) {
+        std::cerr << "--threads and --scales need at least one value." << std::endl;
+        return 1;
+    }
+    if (*std::min_element(thread_counts.begin(), thread_counts.end()) <= 0) {
+        std::cerr << "--threads values must be at least 1." << std::endl;
+        return 1;
+    }
+    std::sort(thread_counts.begin(), thread_counts.end());
+    Tracing::setEnabled(false);
+
+    const bool external = options.count("command") > 0;
+    QuerySpec query;
+    if (!external) {
+        for (const auto& q : queries())
+            if (q.name == options["query"]) query = q;
+        if (!query.run) {
+            std::cerr << "Unknown --query: " << options["query"] << std::endl;
+            return 1;
+        }
+    }
+    const std::string query_name = external ? "command" : query.name;
+
+    const bool validate = options["validate"] == "on";
+    if (validate && external && !options.count("result_path")) {
+        std::cerr << "--validate with --command needs --result_path to read the answer from." << std::endl;
+        return 1;
+    }
+
+    // Raw samples (ms) of every metric, for the baseline store
+    std::map<std::string, std::vector<double>> metrics;
+
+    std::vector<Cell> cells;
+    for (double sf : scales) {
+        std::string table_path = options.count("table_path")
+            ? substitute(options["table_path"], "{sf}", formatScale(sf)) : "";
+
+        Validation::Answer expected;
+        if (validate) {
+            if (options.count("reference")) {
+                std::string reference = substitute(options["reference"], "{sf}", formatScale(sf));
+                if (!Validation::readAnswer(reference, expected)) {
+                    std::cerr << "Failed to read reference answer: " << reference << std::endl;
+                    return 1;
+                }
+            } else if (table_path.empty() || external ||
+                       !Validation::builtinAnswer(query_name, sf, expected)) {
+                // Bundled answers only hold for dbgen data; the TPC-H answer set is for SF1
+                std::cerr << "No reference answer for " << query_name << " at SF " << formatScale(sf)
+                          << (table_path.empty() ? " on generated tables" : "")
+                          << ": only the TPC-H SF1 answer on dbgen data is bundled; pass --reference." << std::endl;
+                return 1;
+            }
+        }
+
+        Tables tables;
+        if (!external) {
+            bool loaded = true;
+            if (!table_path.empty()) {
+                for (int r = 0; r < load_repetitions && loaded; r++) {
+                    tables = Tables();
+                    auto start = std::chrono::steady_clock::now();
+                    loaded = readTPCHData(table_path, tables.customer, tables.orders, tables.lineitem,
+                                          tables.supplier, tables.nation, tables.region);
+                    auto end = std::chrono::steady_clock::now();
+                    metrics["load sf=" + formatScale(sf)].push_back(
+                        std::chrono::duration<double, std::milli>(end - start).count());
+                }
+            } else {
+                DataGen::Options gen;
+                gen.scale_factor = sf;
+                gen.seed = seed;
+                gen.num_threads = thread_counts.back();
+                loaded = DataGen::generateTables(gen, tables.customer, tables.orders, tables.lineitem,
+                                                 tables.supplier, tables.nation, tables.region);
+            }
+            if (!loaded) {
+                std::cerr << "Failed to load tables for scale factor " << sf << std::endl;
+                return 1;
+            }
+        }
+
+        double baseline_ms = 0;
+        for (int threads : thread_counts) {
+            std::function<bool()> run_once;
+            std::map<std::string, double> results;
+            std::string result_path;
+            if (external) {
+                std::string command = substitute(options["command"], "{threads}", std::to_string(threads));
+                command = substitute(command, "{sf}", formatScale(sf));
+                command = substitute(command, "{table_path}", table_path);
+                run_once = [command] { return std::system(command.c_str()) == 0; };
+                if (validate) {
+                    result_path = substitute(options["result_path"], "{threads}", std::to_string(threads));
+                    result_path = substitute(result_path, "{sf}", formatScale(sf));
+                }
+            } else {
+                run_once = [&query, &tables, &results, threads] {
+                    results.clear();
+                    return query.run(threads, tables, results);
+                };
+            }
+
+            std::vector<double> samples;
+            for (int r = 0; r < warmup + repetitions; r++) {
+                auto start = std::chrono::steady_clock::now();
+                if (!run_once()) {
+                    std::cerr << "Run failed at scale factor " << sf << ", " << threads << " threads" << std::endl;
+                    return 1;
+                }
+                auto end = std::chrono::steady_clock::now();
+                const std::string cell_name = query_name + " sf=" + formatScale(sf) + " threads=" + std::to_string(threads);
+                if (r >= warmup) {
+                    samples.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+                    metrics[cell_name].push_back(samples.back());
+                }
+                if (r >= warmup && !external) {
+                    const Profiling::QueryProfile& profile = Profiling::currentQuery();
+                    for (const auto& pipeline : profile.pipelines)
+                        metrics[cell_name + " pipeline " + pipeline.name].push_back(pipeline.total_ns / 1e6);
+                    // Operators are summed by name, e.g. all INNER_JOINs of the query
+                    std::map<std::string, double> operator_ms;
+                    for (const auto& op : profile.operators) operator_ms[op.name] += op.total_ns / 1e6;
+                    for (const auto& [name, ms] : operator_ms)
+                        metrics[cell_name + " operator " + name].push_back(ms);
+                }
+
+                if (validate) {
+                    Validation::Answer actual;
+                    if (external && !Validation::readAnswer(result_path, actual)) {
+                        std::cerr << "Failed to read answer from " << result_path << std::endl;
+                        return 1;
+                    }
+                    if (!external) actual = Validation::fromResults(results);
+                    std::vector<std::string> mismatches = Validation::compare(expected, actual);
+                    if (!mismatches.empty()) {
+                        std::cerr << "VALIDATION FAILED: " << query_name << " at scale factor " << sf << ", "
+                                  << threads << " threads, " << (r < warmup ? "warmup" : "timed") << " run "
+                                  << (r < warmup ? r : r - warmup) + 1 << std::endl;
+                        for (const auto& mismatch : mismatches) std::cerr << "  " << mismatch << std::endl;
+                        std::cerr << "No timings reported." << std::endl;
+                        return 2;
+                    }
+                }
+            }
+
+            Cell cell;
+            cell.scale_factor = sf;
+            cell.threads = threads;
+            cell.time_ms = summarize(samples);
+            // Speedup relative to the smallest thread count (1 thread unless
+            // --threads leaves it out); efficiency and the Karp-Flatt serial
+            // fraction use the thread ratio to that count
+            if (baseline_ms == 0) baseline_ms = cell.time_ms.median;
+            const double ratio = static_cast<double>(threads) / thread_counts.front();
+            cell.speedup = baseline_ms / cell.time_ms.median;
+            cell.efficiency = cell.speedup / ratio;
+            if (ratio > 1)
+                cell.karp_flatt = (1.0 / cell.speedup - 1.0 / ratio) / (1.0 - 1.0 / ratio);
+            cells.push_back(cell);
+        }
+    }
+
+    if (validate) {
+        std::printf("Validation passed for %zu scale factor(s) x %zu thread count(s).\n", scales.size(),
+                    thread_counts.size());
+    }
+
+    // Human readable table; efficiency bars make scaling cliffs stand out
+    if (thread_counts.front() != 1)
+        std::printf("\nSpeedup, efficiency and serial fraction are relative to %d threads.\n", thread_counts.front());
+    std::printf("\n%-8s %-8s %7s %11s %11s %11s %8s %6s %7s  %s\n", "query", "sf", "threads", "median_ms",
+                "p25_ms", "p75_ms", "speedup", "eff", "serial", "efficiency");
+    for (size_t i = 0; i < cells.size(); i++) {
+        const Cell& c = cells[i];
+        int bar = static_cast<int>(std::round(std::min(1.0, std::max(0.0, c.efficiency)) * 20));
+        bool cliff = i > 0 && cells[i - 1].scale_factor == c.scale_factor && c.speedup <= cells[i - 1].speedup;
+        std::printf("%-8s %-8s %7d %11.2f %11.2f %11.2f %8.2f %6.2f %7.3f  %s%s\n", query_name.c_str(),
+                    formatScale(c.scale_factor).c_str(), c.threads, c.time_ms.median, c.time_ms.p25, c.time_ms.p75,
+                    c.speedup, c.efficiency, c.karp_flatt, std::string(bar, '#').c_str(),
+                    cliff ? "  <- no gain from more threads" : "");
+    }
+
+    if (options.count("csv")) {
+        std::ofstream csv(options["csv"]);
+        if (!csv.is_open()) {
+            std::cerr << "Failed to open CSV file: " << options["csv"] << std::endl;
+            return 1;
+        }
+        csv << "query,scale_factor,threads,repetitions,median_ms,min_ms,max_ms,p25_ms,p75_ms,stddev_ms,"
+               "speedup,efficiency,serial_fraction" << std::endl;
+        for (const auto& c : cells) {
+            csv << query_name << "," << c.scale_factor << "," << c.threads << "," << repetitions << ","
+                << c.time_ms.median << "," << c.time_ms.min << "," << c.time_ms.max << "," << c.time_ms.p25 << ","
+                << c.time_ms.p75 << "," << c.time_ms.stddev << "," << c.speedup << "," << c.efficiency << ","
+                << c.karp_flatt << std::endl;
+        }
+    }
+
+    if (options.count("baseline_store")) {
+        const std::string store_path = options["baseline_store"];
+        std::vector<Baseline::Run> runs;
+        if (!Baseline::loadStore(store_path, runs)) {
+            std::cerr << "Failed to read baseline store: " << store_path << std::endl;
+            return 1;
+        }
+        Baseline::Run run;
+        run.commit = options.count("commit") ? options["commit"] : Baseline::currentCommit();
+        run.machine = Baseline::machineFingerprint();
+        char timestamp[32];
+        std::time_t now = std::time(nullptr);
+        std::strftime(timestamp, sizeof(timestamp), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+        run.timestamp = timestamp;
+        run.metrics = metrics;
+
+        int regressions = 0;
+        const Baseline::Run* baseline = Baseline::findBaseline(runs, run.machine, run.commit,
+                                                               options.count("baseline_commit") ? options["baseline_commit"] : "");
+        if (!baseline) {
+            std::printf("\nNo baseline for this machine in %s yet.\n", store_path.c_str());
+        } else {
+            std::printf("\nBaseline: commit %s (%s), current: commit %s\n", baseline->commit.c_str(),
+                        baseline->timestamp.c_str(), run.commit.c_str());
+            std::printf("%-52s %11s %11s %8s %19s %7s  %s\n", "metric", "base_ms", "current_ms", "change",
+                        "ci", "p", "verdict");
+            for (const auto& [metric, samples] : run.metrics) {
+                auto it = baseline->metrics.find(metric);
+                if (it == baseline->metrics.end()) continue;
+                Baseline::Comparison c = Baseline::compare(metric, it->second, samples, threshold, alpha);
+                const char* verdict = !c.enough_samples ? "too few samples"
+                    : c.regression ? "REGRESSION" : c.improvement ? "faster" : "ok";
+                std::printf("%-52s %11.2f %11.2f %+7.1f%% [%+7.1f%%,%+7.1f%%] %7.4f  %s\n", metric.c_str(),
+                            c.baseline_median, c.current_median, 100 * c.change, 100 * c.change_low,
+                            100 * c.change_high, c.p_value, verdict);
+                if (c.regression) regressions++;
+            }
+        }
+
+        if (options["save_baseline"] != "off" && !Baseline::saveRun(store_path, runs, run)) {
+            std::cerr << "Failed to write baseline store: " << store_path << std::endl;
+            return 1;
+        }
+        if (regressions > 0) {
+            std::cerr << regressions << " metric(s) regressed by more than " << 100 * threshold
+                      << "% (p < " << alpha << ")." << std::endl;
+            return 3;
+        }
+    }
+    return 0;
+}
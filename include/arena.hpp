@@ -0,0 +1,65 @@
+#ifndef ARENA_HPP
+#define ARENA_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+
+// Per-query memory for the data structures operators build while a query
+// runs: selection vectors, join hash indexes, groups and sort keys.
+//
+// A QueryScope owns a std::pmr pool whose chunks are carved out of one
+// reserved address range with a pointer bump. Operators are handed the
+// scope's resource() and build std::pmr containers on it; nothing else
+// allocates from the arena, so results, profile records and trace buffers
+// need no special care. Freed blocks go back to the pool and are reused within
+// the query. Blocks above LARGE_BYTES (big selection vectors, hash table
+// buckets) bypass the pool and are carved straight from the range; freeing
+// them gives nothing back until the query ends. When the scope closes the
+// whole range is returned to the operating system at once. Only what no
+// longer fits in the range comes from the heap, so a query never fails
+// because of it.
+//
+// Joined rows are not arena memory: Row and Table keep the default allocator
+// throughout the engine, so the rows INNER_JOIN builds, loaded tables and
+// results live on the heap.
+
+namespace Arena {
+
+constexpr size_t LARGE_BYTES = 256 << 10;   // bigger blocks bypass the pool, not the range
+
+// Runtime switch, e.g. --arena off
+void setEnabled(bool enabled);
+bool isEnabled();
+// Size of the reserved range; only takes effect before the first query
+void setLimit(size_t bytes);
+
+// Usage of the most recent query arena
+struct Stats {
+    bool used = false;
+    uint64_t bytes = 0;              // carved from the range
+    uint64_t blocks = 0;             // pool chunks and large blocks carved from the range
+    uint64_t fallback_allocations = 0;
+};
+Stats lastQueryStats();
+
+// Opens the arena for one query. Only one query arena exists at a time; a
+// nested or concurrent scope (or --arena off) hands out the heap instead.
+class QueryScope {
+public:
+    QueryScope();
+    ~QueryScope();
+    QueryScope(const QueryScope&) = delete;
+    QueryScope& operator=(const QueryScope&) = delete;
+
+    // Thread safe; containers built on it must not outlive the scope
+    std::pmr::memory_resource* resource() const { return resource_; }
+private:
+    std::unique_ptr<std::pmr::synchronized_pool_resource> pool_;
+    std::pmr::memory_resource* resource_;
+};
+
+}
+
+#endif // ARENA_HPP
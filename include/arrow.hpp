@@ -0,0 +1,134 @@
+#ifndef ARROW_HPP
+#define ARROW_HPP
+
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "encoding.hpp"
+
+// Arrow IPC files (.arrow), read and written without the Arrow library.
+//
+// Layout (little endian, everything 8-byte aligned):
+//   "ARROW1\0\0"
+//   messages  uint32 0xFFFFFFFF, int32 metadata size, a FlatBuffers Message
+//             (the Schema, then one RecordBatch per batch), then the batch's
+//             body: per column a validity bitmap and the value buffers
+//             (int32 offsets and bytes for strings)
+//   footer    FlatBuffers Footer with the schema and the file position of
+//             every batch, int32 footer size, "ARROW1"
+//
+// A File maps the file and hands out columns that point into the mapping,
+// so nothing is converted or copied until values are read. Columns are
+// Utf8, Int32 / Int64, Float64 or Date32 (days since 1970-01-01); other
+// Arrow types, dictionary batches and compressed bodies are rejected.
+
+namespace Arrow {
+
+enum class Type { UTF8, INT32, INT64, FLOAT64, DATE32 };
+
+struct Field {
+    std::string name;
+    Type type = Type::UTF8;
+    bool nullable = true;
+};
+
+// One column of a record batch, pointing into the mapped file
+struct Column {
+    Type type = Type::UTF8;
+    int64_t length = 0;
+    int64_t null_count = 0;
+    const uint8_t* validity = nullptr;   // nullptr: no nulls
+    const int32_t* offsets = nullptr;    // UTF8: length + 1 offsets into data
+    const char* data = nullptr;
+
+    bool isNull(int64_t row) const { return validity && !((validity[row >> 3] >> (row & 7)) & 1); }
+    std::string_view text(int64_t row) const;   // UTF8 value
+    int64_t integer(int64_t row) const;         // INT32 / INT64 / DATE32 value
+    double number(int64_t row) const;           // FLOAT64 value
+    // Value as the tables hold it: dates as YYYY-MM-DD, nulls as ""
+    std::string value(int64_t row) const;
+};
+
+struct RecordBatch {
+    int64_t rows = 0;
+    std::vector<Column> columns;   // in schema order
+};
+
+class File {
+public:
+    File() = default;
+    File(const File&) = delete;
+    File& operator=(const File&) = delete;
+    ~File();
+
+    bool open(const std::string& path, std::string& error);
+    const std::vector<Field>& schema() const { return schema_; }
+    size_t batchCount() const { return batches_.size(); }
+    int64_t rows() const { return rows_; }
+    // Locates the buffers of batch `index`; they stay valid while the file is open
+    bool batch(size_t index, RecordBatch& out, std::string& error) const;
+
+private:
+    struct BlockInfo {
+        int64_t offset;
+        int32_t metadata_bytes;
+        int64_t body_bytes;
+    };
+    void unmap();
+
+    const char* data_ = nullptr;
+    uint64_t bytes_ = 0;
+    intptr_t handle_ = -1;
+    std::vector<Field> schema_;
+    std::vector<BlockInfo> batches_;
+    int64_t rows_ = 0;
+};
+
+// Values of one column of a typed batch: the pointer matching the field's
+// type holds `rows` values, text for UTF8, numbers for FLOAT64 and integers
+// for INT32 / INT64 / DATE32 (days since 1970-01-01). None are null.
+struct ColumnValues {
+    const std::string_view* text = nullptr;
+    const double* numbers = nullptr;
+    const int64_t* integers = nullptr;
+};
+
+// Streams record batches into an .arrow file
+class Writer {
+public:
+    bool open(const std::string& path, const std::vector<Field>& fields);
+    // fields holds `rows` rows in row-major order, one entry per column, as
+    // text; non-UTF8 columns are parsed (see fastparse.hpp) and "" is null
+    bool appendBatch(const std::vector<std::string>& fields, size_t rows);
+    // Same from typed columns, one per field, copied as they are
+    bool appendBatch(const std::vector<ColumnValues>& columns, size_t rows);
+    bool close();
+private:
+    // Writes the RecordBatch message of a body laid out by appendBatch
+    bool writeBatch(const std::string& body, const std::string& nodes, const std::string& buffers, size_t rows);
+
+    std::ofstream out_;
+    std::vector<Field> fields_;
+    std::vector<std::string> blocks_;   // footer Block structs of the batches written
+    uint64_t position_ = 0;
+};
+
+// Utf8 fields named `columns`
+std::vector<Field> textFields(const std::vector<std::string>& columns);
+
+// Loads the given columns of an .arrow file as rows (same shape as readTable),
+// keeping only the rows that pass `filters`
+bool readTable(const std::string& path, const std::vector<std::string>& columns,
+               std::vector<std::map<std::string, std::string>>& out,
+               const std::vector<Columnar::Filter>& filters = {});
+
+// Writes a table as Utf8 columns, one record batch per `rows_per_batch` rows
+bool writeTable(const std::string& path, const std::vector<std::string>& columns,
+                const std::vector<std::map<std::string, std::string>>& table, size_t rows_per_batch = 65536);
+
+}
+
+#endif // ARROW_HPP
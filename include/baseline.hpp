@@ -0,0 +1,66 @@
+#ifndef BASELINE_HPP
+#define BASELINE_HPP
+
+#include <map>
+#include <string>
+#include <vector>
+
+// Local store of benchmark results and regression checks against it.
+//
+// The store is one JSON file holding runs keyed by commit and machine
+// fingerprint, each with the raw samples (milliseconds) of every metric.
+// A new run is compared with the latest run of another commit on the same
+// machine: the shift is the Hodges-Lehmann estimate (median of all pairwise
+// differences) with its distribution-free confidence interval, and the
+// two-sided Mann-Whitney U test decides whether it is more than noise.
+
+namespace Baseline {
+
+struct Run {
+    std::string commit;
+    std::string machine;
+    std::string timestamp;
+    std::map<std::string, std::vector<double>> metrics;
+};
+
+// A missing file is an empty store; false only on unreadable or malformed files
+bool loadStore(const std::string& path, std::vector<Run>& runs);
+// Replaces any run with the same commit and machine, then writes the file
+bool saveRun(const std::string& path, std::vector<Run>& runs, const Run& run);
+
+// Host name, CPU model, logical CPUs and compiler
+std::string machineFingerprint();
+// Short hash of the git HEAD in the working directory, or "unknown"
+std::string currentCommit();
+
+// Latest run on the machine for `commit`, or from any commit other than
+// `current_commit` when `commit` is empty; nullptr if there is none
+const Run* findBaseline(const std::vector<Run>& runs, const std::string& machine,
+                        const std::string& current_commit, const std::string& commit);
+
+struct Comparison {
+    std::string metric;
+    size_t baseline_samples = 0;
+    size_t current_samples = 0;
+    double baseline_median = 0;
+    double current_median = 0;
+    double change = 0;           // Hodges-Lehmann shift relative to the baseline median
+    double change_low = 0;       // confidence interval of the shift, also relative
+    double change_high = 0;
+    double p_value = 1;          // two-sided Mann-Whitney U, normal approximation
+    bool enough_samples = false; // at least MIN_SAMPLES on both sides
+    bool regression = false;
+    bool improvement = false;
+};
+
+// Fewer samples can still give p < 0.05 (4 vs 4: p = 0.02), but the 95%
+// interval of the shift then spans every pairwise difference
+constexpr size_t MIN_SAMPLES = 5;
+
+// Slower by more than `threshold` (e.g. 0.05) with p < alpha is a regression
+Comparison compare(const std::string& metric, const std::vector<double>& baseline,
+                   const std::vector<double>& current, double threshold, double alpha);
+
+}
+
+#endif // BASELINE_HPP
@@ -0,0 +1,117 @@
+#ifndef BITMAP_HPP
+#define BITMAP_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+// Compressed bitmaps of row positions and bitmap indexes over them.
+//
+// A RoaringBitmap splits a 32-bit position into its high 16 bits, which pick
+// a container, and its low 16 bits, stored in the container either as a
+// sorted array of uint16 (up to 4096 values) or as a 65536-bit bitset.
+// Sparse and dense ranges thus both stay compact, and OR / AND work
+// container by container: arrays merge, bitsets combine 64 bits at a time.
+//
+// A BitmapIndex holds one bitmap per distinct value of a low-cardinality
+// column (nation keys, flags, segments), so an IN predicate is the OR of a
+// few bitmaps and never reads the column.
+
+namespace SQLEngine {
+
+class RoaringBitmap {
+public:
+    // Positions may be added in any order; ascending is fastest
+    void add(uint32_t position);
+    bool contains(uint32_t position) const;
+    uint64_t cardinality() const;
+    bool empty() const { return containers_.empty(); }
+    // One past the largest position; 0 when empty
+    uint64_t extent() const;
+
+    RoaringBitmap& operator|=(const RoaringBitmap& other);
+    RoaringBitmap& operator&=(const RoaringBitmap& other);
+
+    // Ascending positions
+    std::vector<size_t> positions() const;
+    // Bitmap of ascending or unsorted `positions`
+    static RoaringBitmap of(const size_t* positions, size_t count);
+
+    // Appends the bitmap to `out`; read() parses it back and advances `data`
+    void write(std::string& out) const;
+    bool read(const char*& data, const char* end);
+
+    size_t bytes() const;
+
+private:
+    static constexpr size_t ARRAY_MAX = 4096;
+    static constexpr size_t BITSET_WORDS = 65536 / 64;
+
+    struct Container {
+        uint16_t key = 0;
+        uint32_t cardinality = 0;
+        std::vector<uint16_t> array;   // sorted low bits while cardinality <= ARRAY_MAX
+        std::vector<uint64_t> bits;    // BITSET_WORDS words otherwise
+        bool isBitset() const { return !bits.empty(); }
+        void add(uint16_t low);
+        bool contains(uint16_t low) const;
+        void toBitset();
+        void toArrayIfSparse();
+    };
+    Container& containerFor(uint16_t key);
+    static Container unite(const Container& a, const Container& b);
+    static Container intersect(const Container& a, const Container& b);
+
+    std::vector<Container> containers_;   // ascending keys
+};
+
+class BitmapIndex {
+public:
+    BitmapIndex() = default;
+    // One bitmap per distinct value of `column` in `table`
+    BitmapIndex(const std::vector<std::map<std::string, std::string>>& table, const std::string& column);
+
+    const std::string& name() const { return name_; }
+    // Table the index was built from (or loaded for); positions are its rows
+    const void* source() const { return source_; }
+    size_t rows() const { return rows_; }
+    size_t distinctValues() const { return bitmaps_.size(); }
+    size_t bytes() const;
+
+    // Rows whose value is any of `values`
+    RoaringBitmap anyOf(const std::vector<std::string>& values) const;
+
+    void write(std::string& out) const;
+    bool read(const char*& data, const char* end, const void* source, size_t rows);
+
+private:
+    std::string name_;
+    const void* source_ = nullptr;
+    size_t rows_ = 0;
+    std::map<std::string, RoaringBitmap> bitmaps_;
+};
+
+// Bitmap indexes of the loaded tables by column name, built or read by readTPCHData
+struct BitmapIndexes {
+    std::map<std::string, BitmapIndex> columns;
+
+    // The index on `column` of `table`, if it was built for that table
+    const BitmapIndex* find(const std::vector<std::map<std::string, std::string>>& table, const std::string& column) const;
+};
+
+// Low-cardinality columns of `table` ("customer", ...) readTPCHData indexes
+const std::vector<std::string>& bitmapIndexColumns(const std::string& table);
+
+// Persist the indexes on `columns` of a table with `rows` rows to `path`, and
+// load them back; reading fails if the file holds another row count or lacks
+// a column
+bool writeBitmapIndexes(const std::string& path, const BitmapIndexes& indexes, const std::vector<std::string>& columns,
+                        size_t rows);
+bool readBitmapIndexes(const std::string& path, const std::vector<std::map<std::string, std::string>>& table,
+                       const std::vector<std::string>& columns, BitmapIndexes& indexes);
+
+}
+
+#endif // BITMAP_HPP
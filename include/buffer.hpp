@@ -0,0 +1,144 @@
+#ifndef BUFFER_HPP
+#define BUFFER_HPP
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Buffer pool over fixed-size pages of read-only files.
+//
+// A Pool owns a fixed number of page frames. pin() makes a page resident and
+// keeps it there until the returned Page is destroyed; unpinned pages are
+// evicted with the clock algorithm when a frame is needed. prefetch() queues
+// pages for a background thread, so the next pages of a scan are read while
+// the current ones are decoded. Memory use is bounded by the pool capacity
+// no matter how large the files are.
+
+namespace Buffer {
+
+constexpr size_t DEFAULT_PAGE_BYTES = 1 << 20;
+constexpr size_t MIN_FRAMES = 4;
+
+struct Stats {
+    bool used = false;
+    uint64_t capacity_bytes = 0;
+    uint64_t page_bytes = 0;
+    uint64_t pins = 0;
+    uint64_t hits = 0;            // page was resident (or being read) when pinned
+    uint64_t misses = 0;          // page was read by the pinning thread
+    uint64_t prefetched = 0;      // pages read by the prefetch thread
+    uint64_t prefetch_hits = 0;   // prefetched pages pinned before being evicted
+    uint64_t evictions = 0;
+    uint64_t bytes_read = 0;
+    uint64_t read_ns = 0;         // time spent in file reads (all threads)
+    uint64_t wait_ns = 0;         // time pins waited for a read or a free frame
+
+    void writeJSON(std::ostream& out) const;
+};
+
+class Pool;
+
+// A pinned page; unpinned when destroyed. Empty when the pin failed.
+class Page {
+public:
+    Page() = default;
+    ~Page() { release(); }
+    Page(Page&& other) noexcept { *this = std::move(other); }
+    Page& operator=(Page&& other) noexcept;
+    Page(const Page&) = delete;
+    Page& operator=(const Page&) = delete;
+
+    explicit operator bool() const { return pool_ != nullptr; }
+    const char* data() const { return data_; }
+    size_t size() const { return size_; }   // shorter than the page size at the end of a file
+private:
+    friend class Pool;
+    Page(Pool* pool, size_t frame, const char* data, size_t size)
+        : pool_(pool), frame_(frame), data_(data), size_(size) {}
+    void release();
+
+    Pool* pool_ = nullptr;
+    size_t frame_ = 0;
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+};
+
+class Pool {
+public:
+    // Capacity is rounded down to whole pages, with at least MIN_FRAMES frames
+    explicit Pool(size_t capacity_bytes, size_t page_bytes = DEFAULT_PAGE_BYTES);
+    ~Pool();
+    Pool(const Pool&) = delete;
+    Pool& operator=(const Pool&) = delete;
+
+    // Registers a file for reading; returns its id, or -1 if it cannot be opened
+    int openFile(const std::string& path);
+    uint64_t fileSize(int file) const;
+
+    // Pins a page, reading it on a miss. Blocks while every frame is pinned.
+    Page pin(int file, uint64_t page_no);
+    // Copies bytes [offset, offset + bytes) of a file, one pinned page at a time
+    bool read(int file, uint64_t offset, uint64_t bytes, char* out);
+    // Queues the pages covering a byte range for the prefetch thread
+    void prefetch(int file, uint64_t offset, uint64_t bytes);
+
+    size_t pageBytes() const { return page_bytes_; }
+    size_t frameCount() const { return frames_.size(); }
+    Stats stats() const;
+
+private:
+    friend class Page;
+    enum class State { EMPTY, LOADING, READY };
+
+    struct Frame {
+        uint64_t key = 0;
+        State state = State::EMPTY;
+        uint32_t pins = 0;
+        bool referenced = false;     // clock bit
+        bool prefetched = false;     // read ahead and not pinned yet
+        size_t size = 0;
+    };
+
+    struct File {
+        std::string path;
+        intptr_t handle = -1;
+        uint64_t size = 0;
+    };
+
+    static uint64_t pageKey(int file, uint64_t page_no) { return (uint64_t(file) << 40) | page_no; }
+    char* frameData(size_t frame) { return memory_.get() + frame * page_bytes_; }
+    // Clock sweep over unpinned frames; frames_.size() when none is free. Caller holds mutex_.
+    size_t findVictim();
+    // Reads a page into a frame claimed by the caller (state LOADING); takes and returns the lock
+    bool load(std::unique_lock<std::mutex>& lock, size_t frame, int file, uint64_t page_no);
+    void unpin(size_t frame);
+    void prefetchLoop();
+
+    size_t page_bytes_;
+    std::unique_ptr<char[]> memory_;
+    std::vector<Frame> frames_;
+    std::vector<File> files_;
+    std::unordered_map<uint64_t, size_t> page_table_;
+    size_t clock_hand_ = 0;
+    Stats stats_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable changed_;   // a read finished or a frame was unpinned
+    std::condition_variable queued_;    // prefetch work or shutdown
+    std::deque<std::pair<int, uint64_t>> prefetch_queue_;
+    bool stopping_ = false;
+    std::thread prefetch_thread_;
+};
+
+}
+
+#endif // BUFFER_HPP
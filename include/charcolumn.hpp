@@ -0,0 +1,72 @@
+#ifndef CHARCOLUMN_HPP
+#define CHARCOLUMN_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Fixed-width storage for short strings such as TPC-H CHAR(n) columns.
+//
+// Every value is stored inline, NUL padded to a stride that is a multiple of
+// 16 bytes, in one contiguous byte array. Equality and prefix tests compare
+// 16 bytes at a time (SSE2 when the target has it) against a padded copy of
+// the constant, and grouping keys on views of the stored bytes (up to the
+// padding), so neither looks the column up in a row map. Values must not
+// contain NUL bytes. Rows without the column match no predicate and belong to
+// no group, as with the row-at-a-time operators.
+//
+// A column is either copied out of a finished table or built with append()
+// by the code that adds the table's rows, so the values are never read back
+// out of the row maps.
+
+namespace SQLEngine {
+
+constexpr size_t CHAR_LANE_BYTES = 16;
+
+class CharColumn {
+public:
+    CharColumn() = default;
+    // Copies `column` out of every row of `table`. The stride fits the declared
+    // CHAR(n) width (TPCH::charWidth) or the longest value, whichever is larger.
+    CharColumn(const std::vector<std::map<std::string, std::string>>& table, const std::string& column);
+    // Empty column of `table`, which must be empty too; append() the value of
+    // each row as it is added to the table
+    static CharColumn growing(const std::vector<std::map<std::string, std::string>>& table, const std::string& column);
+
+    // Adds the next row's value; a value longer than the stride widens it
+    void append(std::string_view value);
+
+    const std::string& name() const { return name_; }
+    // Table the column was built from; rows line up with its rows
+    const void* source() const { return source_; }
+    size_t size() const { return rows_; }
+    size_t stride() const { return stride_; }
+    std::string_view at(size_t row) const;
+    // False for a row of the source table that lacks the column
+    bool has(size_t row) const { return present_.empty() || present_[row]; }
+
+    // Append to `out` the rows (positions in the source table) whose value
+    // equals / starts with `value`. `rows` lists the candidate rows; nullptr
+    // means rows [0, count).
+    void selectEqual(std::string_view value, const size_t* rows, size_t count, std::pmr::vector<size_t>& out) const;
+    void selectPrefix(std::string_view prefix, const size_t* rows, size_t count, std::pmr::vector<size_t>& out) const;
+
+private:
+    const char* value(size_t row) const { return bytes_.data() + row * stride_; }
+    void widen(size_t width);
+
+    std::string name_;
+    const void* source_ = nullptr;
+    size_t rows_ = 0;
+    size_t stride_ = CHAR_LANE_BYTES;
+    std::vector<char> bytes_;
+    std::vector<uint8_t> present_;   // empty when every row has the column
+};
+
+}
+
+#endif // CHARCOLUMN_HPP
@@ -0,0 +1,74 @@
+#ifndef CLUSTER_HPP
+#define CLUSTER_HPP
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "encoding.hpp"
+
+// Shared-nothing multi-process execution of Query 5.
+//
+// orders and lineitem are hash partitioned on the order key (O_ORDERKEY and
+// L_ORDERKEY hash alike, so every lineitem lives with its order); customer,
+// supplier, nation and region are small and every worker loads them whole.
+// Each worker runs Q5 on its partition and sends its per-nation revenue to
+// the coordinator over a TCP connection; the coordinator adds the partials.
+// Because a nation's revenue is a plain sum over lineitems, the merged
+// result equals a single-process run.
+
+namespace Cluster {
+
+// The hash partition of orders and lineitem one process owns
+struct Partition {
+    int index = 0;
+    int count = 1;
+
+    bool whole() const { return count <= 1; }
+    bool owns(std::string_view order_key) const { return whole() || indexOf(order_key, count) == index; }
+    // Partition of `order_key` among `count`; tpch_partition files use it too
+    static int indexOf(std::string_view order_key, int count);
+    // Filter passing the rows whose `key_column` this partition owns; readers
+    // apply it while decoding, so other partitions' rows are never built
+    Columnar::Filter ownedRows(const std::string& key_column) const;
+};
+
+// Listens on the loopback interface and gathers the workers' partial results
+class Coordinator {
+public:
+    Coordinator() = default;
+    Coordinator(const Coordinator&) = delete;
+    Coordinator& operator=(const Coordinator&) = delete;
+    ~Coordinator();
+
+    // port 0 picks a free port
+    bool listen(int port);
+    int port() const { return port_; }
+    // "127.0.0.1:<port>", the --coordinator value for workers
+    std::string address() const;
+
+    // Starts `workers` copies of `program` with `args` plus --worker i; they
+    // are waited for in gather()
+    bool spawn(const std::string& program, const std::vector<std::string>& args, int workers);
+
+    // Waits for one partial result from each of `workers` workers and adds
+    // them into `results` in worker order. Fails if a spawned worker exits
+    // without reporting or nothing arrives for `timeout_s` seconds.
+    bool gather(int workers, double timeout_s, std::map<std::string, double>& results);
+
+private:
+    bool spawnedFailed();
+    bool waitSpawned();
+
+    intptr_t socket_ = -1;
+    int port_ = 0;
+    std::vector<intptr_t> processes_;
+};
+
+// Sends a worker's per-nation revenue to the coordinator at "host:port"
+bool sendPartial(const std::string& address, int worker, const std::map<std::string, double>& results);
+
+}
+
+#endif // CLUSTER_HPP
@@ -0,0 +1,122 @@
+#ifndef COLUMNAR_HPP
+#define COLUMNAR_HPP
+
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+#include "buffer.hpp"
+#include "encoding.hpp"
+
+// Binary columnar table files (.col).
+//
+// Layout (little endian):
+//   header      "TPCHCOL1", uint32 version, uint32 column count,
+//               column names as (uint32 length, bytes)
+//   row groups  one chunk per column; version 2 chunks are tagged with their
+//               encoding (see encoding.hpp), version 1 chunks are untagged
+//               PLAIN: uint32 offsets[rows + 1] relative to the start of the
+//               column's data, followed by the data bytes
+//   footer      uint64 row group count, per row group: uint64 rows and
+//               per column (uint64 file offset, uint64 bytes) of its chunk;
+//               uint64 total rows, uint64 footer offset, "TPCHCOL1"
+//
+// Values decode to the same strings the .tbl files hold, so loading a .col
+// file yields exactly the rows readTable() produces. Both versions are read.
+
+namespace Columnar {
+
+constexpr uint32_t VERSION = 2;
+constexpr size_t DEFAULT_ROW_GROUP_ROWS = 65536;
+
+struct ColumnChunk {
+    uint64_t offset;   // file offset of the chunk
+    uint64_t bytes;
+};
+
+struct RowGroupInfo {
+    uint64_t rows;
+    std::vector<ColumnChunk> columns;
+};
+
+struct FileInfo {
+    uint32_t version = VERSION;
+    std::vector<std::string> columns;
+    std::vector<RowGroupInfo> row_groups;
+    uint64_t total_rows = 0;
+};
+
+// Streams row groups into a .col file
+class Writer {
+public:
+    bool open(const std::string& path, const std::vector<std::string>& columns);
+    // fields holds `rows` rows in row-major order, one entry per column
+    bool appendRowGroup(const std::vector<std::string>& fields, size_t rows);
+    // Appends rows [start, start + count) of a table as one row group
+    bool appendRows(const std::vector<std::map<std::string, std::string>>& table, size_t start, size_t count);
+    bool close();
+private:
+    std::ofstream out_;
+    FileInfo info_;
+    uint64_t position_ = 0;
+    std::vector<char> chunk_;
+};
+
+bool readFileInfo(const std::string& path, FileInfo& info);
+
+// Loads the given columns of a .col file as rows (same shape as readTable).
+// With `filters`, only the rows that pass them are decoded.
+bool readTable(const std::string& path, const std::vector<std::string>& columns,
+               std::vector<std::map<std::string, std::string>>& out, const std::vector<Filter>& filters = {});
+
+// Same, from the image of a .col file in memory (e.g. a shared-memory segment)
+bool readTable(const char* data, uint64_t bytes, const std::vector<std::string>& columns,
+               std::vector<std::map<std::string, std::string>>& out, const std::vector<Filter>& filters = {});
+
+// Streams the given columns of a .col file one row group at a time through a
+// buffer pool, so tables larger than memory can be scanned. The chunks of the
+// next row group are prefetched while the current one is decoded.
+//
+// Filters are evaluated on the encoded chunks of their columns first; row
+// groups with no surviving row are skipped and only surviving rows of the
+// other columns are decoded.
+class Scanner {
+public:
+    bool open(const std::string& path, const std::vector<std::string>& columns, Buffer::Pool& pool,
+              const std::vector<Filter>& filters = {});
+    // Replaces `rows` with the surviving rows of the next row group that has
+    // any; false at the end or on a read error (see failed())
+    bool next(std::vector<std::map<std::string, std::string>>& rows);
+    // Adds `column` of every surviving row in the remaining row groups to
+    // `total` without decoding rows
+    bool sum(const std::string& column, double& total);
+    bool failed() const { return failed_; }
+    uint64_t totalRows() const { return info_.total_rows; }
+private:
+    void prefetchGroup(size_t group);
+    // Runs the filters on a row group; all = true when there are none
+    bool selectRows(const RowGroupInfo& group, std::vector<uint32_t>& selection, bool& all);
+    bool readChunk(const ColumnChunk& chunk);
+
+    Buffer::Pool* pool_ = nullptr;
+    int file_ = -1;
+    FileInfo info_;
+    std::vector<std::string> columns_;
+    std::vector<size_t> wanted_;
+    std::vector<Filter> filters_;
+    std::vector<size_t> filter_columns_;
+    std::vector<uint32_t> selection_;
+    size_t next_group_ = 0;
+    bool failed_ = false;
+    std::vector<char> buffer_;
+    std::vector<std::string> values_;
+};
+
+bool writeTable(const std::string& path, const std::vector<std::string>& columns,
+                const std::vector<std::map<std::string, std::string>>& table,
+                size_t rows_per_group = DEFAULT_ROW_GROUP_ROWS);
+
+}
+
+#endif // COLUMNAR_HPP
@@ -0,0 +1,56 @@
+#ifndef DATAGEN_HPP
+#define DATAGEN_HPP
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+// Deterministic TPC-H data generator.
+//
+// Follows the dbgen specification for the six tables the engine reads:
+// cardinalities per scale factor, sparse order keys, the customer "mortality"
+// rule (custkey % 3 == 0 places no orders), part/supplier bridging of
+// L_SUPPKEY, retail price derived extended prices, date rules for
+// ship/commit/receipt dates, return flags and line/order status. The values
+// come from this generator's own random streams, not dbgen's, and comment
+// text is random words: the tables have dbgen's shape and distributions but
+// are not the TPC-H reference data, and query answers on them differ from
+// the TPC-H reference answers.
+//
+// Rows are produced in fixed-size blocks, each with its own random stream
+// derived from the seed and block number. Threads split the blocks (i.e. the
+// key ranges) among themselves, so the output does not depend on the number
+// of threads.
+
+namespace DataGen {
+
+enum class OutputFormat { TBL, COLUMNAR, ARROW };
+
+struct Options {
+    double scale_factor = 1.0;
+    uint64_t seed = 19920101;
+    int num_threads = 1;
+    bool statistics = false;   // generateFiles also writes <table>.stats.json, updated per row group
+};
+
+// Row counts of the base tables at a scale factor
+uint64_t customerCount(double scale_factor);
+uint64_t supplierCount(double scale_factor);
+uint64_t orderCount(double scale_factor);
+
+// Writes <table>.tbl, <table>.col or <table>.arrow files for all six tables into output_dir
+bool generateFiles(const Options& options, const std::string& output_dir, OutputFormat format);
+
+// Generates the six tables in memory
+bool generateTables(const Options& options,
+                    std::vector<std::map<std::string, std::string>>& customer_data,
+                    std::vector<std::map<std::string, std::string>>& orders_data,
+                    std::vector<std::map<std::string, std::string>>& lineitem_data,
+                    std::vector<std::map<std::string, std::string>>& supplier_data,
+                    std::vector<std::map<std::string, std::string>>& nation_data,
+                    std::vector<std::map<std::string, std::string>>& region_data);
+
+}
+
+#endif // DATAGEN_HPP
@@ -0,0 +1,73 @@
+#ifndef ENCODING_HPP
+#define ENCODING_HPP
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Column chunk encodings of .col files (version 2) and kernels that filter
+// and aggregate encoded chunks without decoding them.
+//
+// Every chunk starts with a uint32 encoding tag:
+//   PLAIN  uint32 offsets[rows + 1] relative to the data, data bytes
+//          (the whole chunk layout of version 1 files)
+//   DICT   uint32 entries, uint32 offsets[entries + 1], entry bytes sorted
+//          ascending, uint32 bit width, bit-packed codes
+//   INT    uint32 scale, uint32 bit width, int64 base, bit-packed (value - base)
+//   RLE    uint32 scale, uint32 bit width, int64 base, uint32 runs,
+//          uint32 run_ends[runs], bit-packed (run value - base)
+// INT and RLE store decimal strings as integers scaled by 10^scale; the
+// writer only picks them when every value formats back to the same string.
+// Bit-packed arrays are little-endian uint64 words plus one padding word.
+
+namespace Columnar {
+
+enum class Encoding : uint32_t { PLAIN = 0, DICT = 1, INT = 2, RLE = 3 };
+
+// Predicate pushed down into a scan
+struct Filter {
+    enum class Kind { RANGE, IN, TEST };
+    std::string column;
+    Kind kind = Kind::RANGE;
+    bool numeric = false;              // compare as decimal numbers instead of strings
+    std::string low, high;             // RANGE: low <= value < high; an empty bound is open
+    std::vector<std::string> values;   // IN
+    std::function<bool(std::string_view)> test;   // TEST: any predicate on the text value; never numeric
+
+    // Reference semantics on a decoded value
+    bool matches(std::string_view value) const;
+};
+
+// Encodes values[r * stride + column] for r < rows with the smallest applicable
+// encoding; false if no encoding can hold the chunk (over 4 GB of strings)
+bool encodeChunk(const std::vector<std::string>& values, size_t column, size_t stride, size_t rows,
+                 std::vector<char>& out);
+
+// Encoding of a chunk; PLAIN for anything unrecognised
+Encoding chunkEncoding(const char* chunk, uint64_t bytes);
+
+// Decodes a version 1 chunk (no tag) into strings appended to `values`
+bool decodePlain(const char* chunk, uint64_t bytes, uint64_t rows, std::vector<std::string>& values);
+
+// Decodes every row of a chunk into strings appended to `values`
+bool decodeChunk(const char* chunk, uint64_t bytes, uint64_t rows, std::vector<std::string>& values);
+
+// Decodes only the rows in `selection` (ascending positions in the chunk)
+bool decodeRows(const char* chunk, uint64_t bytes, uint64_t rows, const std::vector<uint32_t>& selection,
+                std::vector<std::string>& values);
+
+// Keeps the rows of `selection` that pass the filter; with `all` the
+// selection starts out as every row of the chunk
+bool filterChunk(const char* chunk, uint64_t bytes, uint64_t rows, const Filter& filter, bool all,
+                 std::vector<uint32_t>& selection);
+
+// Adds the values of the selected rows (nullptr: all rows) to `sum`; runs
+// and dictionary codes are counted, not expanded
+bool sumChunk(const char* chunk, uint64_t bytes, uint64_t rows, const std::vector<uint32_t>* selection,
+              double& sum);
+
+}
+
+#endif // ENCODING_HPP
@@ -0,0 +1,163 @@
+#ifndef FASTPARSE_HPP
+#define FASTPARSE_HPP
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+// Parsers for the numeric text of TPC-H tables: integer keys, NNNN.NN
+// decimals and YYYY-MM-DD dates.
+//
+// std::stod / std::stoi go through the locale and a general-purpose float
+// parser on every call. These kernels instead load up to eight digits into a
+// 64-bit word and check and convert them together (SWAR: three multiplies
+// per eight digits), and return fixed-point and day-number values directly.
+// Each returns false for text outside its format so callers can fall back.
+
+namespace FastParse {
+
+namespace detail {
+
+// `count` (<= 8) characters as a word with the first in the lowest byte,
+// right-aligned and padded with '0'. Shifting them in is about twice as fast
+// as a variable-length memcpy and does not depend on the byte order.
+inline uint64_t loadDigits(const char* text, size_t count) {
+    uint64_t chunk = 0x3030303030303030ULL;
+    for (size_t i = 0; i < count; i++) chunk = (chunk >> 8) | (uint64_t(static_cast<unsigned char>(text[i])) << 56);
+    return chunk;
+}
+
+inline bool allDigits(uint64_t chunk) {
+    // Every byte is 0x30..0x39: high nibble 3, and adding 6 keeps it 3
+    return ((chunk & 0xF0F0F0F0F0F0F0F0ULL) | (((chunk + 0x0606060606060606ULL) & 0xF0F0F0F0F0F0F0F0ULL) >> 4)) ==
+           0x3333333333333333ULL;
+}
+
+// Value of eight digits, combining neighbouring digits, then pairs, then quads
+inline uint32_t eightDigits(uint64_t chunk) {
+    chunk = ((chunk & 0x0F0F0F0F0F0F0F0FULL) * 2561) >> 8;
+    chunk = ((chunk & 0x00FF00FF00FF00FFULL) * 6553601) >> 16;
+    return static_cast<uint32_t>(((chunk & 0x0000FFFF0000FFFFULL) * 42949672960001ULL) >> 32);
+}
+
+// Up to 16 digits
+inline bool unsignedDigits(const char* text, size_t count, uint64_t& value) {
+    if (count == 0 || count > 16) return false;
+    if (count <= 8) {
+        uint64_t chunk = loadDigits(text, count);
+        if (!allDigits(chunk)) return false;
+        value = eightDigits(chunk);
+        return true;
+    }
+    uint64_t high = loadDigits(text, count - 8);
+    uint64_t low = loadDigits(text + count - 8, 8);
+    if (!allDigits(high) || !allDigits(low)) return false;
+    value = uint64_t(eightDigits(high)) * 100000000 + eightDigits(low);
+    return true;
+}
+
+constexpr uint64_t POW10[] = {1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL,
+                              100000000ULL, 1000000000ULL, 10000000000ULL, 100000000000ULL, 1000000000000ULL,
+                              10000000000000ULL, 100000000000000ULL, 1000000000000000ULL};
+
+}
+
+// [-]digits with at most 16 digits
+inline bool parseInt(std::string_view text, int64_t& value) {
+    bool negative = !text.empty() && text[0] == '-';
+    uint64_t magnitude = 0;
+    if (!detail::unsignedDigits(text.data() + negative, text.size() - negative, magnitude)) return false;
+    value = negative ? -static_cast<int64_t>(magnitude) : static_cast<int64_t>(magnitude);
+    return true;
+}
+
+// [-]digits[.digits] as value * 10^-scale (scale <= 8), e.g. "1234.5" -> 123450
+// at scale 2; false for more than `scale` fraction digits or more than 16
+// integer digits
+inline bool parseFixed(std::string_view text, uint32_t scale, int64_t& value) {
+    if (scale > 8) return false;
+    bool negative = !text.empty() && text[0] == '-';
+    const char* begin = text.data() + negative;
+    size_t size = text.size() - negative;
+    const char* dot = static_cast<const char*>(std::memchr(begin, '.', size));
+    size_t integer_digits = dot ? static_cast<size_t>(dot - begin) : size;
+    size_t fraction_digits = dot ? size - integer_digits - 1 : 0;
+    if ((dot && fraction_digits == 0) || fraction_digits > scale || integer_digits + scale > 18) return false;
+    uint64_t integer = 0, fraction = 0;
+    if (!detail::unsignedDigits(begin, integer_digits, integer)) return false;
+    if (fraction_digits && !detail::unsignedDigits(dot + 1, fraction_digits, fraction)) return false;
+    uint64_t magnitude = integer * detail::POW10[scale] + fraction * detail::POW10[scale - fraction_digits];
+    value = negative ? -static_cast<int64_t>(magnitude) : static_cast<int64_t>(magnitude);
+    return true;
+}
+
+// Days from 1970-01-01 to a proleptic Gregorian date
+inline int32_t daysFromCivil(int32_t year, uint32_t month, uint32_t day) {
+    year -= month <= 2;
+    const int32_t era = (year >= 0 ? year : year - 399) / 400;
+    const uint32_t year_of_era = static_cast<uint32_t>(year - era * 400);
+    const uint32_t day_of_year = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+    const uint32_t day_of_era = year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_year;
+    return era * 146097 + static_cast<int32_t>(day_of_era) - 719468;
+}
+
+// Inverse of daysFromCivil
+inline void civilFromDays(int32_t days, int32_t& year, uint32_t& month, uint32_t& day) {
+    const int64_t z = int64_t(days) + 719468;
+    const int64_t era = (z >= 0 ? z : z - 146096) / 146097;
+    const uint32_t day_of_era = static_cast<uint32_t>(z - era * 146097);
+    const uint32_t year_of_era = (day_of_era - day_of_era / 1460 + day_of_era / 36524 - day_of_era / 146096) / 365;
+    const uint32_t day_of_year = day_of_era - (365 * year_of_era + year_of_era / 4 - year_of_era / 100);
+    const uint32_t shifted_month = (5 * day_of_year + 2) / 153;
+    day = day_of_year - (153 * shifted_month + 2) / 5 + 1;
+    month = shifted_month < 10 ? shifted_month + 3 : shifted_month - 9;
+    year = static_cast<int32_t>(int64_t(year_of_era) + era * 400) + (month <= 2);
+}
+
+// YYYY-MM-DD as days since 1970-01-01; false unless a valid date in that form
+inline bool parseDate(std::string_view text, int32_t& days) {
+    if (text.size() != 10 || text[4] != '-' || text[7] != '-') return false;
+    // The eight digits YYYYMMDD in one word, as loadDigits lays them out
+    static constexpr int POSITIONS[] = {0, 1, 2, 3, 5, 6, 8, 9};
+    uint64_t chunk = 0;
+    for (int i = 0; i < 8; i++) chunk |= uint64_t(static_cast<unsigned char>(text[POSITIONS[i]])) << (8 * i);
+    if (!detail::allDigits(chunk)) return false;
+    uint32_t date = detail::eightDigits(chunk);
+    uint32_t year = date / 10000, month = date / 100 % 100, day = date % 100;
+    static constexpr uint8_t MONTH_DAYS[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    bool leap = year % 4 == 0 && (year % 100 != 0 || year % 400 == 0);
+    if (month < 1 || month > 12 || day < 1 || day > MONTH_DAYS[month - 1] + (month == 2 && leap ? 1u : 0u)) return false;
+    days = daysFromCivil(static_cast<int32_t>(year), month, day);
+    return true;
+}
+
+// A number as double, bit-identical to std::strtod. Plain decimals with up to
+// 15 significant digits take the fixed-point path: the digits are an exact
+// double and so is the power of ten, so one (correctly rounded) division
+// gives the correctly rounded value. Anything else goes to strtod.
+inline double toDouble(std::string_view text) {
+    bool negative = !text.empty() && text[0] == '-';
+    const char* begin = text.data() + negative;
+    size_t size = text.size() - negative;
+    const char* dot = static_cast<const char*>(std::memchr(begin, '.', size));
+    size_t integer_digits = dot ? static_cast<size_t>(dot - begin) : size;
+    size_t fraction_digits = dot ? size - integer_digits - 1 : 0;
+    uint64_t integer = 0, fraction = 0;
+    if (integer_digits + fraction_digits <= 15 && detail::unsignedDigits(begin, integer_digits, integer) &&
+        (!dot || detail::unsignedDigits(dot + 1, fraction_digits, fraction))) {
+        double value = static_cast<double>(integer * detail::POW10[fraction_digits] + fraction) /
+                       static_cast<double>(detail::POW10[fraction_digits]);
+        return negative ? -value : value;
+    }
+    char buffer[64];
+    if (text.size() >= sizeof(buffer)) return std::strtod(std::string(text).c_str(), nullptr);
+    std::memcpy(buffer, text.data(), text.size());
+    buffer[text.size()] = '\0';
+    return std::strtod(buffer, nullptr);
+}
+
+}
+
+#endif // FASTPARSE_HPP
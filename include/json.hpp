@@ -0,0 +1,52 @@
+#ifndef JSON_HPP
+#define JSON_HPP
+
+#include <string>
+#include <cstdio>
+#include <utility>
+#include <vector>
+
+// Escape a string for use inside a JSON string literal (quotes included)
+inline std::string jsonQuote(const std::string& str) {
+    std::string out;
+    out.reserve(str.size() + 2);
+    out += '"';
+    for (char c : str) {
+        switch (c) {
+            case '"':  out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    char buf[8];
+                    std::snprintf(buf, sizeof(buf), "\\u%04x", c);
+                    out += buf;
+                } else {
+                    out += c;
+                }
+        }
+    }
+    out += '"';
+    return out;
+}
+
+// Minimal JSON document model, enough to read back the files this project writes
+struct JsonValue {
+    enum Type { NUL, BOOLEAN, NUMBER, STRING, ARRAY, OBJECT };
+    Type type = NUL;
+    bool boolean = false;
+    double number = 0;
+    std::string string;
+    std::vector<JsonValue> array;
+    std::vector<std::pair<std::string, JsonValue>> object;  // in document order
+
+    // Member of an object, nullptr if missing or not an object
+    const JsonValue* find(const std::string& key) const;
+};
+
+// Parses a complete JSON document; false on syntax errors or trailing garbage
+bool parseJson(const std::string& text, JsonValue& value);
+
+#endif // JSON_HPP
@@ -0,0 +1,77 @@
+#ifndef MEMTRACK_HPP
+#define MEMTRACK_HPP
+
+#include <cstdint>
+#include <ostream>
+
+// Heap allocation accounting for profiling builds.
+//
+// With TPCH_ENABLE_PROFILING the global operator new/delete are replaced by
+// versions that put a 16 byte header in front of every block, recording its
+// size and the tag that was active on the allocating thread. A tag is opened
+// by a Scope (one per operator or table load) and attached to worker threads
+// with Attach, so every container the engine builds is charged to the
+// operator that allocated it, including memory freed later by someone else.
+// Without profiling nothing is replaced and every count is zero.
+
+namespace MemTrack {
+
+// Allocation counters of one tag, or of the whole process
+struct Counts {
+    uint64_t allocated_bytes = 0;
+    uint64_t allocations = 0;       // operator new calls, i.e. malloc calls
+    uint64_t frees = 0;
+    int64_t live_bytes = 0;         // allocated and not yet freed
+    int64_t peak_bytes = 0;         // high-water mark of live_bytes
+
+    void writeJSON(std::ostream& out, uint64_t rows) const;
+};
+
+constexpr bool enabled() {
+#ifdef TPCH_ENABLE_PROFILING
+    return true;
+#else
+    return false;
+#endif
+}
+
+// Opens a fresh tag with zeroed counters (0 when tracking is disabled)
+uint32_t openTag();
+Counts read(uint32_t tag);
+
+// Tag charged for allocations of the calling thread; returns the previous one
+uint32_t setCurrentTag(uint32_t tag);
+
+// Whole process; resetPeak() restarts the high-water mark at the live size
+Counts process();
+void resetPeak();
+
+// Opens a tag and makes it current on this thread until the end of the scope
+class Scope {
+public:
+    Scope() : tag_(openTag()), previous_(setCurrentTag(tag_)) {}
+    ~Scope() { setCurrentTag(previous_); }
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+    uint32_t tag() const { return tag_; }
+    Counts counts() const { return read(tag_); }
+private:
+    uint32_t tag_;
+    uint32_t previous_;
+};
+
+// Charges a worker thread's allocations to an existing tag
+class Attach {
+public:
+    explicit Attach(uint32_t tag) : previous_(setCurrentTag(tag)) {}
+    ~Attach() { setCurrentTag(previous_); }
+    Attach(const Attach&) = delete;
+    Attach& operator=(const Attach&) = delete;
+private:
+    uint32_t previous_;
+};
+
+}
+
+#endif // MEMTRACK_HPP
@@ -0,0 +1,102 @@
+#ifndef PARQUET_HPP
+#define PARQUET_HPP
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+#include "encoding.hpp"
+
+// Parquet files (.parquet), read without a Parquet library.
+//
+// Layout: "PAR1", per row group and column a chunk of pages (an optional
+// dictionary page, then data pages), the Thrift compact-encoded FileMetaData
+// with the schema and the file position and min / max of every chunk,
+// uint32 metadata size, "PAR1".
+//
+// Covered: flat schemas of required and optional columns, uncompressed
+// pages (data page v1 and v2), PLAIN, RLE / bit-packed and dictionary
+// encodings. Values decode to the text the .tbl files hold: strings as is,
+// integers, DATE as YYYY-MM-DD and DECIMAL with its scale's digits (so
+// "5.00"); nulls are "". Compressed chunks, nested or repeated columns,
+// INT96 and the DELTA / BYTE_STREAM_SPLIT encodings are rejected.
+
+namespace Parquet {
+
+enum class Type { BOOLEAN, INT32, INT64, INT96, FLOAT, DOUBLE, BYTE_ARRAY, FIXED_LEN_BYTE_ARRAY };
+
+struct ColumnInfo {
+    std::string name;
+    Type type = Type::BYTE_ARRAY;
+    int32_t type_length = 0;   // FIXED_LEN_BYTE_ARRAY
+    bool optional = false;
+    bool date = false;         // INT32 days since 1970-01-01
+    int32_t scale = -1;        // DECIMAL scale; -1: not a decimal
+};
+
+struct ChunkInfo {
+    int64_t offset = 0;        // first page (the dictionary page, if any)
+    int64_t bytes = 0;
+    int64_t values = 0;
+    int32_t codec = 0;         // 0: uncompressed
+    bool has_bounds = false;
+    std::string min, max;      // formatted as the values are
+};
+
+struct RowGroupInfo {
+    int64_t rows = 0;
+    std::vector<ChunkInfo> columns;   // in schema order
+};
+
+struct FileInfo {
+    std::vector<ColumnInfo> columns;
+    std::vector<RowGroupInfo> row_groups;
+    int64_t total_rows = 0;
+};
+
+// Maps a file and decodes its row groups
+class File {
+public:
+    File() = default;
+    File(const File&) = delete;
+    File& operator=(const File&) = delete;
+    ~File();
+
+    bool open(const std::string& path, std::string& error);
+    const FileInfo& info() const { return info_; }
+    // False when the min / max of row group `group` show that no row passes
+    // `filters` (filters on other columns are ignored)
+    bool mayMatch(size_t group, const std::vector<Columnar::Filter>& filters) const;
+    // Appends the rows of row group `group` that pass `filters`, with the
+    // columns at `columns` (schema positions) named `names`. Safe to call
+    // from several threads.
+    bool readRowGroup(size_t group, const std::vector<size_t>& columns, const std::vector<std::string>& names,
+                      const std::vector<Columnar::Filter>& filters,
+                      std::vector<std::map<std::string, std::string>>& out, std::string& error) const;
+
+private:
+    void unmap();
+
+    const char* data_ = nullptr;
+    uint64_t bytes_ = 0;
+    intptr_t handle_ = -1;
+    FileInfo info_;
+};
+
+// Passes the surviving rows of every row group, in file order, to `consume`.
+// Row groups are skipped by their min / max and decoded by up to `threads`
+// threads, `threads` row groups at a time.
+bool scan(const std::string& path, const std::vector<std::string>& columns,
+          const std::vector<Columnar::Filter>& filters, int threads,
+          const std::function<void(std::vector<std::map<std::string, std::string>>&)>& consume, std::string& error);
+
+// Loads the given columns of a .parquet file as rows (same shape as readTable),
+// keeping only the rows that pass `filters`
+bool readTable(const std::string& path, const std::vector<std::string>& columns,
+               std::vector<std::map<std::string, std::string>>& out, int threads = 1,
+               const std::vector<Columnar::Filter>& filters = {});
+
+}
+
+#endif // PARQUET_HPP
@@ -0,0 +1,67 @@
+#ifndef PARTITIONING_HPP
+#define PARTITIONING_HPP
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Partitioned table layout written by tpch_partition.
+//
+// orders and lineitem are hash partitioned on the order key with the hash of
+// Cluster::Partition, so lineitem partition h only joins orders partition h.
+// orders is further range partitioned on O_ORDERDATE, so a date predicate
+// skips whole partitions. The other tables keep one file each.
+//
+//   partitions.manifest         "tpch-partitions <version>",
+//                               "hash_partitions <n>",
+//                               "orders_date_bounds <date> <date> ..."
+//   orders/h<h>_r<r>.col        hash partition h, date range r
+//   lineitem/h<h>.col           hash partition h
+//   <table>.col                 every other table
+//
+// Date range r holds bounds[r - 1] <= O_ORDERDATE < bounds[r]; the first and
+// last ranges are open ended.
+
+namespace Partitioning {
+
+constexpr int VERSION = 1;
+constexpr const char* MANIFEST = "partitions.manifest";
+
+struct Layout {
+    int hash_partitions = 1;
+    std::vector<std::string> date_bounds;   // ascending
+
+    size_t dateRanges() const { return date_bounds.size() + 1; }
+    // Date range holding `date`
+    size_t dateRange(const std::string& date) const;
+    // Whether range r may hold / only holds dates in [start, end)
+    bool overlaps(size_t r, const std::string& start, const std::string& end) const;
+    bool within(size_t r, const std::string& start, const std::string& end) const;
+
+    static std::string ordersFile(const std::string& directory, int h, size_t r);
+    static std::string lineitemFile(const std::string& directory, int h);
+};
+
+bool readLayout(const std::string& directory, Layout& layout);
+bool writeLayout(const std::string& directory, const Layout& layout);
+
+// orders and lineitem of a partitioned table directory, loaded by readTPCHData
+struct PartitionedTables {
+    std::string directory;
+    Layout layout;
+    // Date range of the query; orders date ranges outside it are not loaded
+    std::string start_date, end_date;
+    // orders[h][r]: hash partition h, date range r; lineitem[h]: hash partition h
+    std::vector<std::vector<std::vector<std::map<std::string, std::string>>>> orders;
+    std::vector<std::vector<std::map<std::string, std::string>>> lineitem;
+};
+
+// The partitions of `table_path` if it holds a manifest; nullptr otherwise.
+// Only the orders of [start_date, end_date) will be queried.
+std::shared_ptr<PartitionedTables> openPartitioned(const std::string& table_path, const std::string& start_date,
+                                                   const std::string& end_date);
+
+}
+
+#endif // PARTITIONING_HPP
@@ -0,0 +1,69 @@
+#ifndef PERFCOUNTERS_HPP
+#define PERFCOUNTERS_HPP
+
+#include <cstdint>
+#include <string>
+#include <ostream>
+
+// Thin wrapper around Linux perf_event_open for per-thread hardware counters.
+//
+// A CounterGroup opens one counter group for the calling thread and reads
+// all events atomically. When the kernel refuses an event (no PMU in a VM,
+// perf_event_paranoid, seccomp, non-Linux build) that event is reported as
+// invalid; when the group leader cannot be opened the group is unavailable
+// and every read returns an empty Counts.
+
+namespace PerfCounters {
+
+enum Event {
+    CYCLES,
+    INSTRUCTIONS,
+    CACHE_MISSES,
+    LLC_MISSES,
+    DTLB_MISSES,
+    BRANCH_MISSES,
+    NUM_EVENTS
+};
+
+const char* eventName(int event);
+
+// Counter values, scaled for multiplexing
+struct Counts {
+    uint64_t values[NUM_EVENTS] = {};
+    bool valid[NUM_EVENTS] = {};
+
+    bool any() const;
+    double ipc() const;
+    Counts& operator+=(const Counts& other);
+    // JSON object with one field per valid event, or null when nothing was counted
+    void writeJSON(std::ostream& out) const;
+};
+
+// Counter group bound to the thread that constructed it
+class CounterGroup {
+public:
+    CounterGroup();
+    ~CounterGroup();
+    CounterGroup(const CounterGroup&) = delete;
+    CounterGroup& operator=(const CounterGroup&) = delete;
+
+    bool available() const { return fds_[CYCLES] >= 0; }
+    void start();
+    Counts stop();
+
+private:
+    int fds_[NUM_EVENTS];
+    uint64_t ids_[NUM_EVENTS] = {};
+};
+
+// Runtime switch, e.g. to avoid the syscalls when counters are not wanted
+void setEnabled(bool enabled);
+bool isEnabled();
+
+// True if a counter group could be opened on this machine; the reason
+// for the failure is returned otherwise
+bool probe(std::string& reason);
+
+}
+
+#endif // PERFCOUNTERS_HPP
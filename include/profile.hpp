@@ -0,0 +1,233 @@
+#ifndef PROFILE_HPP
+#define PROFILE_HPP
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <thread>
+#include "perfcounters.hpp"
+#include "memtrack.hpp"
+
+// Per-operator profiling counters.
+//
+// Queries, pipelines and operators record their counters through the
+// TPCH_PROFILE_* macros below. Unless the build defines TPCH_ENABLE_PROFILING
+// (cmake -DTPCH_PROFILING=ON) every macro expands to nothing and the scope
+// classes are not compiled, so release builds carry no profiling code.
+// Profiling builds also read hardware counters (see perfcounters.hpp) around
+// each pipeline, each operator and each of its worker threads when the
+// machine allows it, and charge every heap allocation to the operator that
+// made it (memtrack.hpp).
+
+namespace Profiling {
+
+// Counters for one operator invocation
+struct OperatorProfile {
+    std::string name;                     // WHERE, INNER_JOIN, GROUP_BY, ...
+    std::string detail;                   // columns the operator works on
+    uint64_t rows_in = 0;
+    uint64_t rows_out = 0;
+    uint64_t build_ns = 0;                // hash build (joins only)
+    uint64_t probe_ns = 0;                // hash probe (joins only)
+    uint64_t total_ns = 0;
+    uint64_t peak_rows = 0;               // largest number of rows held at once
+    std::vector<uint64_t> thread_busy_ns; // busy time of each worker thread
+    PerfCounters::Counts hw;              // calling thread plus all workers
+    std::vector<PerfCounters::Counts> thread_hw;
+    std::thread::id thread;               // calling thread
+    MemTrack::Counts memory;              // allocations made by the operator and its workers
+};
+
+// Wall time of one pipeline of a query
+struct PipelineProfile {
+    std::string name;
+    uint64_t total_ns = 0;
+    uint64_t rows_out = 0;
+    PerfCounters::Counts hw;              // pipeline thread plus its operators' other threads
+};
+
+// All pipelines and operators executed by one query, in execution order
+struct QueryProfile {
+    std::string query;
+    int num_threads = 0;
+    uint64_t total_ns = 0;
+    bool hw_available = false;
+    std::string hw_status;                // why counters are unavailable
+    PerfCounters::Counts hw;              // sum over all operators
+    MemTrack::Counts memory;              // process heap during the query (peak is absolute)
+    std::vector<PipelineProfile> pipelines;
+    std::vector<OperatorProfile> operators;
+
+    void writeJSON(std::ostream& out) const;
+};
+
+// True when the build was compiled with TPCH_ENABLE_PROFILING
+constexpr bool enabled() {
+#ifdef TPCH_ENABLE_PROFILING
+    return true;
+#else
+    return false;
+#endif
+}
+
+// Profile of the most recently started query
+QueryProfile& currentQuery();
+
+// Append a finished operator to the current query profile (thread safe)
+void recordOperator(OperatorProfile&& op);
+void recordPipeline(PipelineProfile&& pipeline);
+
+inline uint64_t nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+#ifdef TPCH_ENABLE_PROFILING
+// Number of operators recorded so far in the current query
+size_t operatorCount();
+// Counters of the operators recorded since `first_operator` taken on threads
+// other than `thread`: their worker threads, and their calling thread when it
+// is not `thread`
+PerfCounters::Counts otherThreadCounts(size_t first_operator, std::thread::id thread);
+
+// Resets the current query profile and records the total query time on exit
+class QueryScope {
+public:
+    QueryScope(const std::string& query, int num_threads);
+    ~QueryScope();
+    QueryScope(const QueryScope&) = delete;
+    QueryScope& operator=(const QueryScope&) = delete;
+private:
+    uint64_t start_ns_;
+    MemTrack::Counts memory_start_;
+};
+
+// Records the wall time and hardware counters of a pipeline at finish() or,
+// failing that, on exit
+class PipelineScope {
+public:
+    explicit PipelineScope(const char* name)
+        : start_ns_(nowNs()), first_operator_(operatorCount()), thread_(std::this_thread::get_id()) {
+        stats_.name = name;
+        counters_.start();
+    }
+    ~PipelineScope() { finish(stats_.rows_out); }
+    PipelineScope(const PipelineScope&) = delete;
+    PipelineScope& operator=(const PipelineScope&) = delete;
+
+    void finish(uint64_t rows_out) {
+        if (finished_) return;
+        finished_ = true;
+        stats_.rows_out = rows_out;
+        stats_.hw = counters_.stop();
+        stats_.hw += otherThreadCounts(first_operator_, thread_);
+        stats_.total_ns = nowNs() - start_ns_;
+        recordPipeline(std::move(stats_));
+    }
+private:
+    PipelineProfile stats_;
+    PerfCounters::CounterGroup counters_;
+    uint64_t start_ns_;
+    size_t first_operator_;
+    std::thread::id thread_;
+    bool finished_ = false;
+};
+
+// Collects the counters of one operator and records them on exit
+class OperatorScope {
+public:
+    OperatorScope(const char* name, std::string detail) : start_ns_(nowNs()) {
+        stats.name = name;
+        stats.detail = std::move(detail);
+        stats.thread = std::this_thread::get_id();
+        counters_.start();
+    }
+    ~OperatorScope() {
+        stats.hw += counters_.stop();
+        for (const auto& thread_counts : stats.thread_hw) stats.hw += thread_counts;
+        stats.total_ns = nowNs() - start_ns_;
+        stats.memory = memory_.counts();
+        recordOperator(std::move(stats));
+    }
+    OperatorScope(const OperatorScope&) = delete;
+    OperatorScope& operator=(const OperatorScope&) = delete;
+
+    void notePeak(uint64_t rows) {
+        if (rows > stats.peak_rows) stats.peak_rows = rows;
+    }
+
+    void setThreads(int num_threads) {
+        stats.thread_busy_ns.assign(num_threads, 0);
+        stats.thread_hw.assign(num_threads, PerfCounters::Counts());
+    }
+
+    uint32_t memoryTag() const { return memory_.tag(); }
+
+    OperatorProfile stats;
+private:
+    MemTrack::Scope memory_;
+    PerfCounters::CounterGroup counters_;
+    uint64_t start_ns_;
+};
+
+// Busy time and hardware counters of one worker thread of an operator
+class WorkerScope {
+public:
+    WorkerScope(OperatorScope& op, int thread_id)
+        : op_(op), thread_id_(thread_id), memory_(op.memoryTag()), start_ns_(nowNs()) {
+        counters_.start();
+    }
+    ~WorkerScope() {
+        op_.stats.thread_hw[thread_id_] += counters_.stop();
+        op_.stats.thread_busy_ns[thread_id_] += nowNs() - start_ns_;
+    }
+    WorkerScope(const WorkerScope&) = delete;
+    WorkerScope& operator=(const WorkerScope&) = delete;
+private:
+    OperatorScope& op_;
+    int thread_id_;
+    MemTrack::Attach memory_;
+    PerfCounters::CounterGroup counters_;
+    uint64_t start_ns_;
+};
+
+// Adds the elapsed time of its scope to a counter
+class ScopedTimer {
+public:
+    explicit ScopedTimer(uint64_t& counter) : counter_(counter), start_ns_(nowNs()) {}
+    ~ScopedTimer() { counter_ += nowNs() - start_ns_; }
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+private:
+    uint64_t& counter_;
+    uint64_t start_ns_;
+};
+#endif
+
+}
+
+#ifdef TPCH_ENABLE_PROFILING
+#define TPCH_PROFILE_QUERY(var, query, num_threads) Profiling::QueryScope var(query, num_threads)
+#define TPCH_PROFILE_PIPELINE(var, name) Profiling::PipelineScope var(name)
+#define TPCH_PROFILE_PIPELINE_END(var, rows) ((var).finish(rows))
+#define TPCH_PROFILE_OPERATOR(var, name, detail) Profiling::OperatorScope var(name, detail)
+#define TPCH_PROFILE_ADD(var, field, n) ((var).stats.field += (n))
+#define TPCH_PROFILE_PEAK(var, rows) ((var).notePeak(rows))
+#define TPCH_PROFILE_TIMER(timer, var, field) Profiling::ScopedTimer timer((var).stats.field)
+#define TPCH_PROFILE_THREADS(var, n) ((var).setThreads(n))
+#define TPCH_PROFILE_WORKER(scope, var, thread_id) Profiling::WorkerScope scope(var, thread_id)
+#else
+#define TPCH_PROFILE_QUERY(var, query, num_threads) ((void)0)
+#define TPCH_PROFILE_PIPELINE(var, name) ((void)0)
+#define TPCH_PROFILE_PIPELINE_END(var, rows) ((void)0)
+#define TPCH_PROFILE_OPERATOR(var, name, detail) ((void)0)
+#define TPCH_PROFILE_ADD(var, field, n) ((void)0)
+#define TPCH_PROFILE_PEAK(var, rows) ((void)0)
+#define TPCH_PROFILE_TIMER(timer, var, field) ((void)0)
+#define TPCH_PROFILE_THREADS(var, n) ((void)0)
+#define TPCH_PROFILE_WORKER(scope, var, thread_id) ((void)0)
+#endif
+
+#endif // PROFILE_HPP
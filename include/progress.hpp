@@ -0,0 +1,129 @@
+#ifndef PROGRESS_HPP
+#define PROGRESS_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Live progress of loads and queries.
+//
+// The engine announces its phase (table load, query pipeline) and, inside it,
+// steps with a known amount of work: bytes of a table file, input rows of an
+// operator. Hot loops report work through a Batch, which touches the shared
+// atomic counters once every BATCH_ROWS rows. A Reporter thread samples the
+// state periodically, prints one line to stderr and/or rewrites a JSON status
+// file, and estimates the remaining time of the current step. A step that
+// stops advancing is reported as stalled, which tells a slow query from a
+// stuck one.
+
+namespace Progress {
+
+enum class Unit { ROWS, BYTES };
+
+constexpr uint64_t BATCH_ROWS = 4096;
+
+// Load phase or query pipeline, e.g. "load" or "Q5 lineitem_probe"
+void setPhase(const std::string& phase);
+
+// Unit of work with a known size; steps nest and restore the outer one on exit.
+// Rows are also counted against `table` ("intermediate" for joined rows).
+// Steps form one process-wide stack, so only one thread at a time may open
+// them; threads running operators side by side do so under a Quiet.
+class Step {
+public:
+    Step(const std::string& label, const std::string& table, uint64_t total, Unit unit = Unit::ROWS);
+    ~Step();
+    Step(const Step&) = delete;
+    Step& operator=(const Step&) = delete;
+private:
+    bool active_ = true;
+};
+
+// Adds work to the current step; rows are credited to its table
+void advance(uint64_t units, uint64_t rows);
+
+// While one lives, the steps and work of the calling thread are not
+// reported; its caller accounts for the work in a step of its own. Threads
+// an operator starts take on their starter's quiet() with Quiet(quiet).
+class Quiet {
+public:
+    explicit Quiet(bool enable = true);
+    ~Quiet();
+    Quiet(const Quiet&) = delete;
+    Quiet& operator=(const Quiet&) = delete;
+private:
+    bool enabled_;
+};
+
+// True while the calling thread is under a Quiet
+bool quiet();
+
+// Thread-local accumulator for hot loops
+class Batch {
+public:
+    Batch() = default;
+    ~Batch() { flush(); }
+    Batch(const Batch&) = delete;
+    Batch& operator=(const Batch&) = delete;
+
+    void add(uint64_t units = 1, uint64_t rows = 1) {
+        units_ += units;
+        rows_ += rows;
+        if (rows_ >= BATCH_ROWS) flush();
+    }
+    void flush() {
+        if (rows_ == 0 && units_ == 0) return;
+        advance(units_, rows_);
+        units_ = rows_ = 0;
+    }
+private:
+    uint64_t units_ = 0;
+    uint64_t rows_ = 0;
+};
+
+struct Status {
+    double elapsed_s = 0;          // since the process started
+    std::string phase;
+    std::string step;
+    Unit unit = Unit::ROWS;
+    uint64_t done = 0;
+    uint64_t total = 0;
+    double step_elapsed_s = 0;
+    uint64_t step_id = 0;          // changes whenever a step starts or ends
+    std::vector<std::pair<std::string, uint64_t>> rows_scanned;  // per table
+};
+
+Status snapshot();
+
+// Samples the progress every interval until destroyed
+class Reporter {
+public:
+    // print: one line per interval on stderr; status_path: JSON file rewritten every interval
+    Reporter(double interval_s, bool print, std::string status_path);
+    ~Reporter();
+    Reporter(const Reporter&) = delete;
+    Reporter& operator=(const Reporter&) = delete;
+private:
+    void run();
+    void report();
+
+    double interval_s_;
+    bool print_;
+    std::string status_path_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    bool stop_ = false;
+    uint64_t last_done_ = 0;
+    uint64_t last_step_id_ = 0;
+    double last_change_s_ = 0;
+    std::thread thread_;
+};
+
+}
+
+#endif // PROGRESS_HPP
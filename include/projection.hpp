@@ -0,0 +1,44 @@
+#ifndef PROJECTION_HPP
+#define PROJECTION_HPP
+
+#include <string>
+#include <vector>
+
+// Date-clustered projection of orders and lineitem, kept next to the base
+// tables of a directory:
+//
+//   orders.by_date.col     orders sorted by O_ORDERDATE
+//   lineitem.by_date.col   lineitem in the order of its orders, with the
+//                          O_ORDERDATE of its order as an extra column
+//
+// Both are sorted by O_ORDERDATE, so the rows of a date range are one
+// contiguous slice of each file: loaded tables are cut by binary search and
+// streamed scans skip every row group outside the range.
+
+namespace Projection {
+
+constexpr const char* ORDERS_BY_DATE = "orders.by_date";
+constexpr const char* LINEITEM_BY_DATE = "lineitem.by_date";
+
+// Columns of lineitem.by_date.col
+const std::vector<std::string>& lineitemColumns();
+
+// Writes the projection of the orders and lineitem of `table_path`, read
+// from the files tpch_query5 would load (see readBaseTable)
+bool build(const std::string& table_path, std::string& error);
+
+// Whether `table_path` has a projection that is not older than its orders
+// and lineitem files
+bool current(const std::string& table_path);
+
+enum class Layout { BASE, ORDER_DATE };
+
+// The layout a query on orders and lineitem with an O_ORDERDATE range reads.
+// `mode` is "auto" (the projection when it is current), "base" or
+// "order_date"; false for an unknown mode or a missing / stale projection
+// that was asked for.
+bool choose(const std::string& table_path, const std::string& mode, Layout& layout, std::string& error);
+
+}
+
+#endif // PROJECTION_HPP
@@ -4,16 +4,83 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <unordered_map>
+#include <cstdint>
+#include "memtrack.hpp"
+#include "buffer.hpp"
+#include "cluster.hpp"
+#include "partitioning.hpp"
+#include "bitmap.hpp"
+#include "statistics.hpp"
 
 // Function to parse command line arguments
-bool parseArgs(int argc, char* argv[], std::string& r_name, std::string& start_date, std::string& end_date, int& num_threads, std::string& table_path, std::string& result_path);
+// Options other than the six required ones are returned in extra_options
+bool parseArgs(int argc, char* argv[], std::string& r_name, std::string& start_date, std::string& end_date, int& num_threads, std::string& table_path, std::string& result_path, std::unordered_map<std::string, std::string>& extra_options);
+
+// Load statistics of one table
+struct TableLoadStats {
+    std::string name;
+    std::string path;
+    std::string format;     // "tbl", "columnar", "arrow", "parquet", "shared" (shared-memory segment) or "partitioned"
+    uint64_t rows = 0;
+    uint64_t bytes = 0;     // size of the file read
+    double load_ms = 0;
+    MemTrack::Counts memory;  // heap allocated while loading (profiling builds)
+};
+
+// Tables that are scanned from their .col file through a buffer pool (or
+// from their .parquet file, row group by row group) while the query runs
+// instead of being loaded up front (out-of-core execution)
+struct StreamedTables {
+    Buffer::Pool* pool = nullptr;
+    std::string orders_path;     // empty: orders_data is used
+    std::string lineitem_path;   // empty: lineitem_data is used
+    int threads = 1;             // threads decoding Parquet row groups
+    // Hash partition of orders and lineitem this process owns (multi-process
+    // runs); loads and scans drop the other rows. Whole tables by default.
+    Cluster::Partition partition;
+    // orders and lineitem of a directory written by tpch_partition; when set,
+    // readTPCHData loads them per partition and Q5 joins them partition-wise
+    std::shared_ptr<Partitioning::PartitionedTables> partitioned;
+    // orders and lineitem are read from the date-clustered projection (see
+    // projection.hpp) and cut to the date range by binary search or, when
+    // streamed, by a date filter on both scans
+    bool date_clustered = false;
+    // When set, readTPCHData fills it with bitmap indexes on the low-cardinality
+    // columns of the loaded tables, read from <table>.bitmaps when current and
+    // built and saved there otherwise
+    std::shared_ptr<SQLEngine::BitmapIndexes> bitmaps;
+    // When set, readTPCHData fills it with the statistics of the whole tables
+    // from <table>.stats.json when current (collecting and saving them with
+    // Catalog::collect), and Q5 prints its cardinality estimates
+    std::shared_ptr<Statistics::Catalog> statistics;
+};
+
+// Streams orders and lineitem through `pool` when they have an up-to-date .col
+// file, or else scans their .parquet file; the files of the date-clustered
+// projection with `date_clustered`
+StreamedTables streamedTables(const std::string& table_path, Buffer::Pool& pool, bool date_clustered = false);
 
 // Function to read TPCH data from the specified paths
 bool readTPCHData(const std::string& table_path, std::vector<std::map<std::string, std::string>>& customer_data, std::vector<std::map<std::string, std::string>>& orders_data, std::vector<std::map<std::string, std::string>>& lineitem_data, std::vector<std::map<std::string, std::string>>& supplier_data, std::vector<std::map<std::string, std::string>>& nation_data, std::vector<std::map<std::string, std::string>>& region_data);
 
+// Same, also reporting per-table load statistics
+bool readTPCHData(const std::string& table_path, std::vector<std::map<std::string, std::string>>& customer_data, std::vector<std::map<std::string, std::string>>& orders_data, std::vector<std::map<std::string, std::string>>& lineitem_data, std::vector<std::map<std::string, std::string>>& supplier_data, std::vector<std::map<std::string, std::string>>& nation_data, std::vector<std::map<std::string, std::string>>& region_data, std::vector<TableLoadStats>& load_stats);
+
+// Same, skipping the tables that are streamed
+bool readTPCHData(const std::string& table_path, std::vector<std::map<std::string, std::string>>& customer_data, std::vector<std::map<std::string, std::string>>& orders_data, std::vector<std::map<std::string, std::string>>& lineitem_data, std::vector<std::map<std::string, std::string>>& supplier_data, std::vector<std::map<std::string, std::string>>& nation_data, std::vector<std::map<std::string, std::string>>& region_data, std::vector<TableLoadStats>& load_stats, const StreamedTables& streamed);
+
+// Reads `columns` of one table from the file readTPCHData would load it from:
+// <name>.col, .arrow or .parquet when not older than <name>.tbl (in that
+// order), else <name>.tbl. Used by the tools that rewrite tables.
+bool readBaseTable(const std::string& table_path, const std::string& name, const std::vector<std::string>& columns, std::vector<std::map<std::string, std::string>>& out, int threads = 1);
+
 // Function to execute TPCH Query 5 using multithreading
 bool executeQuery5(const std::string& r_name, const std::string& start_date, const std::string& end_date, int num_threads, const std::vector<std::map<std::string, std::string>>& customer_data, const std::vector<std::map<std::string, std::string>>& orders_data, const std::vector<std::map<std::string, std::string>>& lineitem_data, const std::vector<std::map<std::string, std::string>>& supplier_data, const std::vector<std::map<std::string, std::string>>& nation_data, const std::vector<std::map<std::string, std::string>>& region_data, std::map<std::string, double>& results);
 
+// Same, scanning the streamed tables row group by row group
+bool executeQuery5(const std::string& r_name, const std::string& start_date, const std::string& end_date, int num_threads, const std::vector<std::map<std::string, std::string>>& customer_data, const std::vector<std::map<std::string, std::string>>& orders_data, const std::vector<std::map<std::string, std::string>>& lineitem_data, const std::vector<std::map<std::string, std::string>>& supplier_data, const std::vector<std::map<std::string, std::string>>& nation_data, const std::vector<std::map<std::string, std::string>>& region_data, std::map<std::string, double>& results, const StreamedTables& streamed);
+
 // Function to output results to the specified path
 bool outputResults(const std::string& result_path, const std::map<std::string, double>& results);
 
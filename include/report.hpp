@@ -0,0 +1,47 @@
+#ifndef REPORT_HPP
+#define REPORT_HPP
+
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "query5.hpp"
+#include "profile.hpp"
+#include "arena.hpp"
+#include "buffer.hpp"
+
+// Machine-readable report of one tpch_query5 run
+namespace Report {
+
+struct PhaseTimes {
+    double parse_args_ms = 0;
+    double load_ms = 0;
+    double execute_ms = 0;
+    double output_ms = 0;
+    double total_ms = 0;
+};
+
+struct RunReport {
+    // Configuration
+    std::string query = "Q5";
+    std::string r_name, start_date, end_date, table_path, result_path;
+    int num_threads = 0;
+    std::map<std::string, std::string> engine_options;
+
+    PhaseTimes phases;
+    std::vector<TableLoadStats> tables;
+    std::vector<Profiling::PipelineProfile> pipelines;
+    size_t result_rows = 0;
+    long peak_rss_kb = 0;
+    Arena::Stats arena;
+    Buffer::Stats buffer;       // out-of-core scans (--buffer_mb)
+
+    void writeJSON(std::ostream& out) const;
+};
+
+// Peak resident set size of this process in KiB (0 if unknown)
+long peakRssKb();
+
+}
+
+#endif // REPORT_HPP
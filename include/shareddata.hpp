@@ -0,0 +1,76 @@
+#ifndef SHAREDDATA_HPP
+#define SHAREDDATA_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Host-wide copy of the .col tables in shared memory.
+//
+// publish() copies the .col files of a table directory into a named POSIX
+// shared-memory segment (or any file, e.g. on hugetlbfs, when the name is a
+// path) behind a versioned header. Other processes attach() read-only, which
+// only maps the segment, and decode tables from it instead of reading the
+// files. That saves the disk reads, not memory: only the encoded images are
+// shared, and each process decodes them into rows of its own. Layout:
+//   header   "TPCHSHM1", uint32 version, uint32 table count, uint64 total
+//            bytes, uint64 ready flag (set last), source directory
+//   entries  per table: name, uint64 offset, uint64 bytes, int64 .col mtime
+//   images   the .col files, 64-byte aligned
+// Republishing unlinks the old segment first; processes still attached keep
+// their mapping of it.
+
+namespace SharedData {
+
+constexpr uint32_t VERSION = 1;
+
+struct TableImage {
+    std::string name;
+    const char* data = nullptr;
+    uint64_t bytes = 0;
+    int64_t modified = 0;    // last write time of the .col file when published
+};
+
+class Segment {
+public:
+    Segment() = default;
+    Segment(const Segment&) = delete;
+    Segment& operator=(const Segment&) = delete;
+    ~Segment();
+
+    // Creates the segment `name` holding <table_path>/<table>.col for every table
+    bool publish(const std::string& name, const std::string& table_path, const std::vector<std::string>& tables,
+                 std::string& error);
+    bool attach(const std::string& name, std::string& error);
+
+    const std::string& source() const { return source_; }
+    uint64_t bytes() const { return bytes_; }
+    const std::vector<TableImage>& tables() const { return tables_; }
+    // Image of <table_path>/<table>.col; nullptr if the segment was published
+    // from another directory or the file changed since
+    const TableImage* find(const std::string& table_path, const std::string& table) const;
+
+private:
+    void unmap();
+
+    void* base_ = nullptr;
+    uint64_t bytes_ = 0;
+    intptr_t handle_ = -1;
+    std::string source_;
+    std::vector<TableImage> tables_;
+};
+
+// Deletes a published segment; attached processes keep their mapping
+bool remove(const std::string& name);
+
+// Whether a segment outlives the process that published it. On Windows it
+// lives only while some process has it open, so the publisher must stay up.
+bool persistsAfterExit();
+
+// Segment readTPCHData loads tables from, attached for the whole process
+bool attach(const std::string& name, std::string& error);
+const Segment* attached();
+
+}
+
+#endif // SHAREDDATA_HPP
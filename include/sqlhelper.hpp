@@ -5,9 +5,20 @@
 #include <map>
 #include <string>
 #include <functional>
+#include <memory_resource>
 #include <algorithm>
 #include <set>
+#include <string_view>
+#include <unordered_map>
 #include <thread>
+#include <utility>
+#include "profile.hpp"
+#include "trace.hpp"
+#include "progress.hpp"
+#include "tpch_schema.hpp"
+#include "charcolumn.hpp"
+#include "bitmap.hpp"
+#include "fastparse.hpp"
 
 
 namespace SQLEngine {
@@ -16,49 +27,273 @@ namespace SQLEngine {
 using Row = std::map<std::string, std::string>;
 using Table = std::vector<Row>;
 
+// Rows of a base table picked by a selection vector, without copying them.
+// Filters return views and every operator accepts one; a Table converts to a
+// view of all its rows. The base table must outlive its views.
+//
+// Operators take the memory resource their own containers (selections, hash
+// indexes, groups, sort keys) are built on, normally the query arena's
+// (arena.hpp); the default is the heap. Rows are always on the heap.
+class TableView {
+public:
+    TableView() = default;
+    TableView(const Table& table) : base_(&table), all_(true) {}
+    TableView(const Table& table, std::pmr::vector<size_t> selection)
+        : base_(&table), selection_(std::move(selection)) {}
+    // A view of a temporary would dangle as soon as the full expression ends
+    TableView(Table&&) = delete;
+    TableView(Table&&, std::pmr::vector<size_t>) = delete;
+
+    size_t size() const { return all_ ? base_->size() : selection_.size(); }
+    bool empty() const { return size() == 0; }
+    const Row& operator[](size_t i) const { return (*base_)[baseIndex(i)]; }
+    // Position in the base table of the i-th row of the view
+    size_t baseIndex(size_t i) const { return all_ ? i : selection_[i]; }
+    const Table* base() const { return base_; }
+    // The selection vector; nullptr when the view holds all rows of the base
+    const size_t* selectionData() const { return all_ ? nullptr : selection_.data(); }
+
+    class iterator {
+    public:
+        iterator(const TableView* view, size_t i) : view_(view), i_(i) {}
+        const Row& operator*() const { return (*view_)[i_]; }
+        iterator& operator++() { ++i_; return *this; }
+        bool operator!=(const iterator& other) const { return i_ != other.i_; }
+    private:
+        const TableView* view_;
+        size_t i_;
+    };
+    iterator begin() const { return iterator(this, 0); }
+    iterator end() const { return iterator(this, size()); }
+
+private:
+    const Table* base_ = nullptr;
+    bool all_ = false;
+    std::pmr::vector<size_t> selection_;
+};
+
+// Copies the rows of a view into a table of their own, e.g. to outlive the base
+inline Table materialize(const TableView& view) {
+    Table result;
+    result.reserve(view.size());
+    for (const auto& row : view) result.push_back(row);
+    return result;
+}
+
 // Type alias for predicate functions
 using Predicate = std::function<bool(const Row&)>;
 using JoinPredicate = std::function<bool(const Row&, const Row&)>;
 
+// Base table the rows of a table come from, for progress reporting
+inline std::string sourceTable(const TableView& table) {
+    if (table.empty() || table[0].empty()) return "";
+    std::string first = TPCH::tableOfColumn(table[0].begin()->first);
+    return first == TPCH::tableOfColumn(table[0].rbegin()->first) ? first : "intermediate";
+}
 
-Table WHERE(const Table& table, Predicate predicate) {
-    Table result;
-    for (const auto& row : table) {
-        if (predicate(row)) {
-            result.push_back(row);
+
+// Returns the qualifying rows as a view of the input's base table, so only
+// an index list is allocated. Filtering a view keeps the rows that pass both
+// filters, i.e. chained filters intersect their selections.
+inline TableView WHERE(const TableView& table, Predicate predicate, std::pmr::memory_resource* memory = std::pmr::get_default_resource()) {
+    TPCH_PROFILE_OPERATOR(prof, "WHERE", "");
+    TPCH_PROFILE_ADD(prof, rows_in, table.size());
+    Tracing::Scope trace_scope("WHERE", "operator");
+    Progress::Step progress_step("WHERE", sourceTable(table), table.size());
+    Progress::Batch progress;
+    if (!table.base()) return TableView();
+    std::pmr::vector<size_t> selection(memory);
+    for (size_t i = 0; i < table.size(); i++) {
+        progress.add();
+        if (predicate(table[i])) {
+            selection.push_back(table.baseIndex(i));
         }
     }
-    return result;
+    TPCH_PROFILE_ADD(prof, rows_out, selection.size());
+    trace_scope.setArg(selection.size());
+    return TableView(*table.base(), std::move(selection));
+}
+
+// WHERE column = value / WHERE column LIKE 'prefix%' on a fixed-width column
+// built from the view's base table; compares contiguous bytes instead of
+// looking the column up in every row. Falls back to the row predicate for a
+// column of another table.
+inline TableView WHERE_CHAR(const TableView& table, const CharColumn& column, const std::string& value, bool prefix,
+                            std::pmr::memory_resource* memory = std::pmr::get_default_resource()) {
+    TPCH_PROFILE_OPERATOR(prof, "WHERE", column.name());
+    TPCH_PROFILE_ADD(prof, rows_in, table.size());
+    Tracing::Scope trace_scope("WHERE", "operator");
+    if (!table.base()) return TableView();
+    std::pmr::vector<size_t> selection(memory);
+    if (column.source() == table.base() && column.size() == table.base()->size()) {
+        Progress::Step progress_step("WHERE " + column.name(), sourceTable(table), table.size());
+        if (prefix) column.selectPrefix(value, table.selectionData(), table.size(), selection);
+        else column.selectEqual(value, table.selectionData(), table.size(), selection);
+        Progress::advance(table.size(), table.size());
+    } else {
+        for (size_t i = 0; i < table.size(); i++) {
+            auto it = table[i].find(column.name());
+            if (it == table[i].end()) continue;
+            bool match = prefix ? it->second.compare(0, value.size(), value) == 0 : it->second == value;
+            if (match) selection.push_back(table.baseIndex(i));
+        }
+    }
+    TPCH_PROFILE_ADD(prof, rows_out, selection.size());
+    trace_scope.setArg(selection.size());
+    return TableView(*table.base(), std::move(selection));
+}
+
+inline TableView WHERE_EQUALS(const TableView& table, const CharColumn& column, const std::string& value,
+                              std::pmr::memory_resource* memory = std::pmr::get_default_resource()) {
+    return WHERE_CHAR(table, column, value, false, memory);
+}
+
+inline TableView WHERE_PREFIX(const TableView& table, const CharColumn& column, const std::string& prefix,
+                              std::pmr::memory_resource* memory = std::pmr::get_default_resource()) {
+    return WHERE_CHAR(table, column, prefix, true, memory);
+}
+
+// WHERE column IN (values) answered by a bitmap index on the view's base
+// table: the bitmaps of the values are ORed, and the view's rows are tested
+// against the result in the view's order without reading the column. Falls
+// back to testing every row for an index of another table.
+inline TableView WHERE_IN(const TableView& table, const BitmapIndex& index, const std::vector<std::string>& values,
+                          std::pmr::memory_resource* memory = std::pmr::get_default_resource()) {
+    TPCH_PROFILE_OPERATOR(prof, "WHERE_IN", index.name());
+    TPCH_PROFILE_ADD(prof, rows_in, table.size());
+    Tracing::Scope trace_scope("WHERE_IN", "operator");
+    if (!table.base()) return TableView();
+    std::pmr::vector<size_t> selection(memory);
+    if (index.source() == table.base() && index.rows() == table.base()->size()) {
+        RoaringBitmap matches = index.anyOf(values);
+        if (table.selectionData()) {
+            // A selection may be in any order (e.g. sorted by ORDER_BY_DESC) and is kept as it is
+            for (size_t i = 0; i < table.size(); i++) {
+                size_t row = table.selectionData()[i];
+                if (matches.contains(static_cast<uint32_t>(row))) selection.push_back(row);
+            }
+        } else {
+            std::vector<size_t> positions = matches.positions();
+            selection.assign(positions.begin(), positions.end());
+        }
+    } else {
+        std::set<std::string> wanted(values.begin(), values.end());
+        for (size_t i = 0; i < table.size(); i++) {
+            auto it = table[i].find(index.name());
+            if (it != table[i].end() && wanted.count(it->second)) selection.push_back(table.baseIndex(i));
+        }
+    }
+    TPCH_PROFILE_ADD(prof, rows_out, selection.size());
+    trace_scope.setArg(selection.size());
+    return TableView(*table.base(), std::move(selection));
+}
+
+// WHERE low <= column < high on a view sorted by `column` (e.g. a
+// date-clustered projection): two binary searches find the qualifying slice
+// instead of testing every row.
+inline TableView WHERE_SORTED_RANGE(const TableView& table, const std::string& column,
+                                    const std::string& low, const std::string& high,
+                                    std::pmr::memory_resource* memory = std::pmr::get_default_resource()) {
+    TPCH_PROFILE_OPERATOR(prof, "WHERE_SORTED_RANGE", column);
+    TPCH_PROFILE_ADD(prof, rows_in, table.size());
+    Tracing::Scope trace_scope("WHERE_SORTED_RANGE", "operator");
+    if (!table.base()) return TableView();
+    auto value = [&](size_t i) -> std::string_view {
+        auto it = table[i].find(column);
+        return it == table[i].end() ? std::string_view() : std::string_view(it->second);
+    };
+    auto lowerBound = [&](const std::string& bound) {
+        size_t first = 0, count = table.size();
+        while (count > 0) {
+            size_t step = count / 2;
+            if (value(first + step) < bound) {
+                first += step + 1;
+                count -= step + 1;
+            } else {
+                count = step;
+            }
+        }
+        return first;
+    };
+    size_t begin = lowerBound(low);
+    size_t end = std::max(begin, lowerBound(high));
+    std::pmr::vector<size_t> selection(end - begin, memory);
+    for (size_t i = begin; i < end; i++) selection[i - begin] = table.baseIndex(i);
+    TPCH_PROFILE_ADD(prof, rows_out, selection.size());
+    trace_scope.setArg(selection.size());
+    return TableView(*table.base(), std::move(selection));
+}
+
+// Hash index on the join column of the build side of a join. It is built by
+// the first INNER_JOIN that probes it, so one build can serve several probe
+// inputs (e.g. row groups streamed from disk).
+struct JoinIndex {
+    JoinIndex(TableView table, std::string column,
+              std::pmr::memory_resource* memory = std::pmr::get_default_resource())
+        : table(std::move(table)), column(std::move(column)), rows(memory) {}
+
+    TableView table;
+    std::string column;
+    bool built = false;
+    std::pmr::map<std::string, std::pmr::vector<size_t>> rows;
+};
+
+// Builds `index` unless it is built. Not thread safe: an index several
+// threads probe at once must be built before they start.
+inline void buildJoinIndex(JoinIndex& index) {
+    if (index.built) return;
+    Tracing::Scope build_trace("build", "join");
+    Progress::Step progress_step("INNER_JOIN build " + index.column, sourceTable(index.table), index.table.size());
+    Progress::Batch progress;
+    for (size_t i = 0; i < index.table.size(); i++) {
+        progress.add();
+        if (index.table[i].find(index.column) != index.table[i].end()) {
+            index.rows[index.table[i].at(index.column)].push_back(i);
+        }
+    }
+    index.built = true;
 }
 
 // JOIN Clause (Required for all the table joins)
 
-Table INNER_JOIN(const Table& left_table, const Table& right_table,
-                               const std::string& left_column, const std::string& right_column,
-                               int num_threads) {
+inline Table INNER_JOIN(const TableView& left_table, JoinIndex& right_index,
+                               const std::string& left_column, int num_threads) {
+    const TableView& right_table = right_index.table;
+    const std::string& right_column = right_index.column;
+    TPCH_PROFILE_OPERATOR(prof, "INNER_JOIN", left_column + " = " + right_column);
+    TPCH_PROFILE_ADD(prof, rows_in, left_table.size());
+    TPCH_PROFILE_THREADS(prof, num_threads);
+    Tracing::Scope trace_scope(Tracing::intern("INNER_JOIN " + left_column + " = " + right_column), "operator");
     
     // Build hash index on right table (shared across threads)
-    std::map<std::string, std::vector<size_t>> right_index;
-    for (size_t i = 0; i < right_table.size(); i++) {
-        if (right_table[i].find(right_column) != right_table[i].end()) {
-            right_index[right_table[i].at(right_column)].push_back(i);
-        }
+    if (!right_index.built) {
+        TPCH_PROFILE_ADD(prof, rows_in, right_table.size());
+        TPCH_PROFILE_TIMER(build_timer, prof, build_ns);
+        buildJoinIndex(right_index);
     }
+    const auto& index_rows = right_index.rows;
     
     // Divide left table among threads
     size_t chunk_size = (left_table.size() + num_threads - 1) / num_threads;
     std::vector<std::thread> threads;
     std::vector<Table> thread_results(num_threads);
+    const bool quiet = Progress::quiet();
     
     auto worker = [&](int thread_id, size_t start_idx, size_t end_idx) {
+        TPCH_PROFILE_WORKER(worker_prof, prof, thread_id);
+        Tracing::setThreadName("join-worker");
+        Tracing::Scope morsel_trace("morsel", "join");
+        Progress::Quiet stay_quiet(quiet);
+        Progress::Batch progress;
         Table local_result;
         for (size_t i = start_idx; i < end_idx && i < left_table.size(); i++) {
+            progress.add();
             const auto& left_row = left_table[i];
             if (left_row.find(left_column) == left_row.end()) continue;
             
             const std::string& key = left_row.at(left_column);
-            auto it = right_index.find(key);
-            if (it != right_index.end()) {
+            auto it = index_rows.find(key);
+            if (it != index_rows.end()) {
                 for (size_t right_idx : it->second) {
                     Row merged_row = left_row;
                     for (const auto& [k, v] : right_table[right_idx]) {
@@ -68,82 +303,157 @@ Table INNER_JOIN(const Table& left_table, const Table& right_table,
                 }
             }
         }
+        morsel_trace.setArg(local_result.size());
         thread_results[thread_id] = std::move(local_result);
     };
     
     // Launch threads & wait for threads to merge
-    for (int i = 0; i < num_threads; i++) {
-        size_t start_idx = i * chunk_size;
-        size_t end_idx = start_idx + chunk_size;
-        threads.emplace_back(worker, i, start_idx, end_idx);
+    {
+        TPCH_PROFILE_TIMER(probe_timer, prof, probe_ns);
+        Progress::Step progress_step("INNER_JOIN probe " + left_column + " = " + right_column,
+                                     sourceTable(left_table), left_table.size());
+        for (int i = 0; i < num_threads; i++) {
+            size_t start_idx = i * chunk_size;
+            size_t end_idx = start_idx + chunk_size;
+            threads.emplace_back(worker, i, start_idx, end_idx);
+        }
+        
+        Tracing::Scope wait_trace("wait", "join");
+        for (auto& t : threads) t.join();
     }
     
-    for (auto& t : threads) t.join();
-    
     
     // Merge results
+    Tracing::begin("merge", "join");
     Table result;
     for (const auto& thread_result : thread_results) {
         result.insert(result.end(), thread_result.begin(), thread_result.end());
     }
+    Tracing::end("merge", "join", result.size());
+    trace_scope.setArg(result.size());
+    // Thread results and the merged table are alive together at this point
+    TPCH_PROFILE_ADD(prof, rows_out, result.size());
+    TPCH_PROFILE_PEAK(prof, 2 * result.size());
     
     return result;
 }
 
+inline Table INNER_JOIN(const TableView& left_table, const TableView& right_table,
+                               const std::string& left_column, const std::string& right_column,
+                               int num_threads, std::pmr::memory_resource* memory = std::pmr::get_default_resource()) {
+    JoinIndex right_index{right_table, right_column, memory};
+    return INNER_JOIN(left_table, right_index, left_column, num_threads);
+}
+
 // GROUP BY Clause (Required for: GROUP BY n_name)
-std::map<std::string, Table> GROUP_BY(const Table& table, const std::string& group_column) {
-    std::map<std::string, Table> groups;
-    for (const auto& row : table) {
-        if (row.find(group_column) != row.end()) {
-            std::string key = row.at(group_column);
-            groups[key].push_back(row);
+// Groups are views of the input's base table
+inline std::map<std::string, TableView> GROUP_BY(const TableView& table, const std::string& group_column,
+                                                 std::pmr::memory_resource* memory = std::pmr::get_default_resource()) {
+    TPCH_PROFILE_OPERATOR(prof, "GROUP_BY", group_column);
+    TPCH_PROFILE_ADD(prof, rows_in, table.size());
+    Tracing::Scope trace_scope("GROUP_BY", "operator");
+    Progress::Step progress_step("GROUP_BY", sourceTable(table), table.size());
+    Progress::Batch progress;
+    std::pmr::map<std::string, std::pmr::vector<size_t>> selections(memory);
+    for (size_t i = 0; i < table.size(); i++) {
+        progress.add();
+        const Row& row = table[i];
+        auto it = row.find(group_column);
+        if (it != row.end()) {
+            selections[it->second].push_back(table.baseIndex(i));
         }
     }
+    std::map<std::string, TableView> groups;
+    for (auto& [key, selection] : selections) {
+        groups.emplace(key, TableView(*table.base(), std::move(selection)));
+    }
+    TPCH_PROFILE_ADD(prof, rows_out, groups.size());
+    return groups;
+}
+
+// GROUP BY on a fixed-width column of the view's base table: rows are
+// grouped by views of the column's stored values, without a map lookup per row
+inline std::map<std::string, TableView> GROUP_BY(const TableView& table, const CharColumn& column,
+                                                 std::pmr::memory_resource* memory = std::pmr::get_default_resource()) {
+    if (column.source() != table.base() || column.size() != table.base()->size())
+        return GROUP_BY(table, column.name(), memory);
+    TPCH_PROFILE_OPERATOR(prof, "GROUP_BY", column.name());
+    TPCH_PROFILE_ADD(prof, rows_in, table.size());
+    Tracing::Scope trace_scope("GROUP_BY", "operator");
+    Progress::Step progress_step("GROUP_BY", sourceTable(table), table.size());
+    Progress::Batch progress;
+    std::pmr::unordered_map<std::string_view, std::pmr::vector<size_t>> selections(memory);
+    for (size_t i = 0; i < table.size(); i++) {
+        progress.add();
+        size_t row = table.baseIndex(i);
+        if (column.has(row)) selections[column.at(row)].push_back(row);
+    }
+    std::map<std::string, TableView> groups;
+    for (auto& [key, selection] : selections) {
+        groups.emplace(std::string(key), TableView(*table.base(), std::move(selection)));
+    }
+    TPCH_PROFILE_ADD(prof, rows_out, groups.size());
     return groups;
 }
 
 // Aggregate Fx: SUM(column)
-double SUM(const Table& group, const std::string& column) {
+inline double SUM(const TableView& group, const std::string& column) {
+    TPCH_PROFILE_OPERATOR(prof, "SUM", column);
+    TPCH_PROFILE_ADD(prof, rows_in, group.size());
+    TPCH_PROFILE_ADD(prof, rows_out, 1);
+    Tracing::Scope trace_scope("SUM", "operator");
     double sum = 0.0;
     for (const auto& row : group) {
         if (row.find(column) != row.end()) {
-            sum += std::stod(row.at(column));
+            sum += FastParse::toDouble(row.at(column));
         }
     }
     return sum;
 }
 
 // ORDER BY Clause (Required for: ORDER BY revenue DESC)
-Table ORDER_BY_DESC(Table table, const std::string& column) {
-    std::sort(table.begin(), table.end(),
-              [&column](const Row& a, const Row& b) {
-                  return std::stod(a.at(column)) > std::stod(b.at(column));
-              });
-    return table;
+// Sorts the selection, the rows stay where they are. Each key is parsed once.
+inline TableView ORDER_BY_DESC(const TableView& table, const std::string& column,
+                               std::pmr::memory_resource* memory = std::pmr::get_default_resource()) {
+    TPCH_PROFILE_OPERATOR(prof, "ORDER_BY_DESC", column);
+    TPCH_PROFILE_ADD(prof, rows_in, table.size());
+    TPCH_PROFILE_ADD(prof, rows_out, table.size());
+    Tracing::Scope trace_scope("ORDER_BY_DESC", "operator");
+    if (!table.base()) return TableView();
+    const Table& base = *table.base();
+    std::pmr::vector<std::pair<double, size_t>> keyed(table.size(), memory);
+    for (size_t i = 0; i < table.size(); i++) {
+        size_t index = table.baseIndex(i);
+        keyed[i] = {FastParse::toDouble(base[index].at(column)), index};
+    }
+    std::sort(keyed.begin(), keyed.end(), [](const auto& a, const auto& b) { return a.first > b.first; });
+    std::pmr::vector<size_t> selection(keyed.size(), memory);
+    for (size_t i = 0; i < keyed.size(); i++) selection[i] = keyed[i].second;
+    return TableView(base, std::move(selection));
 }
 
 // Helper Predicate Builders
 
-Predicate EQUALS(const std::string& column, const std::string& value) {
+inline Predicate EQUALS(const std::string& column, const std::string& value) {
     return [column, value](const Row& row) {
         return row.find(column) != row.end() && row.at(column) == value;
     };
 }
 
-Predicate GREATER_EQUAL(const std::string& column, const std::string& value) {
+inline Predicate GREATER_EQUAL(const std::string& column, const std::string& value) {
     return [column, value](const Row& row) {
         return row.find(column) != row.end() && row.at(column) >= value;
     };
 }
 
-Predicate LESS_THAN(const std::string& column, const std::string& value) {
+inline Predicate LESS_THAN(const std::string& column, const std::string& value) {
     return [column, value](const Row& row) {
         return row.find(column) != row.end() && row.at(column) < value;
     };
 }
 
 // Build join predicate: table1.col1 = table2.col2
-JoinPredicate JOIN_ON(const std::string& left_column, const std::string& right_column) {
+inline JoinPredicate JOIN_ON(const std::string& left_column, const std::string& right_column) {
     return [left_column, right_column](const Row& left, const Row& right) {
         return left.find(left_column) != left.end() && 
                right.find(right_column) != right.end() &&
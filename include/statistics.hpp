@@ -0,0 +1,101 @@
+#ifndef STATISTICS_HPP
+#define STATISTICS_HPP
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Column statistics for cardinality estimation.
+//
+// Per column: row and null (empty value) counts, min / max, a HyperLogLog
+// sketch of the distinct values and a fixed-size row sample. The sample keeps
+// the rows whose position hashes lowest (bottom-k), so it stays a uniform
+// sample when rows are appended later; the equi-depth histogram and the most
+// common values are derived from it. Statistics are saved as
+// <table>.stats.json next to the table files.
+
+namespace Statistics {
+
+constexpr int VERSION = 1;
+constexpr int HLL_BITS = 12;                 // 4096 registers, ~1.6% standard error
+constexpr size_t SAMPLE_SIZE = 2048;
+constexpr size_t HISTOGRAM_BUCKETS = 32;
+constexpr size_t MOST_COMMON_VALUES = 16;
+
+// Equi-depth histogram bucket: values in (previous upper, upper]
+struct Bucket {
+    std::string upper;
+    uint64_t rows = 0;
+};
+
+struct ColumnStats {
+    std::string name;
+    uint64_t rows = 0;
+    uint64_t nulls = 0;
+    std::string min, max;
+    bool numeric = true;                          // every non-null value parses as a number
+    std::vector<Bucket> histogram;
+    std::vector<std::pair<std::string, uint64_t>> most_common;   // value, estimated rows
+
+    // Sketch, sample and extremes the summaries above are derived from
+    std::string min_text, max_text;
+    double min_number = 0, max_number = 0;
+    std::vector<uint8_t> registers = std::vector<uint8_t>(size_t(1) << HLL_BITS, 0);
+    std::vector<std::pair<uint64_t, std::string>> sample;        // (position hash, value), max-heap
+
+    // Adds the value of row `position` of the table
+    void add(std::string_view value, uint64_t position);
+    // Rebuilds the histogram and the most common values from the sample
+    void summarize();
+
+    double distinct() const;
+    // Estimated fraction of the rows with value == `value` / low <= value < high
+    double equalSelectivity(const std::string& value) const;
+    double rangeSelectivity(const std::string& low, const std::string& high) const;
+};
+
+struct TableStats {
+    std::string table;
+    uint64_t rows = 0;
+    std::vector<ColumnStats> columns;
+
+    TableStats() = default;
+    TableStats(const std::string& table, const std::vector<std::string>& columns);
+
+    const ColumnStats* find(const std::string& column) const;
+    // Adds `rows` rows given as row-major fields in column order (a row group
+    // of Columnar::Writer) and keeps the summaries current. Columns are
+    // processed by up to `threads` threads.
+    void appendRowGroup(const std::vector<std::string>& fields, size_t rows, int threads);
+    void append(const std::vector<std::map<std::string, std::string>>& table, int threads);
+};
+
+// Statistics of `table`, collected with up to `threads` threads
+TableStats collect(const std::string& name, const std::vector<std::string>& columns,
+                   const std::vector<std::map<std::string, std::string>>& table, int threads);
+
+bool writeStats(const std::string& path, const TableStats& stats);
+bool readStats(const std::string& path, TableStats& stats);
+
+// Statistics of the loaded tables, filled by readTPCHData
+struct Catalog {
+    bool collect = false;    // collect and save missing or stale statistics at load
+    int threads = 1;
+    std::map<std::string, TableStats> tables;
+
+    const TableStats* table(const std::string& name) const;
+    const ColumnStats* column(const std::string& table, const std::string& column) const;
+};
+
+// Estimated rows of an equi-join of inputs of `left_rows` and `right_rows`
+// rows (possibly filtered) on columns with the given statistics: the keys of
+// the column with fewer distinct values are assumed to occur in the other,
+// and the filters to be independent of the keys
+double joinRows(double left_rows, const ColumnStats& left, double right_rows, const ColumnStats& right);
+
+}
+
+#endif // STATISTICS_HPP
@@ -0,0 +1,64 @@
+#ifndef TPCH_SCHEMA_HPP
+#define TPCH_SCHEMA_HPP
+
+#include <algorithm>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Column names of the TPC-H tables in .tbl field order
+namespace TPCH {
+
+inline const std::vector<std::string> CUSTOMER_COLUMNS = {"C_CUSTKEY", "C_NAME", "C_ADDRESS", "C_NATIONKEY",
+                                                          "C_PHONE", "C_ACCTBAL", "C_MKTSEGMENT", "C_COMMENT"};
+inline const std::vector<std::string> ORDERS_COLUMNS = {"O_ORDERKEY", "O_CUSTKEY", "O_ORDERSTATUS", "O_TOTALPRICE",
+                                                        "O_ORDERDATE", "O_ORDERPRIORITY", "O_CLERK",
+                                                        "O_SHIPPRIORITY", "O_COMMENT"};
+inline const std::vector<std::string> LINEITEM_COLUMNS = {"L_ORDERKEY", "L_PARTKEY", "L_SUPPKEY", "L_LINENUMBER",
+                                                          "L_QUANTITY", "L_EXTENDEDPRICE", "L_DISCOUNT", "L_TAX",
+                                                          "L_RETURNFLAG", "L_LINESTATUS", "L_SHIPDATE",
+                                                          "L_COMMITDATE", "L_RECEIPTDATE", "L_SHIPINSTRUCT",
+                                                          "L_SHIPMODE", "L_COMMENT"};
+inline const std::vector<std::string> SUPPLIER_COLUMNS = {"S_SUPPKEY", "S_NAME", "S_ADDRESS", "S_NATIONKEY",
+                                                          "S_PHONE", "S_ACCTBAL", "S_COMMENT"};
+inline const std::vector<std::string> NATION_COLUMNS = {"N_NATIONKEY", "N_NAME", "N_REGIONKEY", "N_COMMENT"};
+inline const std::vector<std::string> REGION_COLUMNS = {"R_REGIONKEY", "R_NAME", "R_COMMENT"};
+
+// Columns of a table by file name stem ("customer", "orders", ...); empty if unknown
+inline const std::vector<std::string>& columnsOf(const std::string& table) {
+    static const std::vector<std::string> none;
+    if (table == "customer") return CUSTOMER_COLUMNS;
+    if (table == "orders") return ORDERS_COLUMNS;
+    if (table == "lineitem") return LINEITEM_COLUMNS;
+    if (table == "supplier") return SUPPLIER_COLUMNS;
+    if (table == "nation") return NATION_COLUMNS;
+    if (table == "region") return REGION_COLUMNS;
+    return none;
+}
+
+inline const std::vector<std::string> TABLE_NAMES = {"customer", "orders", "lineitem", "supplier", "nation", "region"};
+
+// Table a column belongs to; empty if unknown
+inline std::string tableOfColumn(const std::string& column) {
+    for (const auto& table : TABLE_NAMES) {
+        const auto& columns = columnsOf(table);
+        if (std::find(columns.begin(), columns.end(), column) != columns.end()) return table;
+    }
+    return "";
+}
+
+// Declared width of a fixed-width CHAR(n) column; 0 for other columns
+inline size_t charWidth(const std::string& column) {
+    static const std::vector<std::pair<std::string, size_t>> widths = {
+        {"C_PHONE", 15}, {"C_MKTSEGMENT", 10}, {"O_ORDERSTATUS", 1}, {"O_ORDERPRIORITY", 15},
+        {"O_CLERK", 15}, {"L_RETURNFLAG", 1}, {"L_LINESTATUS", 1}, {"L_SHIPINSTRUCT", 25},
+        {"L_SHIPMODE", 10}, {"S_NAME", 25}, {"S_PHONE", 15}, {"N_NAME", 25}, {"R_NAME", 25}};
+    for (const auto& [name, width] : widths) {
+        if (name == column) return width;
+    }
+    return 0;
+}
+
+}
+
+#endif // TPCH_SCHEMA_HPP
@@ -0,0 +1,108 @@
+#ifndef TRACE_HPP
+#define TRACE_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <chrono>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// Always-on event tracing.
+//
+// Every thread writes begin/end events into its own fixed-size ring buffer
+// (single producer, no locks on the hot path). Buffers of exited threads are
+// recycled by the next new thread, so their lanes read like a thread pool in
+// the exported timeline. writeChromeTrace() dumps all buffers as Chrome /
+// Perfetto trace-event JSON (chrome://tracing, ui.perfetto.dev).
+//
+// Event names and categories are stored as pointers: pass string literals
+// or strings returned by intern().
+
+namespace Tracing {
+
+struct Event {
+    uint64_t tsc;
+    const char* name;
+    const char* category;
+    uint64_t arg;
+    char phase;       // 'B' begin, 'E' end, 'i' instant
+};
+
+constexpr size_t BUFFER_EVENTS = 1 << 13;
+
+struct ThreadBuffer {
+    Event events[BUFFER_EVENTS];
+    std::atomic<uint64_t> head{0};
+    int lane = 0;
+    const char* thread_name = "thread";
+};
+
+extern std::atomic<bool> tracing_enabled;
+
+// Buffer of the calling thread, acquired on first use
+ThreadBuffer* threadBuffer();
+
+inline uint64_t readClock() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+inline void record(char phase, const char* name, const char* category, uint64_t arg = 0) {
+    if (!tracing_enabled.load(std::memory_order_relaxed)) return;
+    ThreadBuffer* buffer = threadBuffer();
+    uint64_t head = buffer->head.load(std::memory_order_relaxed);
+    Event& event = buffer->events[head & (BUFFER_EVENTS - 1)];
+    event.tsc = readClock();
+    event.name = name;
+    event.category = category;
+    event.arg = arg;
+    event.phase = phase;
+    buffer->head.store(head + 1, std::memory_order_release);
+}
+
+inline void begin(const char* name, const char* category, uint64_t arg = 0) {
+    record('B', name, category, arg);
+}
+
+inline void end(const char* name, const char* category, uint64_t arg = 0) {
+    record('E', name, category, arg);
+}
+
+// Begin/end pair around a scope; the end event can carry a count (e.g. rows)
+class Scope {
+public:
+    Scope(const char* name, const char* category) : name_(name), category_(category) {
+        begin(name_, category_);
+    }
+    ~Scope() { end(name_, category_, arg_); }
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+    void setArg(uint64_t arg) { arg_ = arg; }
+private:
+    const char* name_;
+    const char* category_;
+    uint64_t arg_ = 0;
+};
+
+void setEnabled(bool enabled);
+
+// Names the calling thread's lane in the exported trace
+void setThreadName(const char* name);
+
+// Returns a pointer that stays valid for the lifetime of the process
+const char* intern(const std::string& str);
+
+// Writes all buffered events as trace-event JSON
+bool writeChromeTrace(const std::string& path);
+
+}
+
+#endif // TRACE_HPP
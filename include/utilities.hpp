@@ -1,10 +1,17 @@
+#ifndef UTILITIES_HPP
+#define UTILITIES_HPP
+
+#include <algorithm>
 #include <sstream>
 #include <vector>
 #include <string>
 #include <fstream>
 #include <map>
+#include "trace.hpp"
+#include "progress.hpp"
+#include "encoding.hpp"
 
-std::vector<std::string> splitPipe(const std::string& line)
+inline std::vector<std::string> splitPipe(const std::string& line)
 {
     std::vector<std::string> fields;
     std::stringstream ss(line);
@@ -17,27 +24,45 @@ std::vector<std::string> splitPipe(const std::string& line)
 }
 
 
-bool readTable(const std::string& file, const std::vector<std::string>& columns, std::vector<std::map<std::string, std::string>>& out)
+// Loads the given columns of a .tbl file, keeping only the rows that pass `filters`
+inline bool readTable(const std::string& file, const std::vector<std::string>& columns, std::vector<std::map<std::string, std::string>>& out, const std::vector<Columnar::Filter>& filters = {})
 {
+    Tracing::Scope trace_scope(Tracing::intern("read " + file), "io");
     std::ifstream in(file);
     if (!in) return false;
 
+    std::vector<size_t> filter_fields;
+    for (const auto& filter : filters)
+    {
+        auto it = std::find(columns.begin(), columns.end(), filter.column);
+        if (it == columns.end()) return false;
+        filter_fields.push_back(static_cast<size_t>(it - columns.begin()));
+    }
+
     std::string line;
+    Progress::Batch progress;
     while (std::getline(in, line))
     {
+        progress.add(line.size() + 1, 1);
         auto fields = splitPipe(line);
         if (fields.size() < columns.size()) return false;
 
+        bool keep = true;
+        for (size_t f = 0; keep && f < filters.size(); ++f)
+            keep = filters[f].matches(fields[filter_fields[f]]);
+        if (!keep) continue;
+
         std::map<std::string, std::string> row;
         for (size_t i = 0; i < columns.size(); ++i)
             row[columns[i]] = fields[i];
 
         out.push_back(std::move(row));
     }
+    trace_scope.setArg(out.size());
     return true;
 }
 
-std::string trim(const std::string& str) {
+inline std::string trim(const std::string& str) {
     size_t first = str.find_first_not_of(" \t\r\n");
     if (first == std::string::npos) return "";
     size_t last = str.find_last_not_of(" \t\r\n");
@@ -45,7 +70,7 @@ std::string trim(const std::string& str) {
 }
 
 
-std::vector<std::string> split(const std::string& s, char delimiter) {
+inline std::vector<std::string> split(const std::string& s, char delimiter) {
     std::vector<std::string> tokens;
     std::string token;
     std::istringstream tokenStream(s);
@@ -55,4 +80,4 @@ std::vector<std::string> split(const std::string& s, char delimiter) {
     return tokens;
 }
 
-
+#endif // UTILITIES_HPP
@@ -0,0 +1,46 @@
+#ifndef VALIDATION_HPP
+#define VALIDATION_HPP
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Result validation against reference answers.
+//
+// Revenues are compared as exact decimals with four fractional digits (the
+// precision of the TPC-H answer set): reference values are parsed without
+// going through floating point and computed values are rounded once, so a
+// difference in the last digit is a mismatch.
+
+namespace Validation {
+
+// Rows of a Q5 answer in output order, revenue in units of 1/10000
+struct Answer {
+    std::vector<std::pair<std::string, int64_t>> rows;
+};
+
+constexpr int DECIMAL_DIGITS = 4;
+
+// Parses a decimal string into units of 10^-DECIMAL_DIGITS, rounding extra digits half away from zero
+bool parseDecimal(const std::string& text, int64_t& value);
+std::string formatDecimal(int64_t value);
+
+// Answer from executeQuery5 results, ordered by revenue descending
+Answer fromResults(const std::map<std::string, double>& results);
+
+// Reads an answer file in the outputResults format (N_NAME|REVENUE header and lines)
+bool readAnswer(const std::string& path, Answer& answer);
+
+// Bundled answer for the validation parameters of the TPC-H specification
+// (Q5: ASIA, 1994-01-01) on dbgen data. Only SF1 is bundled, the scale factor
+// of the TPC-H answer set; false for other scale factors or a malformed entry
+bool builtinAnswer(const std::string& query, double scale_factor, Answer& answer);
+
+// Differences between two answers, one line each; empty when they agree
+std::vector<std::string> compare(const Answer& expected, const Answer& actual);
+
+}
+
+#endif // VALIDATION_HPP
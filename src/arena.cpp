@@ -0,0 +1,149 @@
+#include "../include/arena.hpp"
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+namespace Arena {
+
+namespace {
+constexpr size_t ALIGNMENT = 64;
+
+std::atomic<bool> arena_enabled{true};
+size_t limit_bytes = sizeof(void*) == 8 ? size_t(4) << 30 : size_t(256) << 20;
+
+// Reserved once; region_bytes is written before region is published
+std::once_flag reserve_once;
+std::atomic<char*> region{nullptr};
+size_t region_bytes = 0;
+
+std::atomic<size_t> region_cursor{0};
+std::atomic<bool> in_use{false};
+std::atomic<uint64_t> block_count{0};
+std::atomic<uint64_t> fallback_count{0};
+Stats last_stats;
+
+void reserveRegion() {
+    size_t bytes = limit_bytes / ALIGNMENT * ALIGNMENT;
+    if (bytes == 0) return;
+#ifdef _WIN32
+    void* base = VirtualAlloc(nullptr, bytes, MEM_RESERVE, PAGE_NOACCESS);
+    if (!base) return;
+#else
+    // Address space only; pages are backed on first touch
+    void* base = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (base == MAP_FAILED) return;
+#endif
+    region_bytes = bytes;
+    region.store(static_cast<char*>(base), std::memory_order_release);
+}
+
+// Takes `bytes` from the reserved range; nullptr when it is exhausted
+char* carve(size_t bytes) {
+    if (bytes > region_bytes) return nullptr;
+    // A request that does not fit leaves the cursor alone, so smaller ones still can
+    size_t offset = region_cursor.load(std::memory_order_relaxed);
+    do {
+        if (offset > region_bytes - bytes) return nullptr;
+    } while (!region_cursor.compare_exchange_weak(offset, offset + bytes, std::memory_order_relaxed));
+    char* span = region.load(std::memory_order_relaxed) + offset;
+#ifdef _WIN32
+    if (!VirtualAlloc(span, bytes, MEM_COMMIT, PAGE_READWRITE)) return nullptr;
+#endif
+    return span;
+}
+
+bool owns(const void* ptr) {
+    const char* base = region.load(std::memory_order_acquire);
+    const char* p = static_cast<const char*>(ptr);
+    return base && p >= base && p < base + region_bytes;
+}
+
+// Returns the pages of the used part of the range to the operating system
+void releasePages(size_t used) {
+    if (used == 0) return;
+    char* base = region.load(std::memory_order_relaxed);
+#ifdef _WIN32
+    VirtualFree(base, used, MEM_DECOMMIT);
+#elif defined(__linux__)
+    madvise(base, used, MADV_DONTNEED);
+#else
+    posix_madvise(base, used, POSIX_MADV_DONTNEED);
+#endif
+}
+
+// Upstream of the query pool: its chunks and the blocks too large for it are
+// bumped out of the range and only given back all at once, when the query
+// ends. The heap only serves what no longer fits in the range.
+class RegionResource : public std::pmr::memory_resource {
+protected:
+    void* do_allocate(size_t bytes, size_t alignment) override {
+        if (alignment <= ALIGNMENT) {
+            if (char* span = carve(std::max((bytes + ALIGNMENT - 1) & ~(ALIGNMENT - 1), ALIGNMENT))) {
+                block_count.fetch_add(1, std::memory_order_relaxed);
+                return span;
+            }
+            fallback_count.fetch_add(1, std::memory_order_relaxed);
+        }
+        return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    }
+    void do_deallocate(void* ptr, size_t bytes, size_t alignment) override {
+        if (!owns(ptr)) std::pmr::new_delete_resource()->deallocate(ptr, bytes, alignment);
+    }
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+};
+
+RegionResource region_resource;
+}
+
+void setEnabled(bool enabled) {
+    arena_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+bool isEnabled() {
+    return arena_enabled.load(std::memory_order_relaxed);
+}
+
+void setLimit(size_t bytes) {
+    if (!region.load(std::memory_order_acquire)) limit_bytes = bytes;
+}
+
+Stats lastQueryStats() {
+    return last_stats;
+}
+
+QueryScope::QueryScope() : resource_(std::pmr::get_default_resource()) {
+    if (!isEnabled()) return;
+    std::call_once(reserve_once, reserveRegion);
+    if (!region.load(std::memory_order_acquire) || in_use.exchange(true)) return;
+    region_cursor.store(0, std::memory_order_relaxed);
+    block_count.store(0, std::memory_order_relaxed);
+    fallback_count.store(0, std::memory_order_relaxed);
+    std::pmr::pool_options options;
+    options.largest_required_pool_block = LARGE_BYTES;
+    pool_ = std::make_unique<std::pmr::synchronized_pool_resource>(options, &region_resource);
+    resource_ = pool_.get();
+}
+
+QueryScope::~QueryScope() {
+    if (!pool_) return;
+    pool_.reset();
+    size_t used = std::min(region_cursor.load(std::memory_order_relaxed), region_bytes);
+    last_stats.used = true;
+    last_stats.bytes = used;
+    last_stats.blocks = block_count.load(std::memory_order_relaxed);
+    last_stats.fallback_allocations = fallback_count.load(std::memory_order_relaxed);
+    releasePages(used);
+    region_cursor.store(0, std::memory_order_relaxed);
+    in_use.store(false, std::memory_order_release);
+}
+
+}
@@ -0,0 +1,791 @@
+#include "../include/arrow.hpp"
+#include "../include/fastparse.hpp"
+#include "../include/trace.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace Arrow {
+
+namespace {
+
+const char MAGIC[6] = {'A', 'R', 'R', 'O', 'W', '1'};
+constexpr uint32_t CONTINUATION = 0xFFFFFFFF;
+constexpr int16_t METADATA_V5 = 4;
+
+// Union tags of the FlatBuffers schema (Schema.fbs, Message.fbs)
+enum TypeTag : uint8_t { TYPE_INT = 2, TYPE_FLOATING_POINT = 3, TYPE_UTF8 = 5, TYPE_DATE = 8 };
+enum HeaderTag : uint8_t { HEADER_SCHEMA = 1, HEADER_RECORD_BATCH = 3 };
+constexpr int16_t PRECISION_DOUBLE = 2;
+constexpr int16_t DATE_UNIT_DAY = 0;
+
+template <typename T>
+T load(const char* p) {
+    T value;
+    std::memcpy(&value, p, sizeof(T));
+    return value;
+}
+
+template <typename T>
+void append(std::string& out, T value) {
+    char bytes[sizeof(T)];
+    std::memcpy(bytes, &value, sizeof(T));
+    out.append(bytes, sizeof(T));
+}
+
+void padTo(std::string& out, size_t alignment) {
+    out.append((alignment - out.size() % alignment) % alignment, '\0');
+}
+
+// Appends one buffer of a record batch to its body, 8-byte aligned, and its
+// (offset, length) to the batch's buffer list
+void appendBuffer(std::string& body, std::string& buffers, const char* data, size_t length) {
+    append<int64_t>(buffers, static_cast<int64_t>(body.size()));
+    append<int64_t>(buffers, static_cast<int64_t>(length));
+    if (length) body.append(data, length);
+    padTo(body, 8);
+}
+
+// Writes a FlatBuffers buffer front to back: every object is written before
+// the objects it refers to, whose offsets are linked in once they exist, so
+// all references point forward as the format requires.
+class FlatBuilder {
+public:
+    // Inline field of a table: a scalar of `size` bytes or, with `offset`,
+    // a reference linked later
+    struct Slot {
+        uint16_t slot;
+        size_t size;
+        uint64_t value;
+        bool offset;
+    };
+
+    FlatBuilder() : bytes_(4, '\0') {}   // root table offset
+
+    // Writes a vtable and the table; `offsets` receives the positions of the
+    // reference fields in the order given
+    size_t table(const std::vector<Slot>& slots, std::vector<size_t>& offsets) {
+        uint16_t slot_count = 0;
+        for (const auto& s : slots) slot_count = std::max(slot_count, static_cast<uint16_t>(s.slot + 1));
+        std::vector<uint16_t> field_offsets(slot_count, 0);
+        uint16_t table_bytes = 4;   // soffset to the vtable
+        for (const auto& s : slots) {
+            table_bytes = static_cast<uint16_t>((table_bytes + s.size - 1) / s.size * s.size);
+            field_offsets[s.slot] = table_bytes;
+            table_bytes = static_cast<uint16_t>(table_bytes + s.size);
+        }
+        padTo(bytes_, 2);
+        size_t vtable = bytes_.size();
+        append<uint16_t>(bytes_, static_cast<uint16_t>(4 + 2 * slot_count));
+        append<uint16_t>(bytes_, table_bytes);
+        for (uint16_t offset : field_offsets) append<uint16_t>(bytes_, offset);
+        padTo(bytes_, 8);
+        size_t table = bytes_.size();
+        append<int32_t>(bytes_, static_cast<int32_t>(table - vtable));
+        bytes_.resize(table + table_bytes, '\0');
+        offsets.clear();
+        for (const auto& s : slots) {
+            size_t at = table + field_offsets[s.slot];
+            if (s.offset) offsets.push_back(at);
+            else std::memcpy(&bytes_[at], &s.value, s.size);   // little endian
+        }
+        return table;
+    }
+    size_t table(const std::vector<Slot>& slots) {
+        std::vector<size_t> offsets;
+        return table(slots, offsets);
+    }
+
+    size_t string(const std::string& value) {
+        padTo(bytes_, 4);
+        size_t position = bytes_.size();
+        append<uint32_t>(bytes_, static_cast<uint32_t>(value.size()));
+        bytes_ += value;
+        bytes_ += '\0';
+        return position;
+    }
+
+    // Vector of `count` references; `elements` receives their positions
+    size_t offsetVector(size_t count, std::vector<size_t>& elements) {
+        padTo(bytes_, 4);
+        size_t position = bytes_.size();
+        append<uint32_t>(bytes_, static_cast<uint32_t>(count));
+        elements.clear();
+        for (size_t i = 0; i < count; i++) {
+            elements.push_back(bytes_.size());
+            append<uint32_t>(bytes_, 0);
+        }
+        return position;
+    }
+
+    // Vector of `count` structs of 8-byte alignment, given as their bytes
+    size_t structVector(const std::string& structs, size_t count) {
+        padTo(bytes_, 4);
+        if (bytes_.size() % 8 == 0) append<uint32_t>(bytes_, 0);
+        size_t position = bytes_.size();
+        append<uint32_t>(bytes_, static_cast<uint32_t>(count));
+        bytes_ += structs;
+        return position;
+    }
+
+    void link(size_t at, size_t target) {
+        uint32_t relative = static_cast<uint32_t>(target - at);
+        std::memcpy(&bytes_[at], &relative, sizeof(relative));
+    }
+
+    std::string finish(size_t root) {
+        link(0, root);
+        padTo(bytes_, 8);
+        return std::move(bytes_);
+    }
+
+private:
+    std::string bytes_;
+};
+
+// Bounds-checked view of a FlatBuffers table; lookups of missing or
+// malformed fields fail instead of reading outside the buffer
+class FlatTable {
+public:
+    static bool root(const char* base, size_t size, FlatTable& out) {
+        return size >= 4 && out.init(base, size, load<uint32_t>(base));
+    }
+
+    template <typename T>
+    T scalar(uint16_t slot, T fallback) const {
+        size_t at = field(slot);
+        return at && at + sizeof(T) <= size_ ? load<T>(base_ + at) : fallback;
+    }
+    bool table(uint16_t slot, FlatTable& out) const {
+        size_t at = target(slot);
+        return at && out.init(base_, size_, at);
+    }
+    bool string(uint16_t slot, std::string& out) const {
+        size_t first = 0, count = 0;
+        if (!vector(slot, 1, first, count)) return false;
+        out.assign(base_ + first, count);
+        return true;
+    }
+    // Position of the first of `count` elements of `element_size` bytes
+    bool vector(uint16_t slot, size_t element_size, size_t& first, size_t& count) const {
+        size_t at = target(slot);
+        if (!at || at + 4 > size_) return false;
+        count = load<uint32_t>(base_ + at);
+        first = at + 4;
+        return count <= (size_ - first) / element_size;
+    }
+    // Table referenced by element `index` of a vector of tables starting at `first`
+    bool element(size_t first, size_t index, FlatTable& out) const {
+        size_t at = first + 4 * index;
+        return at + 4 <= size_ && out.init(base_, size_, at + load<uint32_t>(base_ + at));
+    }
+    const char* base() const { return base_; }
+
+private:
+    bool init(const char* base, size_t size, uint64_t position) {
+        base_ = base;
+        size_ = size;
+        if (position + 4 > size || position % 4 != 0) return false;
+        int64_t vtable = static_cast<int64_t>(position) - load<int32_t>(base + position);
+        if (vtable < 0 || static_cast<uint64_t>(vtable) + 4 > size || vtable % 2 != 0) return false;
+        vtable_ = static_cast<size_t>(vtable);
+        vtable_bytes_ = load<uint16_t>(base + vtable_);
+        table_bytes_ = load<uint16_t>(base + vtable_ + 2);
+        position_ = static_cast<size_t>(position);
+        return vtable_bytes_ >= 4 && vtable_ + vtable_bytes_ <= size && position_ + table_bytes_ <= size;
+    }
+    size_t field(uint16_t slot) const {
+        size_t entry = 4 + 2 * size_t(slot);
+        if (entry + 2 > vtable_bytes_) return 0;
+        uint16_t offset = load<uint16_t>(base_ + vtable_ + entry);
+        return offset && offset < table_bytes_ ? position_ + offset : 0;
+    }
+    size_t target(uint16_t slot) const {
+        size_t at = field(slot);
+        if (!at || at + 4 > size_) return 0;
+        uint64_t target = uint64_t(at) + load<uint32_t>(base_ + at);
+        return target < size_ ? static_cast<size_t>(target) : 0;
+    }
+
+    const char* base_ = nullptr;
+    size_t size_ = 0;
+    size_t position_ = 0;
+    size_t vtable_ = 0;
+    uint16_t vtable_bytes_ = 0;
+    uint16_t table_bytes_ = 0;
+};
+
+uint8_t typeTag(Type type) {
+    switch (type) {
+    case Type::INT32:
+    case Type::INT64: return TYPE_INT;
+    case Type::FLOAT64: return TYPE_FLOATING_POINT;
+    case Type::DATE32: return TYPE_DATE;
+    case Type::UTF8: break;
+    }
+    return TYPE_UTF8;
+}
+
+size_t typeTable(FlatBuilder& builder, Type type) {
+    switch (type) {
+    case Type::INT32:
+    case Type::INT64:   // bitWidth, is_signed
+        return builder.table({{0, 4, type == Type::INT32 ? 32u : 64u, false}, {1, 1, 1, false}});
+    case Type::FLOAT64:   // precision
+        return builder.table({{0, 2, static_cast<uint64_t>(PRECISION_DOUBLE), false}});
+    case Type::DATE32:   // unit, written although DAY is not the default
+        return builder.table({{0, 2, static_cast<uint64_t>(DATE_UNIT_DAY), false}});
+    case Type::UTF8: break;
+    }
+    return builder.table({});
+}
+
+// Schema table (endianness little by default, fields) and its fields
+size_t schemaTable(FlatBuilder& builder, const std::vector<Field>& fields) {
+    std::vector<size_t> schema_links, elements, field_links, children;
+    size_t schema = builder.table({{1, 4, 0, true}}, schema_links);
+    builder.link(schema_links[0], builder.offsetVector(fields.size(), elements));
+    for (size_t i = 0; i < fields.size(); i++) {
+        // name, nullable, type tag, type, children (required even when empty)
+        size_t field = builder.table({{0, 4, 0, true}, {1, 1, fields[i].nullable ? 1u : 0u, false},
+                                      {2, 1, typeTag(fields[i].type), false}, {3, 4, 0, true}, {5, 4, 0, true}},
+                                     field_links);
+        builder.link(elements[i], field);
+        builder.link(field_links[0], builder.string(fields[i].name));
+        builder.link(field_links[1], typeTable(builder, fields[i].type));
+        builder.link(field_links[2], builder.offsetVector(0, children));
+    }
+    return schema;
+}
+
+// Message table wrapping a Schema or RecordBatch header written by `header`
+template <typename Header>
+std::string message(uint8_t header_tag, int64_t body_bytes, Header header) {
+    FlatBuilder builder;
+    std::vector<size_t> links;
+    size_t root = builder.table({{0, 2, static_cast<uint64_t>(METADATA_V5), false}, {1, 1, header_tag, false},
+                                 {2, 4, 0, true}, {3, 8, static_cast<uint64_t>(body_bytes), false}}, links);
+    builder.link(links[0], header(builder));
+    return builder.finish(root);
+}
+
+bool parseField(const FlatTable& table, Field& field, std::string& error) {
+    if (!table.string(0, field.name)) {
+        error = "field without a name";
+        return false;
+    }
+    field.nullable = table.scalar<uint8_t>(1, 0) != 0;
+    FlatTable type, dictionary;
+    size_t first = 0, children = 0;
+    if (table.table(4, dictionary) || (table.vector(5, 4, first, children) && children > 0)) {
+        error = "field " + field.name + " is dictionary encoded or nested";
+        return false;
+    }
+    uint8_t tag = table.scalar<uint8_t>(2, 0);
+    bool has_type = table.table(3, type);
+    if (tag == TYPE_UTF8) {
+        field.type = Type::UTF8;
+    } else if (tag == TYPE_INT && has_type && type.scalar<uint8_t>(1, 0) &&
+               (type.scalar<int32_t>(0, 0) == 32 || type.scalar<int32_t>(0, 0) == 64)) {
+        field.type = type.scalar<int32_t>(0, 0) == 32 ? Type::INT32 : Type::INT64;
+    } else if (tag == TYPE_FLOATING_POINT && has_type && type.scalar<int16_t>(0, 0) == PRECISION_DOUBLE) {
+        field.type = Type::FLOAT64;
+    } else if (tag == TYPE_DATE && has_type && type.scalar<int16_t>(0, 1) == DATE_UNIT_DAY) {
+        field.type = Type::DATE32;
+    } else {
+        error = "field " + field.name + " has an unsupported type";
+        return false;
+    }
+    return true;
+}
+
+bool parseSchema(const FlatTable& schema, std::vector<Field>& fields, std::string& error) {
+    size_t first = 0, count = 0;
+    if (schema.scalar<int16_t>(0, 0) != 0 || !schema.vector(1, 4, first, count)) {
+        error = "big-endian or malformed schema";
+        return false;
+    }
+    fields.assign(count, Field());
+    for (size_t i = 0; i < count; i++) {
+        FlatTable field;
+        if (!schema.element(first, i, field)) {
+            error = "malformed field";
+            return false;
+        }
+        if (!parseField(field, fields[i], error)) return false;
+    }
+    return true;
+}
+
+// Bytes of fixed-width values of a type
+size_t valueBytes(Type type) {
+    return type == Type::INT64 || type == Type::FLOAT64 ? 8 : 4;
+}
+
+std::string formatDate(int32_t days) {
+    int32_t year = 0;
+    uint32_t month = 0, day = 0;
+    FastParse::civilFromDays(days, year, month, day);
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%04d-%02u-%02u", year, month, day);
+    return buffer;
+}
+
+// Shortest of 15 or 17 significant digits that reads back as the same double
+std::string formatNumber(double value) {
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%.15g", value);
+    if (FastParse::toDouble(buffer) != value) std::snprintf(buffer, sizeof(buffer), "%.17g", value);
+    return buffer;
+}
+
+}
+
+std::string_view Column::text(int64_t row) const {
+    return std::string_view(data + offsets[row], static_cast<size_t>(offsets[row + 1] - offsets[row]));
+}
+
+int64_t Column::integer(int64_t row) const {
+    return type == Type::INT64 ? load<int64_t>(data + 8 * row) : load<int32_t>(data + 4 * row);
+}
+
+double Column::number(int64_t row) const {
+    return load<double>(data + 8 * row);
+}
+
+std::string Column::value(int64_t row) const {
+    if (isNull(row)) return std::string();
+    switch (type) {
+    case Type::UTF8: return std::string(text(row));
+    case Type::INT32:
+    case Type::INT64: return std::to_string(integer(row));
+    case Type::FLOAT64: return formatNumber(number(row));
+    case Type::DATE32: return formatDate(static_cast<int32_t>(integer(row)));
+    }
+    return std::string();
+}
+
+File::~File() {
+    unmap();
+}
+
+void File::unmap() {
+    if (!data_) return;
+#ifdef _WIN32
+    UnmapViewOfFile(data_);
+    CloseHandle(reinterpret_cast<HANDLE>(handle_));
+#else
+    munmap(const_cast<char*>(data_), bytes_);
+#endif
+    data_ = nullptr;
+    bytes_ = 0;
+    handle_ = -1;
+}
+
+bool File::open(const std::string& path, std::string& error) {
+    unmap();
+    schema_.clear();
+    batches_.clear();
+    rows_ = 0;
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL, nullptr);
+    LARGE_INTEGER size = {};
+    if (file == INVALID_HANDLE_VALUE || !GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+        if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+        error = "cannot open " + path;
+        return false;
+    }
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(file);
+    void* base = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+    if (!base) {
+        if (mapping) CloseHandle(mapping);
+        error = "cannot map " + path;
+        return false;
+    }
+    handle_ = reinterpret_cast<intptr_t>(mapping);
+    bytes_ = static_cast<uint64_t>(size.QuadPart);
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    struct stat st;
+    void* base = MAP_FAILED;
+    if (fd >= 0 && fstat(fd, &st) == 0 && st.st_size > 0) {
+        bytes_ = static_cast<uint64_t>(st.st_size);
+        base = mmap(nullptr, bytes_, PROT_READ, MAP_SHARED, fd, 0);
+    }
+    if (fd >= 0) ::close(fd);
+    if (base == MAP_FAILED) {
+        bytes_ = 0;
+        error = "cannot map " + path;
+        return false;
+    }
+#endif
+    data_ = static_cast<const char*>(base);
+
+    // Magic at both ends, the footer before the trailing size and magic
+    if (bytes_ < 8 + 10 || std::memcmp(data_, MAGIC, 6) != 0 || std::memcmp(data_ + bytes_ - 6, MAGIC, 6) != 0) {
+        error = path + " is not an Arrow IPC file";
+        unmap();
+        return false;
+    }
+    int32_t footer_bytes = load<int32_t>(data_ + bytes_ - 10);
+    FlatTable footer, schema;
+    size_t first = 0, count = 0, dictionary_first = 0, dictionaries = 0;
+    if (footer_bytes <= 0 || static_cast<uint64_t>(footer_bytes) > bytes_ - 18 ||
+        !FlatTable::root(data_ + bytes_ - 10 - footer_bytes, static_cast<size_t>(footer_bytes), footer) ||
+        !footer.table(1, schema) || !footer.vector(3, 24, first, count)) {
+        error = path + " has a malformed footer";
+        unmap();
+        return false;
+    }
+    if (footer.vector(2, 24, dictionary_first, dictionaries) && dictionaries > 0) {
+        error = path + " has dictionary batches, which are not supported";
+        unmap();
+        return false;
+    }
+    if (!parseSchema(schema, schema_, error)) {
+        error = path + ": " + error;
+        unmap();
+        return false;
+    }
+    const char* blocks = footer.base() + first;
+    for (size_t i = 0; i < count; i++) {
+        BlockInfo block{load<int64_t>(blocks + 24 * i), load<int32_t>(blocks + 24 * i + 8),
+                        load<int64_t>(blocks + 24 * i + 16)};
+        batches_.push_back(block);
+    }
+    for (size_t i = 0; i < batches_.size(); i++) {
+        RecordBatch batch;
+        if (!this->batch(i, batch, error)) {
+            error = path + ": " + error;
+            unmap();
+            return false;
+        }
+        rows_ += batch.rows;
+    }
+    return true;
+}
+
+bool File::batch(size_t index, RecordBatch& out, std::string& error) const {
+    const BlockInfo& block = batches_.at(index);
+    const uint64_t file_end = bytes_ - 10;
+    if (block.offset < 8 || block.metadata_bytes < 8 || block.body_bytes < 0 ||
+        static_cast<uint64_t>(block.offset) + block.metadata_bytes + block.body_bytes > file_end) {
+        error = "record batch " + std::to_string(index) + " lies outside the file";
+        return false;
+    }
+    // Metadata after the continuation marker and its size (or only the size, pre-1.0 files)
+    const char* message_data = data_ + block.offset;
+    size_t prefix = load<uint32_t>(message_data) == CONTINUATION ? 8 : 4;
+    int32_t flat_bytes = load<int32_t>(message_data + prefix - 4);
+    FlatTable message, header;
+    size_t node_first = 0, node_count = 0, buffer_first = 0, buffer_count = 0;
+    FlatTable compression;
+    if (flat_bytes <= 0 || prefix + flat_bytes > static_cast<size_t>(block.metadata_bytes) ||
+        !FlatTable::root(message_data + prefix, static_cast<size_t>(flat_bytes), message) ||
+        message.scalar<uint8_t>(1, 0) != HEADER_RECORD_BATCH || !message.table(2, header) ||
+        !header.vector(1, 16, node_first, node_count) || !header.vector(2, 16, buffer_first, buffer_count) ||
+        header.table(3, compression)) {
+        error = "record batch " + std::to_string(index) + " is malformed or compressed";
+        return false;
+    }
+    out.rows = header.scalar<int64_t>(0, 0);
+    out.columns.assign(schema_.size(), Column());
+    const char* body = message_data + block.metadata_bytes;
+    const char* nodes = header.base() + node_first;
+    const char* buffers = header.base() + buffer_first;
+    size_t next_buffer = 0;
+    // Next buffer of the body, checked against the body and the element alignment
+    auto locate = [&](const char*& data, int64_t& length, size_t alignment) {
+        if (next_buffer >= buffer_count) return false;
+        int64_t offset = load<int64_t>(buffers + 16 * next_buffer);
+        length = load<int64_t>(buffers + 16 * next_buffer + 8);
+        next_buffer++;
+        if (offset < 0 || length < 0 || offset + length > block.body_bytes) return false;
+        data = body + offset;
+        return reinterpret_cast<uintptr_t>(data) % alignment == 0;
+    };
+    if (node_count != schema_.size()) {
+        error = "record batch " + std::to_string(index) + " does not match the schema";
+        return false;
+    }
+    for (size_t c = 0; c < schema_.size(); c++) {
+        Column& column = out.columns[c];
+        column.type = schema_[c].type;
+        column.length = load<int64_t>(nodes + 16 * c);
+        column.null_count = load<int64_t>(nodes + 16 * c + 8);
+        const char* validity = nullptr;
+        const char* values = nullptr;
+        int64_t validity_bytes = 0, values_bytes = 0;
+        bool ok = column.length == out.rows && column.null_count >= 0 && locate(validity, validity_bytes, 1);
+        if (ok && column.null_count > 0) {
+            ok = validity_bytes >= (column.length + 7) / 8;
+            column.validity = reinterpret_cast<const uint8_t*>(validity);
+        }
+        if (ok && column.type == Type::UTF8) {
+            const char* offsets = nullptr;
+            int64_t offsets_bytes = 0;
+            ok = locate(offsets, offsets_bytes, 4) && offsets_bytes >= 4 * (column.length + 1) &&
+                 locate(values, values_bytes, 1);
+            column.offsets = reinterpret_cast<const int32_t*>(offsets);
+            // Offsets must ascend within the data buffer for text() to stay in bounds
+            for (int64_t r = 0; ok && r <= column.length; r++) {
+                int32_t offset = column.offsets[r];
+                ok = offset >= 0 && offset <= values_bytes && (r == 0 || offset >= column.offsets[r - 1]);
+            }
+        } else if (ok) {
+            size_t width = valueBytes(column.type);
+            ok = locate(values, values_bytes, width) && values_bytes >= static_cast<int64_t>(width) * column.length;
+        }
+        column.data = values;
+        if (!ok) {
+            error = "column " + schema_[c].name + " of record batch " + std::to_string(index) + " is malformed";
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Writer::open(const std::string& path, const std::vector<Field>& fields) {
+    out_.open(path, std::ios::binary | std::ios::trunc);
+    if (!out_.is_open()) return false;
+    fields_ = fields;
+    blocks_.clear();
+    std::string bytes(MAGIC, 6);
+    bytes.append(2, '\0');
+    std::string schema = message(HEADER_SCHEMA, 0, [&](FlatBuilder& b) { return schemaTable(b, fields_); });
+    append<uint32_t>(bytes, CONTINUATION);
+    append<int32_t>(bytes, static_cast<int32_t>(schema.size()));
+    bytes += schema;
+    out_.write(bytes.data(), bytes.size());
+    position_ = bytes.size();
+    return out_.good();
+}
+
+bool Writer::appendBatch(const std::vector<std::string>& fields, size_t rows) {
+    const size_t num_columns = fields_.size();
+    if (fields.size() < rows * num_columns) return false;
+    std::string body, nodes, buffers;
+    auto addBuffer = [&](const char* data, size_t length) { appendBuffer(body, buffers, data, length); };
+    std::vector<uint8_t> validity((rows + 7) / 8);
+    std::string values;
+    for (size_t c = 0; c < num_columns; c++) {
+        const Type type = fields_[c].type;
+        std::fill(validity.begin(), validity.end(), 0);
+        values.clear();
+        int64_t nulls = 0;
+        if (type == Type::UTF8) {
+            // Strings are never null; "" is an empty value
+            std::string data;
+            append<int32_t>(values, 0);
+            for (size_t r = 0; r < rows; r++) {
+                data += fields[r * num_columns + c];
+                if (data.size() > INT32_MAX) return false;
+                append<int32_t>(values, static_cast<int32_t>(data.size()));
+            }
+            addBuffer(nullptr, 0);
+            addBuffer(values.data(), values.size());
+            addBuffer(data.data(), data.size());
+        } else {
+            for (size_t r = 0; r < rows; r++) {
+                const std::string& text = fields[r * num_columns + c];
+                int64_t integer = 0;
+                int32_t day = 0;
+                bool present = !text.empty();
+                if (present) validity[r / 8] |= static_cast<uint8_t>(1u << (r % 8));
+                else nulls++;
+                if (type == Type::FLOAT64) {
+                    append<double>(values, present ? FastParse::toDouble(text) : 0.0);
+                } else if (type == Type::DATE32) {
+                    if (present && !FastParse::parseDate(text, day)) return false;
+                    append<int32_t>(values, present ? day : 0);
+                } else {
+                    if (present && !FastParse::parseInt(text, integer)) return false;
+                    if (type == Type::INT64) append<int64_t>(values, integer);
+                    else append<int32_t>(values, static_cast<int32_t>(integer));
+                }
+            }
+            if (nulls > 0) addBuffer(reinterpret_cast<const char*>(validity.data()), validity.size());
+            else addBuffer(nullptr, 0);
+            addBuffer(values.data(), values.size());
+        }
+        append<int64_t>(nodes, static_cast<int64_t>(rows));
+        append<int64_t>(nodes, nulls);
+    }
+    return writeBatch(body, nodes, buffers, rows);
+}
+
+bool Writer::appendBatch(const std::vector<ColumnValues>& columns, size_t rows) {
+    const size_t num_columns = fields_.size();
+    if (columns.size() != num_columns) return false;
+    std::string body, nodes, buffers;
+    auto addBuffer = [&](const char* data, size_t length) { appendBuffer(body, buffers, data, length); };
+    std::string values;
+    for (size_t c = 0; c < num_columns; c++) {
+        const Type type = fields_[c].type;
+        const ColumnValues& column = columns[c];
+        values.clear();
+        addBuffer(nullptr, 0);   // no validity bitmap: nothing is null
+        if (type == Type::UTF8) {
+            if (!column.text && rows > 0) return false;
+            std::string data;
+            append<int32_t>(values, 0);
+            for (size_t r = 0; r < rows; r++) {
+                data.append(column.text[r].data(), column.text[r].size());
+                if (data.size() > INT32_MAX) return false;
+                append<int32_t>(values, static_cast<int32_t>(data.size()));
+            }
+            addBuffer(values.data(), values.size());
+            addBuffer(data.data(), data.size());
+        } else if (type == Type::FLOAT64) {
+            if (!column.numbers && rows > 0) return false;
+            addBuffer(reinterpret_cast<const char*>(column.numbers), rows * sizeof(double));
+        } else if (type == Type::INT64) {
+            if (!column.integers && rows > 0) return false;
+            addBuffer(reinterpret_cast<const char*>(column.integers), rows * sizeof(int64_t));
+        } else {
+            // INT32 and DATE32 narrow to 32 bits
+            if (!column.integers && rows > 0) return false;
+            for (size_t r = 0; r < rows; r++) {
+                if (column.integers[r] < INT32_MIN || column.integers[r] > INT32_MAX) return false;
+                append<int32_t>(values, static_cast<int32_t>(column.integers[r]));
+            }
+            addBuffer(values.data(), values.size());
+        }
+        append<int64_t>(nodes, static_cast<int64_t>(rows));
+        append<int64_t>(nodes, 0);
+    }
+    return writeBatch(body, nodes, buffers, rows);
+}
+
+bool Writer::writeBatch(const std::string& body, const std::string& nodes, const std::string& buffers, size_t rows) {
+    const size_t num_columns = fields_.size();
+    // RecordBatch: length, nodes, buffers
+    std::string metadata = message(HEADER_RECORD_BATCH, static_cast<int64_t>(body.size()), [&](FlatBuilder& b) {
+        std::vector<size_t> links;
+        size_t batch = b.table({{0, 8, static_cast<uint64_t>(rows), false}, {1, 4, 0, true}, {2, 4, 0, true}}, links);
+        b.link(links[0], b.structVector(nodes, num_columns));
+        b.link(links[1], b.structVector(buffers, buffers.size() / 16));
+        return batch;
+    });
+    std::string bytes;
+    append<uint32_t>(bytes, CONTINUATION);
+    append<int32_t>(bytes, static_cast<int32_t>(metadata.size()));
+    bytes += metadata;
+
+    // Footer Block: offset, metadata length (prefix included), padding, body length
+    std::string block;
+    append<int64_t>(block, static_cast<int64_t>(position_));
+    append<int32_t>(block, static_cast<int32_t>(bytes.size()));
+    append<int32_t>(block, 0);
+    append<int64_t>(block, static_cast<int64_t>(body.size()));
+    blocks_.push_back(block);
+
+    out_.write(bytes.data(), bytes.size());
+    out_.write(body.data(), body.size());
+    position_ += bytes.size() + body.size();
+    return out_.good();
+}
+
+bool Writer::close() {
+    if (!out_.is_open()) return false;
+    // End-of-stream marker for stream readers, then the footer
+    std::string bytes;
+    append<uint32_t>(bytes, CONTINUATION);
+    append<int32_t>(bytes, 0);
+    FlatBuilder builder;
+    std::vector<size_t> links;
+    size_t footer = builder.table({{0, 2, static_cast<uint64_t>(METADATA_V5), false}, {1, 4, 0, true},
+                                   {2, 4, 0, true}, {3, 4, 0, true}}, links);
+    builder.link(links[0], schemaTable(builder, fields_));
+    builder.link(links[1], builder.structVector("", 0));
+    std::string blocks;
+    for (const auto& block : blocks_) blocks += block;
+    builder.link(links[2], builder.structVector(blocks, blocks_.size()));
+    std::string flat = builder.finish(footer);
+    bytes += flat;
+    append<int32_t>(bytes, static_cast<int32_t>(flat.size()));
+    bytes.append(MAGIC, 6);
+    out_.write(bytes.data(), bytes.size());
+    out_.close();
+    return !out_.fail();
+}
+
+std::vector<Field> textFields(const std::vector<std::string>& columns) {
+    std::vector<Field> fields;
+    for (const auto& column : columns) fields.push_back({column, Type::UTF8, false});
+    return fields;
+}
+
+bool readTable(const std::string& path, const std::vector<std::string>& columns,
+               std::vector<std::map<std::string, std::string>>& out, const std::vector<Columnar::Filter>& filters) {
+    Tracing::Scope trace_scope(Tracing::intern("read " + path), "io");
+    File file;
+    std::string error;
+    if (!file.open(path, error)) return false;
+    auto find = [&](const std::string& column, size_t& c) {
+        for (c = 0; c < file.schema().size(); c++)
+            if (file.schema()[c].name == column) return true;
+        return false;
+    };
+    std::vector<size_t> wanted(columns.size()), filter_columns(filters.size());
+    for (size_t i = 0; i < columns.size(); i++)
+        if (!find(columns[i], wanted[i])) return false;
+    for (size_t f = 0; f < filters.size(); f++)
+        if (!find(filters[f].column, filter_columns[f])) return false;
+    if (filters.empty()) out.reserve(out.size() + static_cast<size_t>(file.rows()));
+    auto valueOf = [](const Column& column, int64_t r) {
+        return column.type == Type::UTF8 && !column.isNull(r) ? std::string(column.text(r)) : column.value(r);
+    };
+    size_t first_row = out.size();
+    RecordBatch batch;
+    for (size_t b = 0; b < file.batchCount(); b++) {
+        if (!file.batch(b, batch, error)) return false;
+        for (int64_t r = 0; r < batch.rows; r++) {
+            bool keep = true;
+            for (size_t f = 0; keep && f < filters.size(); f++) {
+                const Column& column = batch.columns[filter_columns[f]];
+                keep = column.type == Type::UTF8 && !column.isNull(r) ? filters[f].matches(column.text(r))
+                                                                      : filters[f].matches(column.value(r));
+            }
+            if (!keep) continue;
+            std::map<std::string, std::string> row;
+            for (size_t i = 0; i < columns.size(); i++) row.emplace(columns[i], valueOf(batch.columns[wanted[i]], r));
+            out.push_back(std::move(row));
+        }
+    }
+    trace_scope.setArg(static_cast<uint64_t>(out.size() - first_row));
+    return true;
+}
+
+bool writeTable(const std::string& path, const std::vector<std::string>& columns,
+                const std::vector<std::map<std::string, std::string>>& table, size_t rows_per_batch) {
+    Writer writer;
+    if (!writer.open(path, textFields(columns))) return false;
+    std::vector<std::string> fields;
+    for (size_t start = 0; start < table.size(); start += rows_per_batch) {
+        size_t count = std::min(rows_per_batch, table.size() - start);
+        fields.clear();
+        for (size_t r = start; r < start + count; r++) {
+            for (const auto& column : columns) {
+                auto it = table[r].find(column);
+                fields.push_back(it == table[r].end() ? std::string() : it->second);
+            }
+        }
+        if (!writer.appendBatch(fields, count)) return false;
+    }
+    return writer.close();
+}
+
+}
@@ -0,0 +1,226 @@
+#include "../include/baseline.hpp"
+#include "../include/json.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+#define popen _popen
+#define pclose _pclose
+#endif
+
+namespace Baseline {
+
+namespace {
+double median(std::vector<double> values) {
+    std::sort(values.begin(), values.end());
+    size_t n = values.size();
+    return n % 2 ? values[n / 2] : (values[n / 2 - 1] + values[n / 2]) / 2;
+}
+
+double normalCdf(double x) {
+    return 0.5 * std::erfc(-x / std::sqrt(2.0));
+}
+
+// Inverse of normalCdf by bisection; precise enough for confidence levels
+double normalQuantile(double p) {
+    double lo = -10, hi = 10;
+    for (int i = 0; i < 100; i++) {
+        double mid = (lo + hi) / 2;
+        (normalCdf(mid) < p ? lo : hi) = mid;
+    }
+    return (lo + hi) / 2;
+}
+
+// Two-sided p-value of the Mann-Whitney U test with tie correction
+double mannWhitneyP(const std::vector<double>& a, const std::vector<double>& b) {
+    std::vector<std::pair<double, int>> all;
+    for (double v : a) all.emplace_back(v, 0);
+    for (double v : b) all.emplace_back(v, 1);
+    std::sort(all.begin(), all.end());
+
+    double n = static_cast<double>(all.size());
+    double rank_sum_a = 0, tie_term = 0;
+    for (size_t i = 0; i < all.size();) {
+        size_t j = i;
+        while (j < all.size() && all[j].first == all[i].first) j++;
+        double ties = static_cast<double>(j - i);
+        double rank = (i + 1 + j) / 2.0;  // average of ranks i+1 .. j
+        for (size_t k = i; k < j; k++)
+            if (all[k].second == 0) rank_sum_a += rank;
+        tie_term += ties * ties * ties - ties;
+        i = j;
+    }
+
+    double m = static_cast<double>(a.size()), k = static_cast<double>(b.size());
+    double u = rank_sum_a - m * (m + 1) / 2;
+    double variance = m * k / 12 * ((n + 1) - tie_term / (n * (n - 1)));
+    if (variance <= 0) return 1.0;
+    double z = std::max(0.0, std::fabs(u - m * k / 2) - 0.5) / std::sqrt(variance);
+    return std::erfc(z / std::sqrt(2.0));
+}
+
+void writeRun(std::ostream& out, const Run& run) {
+    out << "    {\"commit\": " << jsonQuote(run.commit)
+        << ", \"machine\": " << jsonQuote(run.machine)
+        << ", \"timestamp\": " << jsonQuote(run.timestamp)
+        << ", \"metrics\": {";
+    bool first = true;
+    for (const auto& [metric, samples] : run.metrics) {
+        out << (first ? "\n" : ",\n") << "      " << jsonQuote(metric) << ": [";
+        for (size_t i = 0; i < samples.size(); i++) out << (i ? ", " : "") << samples[i];
+        out << "]";
+        first = false;
+    }
+    out << (run.metrics.empty() ? "}}" : "\n    }}");
+}
+}
+
+bool loadStore(const std::string& path, std::vector<Run>& runs) {
+    runs.clear();
+    std::ifstream file(path);
+    if (!file.is_open()) return true;
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+
+    JsonValue document;
+    if (!parseJson(buffer.str(), document)) return false;
+    const JsonValue* list = document.find("runs");
+    if (!list || list->type != JsonValue::ARRAY) return false;
+    for (const auto& entry : list->array) {
+        const JsonValue* commit = entry.find("commit");
+        const JsonValue* machine = entry.find("machine");
+        const JsonValue* timestamp = entry.find("timestamp");
+        const JsonValue* metrics = entry.find("metrics");
+        if (!commit || !machine || !metrics || metrics->type != JsonValue::OBJECT) return false;
+        Run run;
+        run.commit = commit->string;
+        run.machine = machine->string;
+        run.timestamp = timestamp ? timestamp->string : "";
+        for (const auto& [name, samples] : metrics->object) {
+            if (samples.type != JsonValue::ARRAY) return false;
+            std::vector<double>& values = run.metrics[name];
+            for (const auto& sample : samples.array) {
+                if (sample.type != JsonValue::NUMBER) return false;
+                values.push_back(sample.number);
+            }
+        }
+        runs.push_back(std::move(run));
+    }
+    return true;
+}
+
+bool saveRun(const std::string& path, std::vector<Run>& runs, const Run& run) {
+    runs.erase(std::remove_if(runs.begin(), runs.end(), [&run](const Run& r) {
+        return r.commit == run.commit && r.machine == run.machine;
+    }), runs.end());
+    runs.push_back(run);
+
+    std::ofstream file(path, std::ios::trunc);
+    if (!file.is_open()) return false;
+    file.precision(10);
+    file << "{\n  \"runs\": [";
+    for (size_t i = 0; i < runs.size(); i++) {
+        file << (i == 0 ? "\n" : ",\n");
+        writeRun(file, runs[i]);
+    }
+    file << (runs.empty() ? "]\n}\n" : "\n  ]\n}\n");
+    return static_cast<bool>(file);
+}
+
+std::string machineFingerprint() {
+    std::string host = "unknown-host";
+#if defined(__unix__) || defined(__APPLE__)
+    char name[256] = {};
+    if (gethostname(name, sizeof(name) - 1) == 0) host = name;
+#endif
+    std::string cpu = "unknown-cpu";
+    std::ifstream cpuinfo("/proc/cpuinfo");
+    for (std::string line; std::getline(cpuinfo, line);) {
+        if (line.compare(0, 10, "model name") == 0 && line.find(':') != std::string::npos) {
+            cpu = line.substr(line.find(':') + 2);
+            break;
+        }
+    }
+#if defined(__clang__)
+    std::string compiler = "clang " __clang_version__;
+#elif defined(__GNUC__)
+    std::string compiler = "gcc " __VERSION__;
+#elif defined(_MSC_VER)
+    std::string compiler = "msvc " + std::to_string(_MSC_VER);
+#else
+    std::string compiler = "unknown-compiler";
+#endif
+    return host + " | " + cpu + " | " + std::to_string(std::thread::hardware_concurrency()) + " cpus | " + compiler;
+}
+
+std::string currentCommit() {
+#ifdef _WIN32
+    FILE* pipe = popen("git rev-parse --short HEAD 2>nul", "r");
+#else
+    FILE* pipe = popen("git rev-parse --short HEAD 2>/dev/null", "r");
+#endif
+    if (!pipe) return "unknown";
+    char buffer[128] = {};
+    std::string commit = std::fgets(buffer, sizeof(buffer), pipe) ? buffer : "";
+    pclose(pipe);
+    while (!commit.empty() && (commit.back() == '\n' || commit.back() == '\r')) commit.pop_back();
+    return commit.empty() ? "unknown" : commit;
+}
+
+const Run* findBaseline(const std::vector<Run>& runs, const std::string& machine,
+                        const std::string& current_commit, const std::string& commit) {
+    // Runs are appended, so the last match is the latest
+    for (auto it = runs.rbegin(); it != runs.rend(); ++it) {
+        if (it->machine != machine) continue;
+        if (commit.empty() ? it->commit != current_commit : it->commit == commit) return &*it;
+    }
+    return nullptr;
+}
+
+Comparison compare(const std::string& metric, const std::vector<double>& baseline,
+                   const std::vector<double>& current, double threshold, double alpha) {
+    Comparison c;
+    c.metric = metric;
+    c.baseline_samples = baseline.size();
+    c.current_samples = current.size();
+    if (baseline.empty() || current.empty()) return c;
+    c.baseline_median = median(baseline);
+    c.current_median = median(current);
+
+    // Hodges-Lehmann shift and its confidence interval from the U distribution
+    std::vector<double> differences;
+    differences.reserve(baseline.size() * current.size());
+    for (double b : baseline)
+        for (double v : current) differences.push_back(v - b);
+    std::sort(differences.begin(), differences.end());
+    double pairs = static_cast<double>(differences.size());
+    double m = static_cast<double>(baseline.size()), n = static_cast<double>(current.size());
+    double z = normalQuantile(1 - alpha / 2);
+    long k = static_cast<long>(std::floor(pairs / 2 - z * std::sqrt(m * n * (m + n + 1) / 12)));
+    double shift = median(differences);
+    double low = k < 1 ? differences.front() : differences[k - 1];
+    double high = k < 1 ? differences.back() : differences[differences.size() - k];
+
+    double scale = c.baseline_median != 0 ? c.baseline_median : 1;
+    c.change = shift / scale;
+    c.change_low = low / scale;
+    c.change_high = high / scale;
+
+    c.enough_samples = baseline.size() >= MIN_SAMPLES && current.size() >= MIN_SAMPLES;
+    if (!c.enough_samples) return c;
+    c.p_value = mannWhitneyP(baseline, current);
+    c.regression = c.p_value < alpha && c.change > threshold;
+    c.improvement = c.p_value < alpha && c.change < -threshold;
+    return c;
+}
+
+}
@@ -0,0 +1,431 @@
+#include "../include/bitmap.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <set>
+#include <sstream>
+
+namespace SQLEngine {
+
+namespace {
+constexpr char MAGIC[8] = {'T', 'P', 'C', 'H', 'B', 'M', 'P', '1'};
+
+int popcount(uint64_t word) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_popcountll(word);
+#else
+    int count = 0;
+    for (; word; word &= word - 1) count++;
+    return count;
+#endif
+}
+
+int lowestBit(uint64_t word) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctzll(word);
+#else
+    int bit = 0;
+    while (!(word & 1)) {
+        word >>= 1;
+        bit++;
+    }
+    return bit;
+#endif
+}
+
+template <typename T>
+void append(std::string& out, T value) {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+bool take(const char*& data, const char* end, T& value) {
+    if (static_cast<size_t>(end - data) < sizeof(T)) return false;
+    std::memcpy(&value, data, sizeof(T));
+    data += sizeof(T);
+    return true;
+}
+
+void appendString(std::string& out, const std::string& value) {
+    append<uint32_t>(out, static_cast<uint32_t>(value.size()));
+    out += value;
+}
+
+bool takeString(const char*& data, const char* end, std::string& value) {
+    uint32_t length = 0;
+    if (!take(data, end, length) || static_cast<size_t>(end - data) < length) return false;
+    value.assign(data, length);
+    data += length;
+    return true;
+}
+}
+
+void RoaringBitmap::Container::add(uint16_t low) {
+    if (isBitset()) {
+        uint64_t& word = bits[low >> 6];
+        uint64_t bit = uint64_t(1) << (low & 63);
+        if (!(word & bit)) {
+            word |= bit;
+            cardinality++;
+        }
+        return;
+    }
+    if (array.empty() || array.back() < low) {
+        array.push_back(low);
+    } else {
+        auto it = std::lower_bound(array.begin(), array.end(), low);
+        if (*it == low) return;
+        array.insert(it, low);
+    }
+    cardinality = static_cast<uint32_t>(array.size());
+    if (cardinality > ARRAY_MAX) toBitset();
+}
+
+bool RoaringBitmap::Container::contains(uint16_t low) const {
+    if (isBitset()) return (bits[low >> 6] >> (low & 63)) & 1;
+    return std::binary_search(array.begin(), array.end(), low);
+}
+
+void RoaringBitmap::Container::toBitset() {
+    if (isBitset()) return;
+    bits.assign(BITSET_WORDS, 0);
+    for (uint16_t low : array) bits[low >> 6] |= uint64_t(1) << (low & 63);
+    std::vector<uint16_t>().swap(array);
+}
+
+void RoaringBitmap::Container::toArrayIfSparse() {
+    if (!isBitset() || cardinality > ARRAY_MAX) return;
+    array.clear();
+    array.reserve(cardinality);
+    for (size_t w = 0; w < BITSET_WORDS; w++) {
+        for (uint64_t word = bits[w]; word; word &= word - 1)
+            array.push_back(static_cast<uint16_t>(w * 64 + lowestBit(word)));
+    }
+    std::vector<uint64_t>().swap(bits);
+}
+
+RoaringBitmap::Container& RoaringBitmap::containerFor(uint16_t key) {
+    if (containers_.empty() || containers_.back().key < key) {
+        containers_.emplace_back();
+        containers_.back().key = key;
+        return containers_.back();
+    }
+    auto it = std::lower_bound(containers_.begin(), containers_.end(), key,
+                               [](const Container& c, uint16_t k) { return c.key < k; });
+    if (it == containers_.end() || it->key != key) {
+        it = containers_.insert(it, Container());
+        it->key = key;
+    }
+    return *it;
+}
+
+void RoaringBitmap::add(uint32_t position) {
+    containerFor(static_cast<uint16_t>(position >> 16)).add(static_cast<uint16_t>(position & 0xFFFF));
+}
+
+bool RoaringBitmap::contains(uint32_t position) const {
+    uint16_t key = static_cast<uint16_t>(position >> 16);
+    auto it = std::lower_bound(containers_.begin(), containers_.end(), key,
+                               [](const Container& c, uint16_t k) { return c.key < k; });
+    return it != containers_.end() && it->key == key && it->contains(static_cast<uint16_t>(position & 0xFFFF));
+}
+
+uint64_t RoaringBitmap::extent() const {
+    if (containers_.empty()) return 0;
+    const Container& last = containers_.back();
+    uint64_t base = uint64_t(last.key) << 16;
+    if (!last.isBitset()) return base + *std::max_element(last.array.begin(), last.array.end()) + 1;
+    for (size_t w = BITSET_WORDS; w-- > 0;) {
+        if (last.bits[w] == 0) continue;
+        int bit = 63;
+        while (!(last.bits[w] >> bit & 1)) bit--;
+        return base + w * 64 + static_cast<uint64_t>(bit) + 1;
+    }
+    return base;
+}
+
+uint64_t RoaringBitmap::cardinality() const {
+    uint64_t total = 0;
+    for (const auto& container : containers_) total += container.cardinality;
+    return total;
+}
+
+RoaringBitmap::Container RoaringBitmap::unite(const Container& a, const Container& b) {
+    Container result;
+    result.key = a.key;
+    if (!a.isBitset() && !b.isBitset()) {
+        result.array.reserve(a.array.size() + b.array.size());
+        std::set_union(a.array.begin(), a.array.end(), b.array.begin(), b.array.end(), std::back_inserter(result.array));
+        result.cardinality = static_cast<uint32_t>(result.array.size());
+        if (result.cardinality > ARRAY_MAX) result.toBitset();
+        return result;
+    }
+    const Container& dense = a.isBitset() ? a : b;
+    const Container& other = a.isBitset() ? b : a;
+    result.bits = dense.bits;
+    if (other.isBitset()) {
+        for (size_t w = 0; w < BITSET_WORDS; w++) result.bits[w] |= other.bits[w];
+    } else {
+        for (uint16_t low : other.array) result.bits[low >> 6] |= uint64_t(1) << (low & 63);
+    }
+    for (uint64_t word : result.bits) result.cardinality += popcount(word);
+    return result;
+}
+
+RoaringBitmap::Container RoaringBitmap::intersect(const Container& a, const Container& b) {
+    Container result;
+    result.key = a.key;
+    if (a.isBitset() && b.isBitset()) {
+        result.bits.resize(BITSET_WORDS);
+        for (size_t w = 0; w < BITSET_WORDS; w++) {
+            result.bits[w] = a.bits[w] & b.bits[w];
+            result.cardinality += popcount(result.bits[w]);
+        }
+        result.toArrayIfSparse();
+        return result;
+    }
+    if (!a.isBitset() && !b.isBitset()) {
+        std::set_intersection(a.array.begin(), a.array.end(), b.array.begin(), b.array.end(),
+                              std::back_inserter(result.array));
+    } else {
+        const Container& dense = a.isBitset() ? a : b;
+        const Container& sparse = a.isBitset() ? b : a;
+        for (uint16_t low : sparse.array) {
+            if (dense.contains(low)) result.array.push_back(low);
+        }
+    }
+    result.cardinality = static_cast<uint32_t>(result.array.size());
+    return result;
+}
+
+RoaringBitmap& RoaringBitmap::operator|=(const RoaringBitmap& other) {
+    std::vector<Container> merged;
+    merged.reserve(containers_.size() + other.containers_.size());
+    size_t i = 0, j = 0;
+    while (i < containers_.size() || j < other.containers_.size()) {
+        if (j == other.containers_.size() || (i < containers_.size() && containers_[i].key < other.containers_[j].key)) {
+            merged.push_back(std::move(containers_[i++]));
+        } else if (i == containers_.size() || other.containers_[j].key < containers_[i].key) {
+            merged.push_back(other.containers_[j++]);
+        } else {
+            merged.push_back(unite(containers_[i++], other.containers_[j++]));
+        }
+    }
+    containers_ = std::move(merged);
+    return *this;
+}
+
+RoaringBitmap& RoaringBitmap::operator&=(const RoaringBitmap& other) {
+    std::vector<Container> kept;
+    size_t i = 0, j = 0;
+    while (i < containers_.size() && j < other.containers_.size()) {
+        if (containers_[i].key < other.containers_[j].key) {
+            i++;
+        } else if (other.containers_[j].key < containers_[i].key) {
+            j++;
+        } else {
+            Container both = intersect(containers_[i++], other.containers_[j++]);
+            if (both.cardinality > 0) kept.push_back(std::move(both));
+        }
+    }
+    containers_ = std::move(kept);
+    return *this;
+}
+
+std::vector<size_t> RoaringBitmap::positions() const {
+    std::vector<size_t> result;
+    result.reserve(cardinality());
+    for (const auto& container : containers_) {
+        size_t high = size_t(container.key) << 16;
+        if (container.isBitset()) {
+            for (size_t w = 0; w < BITSET_WORDS; w++) {
+                for (uint64_t word = container.bits[w]; word; word &= word - 1)
+                    result.push_back(high | (w * 64 + lowestBit(word)));
+            }
+        } else {
+            for (uint16_t low : container.array) result.push_back(high | low);
+        }
+    }
+    return result;
+}
+
+RoaringBitmap RoaringBitmap::of(const size_t* positions, size_t count) {
+    RoaringBitmap bitmap;
+    for (size_t i = 0; i < count; i++) bitmap.add(static_cast<uint32_t>(positions[i]));
+    return bitmap;
+}
+
+size_t RoaringBitmap::bytes() const {
+    size_t total = 0;
+    for (const auto& container : containers_)
+        total += sizeof(Container) + container.array.size() * sizeof(uint16_t) + container.bits.size() * sizeof(uint64_t);
+    return total;
+}
+
+// uint32 container count, then per container: uint16 key, uint32
+// cardinality and either the array or the bitset words
+void RoaringBitmap::write(std::string& out) const {
+    append<uint32_t>(out, static_cast<uint32_t>(containers_.size()));
+    for (const auto& container : containers_) {
+        append<uint16_t>(out, container.key);
+        append<uint32_t>(out, container.cardinality);
+        if (container.isBitset()) out.append(reinterpret_cast<const char*>(container.bits.data()), BITSET_WORDS * 8);
+        else out.append(reinterpret_cast<const char*>(container.array.data()), container.array.size() * 2);
+    }
+}
+
+bool RoaringBitmap::read(const char*& data, const char* end) {
+    containers_.clear();
+    uint32_t count = 0;
+    if (!take(data, end, count)) return false;
+    for (uint32_t c = 0; c < count; c++) {
+        Container container;
+        if (!take(data, end, container.key) || !take(data, end, container.cardinality)) return false;
+        if (container.cardinality == 0 || container.cardinality > 65536) return false;
+        if (!containers_.empty() && containers_.back().key >= container.key) return false;
+        size_t bytes = container.cardinality > ARRAY_MAX ? BITSET_WORDS * 8 : container.cardinality * 2;
+        if (static_cast<size_t>(end - data) < bytes) return false;
+        if (container.cardinality > ARRAY_MAX) {
+            container.bits.resize(BITSET_WORDS);
+            std::memcpy(container.bits.data(), data, bytes);
+        } else {
+            container.array.resize(container.cardinality);
+            std::memcpy(container.array.data(), data, bytes);
+        }
+        data += bytes;
+        containers_.push_back(std::move(container));
+    }
+    return true;
+}
+
+BitmapIndex::BitmapIndex(const std::vector<std::map<std::string, std::string>>& table, const std::string& column)
+    : name_(column), source_(&table), rows_(table.size()) {
+    // Rows arrive in ascending order, so every add appends
+    for (size_t i = 0; i < table.size(); i++) {
+        auto it = table[i].find(column);
+        if (it != table[i].end()) bitmaps_[it->second].add(static_cast<uint32_t>(i));
+    }
+}
+
+size_t BitmapIndex::bytes() const {
+    size_t total = 0;
+    for (const auto& [value, bitmap] : bitmaps_) total += value.size() + bitmap.bytes();
+    return total;
+}
+
+RoaringBitmap BitmapIndex::anyOf(const std::vector<std::string>& values) const {
+    RoaringBitmap result;
+    for (const auto& value : std::set<std::string>(values.begin(), values.end())) {
+        auto it = bitmaps_.find(value);
+        if (it != bitmaps_.end()) result |= it->second;
+    }
+    return result;
+}
+
+void BitmapIndex::write(std::string& out) const {
+    appendString(out, name_);
+    append<uint32_t>(out, static_cast<uint32_t>(bitmaps_.size()));
+    for (const auto& [value, bitmap] : bitmaps_) {
+        appendString(out, value);
+        bitmap.write(out);
+    }
+}
+
+bool BitmapIndex::read(const char*& data, const char* end, const void* source, size_t rows) {
+    bitmaps_.clear();
+    uint32_t count = 0;
+    if (!takeString(data, end, name_) || !take(data, end, count)) return false;
+    for (uint32_t v = 0; v < count; v++) {
+        std::string value;
+        if (!takeString(data, end, value)) return false;
+        RoaringBitmap& bitmap = bitmaps_[value];
+        // Positions past the table would select rows it does not have
+        if (!bitmap.read(data, end) || bitmap.extent() > rows) return false;
+    }
+    source_ = source;
+    rows_ = rows;
+    return true;
+}
+
+const BitmapIndex* BitmapIndexes::find(const std::vector<std::map<std::string, std::string>>& table,
+                                       const std::string& column) const {
+    auto it = columns.find(column);
+    if (it == columns.end() || it->second.source() != &table || it->second.rows() != table.size()) return nullptr;
+    return &it->second;
+}
+
+const std::vector<std::string>& bitmapIndexColumns(const std::string& table) {
+    static const std::map<std::string, std::vector<std::string>> columns = {
+        {"customer", {"C_NATIONKEY", "C_MKTSEGMENT"}},
+        {"orders", {"O_ORDERSTATUS"}},
+        {"lineitem", {"L_RETURNFLAG", "L_SHIPMODE"}},
+        {"supplier", {"S_NATIONKEY"}},
+    };
+    static const std::vector<std::string> none;
+    auto it = columns.find(table);
+    return it == columns.end() ? none : it->second;
+}
+
+// "TPCHBMP1", uint64 rows, uint32 index count, then the indexes
+bool writeBitmapIndexes(const std::string& path, const BitmapIndexes& indexes, const std::vector<std::string>& columns,
+                        size_t rows) {
+    std::string out(MAGIC, sizeof(MAGIC));
+    append<uint64_t>(out, rows);
+    append<uint32_t>(out, static_cast<uint32_t>(columns.size()));
+    for (const auto& column : columns) {
+        auto it = indexes.columns.find(column);
+        if (it == indexes.columns.end()) return false;
+        it->second.write(out);
+    }
+    // Written to a temporary file first so readers never see a partial index;
+    // processes loading the same table at once each write their own
+    std::string temporary = path + "." + std::to_string(std::random_device()()) + ".tmp";
+    {
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+        if (!file.write(out.data(), out.size())) return false;
+    }
+    std::remove(path.c_str());
+    if (std::rename(temporary.c_str(), path.c_str()) != 0) {
+        std::remove(temporary.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool readBitmapIndexes(const std::string& path, const std::vector<std::map<std::string, std::string>>& table,
+                       const std::vector<std::string>& columns, BitmapIndexes& indexes) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) return false;
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    const std::string bytes = buffer.str();
+    const char* data = bytes.data();
+    const char* end = data + bytes.size();
+    char magic[sizeof(MAGIC)];
+    uint64_t rows = 0;
+    uint32_t count = 0;
+    if (bytes.size() < sizeof(MAGIC)) return false;
+    std::memcpy(magic, data, sizeof(MAGIC));
+    data += sizeof(MAGIC);
+    if (std::memcmp(magic, MAGIC, sizeof(MAGIC)) != 0 || !take(data, end, rows) || rows != table.size() ||
+        !take(data, end, count)) {
+        return false;
+    }
+    std::map<std::string, BitmapIndex> loaded;
+    for (uint32_t i = 0; i < count; i++) {
+        BitmapIndex index;
+        if (!index.read(data, end, &table, table.size())) return false;
+        std::string name = index.name();
+        loaded[name] = std::move(index);
+    }
+    for (const auto& column : columns) {
+        if (!loaded.count(column)) return false;
+    }
+    for (auto& [name, index] : loaded) indexes.columns[name] = std::move(index);
+    return true;
+}
+
+}
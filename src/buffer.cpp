@@ -0,0 +1,326 @@
+#include "../include/buffer.hpp"
+#include "../include/trace.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace Buffer {
+
+namespace {
+uint64_t nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+bool readAt(intptr_t handle, uint64_t offset, uint64_t bytes, char* out) {
+    while (bytes > 0) {
+#ifdef _WIN32
+        OVERLAPPED overlapped = {};
+        overlapped.Offset = static_cast<DWORD>(offset);
+        overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+        DWORD want = static_cast<DWORD>(std::min<uint64_t>(bytes, 1u << 30));
+        DWORD got = 0;
+        if (!ReadFile(reinterpret_cast<HANDLE>(handle), out, want, &got, &overlapped) || got == 0) return false;
+#else
+        ssize_t got = pread(static_cast<int>(handle), out, bytes, static_cast<off_t>(offset));
+        if (got < 0 && errno == EINTR) continue;
+        if (got <= 0) return false;
+#endif
+        out += got;
+        offset += got;
+        bytes -= got;
+    }
+    return true;
+}
+
+void closeHandle(intptr_t handle) {
+#ifdef _WIN32
+    CloseHandle(reinterpret_cast<HANDLE>(handle));
+#else
+    close(static_cast<int>(handle));
+#endif
+}
+}
+
+void Stats::writeJSON(std::ostream& out) const {
+    if (!used) {
+        out << "null";
+        return;
+    }
+    out << "{\"capacity_bytes\": " << capacity_bytes
+        << ", \"page_bytes\": " << page_bytes
+        << ", \"pins\": " << pins
+        << ", \"hits\": " << hits
+        << ", \"misses\": " << misses
+        << ", \"hit_rate\": " << (pins > 0 ? double(hits) / pins : 0.0)
+        << ", \"prefetched\": " << prefetched
+        << ", \"prefetch_hits\": " << prefetch_hits
+        << ", \"evictions\": " << evictions
+        << ", \"bytes_read\": " << bytes_read
+        << ", \"read_ms\": " << read_ns / 1e6
+        << ", \"wait_ms\": " << wait_ns / 1e6 << "}";
+}
+
+Page& Page::operator=(Page&& other) noexcept {
+    if (this != &other) {
+        release();
+        pool_ = other.pool_;
+        frame_ = other.frame_;
+        data_ = other.data_;
+        size_ = other.size_;
+        other.pool_ = nullptr;
+    }
+    return *this;
+}
+
+void Page::release() {
+    if (pool_) pool_->unpin(frame_);
+    pool_ = nullptr;
+}
+
+Pool::Pool(size_t capacity_bytes, size_t page_bytes) : page_bytes_(std::max<size_t>(page_bytes, 4096)) {
+    size_t frames = std::max(MIN_FRAMES, capacity_bytes / page_bytes_);
+    memory_.reset(new char[frames * page_bytes_]);
+    frames_.resize(frames);
+    stats_.used = true;
+    stats_.capacity_bytes = frames * page_bytes_;
+    stats_.page_bytes = page_bytes_;
+    prefetch_thread_ = std::thread(&Pool::prefetchLoop, this);
+}
+
+Pool::~Pool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    queued_.notify_all();
+    prefetch_thread_.join();
+    for (const auto& file : files_) closeHandle(file.handle);
+}
+
+int Pool::openFile(const std::string& path) {
+    File file;
+    file.path = path;
+#ifdef _WIN32
+    HANDLE handle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                                FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (handle == INVALID_HANDLE_VALUE) return -1;
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(handle, &size)) {
+        CloseHandle(handle);
+        return -1;
+    }
+    file.handle = reinterpret_cast<intptr_t>(handle);
+    file.size = static_cast<uint64_t>(size.QuadPart);
+#else
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) return -1;
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return -1;
+    }
+    file.handle = fd;
+    file.size = static_cast<uint64_t>(st.st_size);
+#endif
+    std::lock_guard<std::mutex> lock(mutex_);
+    files_.push_back(std::move(file));
+    return static_cast<int>(files_.size() - 1);
+}
+
+uint64_t Pool::fileSize(int file) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return file >= 0 && static_cast<size_t>(file) < files_.size() ? files_[file].size : 0;
+}
+
+size_t Pool::findVictim() {
+    size_t n = frames_.size();
+    // Two sweeps: the first may only clear reference bits
+    for (size_t i = 0; i < 2 * n; i++) {
+        size_t f = clock_hand_;
+        clock_hand_ = (clock_hand_ + 1) % n;
+        Frame& frame = frames_[f];
+        if (frame.pins > 0) continue;   // includes frames being read
+        if (frame.referenced) {
+            frame.referenced = false;
+            continue;
+        }
+        return f;
+    }
+    return n;
+}
+
+bool Pool::load(std::unique_lock<std::mutex>& lock, size_t frame, int file, uint64_t page_no) {
+    const File& source = files_[file];
+    intptr_t handle = source.handle;
+    uint64_t offset = page_no * page_bytes_;
+    size_t bytes = static_cast<size_t>(std::min<uint64_t>(page_bytes_, source.size - offset));
+    char* data = frameData(frame);
+
+    lock.unlock();
+    uint64_t start_ns = nowNs();
+    bool ok;
+    {
+        Tracing::Scope read_trace("page read", "io");
+        ok = readAt(handle, offset, bytes, data);
+        read_trace.setArg(bytes);
+    }
+    uint64_t elapsed_ns = nowNs() - start_ns;
+    lock.lock();
+
+    stats_.read_ns += elapsed_ns;
+    Frame& target = frames_[frame];
+    if (ok) {
+        stats_.bytes_read += bytes;
+        target.state = State::READY;
+        target.size = bytes;
+    } else {
+        page_table_.erase(target.key);
+        target.state = State::EMPTY;
+        target.prefetched = false;
+    }
+    changed_.notify_all();
+    return ok;
+}
+
+Page Pool::pin(int file, uint64_t page_no) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (file < 0 || static_cast<size_t>(file) >= files_.size()) return Page();
+    if (page_no * page_bytes_ >= files_[file].size) return Page();
+    uint64_t key = pageKey(file, page_no);
+    stats_.pins++;
+
+    for (;;) {
+        auto it = page_table_.find(key);
+        if (it != page_table_.end()) {
+            size_t f = it->second;
+            Frame& frame = frames_[f];
+            frame.pins++;
+            frame.referenced = true;
+            if (frame.state == State::LOADING) {
+                uint64_t wait_start = nowNs();
+                changed_.wait(lock, [&frame] { return frame.state != State::LOADING; });
+                stats_.wait_ns += nowNs() - wait_start;
+            }
+            if (frame.state != State::READY || frame.key != key) {
+                // The read failed
+                if (--frame.pins == 0) changed_.notify_all();
+                return Page();
+            }
+            stats_.hits++;
+            if (frame.prefetched) {
+                stats_.prefetch_hits++;
+                frame.prefetched = false;
+            }
+            return Page(this, f, frameData(f), frame.size);
+        }
+
+        size_t victim = findVictim();
+        if (victim == frames_.size()) {
+            uint64_t wait_start = nowNs();
+            changed_.wait(lock);
+            stats_.wait_ns += nowNs() - wait_start;
+            continue;   // the page may have been read meanwhile
+        }
+        Frame& frame = frames_[victim];
+        if (frame.state == State::READY) {
+            page_table_.erase(frame.key);
+            stats_.evictions++;
+        }
+        frame = Frame();
+        frame.key = key;
+        frame.state = State::LOADING;
+        frame.pins = 1;
+        frame.referenced = true;
+        page_table_[key] = victim;
+        stats_.misses++;
+
+        if (!load(lock, victim, file, page_no)) {
+            frames_[victim].pins--;
+            return Page();
+        }
+        return Page(this, victim, frameData(victim), frames_[victim].size);
+    }
+}
+
+void Pool::unpin(size_t frame) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (--frames_[frame].pins == 0) changed_.notify_all();
+}
+
+bool Pool::read(int file, uint64_t offset, uint64_t bytes, char* out) {
+    while (bytes > 0) {
+        uint64_t page_no = offset / page_bytes_;
+        size_t in_page = static_cast<size_t>(offset % page_bytes_);
+        Page page = pin(file, page_no);
+        if (!page || in_page >= page.size()) return false;
+        size_t n = static_cast<size_t>(std::min<uint64_t>(bytes, page.size() - in_page));
+        std::memcpy(out, page.data() + in_page, n);
+        out += n;
+        offset += n;
+        bytes -= n;
+    }
+    return true;
+}
+
+void Pool::prefetch(int file, uint64_t offset, uint64_t bytes) {
+    if (bytes == 0) return;
+    std::lock_guard<std::mutex> lock(mutex_);
+    // Never queue more than half the pool, so read-ahead cannot evict itself
+    size_t max_queued = frames_.size() / 2;
+    for (uint64_t page_no = offset / page_bytes_; page_no <= (offset + bytes - 1) / page_bytes_; page_no++) {
+        if (prefetch_queue_.size() >= max_queued) break;
+        if (page_table_.count(pageKey(file, page_no))) continue;
+        prefetch_queue_.emplace_back(file, page_no);
+    }
+    queued_.notify_one();
+}
+
+void Pool::prefetchLoop() {
+    Tracing::setThreadName("buffer-prefetch");
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+        queued_.wait(lock, [this] { return stopping_ || !prefetch_queue_.empty(); });
+        if (stopping_) return;
+        auto [file, page_no] = prefetch_queue_.front();
+        prefetch_queue_.pop_front();
+
+        uint64_t key = pageKey(file, page_no);
+        if (page_table_.count(key) || page_no * page_bytes_ >= files_[file].size) continue;
+        // Read-ahead never waits for a frame
+        size_t victim = findVictim();
+        if (victim == frames_.size()) continue;
+        Frame& frame = frames_[victim];
+        if (frame.state == State::READY) {
+            page_table_.erase(frame.key);
+            stats_.evictions++;
+        }
+        frame = Frame();
+        frame.key = key;
+        frame.state = State::LOADING;
+        frame.pins = 1;   // held while reading
+        frame.referenced = true;
+        frame.prefetched = true;
+        page_table_[key] = victim;
+
+        if (load(lock, victim, file, page_no)) stats_.prefetched++;
+        if (--frames_[victim].pins == 0) changed_.notify_all();
+    }
+}
+
+Stats Pool::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+}
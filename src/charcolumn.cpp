@@ -0,0 +1,140 @@
+#include "../include/charcolumn.hpp"
+#include "../include/tpch_schema.hpp"
+#include <algorithm>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define TPCH_CHAR_SSE2 1
+#endif
+
+namespace SQLEngine {
+
+namespace {
+size_t roundToLane(size_t bytes) {
+    return std::max<size_t>((bytes + CHAR_LANE_BYTES - 1) / CHAR_LANE_BYTES, 1) * CHAR_LANE_BYTES;
+}
+
+// Bit i set for the first `bytes` bytes of a lane
+uint32_t laneMask(size_t bytes) {
+    return bytes >= CHAR_LANE_BYTES ? 0xFFFFu : (1u << bytes) - 1;
+}
+
+// Compares the first `lanes` lanes of a value with the constant, requiring
+// the bytes in masks[l] of lane l to match
+inline bool matches(const char* value, const char* constant, const uint32_t* masks, size_t lanes) {
+#ifdef TPCH_CHAR_SSE2
+    for (size_t l = 0; l < lanes; l++) {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(value + l * CHAR_LANE_BYTES));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(constant + l * CHAR_LANE_BYTES));
+        uint32_t equal = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(a, b)));
+        if ((equal & masks[l]) != masks[l]) return false;
+    }
+    return true;
+#else
+    for (size_t l = 0; l < lanes; l++) {
+        const char* a = value + l * CHAR_LANE_BYTES;
+        const char* b = constant + l * CHAR_LANE_BYTES;
+        for (size_t i = 0; i < CHAR_LANE_BYTES; i++) {
+            if ((masks[l] >> i & 1u) && a[i] != b[i]) return false;
+        }
+    }
+    return true;
+#endif
+}
+
+// Runs the padded comparison over the candidate rows; rows not `present`
+// (nullptr: all are) never match
+void select(const char* bytes, size_t stride, const std::vector<char>& constant, const std::vector<uint32_t>& masks,
+            const uint8_t* present, const size_t* rows, size_t count, std::pmr::vector<size_t>& out) {
+    size_t lanes = masks.size();
+    auto test = [&](size_t row) {
+        if ((!present || present[row]) && matches(bytes + row * stride, constant.data(), masks.data(), lanes))
+            out.push_back(row);
+    };
+    if (rows) {
+        for (size_t i = 0; i < count; i++) test(rows[i]);
+    } else {
+        for (size_t row = 0; row < count; row++) test(row);
+    }
+}
+}
+
+CharColumn::CharColumn(const std::vector<std::map<std::string, std::string>>& table, const std::string& column)
+    : name_(column), source_(&table), rows_(table.size()) {
+    size_t width = TPCH::charWidth(column);
+    for (const auto& row : table) {
+        auto it = row.find(column);
+        if (it != row.end()) width = std::max(width, it->second.size());
+    }
+    stride_ = roundToLane(width);
+    bytes_.assign(rows_ * stride_, '\0');
+    for (size_t r = 0; r < rows_; r++) {
+        auto it = table[r].find(column);
+        if (it != table[r].end()) {
+            std::memcpy(bytes_.data() + r * stride_, it->second.data(), it->second.size());
+        } else {
+            // A missing value must not read as ""
+            if (present_.empty()) present_.assign(rows_, 1);
+            present_[r] = 0;
+        }
+    }
+}
+
+CharColumn CharColumn::growing(const std::vector<std::map<std::string, std::string>>& table, const std::string& column) {
+    CharColumn result;
+    result.name_ = column;
+    result.source_ = &table;
+    result.stride_ = roundToLane(TPCH::charWidth(column));
+    return result;
+}
+
+void CharColumn::append(std::string_view value) {
+    if (value.size() > stride_) widen(value.size());
+    bytes_.resize(bytes_.size() + stride_, '\0');
+    std::memcpy(bytes_.data() + rows_ * stride_, value.data(), value.size());
+    rows_++;
+}
+
+void CharColumn::widen(size_t width) {
+    size_t stride = roundToLane(width);
+    std::vector<char> bytes(rows_ * stride, '\0');
+    for (size_t r = 0; r < rows_; r++) std::memcpy(bytes.data() + r * stride, value(r), stride_);
+    bytes_.swap(bytes);
+    stride_ = stride;
+}
+
+std::string_view CharColumn::at(size_t row) const {
+    const char* v = value(row);
+    const void* nul = std::memchr(v, '\0', stride_);
+    return std::string_view(v, nul ? static_cast<const char*>(nul) - v : stride_);
+}
+
+void CharColumn::selectEqual(std::string_view value, const size_t* rows, size_t count, std::pmr::vector<size_t>& out) const {
+    if (value.size() > stride_) return;
+    // The padding takes part in the comparison, so "AIR" does not match "AIRMAIL"
+    std::vector<char> constant(stride_, '\0');
+    std::memcpy(constant.data(), value.data(), value.size());
+    std::vector<uint32_t> masks(stride_ / CHAR_LANE_BYTES, 0xFFFFu);
+    select(bytes_.data(), stride_, constant, masks, present_.empty() ? nullptr : present_.data(), rows, count, out);
+}
+
+void CharColumn::selectPrefix(std::string_view prefix, const size_t* rows, size_t count, std::pmr::vector<size_t>& out) const {
+    if (prefix.size() > stride_) return;
+    std::vector<char> constant(stride_, '\0');
+    std::memcpy(constant.data(), prefix.data(), prefix.size());
+    // Only the lanes covering the prefix are compared
+    std::vector<uint32_t> masks;
+    for (size_t covered = 0; covered < prefix.size(); covered += CHAR_LANE_BYTES)
+        masks.push_back(laneMask(prefix.size() - covered));
+    if (masks.empty()) {
+        for (size_t i = 0; i < count; i++) {
+            size_t row = rows ? rows[i] : i;
+            if (has(row)) out.push_back(row);
+        }
+        return;
+    }
+    select(bytes_.data(), stride_, constant, masks, present_.empty() ? nullptr : present_.data(), rows, count, out);
+}
+
+}
@@ -0,0 +1,347 @@
+#include "../include/cluster.hpp"
+#include "../include/trace.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <windows.h>
+#else
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <spawn.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <unistd.h>
+extern char** environ;
+#endif
+
+namespace Cluster {
+
+namespace {
+const char MAGIC[] = "TPCHQ5";
+constexpr double CONNECT_RETRY_S = 10.0;
+
+#ifdef _WIN32
+using SocketHandle = SOCKET;
+const SocketHandle NO_SOCKET = INVALID_SOCKET;
+#else
+using SocketHandle = int;
+const SocketHandle NO_SOCKET = -1;
+#endif
+
+bool initSockets() {
+#ifdef _WIN32
+    static bool ok = [] {
+        WSADATA data;
+        return WSAStartup(MAKEWORD(2, 2), &data) == 0;
+    }();
+    return ok;
+#else
+    return true;
+#endif
+}
+
+void closeSocket(intptr_t handle) {
+#ifdef _WIN32
+    closesocket(static_cast<SocketHandle>(handle));
+#else
+    close(static_cast<SocketHandle>(handle));
+#endif
+}
+
+// Bounds blocking reads on a connection
+void setReceiveTimeout(SocketHandle s, double timeout_s) {
+#ifdef _WIN32
+    DWORD ms = static_cast<DWORD>(timeout_s * 1000);
+    setsockopt(s, SOL_SOCKET, SO_RCVTIMEO, reinterpret_cast<const char*>(&ms), sizeof(ms));
+#else
+    timeval tv;
+    tv.tv_sec = static_cast<time_t>(timeout_s);
+    tv.tv_usec = static_cast<suseconds_t>((timeout_s - tv.tv_sec) * 1e6);
+    setsockopt(s, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+#endif
+}
+
+bool sendAll(SocketHandle s, const std::string& data) {
+    size_t sent = 0;
+    while (sent < data.size()) {
+#if defined(MSG_NOSIGNAL)
+        int flags = MSG_NOSIGNAL;
+#else
+        int flags = 0;
+#endif
+        auto n = send(s, data.data() + sent, static_cast<int>(data.size() - sent), flags);
+        if (n <= 0) return false;
+        sent += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+bool receiveAll(SocketHandle s, std::string& data) {
+    char buf[4096];
+    for (;;) {
+        auto n = recv(s, buf, sizeof(buf), 0);
+        if (n == 0) return true;
+        if (n < 0) return false;
+        data.append(buf, static_cast<size_t>(n));
+    }
+}
+
+// "TPCHQ5 <worker> <nations>" followed by one "<nation>\t<revenue>" line per nation
+bool parsePartial(const std::string& message, int& worker, std::map<std::string, double>& revenue) {
+    std::istringstream in(message);
+    std::string magic, line;
+    size_t nations;
+    if (!(in >> magic >> worker >> nations) || magic != MAGIC) return false;
+    std::getline(in, line);
+    for (size_t i = 0; i < nations; i++) {
+        if (!std::getline(in, line)) return false;
+        size_t tab = line.find('\t');
+        if (tab == std::string::npos) return false;
+        char* end;
+        double value = std::strtod(line.c_str() + tab + 1, &end);
+        if (end == line.c_str() + tab + 1) return false;
+        revenue[line.substr(0, tab)] = value;
+    }
+    return true;
+}
+}
+
+int Partition::indexOf(std::string_view order_key, int count) {
+    if (count <= 1) return 0;
+    uint64_t key = 0;
+    bool numeric = !order_key.empty();
+    for (char c : order_key) {
+        if (c < '0' || c > '9') {
+            numeric = false;
+            break;
+        }
+        key = key * 10 + static_cast<uint64_t>(c - '0');
+    }
+    if (!numeric) {
+        // FNV-1a, stable across processes and builds
+        key = 14695981039346656037ull;
+        for (char c : order_key) key = (key ^ static_cast<unsigned char>(c)) * 1099511628211ull;
+    }
+    // Fibonacci hashing spreads the sparse TPC-H order keys evenly
+    uint64_t hash = key * 0x9E3779B97F4A7C15ull;
+    return static_cast<int>((hash >> 32) % static_cast<uint64_t>(count));
+}
+
+Columnar::Filter Partition::ownedRows(const std::string& key_column) const {
+    Columnar::Filter filter;
+    filter.column = key_column;
+    filter.kind = Columnar::Filter::Kind::TEST;
+    filter.test = [partition = *this](std::string_view key) { return partition.owns(key); };
+    return filter;
+}
+
+Coordinator::~Coordinator() {
+    if (socket_ != -1) closeSocket(socket_);
+    waitSpawned();
+}
+
+bool Coordinator::listen(int port) {
+    if (!initSockets()) return false;
+    SocketHandle s = socket(AF_INET, SOCK_STREAM, 0);
+    if (s == NO_SOCKET) return false;
+    int reuse = 1;
+    setsockopt(s, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&reuse), sizeof(reuse));
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(static_cast<uint16_t>(port));
+    socklen_t length = sizeof(addr);
+    if (bind(s, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || ::listen(s, SOMAXCONN) != 0 ||
+        getsockname(s, reinterpret_cast<sockaddr*>(&addr), &length) != 0) {
+        closeSocket(s);
+        return false;
+    }
+    socket_ = static_cast<intptr_t>(s);
+    port_ = ntohs(addr.sin_port);
+    return true;
+}
+
+std::string Coordinator::address() const {
+    return "127.0.0.1:" + std::to_string(port_);
+}
+
+bool Coordinator::spawn(const std::string& program, const std::vector<std::string>& args, int workers) {
+    for (int w = 0; w < workers; w++) {
+        std::vector<std::string> worker_args = args;
+        worker_args.push_back("--worker");
+        worker_args.push_back(std::to_string(w));
+#ifdef _WIN32
+        std::string command_line = "\"" + program + "\"";
+        for (const auto& arg : worker_args) command_line += " \"" + arg + "\"";
+        STARTUPINFOA startup = {};
+        startup.cb = sizeof(startup);
+        PROCESS_INFORMATION info = {};
+        if (!CreateProcessA(nullptr, &command_line[0], nullptr, nullptr, FALSE, 0, nullptr, nullptr, &startup, &info))
+            return false;
+        CloseHandle(info.hThread);
+        processes_.push_back(reinterpret_cast<intptr_t>(info.hProcess));
+#else
+        std::vector<char*> argv;
+        argv.push_back(const_cast<char*>(program.c_str()));
+        for (auto& arg : worker_args) argv.push_back(const_cast<char*>(arg.c_str()));
+        argv.push_back(nullptr);
+        pid_t pid;
+        int error = program.find('/') == std::string::npos
+                        ? posix_spawnp(&pid, program.c_str(), nullptr, nullptr, argv.data(), environ)
+                        : posix_spawn(&pid, program.c_str(), nullptr, nullptr, argv.data(), environ);
+        if (error != 0) return false;
+        processes_.push_back(static_cast<intptr_t>(pid));
+#endif
+    }
+    return true;
+}
+
+// True once a spawned worker has exited unsuccessfully; reaps exited workers
+bool Coordinator::spawnedFailed() {
+    bool failed = false;
+    for (auto& process : processes_) {
+        if (process == -1) continue;
+#ifdef _WIN32
+        HANDLE handle = reinterpret_cast<HANDLE>(process);
+        if (WaitForSingleObject(handle, 0) != WAIT_OBJECT_0) continue;
+        DWORD code = 1;
+        GetExitCodeProcess(handle, &code);
+        CloseHandle(handle);
+        failed |= code != 0;
+#else
+        int status;
+        if (waitpid(static_cast<pid_t>(process), &status, WNOHANG) == 0) continue;
+        failed |= !WIFEXITED(status) || WEXITSTATUS(status) != 0;
+#endif
+        process = -1;
+    }
+    return failed;
+}
+
+bool Coordinator::waitSpawned() {
+    bool ok = true;
+    for (auto& process : processes_) {
+        if (process == -1) continue;
+#ifdef _WIN32
+        HANDLE handle = reinterpret_cast<HANDLE>(process);
+        WaitForSingleObject(handle, INFINITE);
+        DWORD code = 1;
+        GetExitCodeProcess(handle, &code);
+        CloseHandle(handle);
+        ok &= code == 0;
+#else
+        int status;
+        ok &= waitpid(static_cast<pid_t>(process), &status, 0) >= 0 && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+#endif
+        process = -1;
+    }
+    processes_.clear();
+    return ok;
+}
+
+bool Coordinator::gather(int workers, double timeout_s, std::map<std::string, double>& results) {
+    Tracing::Scope trace_scope("gather partials", "io");
+    std::vector<std::map<std::string, double>> partials(workers);
+    std::vector<bool> received(workers, false);
+    int remaining = workers;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::duration<double>(timeout_s);
+    SocketHandle listener = static_cast<SocketHandle>(socket_);
+
+    while (remaining > 0) {
+        // Wake up every second to notice workers that died before reporting
+        fd_set ready;
+        FD_ZERO(&ready);
+        FD_SET(listener, &ready);
+        timeval tv = {1, 0};
+        int n = select(static_cast<int>(listener) + 1, &ready, nullptr, nullptr, &tv);
+        if (n > 0) {
+            SocketHandle connection = accept(listener, nullptr, nullptr);
+            if (connection == NO_SOCKET) continue;
+            setReceiveTimeout(connection, timeout_s);
+            std::string message;
+            int worker = -1;
+            std::map<std::string, double> revenue;
+            bool ok = receiveAll(connection, message) && parsePartial(message, worker, revenue);
+            closeSocket(static_cast<intptr_t>(connection));
+            if (!ok || worker < 0 || worker >= workers || received[worker]) {
+                std::cerr << "Ignoring malformed or duplicate partial result from a worker." << std::endl;
+                continue;
+            }
+            partials[worker] = std::move(revenue);
+            received[worker] = true;
+            remaining--;
+            continue;
+        }
+        if (spawnedFailed()) {
+            std::cerr << "A worker exited without reporting its partial result." << std::endl;
+            return false;
+        }
+        if (std::chrono::steady_clock::now() > deadline) {
+            std::cerr << "Timed out waiting for " << remaining << " of " << workers << " workers." << std::endl;
+            return false;
+        }
+    }
+
+    // Fixed merge order, so repeated runs produce identical sums
+    for (const auto& partial : partials) {
+        for (const auto& [nation, revenue] : partial) results[nation] += revenue;
+    }
+    trace_scope.setArg(workers);
+    if (!waitSpawned()) {
+        std::cerr << "A worker exited with an error after reporting." << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool sendPartial(const std::string& address, int worker, const std::map<std::string, double>& results) {
+    size_t colon = address.rfind(':');
+    if (colon == std::string::npos || !initSockets()) return false;
+    std::string host = address.substr(0, colon);
+    std::string port = address.substr(colon + 1);
+
+    addrinfo hints = {};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* found = nullptr;
+    if (getaddrinfo(host.c_str(), port.c_str(), &hints, &found) != 0 || !found) return false;
+
+    // The coordinator may still be starting when workers are launched by hand
+    SocketHandle s = NO_SOCKET;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::duration<double>(CONNECT_RETRY_S);
+    for (;;) {
+        s = socket(found->ai_family, found->ai_socktype, found->ai_protocol);
+        if (s != NO_SOCKET && connect(s, found->ai_addr, static_cast<int>(found->ai_addrlen)) == 0) break;
+        if (s != NO_SOCKET) closeSocket(static_cast<intptr_t>(s));
+        s = NO_SOCKET;
+        if (std::chrono::steady_clock::now() > deadline) break;
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    freeaddrinfo(found);
+    if (s == NO_SOCKET) return false;
+
+    std::string message = std::string(MAGIC) + " " + std::to_string(worker) + " " + std::to_string(results.size()) + "\n";
+    char value[32];
+    for (const auto& [nation, revenue] : results) {
+        // 17 significant digits round-trip a double exactly
+        std::snprintf(value, sizeof(value), "%.17g", revenue);
+        message += nation + "\t" + value + "\n";
+    }
+    bool ok = sendAll(s, message);
+    closeSocket(static_cast<intptr_t>(s));
+    return ok;
+}
+
+}
@@ -0,0 +1,437 @@
+#include "../include/columnar.hpp"
+#include "../include/trace.hpp"
+#include "../include/progress.hpp"
+#include "../include/fastparse.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <unordered_map>
+
+namespace Columnar {
+
+namespace {
+const char MAGIC[8] = {'T', 'P', 'C', 'H', 'C', 'O', 'L', '1'};
+
+template <typename T>
+void writeValue(std::ofstream& out, T value) {
+    out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+bool readValue(std::istream& in, T& value) {
+    return static_cast<bool>(in.read(reinterpret_cast<char*>(&value), sizeof(T)));
+}
+
+// Read-only stream over a .col file image in memory
+class MemoryBuffer : public std::streambuf {
+public:
+    MemoryBuffer(const char* data, uint64_t bytes) {
+        char* begin = const_cast<char*>(data);
+        setg(begin, begin, begin + bytes);
+    }
+protected:
+    pos_type seekoff(off_type offset, std::ios_base::seekdir dir, std::ios_base::openmode) override {
+        char* base = dir == std::ios_base::beg ? eback() : dir == std::ios_base::cur ? gptr() : egptr();
+        if (base + offset < eback() || base + offset > egptr()) return pos_type(off_type(-1));
+        setg(eback(), base + offset, egptr());
+        return pos_type(gptr() - eback());
+    }
+    pos_type seekpos(pos_type position, std::ios_base::openmode mode) override {
+        return seekoff(off_type(position), std::ios_base::beg, mode);
+    }
+};
+
+// Every size in the header and footer is checked against the file before
+// anything is allocated from it, so a damaged file fails to open instead of
+// requesting gigabytes
+bool readFileInfo(std::istream& in, FileInfo& info) {
+    const uint64_t trailer_bytes = 2 * sizeof(uint64_t) + sizeof(MAGIC);
+    if (!in.seekg(0, std::ios::end)) return false;
+    std::streamoff end = in.tellg();
+    if (end < 0 || !in.seekg(0)) return false;
+    const uint64_t file_bytes = static_cast<uint64_t>(end);
+
+    char magic[sizeof(MAGIC)];
+    uint32_t version, num_columns;
+    if (!in.read(magic, sizeof(magic)) || std::memcmp(magic, MAGIC, sizeof(MAGIC)) != 0) return false;
+    if (!readValue(in, version) || version < 1 || version > VERSION) return false;
+    if (!readValue(in, num_columns)) return false;
+
+    info = FileInfo();
+    info.version = version;
+    uint64_t position = sizeof(MAGIC) + 2 * sizeof(uint32_t);
+    for (uint32_t c = 0; c < num_columns; c++) {
+        uint32_t length;
+        if (!readValue(in, length)) return false;
+        position += sizeof(uint32_t);
+        if (length > file_bytes - std::min(position, file_bytes)) return false;
+        std::string name(length, '\0');
+        if (!in.read(&name[0], length)) return false;
+        position += length;
+        info.columns.push_back(std::move(name));
+    }
+
+    // Trailer: total rows, footer offset, magic
+    uint64_t footer_offset, num_groups;
+    if (file_bytes < position + trailer_bytes) return false;
+    in.seekg(-static_cast<std::streamoff>(trailer_bytes), std::ios::end);
+    if (!readValue(in, info.total_rows) || !readValue(in, footer_offset)) return false;
+    if (!in.read(magic, sizeof(magic)) || std::memcmp(magic, MAGIC, sizeof(MAGIC)) != 0) return false;
+
+    // The footer fills [footer_offset, trailer) exactly
+    const uint64_t footer_end = file_bytes - trailer_bytes;
+    const uint64_t entry_bytes = sizeof(uint64_t) + uint64_t(num_columns) * 2 * sizeof(uint64_t);
+    if (footer_offset < position || footer_offset > footer_end ||
+        footer_end - footer_offset < sizeof(uint64_t)) return false;
+    in.seekg(static_cast<std::streamoff>(footer_offset));
+    if (!readValue(in, num_groups)) return false;
+    const uint64_t entries_bytes = footer_end - footer_offset - sizeof(uint64_t);
+    if (entries_bytes % entry_bytes != 0 || entries_bytes / entry_bytes != num_groups) return false;
+
+    info.row_groups.resize(num_groups);
+    uint64_t rows = 0;
+    for (auto& group : info.row_groups) {
+        if (!readValue(in, group.rows)) return false;
+        // Row positions within a group are uint32
+        if (group.rows > UINT32_MAX || group.rows > info.total_rows - rows) return false;
+        rows += group.rows;
+        group.columns.resize(num_columns);
+        for (auto& chunk : group.columns) {
+            if (!readValue(in, chunk.offset) || !readValue(in, chunk.bytes)) return false;
+            if (chunk.bytes > footer_offset || chunk.offset > footer_offset - chunk.bytes) return false;
+        }
+    }
+    return rows == info.total_rows;
+}
+
+// Positions of the requested columns in the file; false if one is missing
+bool findColumns(const FileInfo& info, const std::vector<std::string>& columns, std::vector<size_t>& wanted) {
+    std::unordered_map<std::string, size_t> index;
+    for (size_t c = 0; c < info.columns.size(); c++) index[info.columns[c]] = c;
+    wanted.clear();
+    for (const auto& column : columns) {
+        auto it = index.find(column);
+        if (it == index.end()) return false;
+        wanted.push_back(it->second);
+    }
+    return true;
+}
+
+bool decode(uint32_t version, const char* chunk, uint64_t bytes, uint64_t rows, std::vector<std::string>& values) {
+    return version == 1 ? decodePlain(chunk, bytes, rows, values) : decodeChunk(chunk, bytes, rows, values);
+}
+
+// Version 1 chunks are decoded and filtered row by row
+bool filterPlain(const char* chunk, uint64_t bytes, uint64_t rows, const Filter& filter, bool all,
+                 std::vector<uint32_t>& selection) {
+    std::vector<std::string> values;
+    if (!decodePlain(chunk, bytes, rows, values)) return false;
+    std::vector<uint32_t> kept;
+    if (all) {
+        for (uint32_t r = 0; r < rows; r++)
+            if (filter.matches(values[r])) kept.push_back(r);
+    } else {
+        for (uint32_t r : selection)
+            if (filter.matches(values[r])) kept.push_back(r);
+    }
+    selection.swap(kept);
+    return true;
+}
+
+bool filterRows(uint32_t version, const char* chunk, uint64_t bytes, uint64_t rows, const Filter& filter, bool all,
+                std::vector<uint32_t>& selection) {
+    return version == 1 ? filterPlain(chunk, bytes, rows, filter, all, selection)
+                        : filterChunk(chunk, bytes, rows, filter, all, selection);
+}
+
+// Decodes only the rows in `selection`
+bool decodeSelected(uint32_t version, const char* chunk, uint64_t bytes, uint64_t rows,
+                    const std::vector<uint32_t>& selection, std::vector<std::string>& values) {
+    if (version != 1) return decodeRows(chunk, bytes, rows, selection, values);
+    std::vector<std::string> decoded;
+    if (!decodePlain(chunk, bytes, rows, decoded)) return false;
+    for (uint32_t r : selection) values.push_back(std::move(decoded[r]));
+    return true;
+}
+}
+
+bool Writer::open(const std::string& path, const std::vector<std::string>& columns) {
+    out_.open(path, std::ios::binary | std::ios::trunc);
+    if (!out_.is_open()) return false;
+    info_ = FileInfo();
+    info_.columns = columns;
+
+    out_.write(MAGIC, sizeof(MAGIC));
+    writeValue<uint32_t>(out_, VERSION);
+    writeValue<uint32_t>(out_, static_cast<uint32_t>(columns.size()));
+    position_ = sizeof(MAGIC) + 2 * sizeof(uint32_t);
+    for (const auto& name : columns) {
+        writeValue<uint32_t>(out_, static_cast<uint32_t>(name.size()));
+        out_.write(name.data(), name.size());
+        position_ += sizeof(uint32_t) + name.size();
+    }
+    return out_.good();
+}
+
+bool Writer::appendRowGroup(const std::vector<std::string>& fields, size_t rows) {
+    size_t num_columns = info_.columns.size();
+    if (fields.size() != rows * num_columns) return false;
+    if (rows == 0) return true;
+
+    RowGroupInfo group;
+    group.rows = rows;
+    for (size_t c = 0; c < num_columns; c++) {
+        if (!encodeChunk(fields, c, num_columns, rows, chunk_)) return false;
+        out_.write(chunk_.data(), chunk_.size());
+        group.columns.push_back({position_, chunk_.size()});
+        position_ += chunk_.size();
+    }
+    info_.total_rows += rows;
+    info_.row_groups.push_back(std::move(group));
+    return out_.good();
+}
+
+bool Writer::appendRows(const std::vector<std::map<std::string, std::string>>& table, size_t start, size_t count) {
+    std::vector<std::string> fields;
+    fields.reserve(count * info_.columns.size());
+    for (size_t r = start; r < start + count && r < table.size(); r++) {
+        const auto& row = table[r];
+        for (const auto& column : info_.columns) {
+            auto it = row.find(column);
+            fields.push_back(it != row.end() ? it->second : std::string());
+        }
+    }
+    return appendRowGroup(fields, fields.size() / std::max<size_t>(info_.columns.size(), 1));
+}
+
+bool Writer::close() {
+    uint64_t footer_offset = position_;
+    writeValue<uint64_t>(out_, info_.row_groups.size());
+    for (const auto& group : info_.row_groups) {
+        writeValue<uint64_t>(out_, group.rows);
+        for (const auto& chunk : group.columns) {
+            writeValue<uint64_t>(out_, chunk.offset);
+            writeValue<uint64_t>(out_, chunk.bytes);
+        }
+    }
+    writeValue<uint64_t>(out_, info_.total_rows);
+    writeValue<uint64_t>(out_, footer_offset);
+    out_.write(MAGIC, sizeof(MAGIC));
+    out_.close();
+    return !out_.fail();
+}
+
+bool readFileInfo(const std::string& path, FileInfo& info) {
+    std::ifstream in(path, std::ios::binary);
+    return in && readFileInfo(in, info);
+}
+
+// Bytes of a row group's chunks; progress counts a finished row group as all
+// of them, however many were read
+static uint64_t groupBytes(const RowGroupInfo& group) {
+    uint64_t bytes = 0;
+    for (const auto& chunk : group.columns) bytes += chunk.bytes;
+    return bytes;
+}
+
+// Decodes the requested columns of the rows of a .col file read from `in`
+// that pass `filters`
+static bool readTable(std::istream& in, const std::vector<std::string>& columns, const std::vector<Filter>& filters,
+                      std::vector<std::map<std::string, std::string>>& out, uint64_t& rows) {
+    FileInfo info;
+    if (!readFileInfo(in, info)) return false;
+
+    std::vector<size_t> wanted, filter_columns;
+    std::vector<std::string> filter_names;
+    for (const auto& filter : filters) filter_names.push_back(filter.column);
+    if (!findColumns(info, columns, wanted) || !findColumns(info, filter_names, filter_columns)) return false;
+    if (filters.empty()) out.reserve(out.size() + info.total_rows);
+
+    std::vector<char> buffer;
+    std::vector<std::string> values;
+    std::vector<uint32_t> selection;
+    auto readChunk = [&](const ColumnChunk& chunk) {
+        buffer.resize(chunk.bytes);
+        in.seekg(static_cast<std::streamoff>(chunk.offset));
+        return static_cast<bool>(in.read(buffer.data(), chunk.bytes));
+    };
+    for (const auto& group : info.row_groups) {
+        bool all = true;
+        selection.clear();
+        for (size_t f = 0; f < filters.size() && (all || !selection.empty()); f++) {
+            const ColumnChunk& chunk = group.columns[filter_columns[f]];
+            if (!readChunk(chunk) ||
+                !filterRows(info.version, buffer.data(), chunk.bytes, group.rows, filters[f], all, selection))
+                return false;
+            all = false;
+        }
+        // Rows the filters drop are never decoded
+        size_t first_row = out.size();
+        size_t kept = all ? group.rows : selection.size();
+        out.resize(first_row + kept);
+        for (size_t w = 0; w < wanted.size() && kept > 0; w++) {
+            const ColumnChunk& chunk = group.columns[wanted[w]];
+            if (!readChunk(chunk)) return false;
+            values.clear();
+            bool ok = all ? decode(info.version, buffer.data(), chunk.bytes, group.rows, values)
+                          : decodeSelected(info.version, buffer.data(), chunk.bytes, group.rows, selection, values);
+            if (!ok) return false;
+            for (size_t r = 0; r < kept; r++)
+                out[first_row + r].emplace(columns[w], std::move(values[r]));
+        }
+        Progress::advance(groupBytes(group), group.rows);
+        rows += kept;
+    }
+    return true;
+}
+
+bool readTable(const std::string& path, const std::vector<std::string>& columns,
+               std::vector<std::map<std::string, std::string>>& out, const std::vector<Filter>& filters) {
+    Tracing::Scope trace_scope(Tracing::intern("read " + path), "io");
+    std::ifstream in(path, std::ios::binary);
+    uint64_t rows = 0;
+    if (!in || !readTable(in, columns, filters, out, rows)) return false;
+    trace_scope.setArg(rows);
+    return true;
+}
+
+bool readTable(const char* data, uint64_t bytes, const std::vector<std::string>& columns,
+               std::vector<std::map<std::string, std::string>>& out, const std::vector<Filter>& filters) {
+    Tracing::Scope trace_scope("read image", "io");
+    MemoryBuffer buffer(data, bytes);
+    std::istream in(&buffer);
+    uint64_t rows = 0;
+    if (!readTable(in, columns, filters, out, rows)) return false;
+    trace_scope.setArg(rows);
+    return true;
+}
+
+bool Scanner::open(const std::string& path, const std::vector<std::string>& columns, Buffer::Pool& pool,
+                   const std::vector<Filter>& filters) {
+    pool_ = &pool;
+    next_group_ = 0;
+    failed_ = false;
+    columns_ = columns;
+    filters_ = filters;
+    if (!readFileInfo(path, info_) || !findColumns(info_, columns, wanted_)) return false;
+    std::vector<std::string> filter_names;
+    for (const auto& filter : filters) filter_names.push_back(filter.column);
+    if (!findColumns(info_, filter_names, filter_columns_)) return false;
+    file_ = pool.openFile(path);
+    if (file_ < 0) return false;
+    prefetchGroup(0);
+    return true;
+}
+
+void Scanner::prefetchGroup(size_t group) {
+    if (group >= info_.row_groups.size()) return;
+    // Filter columns first, they are read first
+    for (size_t column : filter_columns_) {
+        const ColumnChunk& chunk = info_.row_groups[group].columns[column];
+        pool_->prefetch(file_, chunk.offset, chunk.bytes);
+    }
+    for (size_t column : wanted_) {
+        const ColumnChunk& chunk = info_.row_groups[group].columns[column];
+        pool_->prefetch(file_, chunk.offset, chunk.bytes);
+    }
+}
+
+bool Scanner::readChunk(const ColumnChunk& chunk) {
+    buffer_.resize(chunk.bytes);
+    return pool_->read(file_, chunk.offset, chunk.bytes, buffer_.data());
+}
+
+bool Scanner::selectRows(const RowGroupInfo& group, std::vector<uint32_t>& selection, bool& all) {
+    all = true;
+    selection.clear();
+    for (size_t f = 0; f < filters_.size(); f++) {
+        const ColumnChunk& chunk = group.columns[filter_columns_[f]];
+        if (!readChunk(chunk) ||
+            !filterRows(info_.version, buffer_.data(), chunk.bytes, group.rows, filters_[f], all, selection))
+            return false;
+        all = false;
+        if (selection.empty()) break;
+    }
+    return true;
+}
+
+bool Scanner::next(std::vector<std::map<std::string, std::string>>& rows) {
+    if (failed_ || file_ < 0) return false;
+    while (next_group_ < info_.row_groups.size()) {
+        const RowGroupInfo& group = info_.row_groups[next_group_++];
+        bool all;
+        if (!selectRows(group, selection_, all)) {
+            failed_ = true;
+            return false;
+        }
+        if (!all && selection_.empty()) {
+            prefetchGroup(next_group_);
+            Progress::advance(groupBytes(group), group.rows);
+            continue;
+        }
+
+        rows.clear();
+        rows.resize(all ? group.rows : selection_.size());
+        for (size_t w = 0; w < wanted_.size(); w++) {
+            const ColumnChunk& chunk = group.columns[wanted_[w]];
+            values_.clear();
+            bool ok = readChunk(chunk);
+            if (ok && all) ok = decode(info_.version, buffer_.data(), chunk.bytes, group.rows, values_);
+            else if (ok) ok = decodeSelected(info_.version, buffer_.data(), chunk.bytes, group.rows, selection_, values_);
+            if (!ok) {
+                failed_ = true;
+                return false;
+            }
+            for (size_t r = 0; r < rows.size(); r++)
+                rows[r].emplace(columns_[w], std::move(values_[r]));
+        }
+        // Read the next row group while the caller works on this one
+        prefetchGroup(next_group_);
+        Progress::advance(groupBytes(group), group.rows);
+        return true;
+    }
+    return false;
+}
+
+bool Scanner::sum(const std::string& column, double& total) {
+    if (failed_ || file_ < 0) return false;
+    std::vector<size_t> target;
+    if (!findColumns(info_, {column}, target)) return false;
+    while (next_group_ < info_.row_groups.size()) {
+        const RowGroupInfo& group = info_.row_groups[next_group_++];
+        bool all;
+        bool ok = selectRows(group, selection_, all);
+        if (ok && (all || !selection_.empty())) {
+            const ColumnChunk& chunk = group.columns[target[0]];
+            ok = readChunk(chunk);
+            if (ok && info_.version == 1) {
+                values_.clear();
+                ok = decodePlain(buffer_.data(), chunk.bytes, group.rows, values_);
+                auto add = [&](uint32_t r) { total += FastParse::toDouble(values_[r]); };
+                if (ok && all) for (uint32_t r = 0; r < group.rows; r++) add(r);
+                else if (ok) for (uint32_t r : selection_) add(r);
+            } else if (ok) {
+                ok = sumChunk(buffer_.data(), chunk.bytes, group.rows, all ? nullptr : &selection_, total);
+            }
+        }
+        if (!ok) {
+            failed_ = true;
+            return false;
+        }
+        prefetchGroup(next_group_);
+        Progress::advance(groupBytes(group), group.rows);
+    }
+    return true;
+}
+
+bool writeTable(const std::string& path, const std::vector<std::string>& columns,
+                const std::vector<std::map<std::string, std::string>>& table, size_t rows_per_group) {
+    Writer writer;
+    if (!writer.open(path, columns)) return false;
+    for (size_t start = 0; start < table.size(); start += rows_per_group) {
+        if (!writer.appendRows(table, start, rows_per_group)) return false;
+    }
+    return writer.close();
+}
+
+}
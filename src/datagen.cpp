@@ -0,0 +1,447 @@
+#include "../include/datagen.hpp"
+#include "../include/arrow.hpp"
+#include "../include/columnar.hpp"
+#include "../include/statistics.hpp"
+#include "../include/tpch_schema.hpp"
+#include "../include/trace.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <thread>
+
+namespace DataGen {
+
+namespace {
+
+// splitmix64: small, fast and identical on every platform (unlike the
+// std:: distributions, whose output is implementation defined)
+class Random {
+public:
+    explicit Random(uint64_t seed) : state_(seed) {}
+
+    uint64_t next() {
+        uint64_t z = (state_ += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+
+    int64_t uniform(int64_t low, int64_t high) {
+        return low + static_cast<int64_t>(next() % static_cast<uint64_t>(high - low + 1));
+    }
+
+private:
+    uint64_t state_;
+};
+
+const size_t BLOCK_ROWS = 10000;
+
+struct NationSpec {
+    const char* name;
+    int region;
+};
+
+const NationSpec NATIONS[25] = {
+    {"ALGERIA", 0}, {"ARGENTINA", 1}, {"BRAZIL", 1}, {"CANADA", 1}, {"EGYPT", 4},
+    {"ETHIOPIA", 0}, {"FRANCE", 3}, {"GERMANY", 3}, {"INDIA", 2}, {"INDONESIA", 2},
+    {"IRAN", 4}, {"IRAQ", 4}, {"JAPAN", 2}, {"JORDAN", 4}, {"KENYA", 0},
+    {"MOROCCO", 0}, {"MOZAMBIQUE", 0}, {"PERU", 1}, {"CHINA", 2}, {"ROMANIA", 3},
+    {"SAUDI ARABIA", 4}, {"VIETNAM", 2}, {"RUSSIA", 3}, {"UNITED KINGDOM", 3}, {"UNITED STATES", 1},
+};
+
+const char* REGIONS[5] = {"AFRICA", "AMERICA", "ASIA", "EUROPE", "MIDDLE EAST"};
+const char* SEGMENTS[5] = {"AUTOMOBILE", "BUILDING", "FURNITURE", "MACHINERY", "HOUSEHOLD"};
+const char* PRIORITIES[5] = {"1-URGENT", "2-HIGH", "3-MEDIUM", "4-NOT SPECIFIED", "5-LOW"};
+const char* INSTRUCTIONS[4] = {"DELIVER IN PERSON", "COLLECT COD", "NONE", "TAKE BACK RETURN"};
+const char* MODES[7] = {"REG AIR", "AIR", "RAIL", "SHIP", "TRUCK", "MAIL", "FOB"};
+const char* WORDS[] = {
+    "furiously", "sly", "careful", "blithe", "quick", "fluffy", "slow", "quiet", "ruthless", "thin",
+    "close", "dogged", "daring", "brave", "stealthy", "permanent", "enticing", "idle", "busy", "regular",
+    "final", "ironic", "even", "bold", "silent", "packages", "requests", "accounts", "deposits", "foxes",
+    "ideas", "theodolites", "pinto", "beans", "instructions", "dependencies", "excuses", "platelets",
+    "asymptotes", "courts", "dolphins", "multipliers", "sauternes", "warthogs", "frets", "dinos",
+    "attainments", "somas", "sleep", "wake", "are", "cajole", "haggle", "nag", "use", "boost", "affix",
+    "detect", "integrate", "maintain", "nod", "was", "lose", "sublate", "solve", "thrash", "promise",
+    "engage", "hinder", "print", "x-ray", "breach", "eat", "grow", "impress", "mold", "poach", "serve",
+    "run", "dazzle", "snooze", "doze", "unwind", "kindle", "play", "hang", "believe", "doubt", "about",
+    "above", "according", "to", "across", "after", "against", "along", "among", "around", "at", "the",
+};
+
+// Day numbers (days since 1970-01-01) of the dbgen date constants
+int64_t daysFromCivil(int64_t y, unsigned m, unsigned d) {
+    y -= m <= 2;
+    const int64_t era = (y >= 0 ? y : y - 399) / 400;
+    const unsigned yoe = static_cast<unsigned>(y - era * 400);
+    const unsigned doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + static_cast<int64_t>(doe) - 719468;
+}
+
+std::string dateString(int64_t days) {
+    days += 719468;
+    const int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+    const unsigned doe = static_cast<unsigned>(days - era * 146097);
+    const unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    const unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    const unsigned mp = (5 * doy + 2) / 153;
+    const unsigned d = doy - (153 * mp + 2) / 5 + 1;
+    const unsigned m = mp < 10 ? mp + 3 : mp - 9;
+    const int64_t y = static_cast<int64_t>(yoe) + era * 400 + (m <= 2);
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "%04lld-%02u-%02u", static_cast<long long>(y), m, d);
+    return buf;
+}
+
+const int64_t START_DATE = daysFromCivil(1992, 1, 1);
+const int64_t CURRENT_DATE = daysFromCivil(1995, 6, 17);
+const int64_t END_DATE = daysFromCivil(1998, 12, 31);
+
+std::string money(int64_t cents) {
+    char buf[32];
+    int64_t magnitude = cents < 0 ? -cents : cents;
+    std::snprintf(buf, sizeof(buf), "%s%lld.%02lld", cents < 0 ? "-" : "",
+                  static_cast<long long>(magnitude / 100), static_cast<long long>(magnitude % 100));
+    return buf;
+}
+
+std::string keyName(const char* prefix, int64_t key) {
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "%s#%09lld", prefix, static_cast<long long>(key));
+    return buf;
+}
+
+std::string text(Random& rng, int min_length, int max_length) {
+    size_t length = static_cast<size_t>(rng.uniform(min_length, max_length));
+    std::string out;
+    const int num_words = sizeof(WORDS) / sizeof(WORDS[0]);
+    while (out.size() < length) {
+        if (!out.empty()) out += ' ';
+        out += WORDS[rng.uniform(0, num_words - 1)];
+    }
+    out.resize(length);
+    return out;
+}
+
+std::string address(Random& rng) {
+    static const char alphabet[] = "0123456789abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ,";
+    size_t length = static_cast<size_t>(rng.uniform(10, 40));
+    std::string out(length, ' ');
+    for (auto& c : out) c = alphabet[rng.uniform(0, sizeof(alphabet) - 2)];
+    return out;
+}
+
+std::string phone(Random& rng, int64_t nation) {
+    char buf[48];
+    std::snprintf(buf, sizeof(buf), "%02d-%03d-%03d-%04d", static_cast<int>(nation + 10),
+                  static_cast<int>(rng.uniform(100, 999)), static_cast<int>(rng.uniform(100, 999)),
+                  static_cast<int>(rng.uniform(1000, 9999)));
+    return buf;
+}
+
+// dbgen's sparse order keys: 8 used keys out of every 32
+int64_t sparseOrderKey(int64_t i) {
+    return ((i >> 3) << 5) | (i & 7);
+}
+
+int64_t scaled(double scale_factor, int64_t base) {
+    return std::max<int64_t>(1, static_cast<int64_t>(scale_factor * base));
+}
+
+// Rows of one generated block in row-major order
+struct Block {
+    std::vector<std::string> fields;
+    size_t rows = 0;
+
+    template <typename... Values>
+    void addRow(Values&&... values) {
+        (fields.push_back(std::forward<Values>(values)), ...);
+        rows++;
+    }
+};
+
+// One table-producing job: fills blocks[0..outputs) for a given block number
+struct Job {
+    std::vector<std::string> tables;
+    size_t num_blocks;
+    std::function<void(size_t block, Random& rng, std::vector<Block>& out)> generate;
+};
+
+std::vector<Job> makeJobs(const Options& options) {
+    const double sf = options.scale_factor;
+    const int64_t customers = static_cast<int64_t>(customerCount(sf));
+    const int64_t suppliers = static_cast<int64_t>(supplierCount(sf));
+    const int64_t orders = static_cast<int64_t>(orderCount(sf));
+    const int64_t parts = scaled(sf, 200000);
+    const int64_t clerks = scaled(sf, 1000);
+    auto blocksFor = [](int64_t rows) { return static_cast<size_t>((rows + BLOCK_ROWS - 1) / BLOCK_ROWS); };
+
+    std::vector<Job> jobs;
+    jobs.push_back({{"region"}, 1, [](size_t, Random& rng, std::vector<Block>& out) {
+        for (int r = 0; r < 5; r++)
+            out[0].addRow(std::to_string(r), REGIONS[r], text(rng, 31, 115));
+    }});
+    jobs.push_back({{"nation"}, 1, [](size_t, Random& rng, std::vector<Block>& out) {
+        for (int n = 0; n < 25; n++)
+            out[0].addRow(std::to_string(n), NATIONS[n].name, std::to_string(NATIONS[n].region), text(rng, 31, 114));
+    }});
+    jobs.push_back({{"supplier"}, blocksFor(suppliers), [=](size_t block, Random& rng, std::vector<Block>& out) {
+        int64_t first = static_cast<int64_t>(block * BLOCK_ROWS) + 1;
+        int64_t last = std::min<int64_t>(suppliers, first + BLOCK_ROWS - 1);
+        for (int64_t key = first; key <= last; key++) {
+            int64_t nation = rng.uniform(0, 24);
+            out[0].addRow(std::to_string(key), keyName("Supplier", key), address(rng), std::to_string(nation),
+                          phone(rng, nation), money(rng.uniform(-99999, 999999)), text(rng, 25, 100));
+        }
+    }});
+    jobs.push_back({{"customer"}, blocksFor(customers), [=](size_t block, Random& rng, std::vector<Block>& out) {
+        int64_t first = static_cast<int64_t>(block * BLOCK_ROWS) + 1;
+        int64_t last = std::min<int64_t>(customers, first + BLOCK_ROWS - 1);
+        for (int64_t key = first; key <= last; key++) {
+            int64_t nation = rng.uniform(0, 24);
+            out[0].addRow(std::to_string(key), keyName("Customer", key), address(rng), std::to_string(nation),
+                          phone(rng, nation), money(rng.uniform(-99999, 999999)), SEGMENTS[rng.uniform(0, 4)],
+                          text(rng, 29, 116));
+        }
+    }});
+    jobs.push_back({{"orders", "lineitem"}, blocksFor(orders), [=](size_t block, Random& rng, std::vector<Block>& out) {
+        int64_t first = static_cast<int64_t>(block * BLOCK_ROWS) + 1;
+        int64_t last = std::min<int64_t>(orders, first + BLOCK_ROWS - 1);
+        for (int64_t i = first; i <= last; i++) {
+            int64_t order_key = sparseOrderKey(i);
+            // Every third customer never places an order
+            int64_t cust_key;
+            do {
+                cust_key = rng.uniform(1, customers);
+            } while (cust_key % 3 == 0 && customers > 2);
+            int64_t order_date = rng.uniform(START_DATE, END_DATE - 151);
+            int64_t num_lines = rng.uniform(1, 7);
+
+            int64_t total_cents = 0;
+            int shipped = 0;
+            for (int64_t line = 1; line <= num_lines; line++) {
+                int64_t part_key = rng.uniform(1, parts);
+                int64_t supp_index = rng.uniform(0, 3);
+                int64_t supp_key = (part_key + supp_index * (suppliers / 4 + (part_key - 1) / suppliers)) % suppliers + 1;
+                int64_t quantity = rng.uniform(1, 50);
+                int64_t retail_cents = 90000 + ((part_key / 10) % 20001) + 100 * (part_key % 1000);
+                int64_t extended_cents = quantity * retail_cents;
+                int64_t discount = rng.uniform(0, 10);
+                int64_t tax = rng.uniform(0, 8);
+                int64_t ship_date = order_date + rng.uniform(1, 121);
+                int64_t commit_date = order_date + rng.uniform(30, 90);
+                int64_t receipt_date = ship_date + rng.uniform(1, 30);
+                const char* return_flag = receipt_date <= CURRENT_DATE ? (rng.uniform(0, 1) ? "R" : "A") : "N";
+                bool open = ship_date > CURRENT_DATE;
+                shipped += open ? 0 : 1;
+                total_cents += (extended_cents * (100 + tax) * (100 - discount) + 5000) / 10000;
+
+                out[1].addRow(std::to_string(order_key), std::to_string(part_key), std::to_string(supp_key),
+                              std::to_string(line), std::to_string(quantity) + ".00", money(extended_cents),
+                              money(discount), money(tax), return_flag, open ? "O" : "F",
+                              dateString(ship_date), dateString(commit_date), dateString(receipt_date),
+                              INSTRUCTIONS[rng.uniform(0, 3)], MODES[rng.uniform(0, 6)], text(rng, 10, 43));
+            }
+            const char* status = shipped == num_lines ? "F" : (shipped == 0 ? "O" : "P");
+            out[0].addRow(std::to_string(order_key), std::to_string(cust_key), status, money(total_cents),
+                          dateString(order_date), PRIORITIES[rng.uniform(0, 4)], keyName("Clerk", rng.uniform(1, clerks)),
+                          "0", text(rng, 19, 78));
+        }
+    }});
+    return jobs;
+}
+
+// Destination of the blocks of one table
+class Sink {
+public:
+    virtual ~Sink() = default;
+    virtual bool write(const Block& block) = 0;
+    virtual bool close() = 0;
+};
+
+class TblSink : public Sink {
+public:
+    TblSink(const std::string& path, size_t num_columns) : out_(path, std::ios::binary), columns_(num_columns) {}
+    bool write(const Block& block) override {
+        std::string buffer;
+        for (size_t r = 0; r < block.rows; r++) {
+            for (size_t c = 0; c < columns_; c++) {
+                buffer += block.fields[r * columns_ + c];
+                buffer += '|';
+            }
+            buffer += '\n';
+        }
+        out_.write(buffer.data(), buffer.size());
+        return out_.good();
+    }
+    bool close() override {
+        out_.close();
+        return !out_.fail();
+    }
+    bool isOpen() const { return out_.is_open(); }
+private:
+    std::ofstream out_;
+    size_t columns_;
+};
+
+class ColumnarSink : public Sink {
+public:
+    bool open(const std::string& path, const std::vector<std::string>& columns) { return writer_.open(path, columns); }
+    bool write(const Block& block) override { return writer_.appendRowGroup(block.fields, block.rows); }
+    bool close() override { return writer_.close(); }
+private:
+    Columnar::Writer writer_;
+};
+
+// One Utf8 record batch per block, so the text of every field is kept as is
+class ArrowSink : public Sink {
+public:
+    bool open(const std::string& path, const std::vector<std::string>& columns) {
+        return writer_.open(path, Arrow::textFields(columns));
+    }
+    bool write(const Block& block) override { return writer_.appendBatch(block.fields, block.rows); }
+    bool close() override { return writer_.close(); }
+private:
+    Arrow::Writer writer_;
+};
+
+class MemorySink : public Sink {
+public:
+    MemorySink(std::vector<std::map<std::string, std::string>>& out, const std::vector<std::string>& columns)
+        : out_(out), columns_(columns) {}
+    bool write(const Block& block) override {
+        for (size_t r = 0; r < block.rows; r++) {
+            std::map<std::string, std::string> row;
+            for (size_t c = 0; c < columns_.size(); c++)
+                row.emplace(columns_[c], block.fields[r * columns_.size() + c]);
+            out_.push_back(std::move(row));
+        }
+        return true;
+    }
+    bool close() override { return true; }
+private:
+    std::vector<std::map<std::string, std::string>>& out_;
+    const std::vector<std::string>& columns_;
+};
+
+// Keeps the statistics of a table current as its blocks go to `inner`, and
+// saves them once the table file is complete
+class StatisticsSink : public Sink {
+public:
+    StatisticsSink(std::unique_ptr<Sink> inner, const std::string& path, const std::string& table,
+                   const std::vector<std::string>& columns, int num_threads)
+        : inner_(std::move(inner)), path_(path), stats_(table, columns), threads_(num_threads) {}
+    bool write(const Block& block) override {
+        stats_.appendRowGroup(block.fields, block.rows, threads_);
+        return inner_->write(block);
+    }
+    bool close() override { return inner_->close() && Statistics::writeStats(path_, stats_); }
+private:
+    std::unique_ptr<Sink> inner_;
+    std::string path_;
+    Statistics::TableStats stats_;
+    int threads_;
+};
+
+// Generates blocks in waves of num_threads * 2 and hands them to the sinks in order
+bool runJob(const Job& job, size_t job_id, const Options& options, std::vector<Sink*>& sinks) {
+    Tracing::Scope trace_scope(Tracing::intern("generate " + job.tables[0]), "datagen");
+    const size_t num_threads = static_cast<size_t>(std::max(1, options.num_threads));
+    const size_t wave = num_threads * 2;
+
+    for (size_t first = 0; first < job.num_blocks; first += wave) {
+        size_t count = std::min(wave, job.num_blocks - first);
+        std::vector<std::vector<Block>> blocks(count, std::vector<Block>(job.tables.size()));
+
+        auto worker = [&](size_t thread_id) {
+            Tracing::setThreadName("datagen-worker");
+            for (size_t b = thread_id; b < count; b += num_threads) {
+                Tracing::Scope block_trace("block", "datagen");
+                Random rng(options.seed ^ (job_id << 48) ^ ((first + b + 1) * 0xD1B54A32D192ED03ULL));
+                job.generate(first + b, rng, blocks[b]);
+            }
+        };
+        std::vector<std::thread> threads;
+        for (size_t t = 1; t < std::min(num_threads, count); t++) threads.emplace_back(worker, t);
+        worker(0);
+        for (auto& t : threads) t.join();
+
+        for (const auto& outputs : blocks)
+            for (size_t o = 0; o < outputs.size(); o++)
+                if (!sinks[o]->write(outputs[o])) return false;
+    }
+    for (auto* sink : sinks)
+        if (!sink->close()) return false;
+    return true;
+}
+
+}
+
+uint64_t customerCount(double scale_factor) { return static_cast<uint64_t>(scaled(scale_factor, 150000)); }
+uint64_t supplierCount(double scale_factor) { return static_cast<uint64_t>(scaled(scale_factor, 10000)); }
+uint64_t orderCount(double scale_factor) { return static_cast<uint64_t>(scaled(scale_factor, 1500000)); }
+
+bool generateFiles(const Options& options, const std::string& output_dir, OutputFormat format) {
+    std::error_code ec;
+    std::filesystem::create_directories(output_dir, ec);
+    std::string prefix = output_dir;
+    if (!prefix.empty() && prefix.back() != '/') prefix += "/";
+
+    std::vector<Job> jobs = makeJobs(options);
+    for (size_t j = 0; j < jobs.size(); j++) {
+        std::vector<std::unique_ptr<Sink>> owned;
+        std::vector<Sink*> sinks;
+        for (const auto& table : jobs[j].tables) {
+            const auto& columns = TPCH::columnsOf(table);
+            if (format == OutputFormat::TBL) {
+                auto sink = std::make_unique<TblSink>(prefix + table + ".tbl", columns.size());
+                if (!sink->isOpen()) return false;
+                owned.push_back(std::move(sink));
+            } else if (format == OutputFormat::ARROW) {
+                auto sink = std::make_unique<ArrowSink>();
+                if (!sink->open(prefix + table + ".arrow", columns)) return false;
+                owned.push_back(std::move(sink));
+            } else {
+                auto sink = std::make_unique<ColumnarSink>();
+                if (!sink->open(prefix + table + ".col", columns)) return false;
+                owned.push_back(std::move(sink));
+            }
+            if (options.statistics) {
+                owned.back() = std::make_unique<StatisticsSink>(std::move(owned.back()), prefix + table + ".stats.json",
+                                                                table, columns, options.num_threads);
+            }
+            sinks.push_back(owned.back().get());
+        }
+        if (!runJob(jobs[j], j, options, sinks)) return false;
+    }
+    return true;
+}
+
+bool generateTables(const Options& options,
+                    std::vector<std::map<std::string, std::string>>& customer_data,
+                    std::vector<std::map<std::string, std::string>>& orders_data,
+                    std::vector<std::map<std::string, std::string>>& lineitem_data,
+                    std::vector<std::map<std::string, std::string>>& supplier_data,
+                    std::vector<std::map<std::string, std::string>>& nation_data,
+                    std::vector<std::map<std::string, std::string>>& region_data) {
+    std::map<std::string, std::vector<std::map<std::string, std::string>>*> targets = {
+        {"customer", &customer_data}, {"orders", &orders_data}, {"lineitem", &lineitem_data},
+        {"supplier", &supplier_data}, {"nation", &nation_data}, {"region", &region_data},
+    };
+    std::vector<Job> jobs = makeJobs(options);
+    for (size_t j = 0; j < jobs.size(); j++) {
+        std::vector<std::unique_ptr<Sink>> owned;
+        std::vector<Sink*> sinks;
+        for (const auto& table : jobs[j].tables) {
+            targets[table]->clear();
+            owned.push_back(std::make_unique<MemorySink>(*targets[table], TPCH::columnsOf(table)));
+            sinks.push_back(owned.back().get());
+        }
+        if (!runJob(jobs[j], j, options, sinks)) return false;
+    }
+    return true;
+}
+
+}
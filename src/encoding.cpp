@@ -0,0 +1,664 @@
+#include "../include/encoding.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+
+namespace Columnar {
+
+namespace {
+constexpr int MAX_DIGITS = 18;                 // |value| < 10^18 fits an int64
+constexpr int64_t THRESHOLD_LIMIT = int64_t(1) << 62;
+constexpr uint32_t BLOCK_VALUES = 1 << 15;     // packed values summed in uint64 before widening
+
+const int64_t POW10[] = {1LL, 10LL, 100LL, 1000LL, 10000LL, 100000LL, 1000000LL, 10000000LL, 100000000LL,
+                         1000000000LL, 10000000000LL, 100000000000LL, 1000000000000LL, 10000000000000LL,
+                         100000000000000LL, 1000000000000000LL, 10000000000000000LL, 100000000000000000LL,
+                         1000000000000000000LL};
+
+template <typename T>
+T load(const char* p) {
+    T value;
+    std::memcpy(&value, p, sizeof(T));
+    return value;
+}
+
+template <typename T>
+void append(std::vector<char>& out, T value) {
+    const char* p = reinterpret_cast<const char*>(&value);
+    out.insert(out.end(), p, p + sizeof(T));
+}
+
+uint32_t bitWidth(uint64_t range) {
+    uint32_t width = 0;
+    while (width < 64 && (range >> width) != 0) width++;
+    return width;
+}
+
+uint64_t packedBytes(uint64_t count, uint32_t width) {
+    return ((count * width + 63) / 64 + 1) * sizeof(uint64_t);
+}
+
+void appendPacked(std::vector<char>& out, const std::vector<uint64_t>& values, uint32_t width) {
+    std::vector<uint64_t> words(packedBytes(values.size(), width) / sizeof(uint64_t), 0);
+    if (width > 0) {
+        for (size_t i = 0; i < values.size(); i++) {
+            uint64_t bit = i * width;
+            uint32_t shift = bit % 64;
+            words[bit / 64] |= values[i] << shift;
+            if (shift + width > 64) words[bit / 64 + 1] |= values[i] >> (64 - shift);
+        }
+    }
+    const char* p = reinterpret_cast<const char*>(words.data());
+    out.insert(out.end(), p, p + words.size() * sizeof(uint64_t));
+}
+
+inline uint64_t unpack(const char* packed, uint32_t width, uint64_t i) {
+    if (width == 0) return 0;
+    uint64_t bit = i * width;
+    const char* p = packed + bit / 64 * sizeof(uint64_t);
+    uint32_t shift = bit % 64;
+    uint64_t value = load<uint64_t>(p) >> shift;
+    if (shift + width > 64) value |= load<uint64_t>(p + sizeof(uint64_t)) << (64 - shift);
+    return width == 64 ? value : value & ((uint64_t(1) << width) - 1);
+}
+
+// Parses [-]digits[.digits] as value * 10^-scale
+bool parseDecimal(std::string_view s, int64_t& value, uint32_t& scale) {
+    size_t i = 0;
+    bool negative = i < s.size() && s[i] == '-';
+    if (negative) i++;
+    int64_t v = 0;
+    int digits = 0;
+    size_t start = i;
+    while (i < s.size() && s[i] >= '0' && s[i] <= '9') {
+        if (++digits > MAX_DIGITS) return false;
+        v = v * 10 + (s[i++] - '0');
+    }
+    if (i == start) return false;
+    scale = 0;
+    if (i < s.size() && s[i] == '.') {
+        start = ++i;
+        while (i < s.size() && s[i] >= '0' && s[i] <= '9') {
+            if (++digits > MAX_DIGITS) return false;
+            v = v * 10 + (s[i++] - '0');
+            scale++;
+        }
+        if (i == start) return false;
+    }
+    if (i != s.size()) return false;
+    value = negative ? -v : v;
+    return true;
+}
+
+void formatDecimal(int64_t value, uint32_t scale, std::string& out) {
+    char buf[24];
+    char* end = buf + sizeof(buf);
+    char* p = end;
+    uint64_t magnitude = value < 0 ? 0 - static_cast<uint64_t>(value) : static_cast<uint64_t>(value);
+    uint32_t digits = 0;
+    do {
+        *--p = static_cast<char>('0' + magnitude % 10);
+        magnitude /= 10;
+        if (++digits == scale) *--p = '.';
+    } while (magnitude > 0 || digits <= scale);
+    if (value < 0) *--p = '-';
+    out.assign(p, end);
+}
+
+bool toDouble(std::string_view s, double& value) {
+    char buf[64];
+    if (s.empty() || s.size() >= sizeof(buf)) return false;
+    std::memcpy(buf, s.data(), s.size());
+    buf[s.size()] = '\0';
+    char* end;
+    value = std::strtod(buf, &end);
+    return end == buf + s.size();
+}
+
+// A chunk with its sections located and validated
+struct ChunkView {
+    Encoding encoding = Encoding::PLAIN;
+    const char* offsets = nullptr;   // PLAIN values / DICT entries
+    const char* data = nullptr;
+    uint32_t entries = 0;
+    uint32_t width = 0;
+    const char* packed = nullptr;
+    uint32_t scale = 0;
+    int64_t base = 0;
+    uint32_t runs = 0;
+    const char* run_ends = nullptr;
+
+    std::string_view entry(uint64_t i) const {
+        uint32_t begin = load<uint32_t>(offsets + i * sizeof(uint32_t));
+        uint32_t end = load<uint32_t>(offsets + (i + 1) * sizeof(uint32_t));
+        return std::string_view(data + begin, end - begin);
+    }
+    uint64_t code(uint64_t i) const { return unpack(packed, width, i); }
+    int64_t intValue(uint64_t i) const { return base + static_cast<int64_t>(unpack(packed, width, i)); }
+    uint32_t runEnd(uint32_t run) const { return load<uint32_t>(run_ends + run * sizeof(uint32_t)); }
+};
+
+// Offsets of `count` strings starting at `offsets`, data following them
+bool parseStrings(const char* offsets, uint64_t available, uint64_t count, uint64_t& used) {
+    uint64_t header = (count + 1) * sizeof(uint32_t);
+    if (available < header) return false;
+    uint32_t previous = load<uint32_t>(offsets);
+    if (previous != 0) return false;
+    for (uint64_t i = 1; i <= count; i++) {
+        uint32_t next = load<uint32_t>(offsets + i * sizeof(uint32_t));
+        if (next < previous) return false;
+        previous = next;
+    }
+    if (available - header < previous) return false;
+    used = header + previous;
+    return true;
+}
+
+bool parseChunk(const char* chunk, uint64_t bytes, uint64_t rows, bool tagged, ChunkView& view) {
+    view = ChunkView();
+    const char* p = chunk;
+    uint64_t left = bytes;
+    if (tagged) {
+        if (left < sizeof(uint32_t)) return false;
+        uint32_t tag = load<uint32_t>(p);
+        if (tag > static_cast<uint32_t>(Encoding::RLE)) return false;
+        view.encoding = static_cast<Encoding>(tag);
+        p += sizeof(uint32_t);
+        left -= sizeof(uint32_t);
+    }
+    uint64_t used = 0;
+    switch (view.encoding) {
+    case Encoding::PLAIN:
+        if (!parseStrings(p, left, rows, used)) return false;
+        view.offsets = p;
+        view.data = p + (rows + 1) * sizeof(uint32_t);
+        view.entries = static_cast<uint32_t>(rows);
+        return true;
+    case Encoding::DICT: {
+        if (left < sizeof(uint32_t)) return false;
+        view.entries = load<uint32_t>(p);
+        p += sizeof(uint32_t);
+        left -= sizeof(uint32_t);
+        if (!parseStrings(p, left, view.entries, used)) return false;
+        view.offsets = p;
+        view.data = p + (uint64_t(view.entries) + 1) * sizeof(uint32_t);
+        p += used;
+        left -= used;
+        if (left < sizeof(uint32_t)) return false;
+        view.width = load<uint32_t>(p);
+        view.packed = p + sizeof(uint32_t);
+        return view.width <= 32 && left - sizeof(uint32_t) >= packedBytes(rows, view.width);
+    }
+    case Encoding::INT:
+    case Encoding::RLE: {
+        if (left < 2 * sizeof(uint32_t) + sizeof(int64_t)) return false;
+        view.scale = load<uint32_t>(p);
+        view.width = load<uint32_t>(p + sizeof(uint32_t));
+        view.base = load<int64_t>(p + 2 * sizeof(uint32_t));
+        p += 2 * sizeof(uint32_t) + sizeof(int64_t);
+        left -= 2 * sizeof(uint32_t) + sizeof(int64_t);
+        if (view.scale > MAX_DIGITS || view.width > 64) return false;
+        uint64_t values = rows;
+        if (view.encoding == Encoding::RLE) {
+            if (left < sizeof(uint32_t)) return false;
+            view.runs = load<uint32_t>(p);
+            p += sizeof(uint32_t);
+            left -= sizeof(uint32_t);
+            if (left < uint64_t(view.runs) * sizeof(uint32_t)) return false;
+            view.run_ends = p;
+            uint32_t previous = 0;
+            for (uint32_t r = 0; r < view.runs; r++) {
+                uint32_t end = view.runEnd(r);
+                if (end <= previous) return false;
+                previous = end;
+            }
+            if (previous != rows) return false;
+            p += uint64_t(view.runs) * sizeof(uint32_t);
+            left -= uint64_t(view.runs) * sizeof(uint32_t);
+            values = view.runs;
+        }
+        view.packed = p;
+        return left >= packedBytes(values, view.width);
+    }
+    }
+    return false;
+}
+
+// Filter with its bounds parsed once
+struct PreparedFilter {
+    const Filter& filter;
+    double low = 0, high = 0;
+    std::vector<double> numbers;
+
+    explicit PreparedFilter(const Filter& f) : filter(f) {
+        if (!f.numeric) return;
+        if (!f.low.empty()) low = std::strtod(f.low.c_str(), nullptr);
+        if (!f.high.empty()) high = std::strtod(f.high.c_str(), nullptr);
+        for (const auto& v : f.values) numbers.push_back(std::strtod(v.c_str(), nullptr));
+    }
+
+    bool matchesNumber(double x) const {
+        if (filter.kind == Filter::Kind::IN)
+            return std::find(numbers.begin(), numbers.end(), x) != numbers.end();
+        return (filter.low.empty() || x >= low) && (filter.high.empty() || x < high);
+    }
+
+    bool matches(std::string_view value) const {
+        if (filter.kind == Filter::Kind::TEST) return filter.test(value);
+        if (filter.numeric) {
+            double x;
+            return toDouble(value, x) && matchesNumber(x);
+        }
+        if (filter.kind == Filter::Kind::IN)
+            return std::find(filter.values.begin(), filter.values.end(), value) != filter.values.end();
+        return (filter.low.empty() || value >= filter.low) && (filter.high.empty() || value < filter.high);
+    }
+};
+
+// Smallest x with double(x) / 10^scale >= bound, i.e. the same comparison
+// matchesNumber makes on a decoded value
+int64_t thresholdScaled(double bound, uint32_t scale) {
+    double p10 = static_cast<double>(POW10[scale]);
+    long double t = std::ceil(static_cast<long double>(bound) * p10);
+    int64_t x = t < -THRESHOLD_LIMIT ? -THRESHOLD_LIMIT : t > THRESHOLD_LIMIT ? THRESHOLD_LIMIT : static_cast<int64_t>(t);
+    while (x > -THRESHOLD_LIMIT && static_cast<double>(x - 1) / p10 >= bound) x--;
+    while (x < THRESHOLD_LIMIT && static_cast<double>(x) / p10 < bound) x++;
+    return x;
+}
+
+// Calls keep(r) for the candidate rows and keeps those it accepts
+template <typename Keep>
+void narrow(bool all, uint64_t rows, std::vector<uint32_t>& selection, Keep&& keep) {
+    std::vector<uint32_t> kept;
+    if (all) {
+        for (uint32_t r = 0; r < rows; r++)
+            if (keep(r)) kept.push_back(r);
+    } else {
+        for (uint32_t r : selection)
+            if (keep(r)) kept.push_back(r);
+    }
+    selection.swap(kept);
+}
+
+void appendValue(const ChunkView& view, uint64_t row, std::string& scratch, std::vector<std::string>& values) {
+    switch (view.encoding) {
+    case Encoding::PLAIN:
+        values.emplace_back(view.entry(row));
+        break;
+    case Encoding::DICT:
+        values.emplace_back(view.entry(view.code(row)));
+        break;
+    default:
+        formatDecimal(view.intValue(row), view.scale, scratch);
+        values.push_back(scratch);
+        break;
+    }
+}
+
+bool decodeAll(const ChunkView& view, uint64_t rows, std::vector<std::string>& values) {
+    std::string scratch;
+    if (view.encoding == Encoding::DICT) {
+        for (uint64_t r = 0; r < rows; r++)
+            if (view.code(r) >= view.entries) return false;
+    }
+    if (view.encoding == Encoding::RLE) {
+        uint32_t begin = 0;
+        for (uint32_t run = 0; run < view.runs; run++) {
+            formatDecimal(view.intValue(run), view.scale, scratch);
+            for (uint32_t r = begin; r < view.runEnd(run); r++) values.push_back(scratch);
+            begin = view.runEnd(run);
+        }
+        return true;
+    }
+    for (uint64_t r = 0; r < rows; r++) appendValue(view, r, scratch, values);
+    return true;
+}
+}
+
+bool Filter::matches(std::string_view value) const {
+    return PreparedFilter(*this).matches(value);
+}
+
+bool encodeChunk(const std::vector<std::string>& values, size_t column, size_t stride, size_t rows,
+                 std::vector<char>& out) {
+    auto value = [&](size_t r) -> const std::string& { return values[r * stride + column]; };
+    out.clear();
+
+    uint64_t data_bytes = 0;
+    for (size_t r = 0; r < rows; r++) data_bytes += value(r).size();
+    uint64_t plain_bytes = sizeof(uint32_t) * (rows + 2) + data_bytes;
+    const uint64_t unusable = std::numeric_limits<uint64_t>::max();
+    if (data_bytes > UINT32_MAX) plain_bytes = unusable;
+
+    // Integers and fixed-scale decimals that format back to the same string
+    std::vector<int64_t> ints;
+    bool numeric = rows > 0;
+    uint32_t scale = 0;
+    std::string formatted;
+    for (size_t r = 0; r < rows && numeric; r++) {
+        int64_t v;
+        uint32_t s;
+        numeric = parseDecimal(value(r), v, s) && (r == 0 || s == scale);
+        if (!numeric) break;
+        scale = s;
+        formatDecimal(v, s, formatted);
+        numeric = formatted == value(r);
+        ints.push_back(v);
+    }
+    uint64_t int_bytes = unusable, rle_bytes = unusable;
+    int64_t base = 0;
+    uint32_t int_width = 0;
+    size_t runs = 0;
+    if (numeric) {
+        auto [min_it, max_it] = std::minmax_element(ints.begin(), ints.end());
+        base = *min_it;
+        int_width = bitWidth(static_cast<uint64_t>(*max_it) - static_cast<uint64_t>(base));
+        for (size_t r = 0; r < rows; r++) runs += (r == 0 || ints[r] != ints[r - 1]);
+        int_bytes = 3 * sizeof(uint32_t) + sizeof(int64_t) + packedBytes(rows, int_width);
+        rle_bytes = 4 * sizeof(uint32_t) + sizeof(int64_t) + runs * sizeof(uint32_t) + packedBytes(runs, int_width);
+    }
+
+    // Sorted dictionary, so code order is string order
+    std::vector<std::string_view> entries;
+    entries.reserve(rows);
+    for (size_t r = 0; r < rows; r++) entries.emplace_back(value(r));
+    std::sort(entries.begin(), entries.end());
+    entries.erase(std::unique(entries.begin(), entries.end()), entries.end());
+    uint64_t entry_bytes = 0;
+    for (const auto& e : entries) entry_bytes += e.size();
+    uint32_t code_width = bitWidth(entries.empty() ? 0 : entries.size() - 1);
+    uint64_t dict_bytes = sizeof(uint32_t) * (entries.size() + 4) + entry_bytes + packedBytes(rows, code_width);
+    if (entry_bytes > UINT32_MAX) dict_bytes = unusable;
+
+    uint64_t best = std::min({int_bytes, rle_bytes, dict_bytes, plain_bytes});
+    if (best == unusable) return false;
+
+    if (best == int_bytes || best == rle_bytes) {
+        bool rle = best != int_bytes;
+        append<uint32_t>(out, static_cast<uint32_t>(rle ? Encoding::RLE : Encoding::INT));
+        append<uint32_t>(out, scale);
+        append<uint32_t>(out, int_width);
+        append<int64_t>(out, base);
+        std::vector<uint64_t> packed;
+        if (rle) {
+            append<uint32_t>(out, static_cast<uint32_t>(runs));
+            for (size_t r = 0; r < rows; r++) {
+                if (r + 1 == rows || ints[r + 1] != ints[r]) append<uint32_t>(out, static_cast<uint32_t>(r + 1));
+                if (r == 0 || ints[r] != ints[r - 1]) packed.push_back(static_cast<uint64_t>(ints[r]) - static_cast<uint64_t>(base));
+            }
+        } else {
+            for (int64_t v : ints) packed.push_back(static_cast<uint64_t>(v) - static_cast<uint64_t>(base));
+        }
+        appendPacked(out, packed, int_width);
+    } else if (best == dict_bytes) {
+        append<uint32_t>(out, static_cast<uint32_t>(Encoding::DICT));
+        append<uint32_t>(out, static_cast<uint32_t>(entries.size()));
+        uint32_t offset = 0;
+        append<uint32_t>(out, offset);
+        for (const auto& e : entries) {
+            offset += static_cast<uint32_t>(e.size());
+            append<uint32_t>(out, offset);
+        }
+        for (const auto& e : entries) out.insert(out.end(), e.begin(), e.end());
+        append<uint32_t>(out, code_width);
+        std::vector<uint64_t> codes(rows);
+        for (size_t r = 0; r < rows; r++)
+            codes[r] = std::lower_bound(entries.begin(), entries.end(), std::string_view(value(r))) - entries.begin();
+        appendPacked(out, codes, code_width);
+    } else {
+        append<uint32_t>(out, static_cast<uint32_t>(Encoding::PLAIN));
+        uint32_t offset = 0;
+        append<uint32_t>(out, offset);
+        for (size_t r = 0; r < rows; r++) {
+            offset += static_cast<uint32_t>(value(r).size());
+            append<uint32_t>(out, offset);
+        }
+        for (size_t r = 0; r < rows; r++) out.insert(out.end(), value(r).begin(), value(r).end());
+    }
+    return true;
+}
+
+Encoding chunkEncoding(const char* chunk, uint64_t bytes) {
+    if (bytes < sizeof(uint32_t)) return Encoding::PLAIN;
+    uint32_t tag = load<uint32_t>(chunk);
+    return tag <= static_cast<uint32_t>(Encoding::RLE) ? static_cast<Encoding>(tag) : Encoding::PLAIN;
+}
+
+bool decodePlain(const char* chunk, uint64_t bytes, uint64_t rows, std::vector<std::string>& values) {
+    ChunkView view;
+    return parseChunk(chunk, bytes, rows, false, view) && decodeAll(view, rows, values);
+}
+
+bool decodeChunk(const char* chunk, uint64_t bytes, uint64_t rows, std::vector<std::string>& values) {
+    ChunkView view;
+    return parseChunk(chunk, bytes, rows, true, view) && decodeAll(view, rows, values);
+}
+
+bool decodeRows(const char* chunk, uint64_t bytes, uint64_t rows, const std::vector<uint32_t>& selection,
+                std::vector<std::string>& values) {
+    ChunkView view;
+    if (!parseChunk(chunk, bytes, rows, true, view)) return false;
+    std::string scratch;
+    uint32_t run = 0;
+    uint32_t formatted_run = UINT32_MAX;
+    for (uint32_t r : selection) {
+        if (r >= rows) return false;
+        if (view.encoding == Encoding::DICT && view.code(r) >= view.entries) return false;
+        if (view.encoding == Encoding::RLE) {
+            // One format per run, however many of its rows survive
+            while (r >= view.runEnd(run)) run++;
+            if (run != formatted_run) {
+                formatDecimal(view.intValue(run), view.scale, scratch);
+                formatted_run = run;
+            }
+            values.push_back(scratch);
+        } else {
+            appendValue(view, r, scratch, values);
+        }
+    }
+    return true;
+}
+
+bool filterChunk(const char* chunk, uint64_t bytes, uint64_t rows, const Filter& filter, bool all,
+                 std::vector<uint32_t>& selection) {
+    ChunkView view;
+    if (!parseChunk(chunk, bytes, rows, true, view)) return false;
+    PreparedFilter prepared(filter);
+
+    switch (view.encoding) {
+    case Encoding::PLAIN:
+        narrow(all, rows, selection, [&](uint32_t r) { return prepared.matches(view.entry(r)); });
+        break;
+    case Encoding::DICT: {
+        // Code-set membership: the predicate runs once per dictionary entry
+        std::vector<uint8_t> accepted(view.entries);
+        for (uint32_t e = 0; e < view.entries; e++) accepted[e] = prepared.matches(view.entry(e));
+        narrow(all, rows, selection, [&](uint32_t r) {
+            uint64_t code = view.code(r);
+            return code < view.entries && accepted[code];
+        });
+        break;
+    }
+    case Encoding::INT: {
+        double p10 = static_cast<double>(POW10[view.scale]);
+        if (filter.numeric && filter.kind == Filter::Kind::RANGE) {
+            // Range compare on the packed integers: low <= base + p < high
+            int64_t low = filter.low.empty() ? -THRESHOLD_LIMIT : thresholdScaled(prepared.low, view.scale);
+            int64_t high = filter.high.empty() ? THRESHOLD_LIMIT : thresholdScaled(prepared.high, view.scale);
+            int64_t low_p = low - view.base, high_p = high - view.base;
+            if (high_p <= 0 || high_p <= low_p) {
+                selection.clear();
+                break;
+            }
+            uint64_t lo = low_p < 0 ? 0 : static_cast<uint64_t>(low_p);
+            uint64_t hi = static_cast<uint64_t>(high_p);
+            narrow(all, rows, selection, [&](uint32_t r) {
+                uint64_t p = unpack(view.packed, view.width, r);
+                return p >= lo && p < hi;
+            });
+        } else if (!filter.numeric && filter.kind == Filter::Kind::IN) {
+            // Only values in the column's exact decimal form can be equal
+            std::vector<uint64_t> wanted;
+            std::string formatted;
+            for (const auto& v : filter.values) {
+                int64_t x;
+                uint32_t s;
+                if (!parseDecimal(v, x, s) || s != view.scale || x < view.base) continue;
+                formatDecimal(x, s, formatted);
+                if (formatted == v) wanted.push_back(static_cast<uint64_t>(x - view.base));
+            }
+            std::sort(wanted.begin(), wanted.end());
+            narrow(all, rows, selection, [&](uint32_t r) {
+                return std::binary_search(wanted.begin(), wanted.end(), unpack(view.packed, view.width, r));
+            });
+        } else if (filter.numeric) {
+            narrow(all, rows, selection, [&](uint32_t r) {
+                return prepared.matchesNumber(static_cast<double>(view.intValue(r)) / p10);
+            });
+        } else {
+            std::string formatted;
+            narrow(all, rows, selection, [&](uint32_t r) {
+                formatDecimal(view.intValue(r), view.scale, formatted);
+                return prepared.matches(formatted);
+            });
+        }
+        break;
+    }
+    case Encoding::RLE: {
+        // The predicate runs once per run
+        double p10 = static_cast<double>(POW10[view.scale]);
+        std::vector<uint8_t> accepted(view.runs);
+        std::string formatted;
+        for (uint32_t run = 0; run < view.runs; run++) {
+            if (filter.numeric) {
+                accepted[run] = prepared.matchesNumber(static_cast<double>(view.intValue(run)) / p10);
+            } else {
+                formatDecimal(view.intValue(run), view.scale, formatted);
+                accepted[run] = prepared.matches(formatted);
+            }
+        }
+        std::vector<uint32_t> kept;
+        if (all) {
+            uint32_t begin = 0;
+            for (uint32_t run = 0; run < view.runs; run++) {
+                uint32_t end = view.runEnd(run);
+                if (accepted[run])
+                    for (uint32_t r = begin; r < end; r++) kept.push_back(r);
+                begin = end;
+            }
+        } else {
+            uint32_t run = 0;
+            for (uint32_t r : selection) {
+                if (r >= rows) return false;
+                while (r >= view.runEnd(run)) run++;
+                if (accepted[run]) kept.push_back(r);
+            }
+        }
+        selection.swap(kept);
+        break;
+    }
+    }
+    return true;
+}
+
+bool sumChunk(const char* chunk, uint64_t bytes, uint64_t rows, const std::vector<uint32_t>* selection,
+              double& sum) {
+    ChunkView view;
+    if (!parseChunk(chunk, bytes, rows, true, view)) return false;
+    if (selection) {
+        for (uint32_t r : *selection)
+            if (r >= rows) return false;
+    }
+    auto forEach = [&](auto&& fn) {
+        if (selection) {
+            for (uint32_t r : *selection) fn(r);
+        } else {
+            for (uint32_t r = 0; r < rows; r++) fn(r);
+        }
+    };
+
+    switch (view.encoding) {
+    case Encoding::PLAIN: {
+        double total = 0;
+        forEach([&](uint32_t r) {
+            double x;
+            if (toDouble(view.entry(r), x)) total += x;
+        });
+        sum += total;
+        return true;
+    }
+    case Encoding::DICT: {
+        // Count codes, then multiply each entry's value by its count
+        std::vector<uint64_t> counts(view.entries);
+        bool valid = true;
+        forEach([&](uint32_t r) {
+            uint64_t code = view.code(r);
+            if (code < view.entries) counts[code]++;
+            else valid = false;
+        });
+        if (!valid) return false;
+        double total = 0;
+        for (uint32_t e = 0; e < view.entries; e++) {
+            double x;
+            if (counts[e] > 0 && toDouble(view.entry(e), x)) total += x * counts[e];
+        }
+        sum += total;
+        return true;
+    }
+    case Encoding::INT: {
+        // Packed offsets are summed as integers; the base is added once per row count
+        long double total = 0;
+        uint64_t block = 0, in_block = 0, count = 0;
+        bool narrow_values = view.width <= 48;
+        forEach([&](uint32_t r) {
+            uint64_t p = unpack(view.packed, view.width, r);
+            count++;
+            if (!narrow_values) {
+                total += static_cast<long double>(p);
+                return;
+            }
+            block += p;
+            if (++in_block == BLOCK_VALUES) {
+                total += static_cast<long double>(block);
+                block = 0;
+                in_block = 0;
+            }
+        });
+        total += static_cast<long double>(block);
+        total += static_cast<long double>(view.base) * count;
+        sum += static_cast<double>(total / POW10[view.scale]);
+        return true;
+    }
+    case Encoding::RLE: {
+        // Each run contributes value * (selected rows in the run)
+        long double total = 0;
+        if (!selection) {
+            uint32_t begin = 0;
+            for (uint32_t run = 0; run < view.runs; run++) {
+                uint32_t end = view.runEnd(run);
+                total += static_cast<long double>(view.intValue(run)) * (end - begin);
+                begin = end;
+            }
+        } else {
+            uint32_t run = 0;
+            uint64_t in_run = 0;
+            for (uint32_t r : *selection) {
+                if (r >= view.runEnd(run)) {
+                    total += static_cast<long double>(view.intValue(run)) * in_run;
+                    in_run = 0;
+                    while (r >= view.runEnd(run)) run++;
+                }
+                in_run++;
+            }
+            if (in_run > 0) total += static_cast<long double>(view.intValue(run)) * in_run;
+        }
+        sum += static_cast<double>(total / POW10[view.scale]);
+        return true;
+    }
+    }
+    return false;
+}
+
+}
@@ -0,0 +1,188 @@
+#include "../include/json.hpp"
+#include <cstdlib>
+
+namespace {
+
+class Parser {
+public:
+    explicit Parser(const std::string& text) : text_(text) {}
+
+    bool parseDocument(JsonValue& value) {
+        if (!parseValue(value, 0)) return false;
+        skipSpace();
+        return pos_ == text_.size();
+    }
+
+private:
+    // Guards against stack exhaustion on hostile input
+    static constexpr int MAX_DEPTH = 256;
+
+    void skipSpace() {
+        while (pos_ < text_.size() &&
+               (text_[pos_] == ' ' || text_[pos_] == '\n' || text_[pos_] == '\r' || text_[pos_] == '\t'))
+            pos_++;
+    }
+
+    bool consume(char c) {
+        skipSpace();
+        if (pos_ < text_.size() && text_[pos_] == c) {
+            pos_++;
+            return true;
+        }
+        return false;
+    }
+
+    bool literal(const char* word) {
+        size_t length = std::char_traits<char>::length(word);
+        if (text_.compare(pos_, length, word) != 0) return false;
+        pos_ += length;
+        return true;
+    }
+
+    static void appendUtf8(std::string& out, unsigned code) {
+        if (code < 0x80) {
+            out += static_cast<char>(code);
+        } else if (code < 0x800) {
+            out += static_cast<char>(0xC0 | (code >> 6));
+            out += static_cast<char>(0x80 | (code & 0x3F));
+        } else if (code < 0x10000) {
+            out += static_cast<char>(0xE0 | (code >> 12));
+            out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (code & 0x3F));
+        } else {
+            out += static_cast<char>(0xF0 | (code >> 18));
+            out += static_cast<char>(0x80 | ((code >> 12) & 0x3F));
+            out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (code & 0x3F));
+        }
+    }
+
+    bool parseHex4(unsigned& code) {
+        if (pos_ + 4 > text_.size()) return false;
+        code = 0;
+        for (int i = 0; i < 4; i++) {
+            char c = text_[pos_++];
+            code <<= 4;
+            if (c >= '0' && c <= '9') code |= c - '0';
+            else if (c >= 'a' && c <= 'f') code |= c - 'a' + 10;
+            else if (c >= 'A' && c <= 'F') code |= c - 'A' + 10;
+            else return false;
+        }
+        return true;
+    }
+
+    bool parseString(std::string& out) {
+        if (!consume('"')) return false;
+        out.clear();
+        while (pos_ < text_.size()) {
+            char c = text_[pos_++];
+            if (c == '"') return true;
+            if (static_cast<unsigned char>(c) < 0x20) return false;
+            if (c != '\\') {
+                out += c;
+                continue;
+            }
+            if (pos_ >= text_.size()) return false;
+            switch (text_[pos_++]) {
+                case '"':  out += '"'; break;
+                case '\\': out += '\\'; break;
+                case '/':  out += '/'; break;
+                case 'b':  out += '\b'; break;
+                case 'f':  out += '\f'; break;
+                case 'n':  out += '\n'; break;
+                case 'r':  out += '\r'; break;
+                case 't':  out += '\t'; break;
+                case 'u': {
+                    unsigned code;
+                    if (!parseHex4(code)) return false;
+                    // Surrogate pair
+                    if (code >= 0xD800 && code < 0xDC00 && text_.compare(pos_, 2, "\\u") == 0) {
+                        pos_ += 2;
+                        unsigned low;
+                        if (!parseHex4(low) || low < 0xDC00 || low >= 0xE000) return false;
+                        code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                    }
+                    appendUtf8(out, code);
+                    break;
+                }
+                default: return false;
+            }
+        }
+        return false;
+    }
+
+    bool parseNumber(double& number) {
+        // strtod also takes inf, nan and hex, which JSON does not
+        char first = text_[pos_];
+        if (first != '-' && (first < '0' || first > '9')) return false;
+        const char* begin = text_.c_str() + pos_;
+        char* end = nullptr;
+        number = std::strtod(begin, &end);
+        if (end == begin) return false;
+        pos_ += end - begin;
+        return true;
+    }
+
+    bool parseValue(JsonValue& value, int depth) {
+        if (depth > MAX_DEPTH) return false;
+        skipSpace();
+        if (pos_ >= text_.size()) return false;
+        value = JsonValue();
+        char c = text_[pos_];
+        if (c == '{') {
+            pos_++;
+            value.type = JsonValue::OBJECT;
+            if (consume('}')) return true;
+            do {
+                std::string key;
+                JsonValue member;
+                if (!parseString(key) || !consume(':') || !parseValue(member, depth + 1)) return false;
+                value.object.emplace_back(std::move(key), std::move(member));
+            } while (consume(','));
+            return consume('}');
+        }
+        if (c == '[') {
+            pos_++;
+            value.type = JsonValue::ARRAY;
+            if (consume(']')) return true;
+            do {
+                JsonValue element;
+                if (!parseValue(element, depth + 1)) return false;
+                value.array.push_back(std::move(element));
+            } while (consume(','));
+            return consume(']');
+        }
+        if (c == '"') {
+            value.type = JsonValue::STRING;
+            return parseString(value.string);
+        }
+        if (literal("true")) {
+            value.type = JsonValue::BOOLEAN;
+            value.boolean = true;
+            return true;
+        }
+        if (literal("false")) {
+            value.type = JsonValue::BOOLEAN;
+            return true;
+        }
+        if (literal("null")) return true;
+        value.type = JsonValue::NUMBER;
+        return parseNumber(value.number);
+    }
+
+    const std::string& text_;
+    size_t pos_ = 0;
+};
+
+}
+
+const JsonValue* JsonValue::find(const std::string& key) const {
+    if (type != OBJECT) return nullptr;
+    for (const auto& [name, member] : object)
+        if (name == key) return &member;
+    return nullptr;
+}
+
+bool parseJson(const std::string& text, JsonValue& value) {
+    return Parser(text).parseDocument(value);
+}
@@ -1,4 +1,14 @@
 #include "../include/query5.hpp"
+#include "../include/profile.hpp"
+#include "../include/trace.hpp"
+#include "../include/report.hpp"
+#include "../include/progress.hpp"
+#include "../include/arena.hpp"
+#include "../include/buffer.hpp"
+#include "../include/cluster.hpp"
+#include "../include/shareddata.hpp"
+#include "../include/projection.hpp"
+#include <memory>
 #include <iostream>
 #include <string>
 #include <vector>
@@ -13,17 +23,187 @@
 // TODO: Include additional headers as needed
 
 int main(int argc, char* argv[]) {
+    auto run_start = std::chrono::high_resolution_clock::now();
+    Tracing::setThreadName("main");
     std::string r_name, start_date, end_date, table_path, result_path;
     int num_threads;
+    std::unordered_map<std::string, std::string> extra_options;
 
-    if (!parseArgs(argc, argv, r_name, start_date, end_date, num_threads, table_path, result_path)) {
+    if (!parseArgs(argc, argv, r_name, start_date, end_date, num_threads, table_path, result_path, extra_options)) {
         std::cerr << "Failed to parse command line arguments." << std::endl;
         return 1;
     }
 
+    // Optional: --trace off disables event tracing
+    if (extra_options.count("trace") && extra_options["trace"] == "off") {
+        Tracing::setEnabled(false);
+    }
+
+    // Optional: --hw_counters off skips perf_event_open in profiling builds
+    if (extra_options.count("hw_counters") && extra_options["hw_counters"] == "off") {
+        PerfCounters::setEnabled(false);
+    }
+
+    // Optional: --arena off allocates intermediate data on the heap, --arena_mb caps the query arena
+    if (extra_options.count("arena") && extra_options["arena"] == "off") {
+        Arena::setEnabled(false);
+    }
+    if (extra_options.count("arena_mb")) {
+        try { Arena::setLimit(static_cast<size_t>(std::stoull(extra_options["arena_mb"])) << 20); }
+        catch (...) {
+            std::cerr << "Invalid --arena_mb: " << extra_options["arena_mb"] << std::endl;
+            return 1;
+        }
+    }
+
+    // Optional: --progress <seconds> prints progress lines to stderr, --progress_path keeps a JSON status file
+    std::unique_ptr<Progress::Reporter> progress_reporter;
+    if (extra_options.count("progress") || extra_options.count("progress_path")) {
+        double interval_s = 1.0;
+        try {
+            if (extra_options.count("progress")) interval_s = std::stod(extra_options["progress"]);
+        } catch (...) {
+            std::cerr << "Invalid --progress interval: " << extra_options["progress"] << std::endl;
+            return 1;
+        }
+        std::string status_path = extra_options.count("progress_path") ? extra_options["progress_path"] : "";
+        progress_reporter = std::make_unique<Progress::Reporter>(interval_s, extra_options.count("progress") > 0, status_path);
+    }
+
+    // Optional: --shm NAME loads tables from the shared-memory dataset published by
+    // tpch_shm for this table_path; tables it does not hold are read from files
+    if (extra_options.count("shm")) {
+        std::string error;
+        if (!SharedData::attach(extra_options["shm"], error)) {
+            std::cerr << "Failed to attach shared dataset: " << error << std::endl;
+            return 1;
+        }
+    }
+
+    // Optional: --projection auto|base|order_date picks the layout orders and lineitem
+    // are read from; auto (default) uses the date-clustered projection written by
+    // tpch_datagen --project when it is current
+    Projection::Layout layout;
+    std::string projection_error;
+    if (!Projection::choose(table_path, extra_options.count("projection") ? extra_options["projection"] : "auto",
+                            layout, projection_error)) {
+        std::cerr << "Invalid --projection: " << projection_error << std::endl;
+        return 1;
+    }
+    const bool date_clustered = layout == Projection::Layout::ORDER_DATE;
+    if (date_clustered) std::cout << "Reading orders and lineitem from the order date projection." << std::endl;
+
+    // Optional: --buffer_mb N scans orders and lineitem from their .col files through
+    // an N MB buffer pool (or from their .parquet files) during the query instead of
+    // loading them (out-of-core)
+    std::unique_ptr<Buffer::Pool> buffer_pool;
+    StreamedTables streamed;
+    streamed.date_clustered = date_clustered;
+    if (extra_options.count("buffer_mb")) {
+        size_t buffer_mb = 0;
+        try { buffer_mb = static_cast<size_t>(std::stoull(extra_options["buffer_mb"])); }
+        catch (...) {
+            std::cerr << "Invalid --buffer_mb: " << extra_options["buffer_mb"] << std::endl;
+            return 1;
+        }
+        buffer_pool = std::make_unique<Buffer::Pool>(buffer_mb << 20);
+        streamed = streamedTables(table_path, *buffer_pool, date_clustered);
+        if (streamed.orders_path.empty() || streamed.lineitem_path.empty()) {
+            std::cerr << "Warning: --buffer_mb streams only tables with a .col or .parquet file, loading the others."
+                      << std::endl;
+        }
+    }
+    streamed.threads = num_threads;
+
+    // Optional: --bitmap_index off skips the bitmap indexes on low-cardinality columns
+    // that are otherwise built at load (or read from <table>.bitmaps) and used by
+    // the query's IN predicates
+    if (!extra_options.count("bitmap_index") || extra_options["bitmap_index"] != "off") {
+        streamed.bitmaps = std::make_shared<SQLEngine::BitmapIndexes>();
+    }
+
+    // Optional: --statistics auto|collect|off. auto (default) reads the column
+    // statistics saved in <table>.stats.json when current and prints Q5's
+    // cardinality estimates from them; collect also collects missing or stale
+    // ones at load and saves them
+    std::string statistics_mode = extra_options.count("statistics") ? extra_options["statistics"] : "auto";
+    if (statistics_mode != "auto" && statistics_mode != "collect" && statistics_mode != "off") {
+        std::cerr << "Invalid --statistics: " << statistics_mode << " (expected auto, collect or off)" << std::endl;
+        return 1;
+    }
+    if (statistics_mode != "off") {
+        streamed.statistics = std::make_shared<Statistics::Catalog>();
+        streamed.statistics->collect = statistics_mode == "collect";
+        streamed.statistics->threads = num_threads;
+    }
+
+    // A table_path written by tpch_partition is recognised by its manifest: orders and
+    // lineitem are loaded per partition, orders only in the date ranges the query
+    // touches, and joined partition-wise
+    streamed.partitioned = Partitioning::openPartitioned(table_path, start_date, end_date);
+
+    // Optional: --workers N runs the query shared-nothing on N worker processes that
+    // each own a hash partition of orders and lineitem; this process only merges
+    // their partial results. --port picks the coordinator port, --spawn off waits
+    // for workers started by hand with --workers N --worker i --coordinator host:port.
+    int workers = 0;
+    int worker_index = -1;
+    double worker_timeout_s = 3600;
+    int port = 0;
+    try {
+        if (extra_options.count("workers")) workers = std::stoi(extra_options["workers"]);
+        if (extra_options.count("worker")) worker_index = std::stoi(extra_options["worker"]);
+        if (extra_options.count("worker_timeout")) worker_timeout_s = std::stod(extra_options["worker_timeout"]);
+        if (extra_options.count("port")) port = std::stoi(extra_options["port"]);
+    } catch (...) {
+        std::cerr << "Invalid --workers, --worker, --worker_timeout or --port value." << std::endl;
+        return 1;
+    }
+    if (extra_options.count("workers") && workers < 1) {
+        std::cerr << "--workers must be at least 1." << std::endl;
+        return 1;
+    }
+    if (extra_options.count("worker")) {
+        if (worker_index < 0 || worker_index >= workers || !extra_options.count("coordinator")) {
+            std::cerr << "--worker i needs --workers N with i < N and --coordinator host:port." << std::endl;
+            return 1;
+        }
+        streamed.partition = Cluster::Partition{worker_index, workers};
+    }
+    bool coordinator = workers > 0 && worker_index < 0;
+    std::unique_ptr<Cluster::Coordinator> cluster;
+    if (coordinator) {
+        cluster = std::make_unique<Cluster::Coordinator>();
+        if (!cluster->listen(port)) {
+            std::cerr << "Failed to listen on port " << port << "." << std::endl;
+            return 1;
+        }
+        if (extra_options.count("spawn") && extra_options["spawn"] == "off") {
+            std::cout << "Waiting for " << workers << " workers at " << cluster->address() << std::endl;
+        } else {
+            // Workers get the same query and engine options; output files stay with the coordinator
+            std::vector<std::string> args = {"--r_name", r_name, "--start_date", start_date, "--end_date", end_date,
+                                             "--threads", std::to_string(num_threads), "--table_path", table_path,
+                                             "--result_path", result_path, "--coordinator", cluster->address()};
+            for (const auto& [key, value] : extra_options) {
+                if (key == "port" || key == "spawn" || key == "worker_timeout" || key == "report_path" ||
+                    key == "trace_path" || key == "profile_path" || key == "progress" || key == "progress_path")
+                    continue;
+                args.push_back("--" + key);
+                args.push_back(value);
+            }
+            if (!cluster->spawn(argv[0], args, workers)) {
+                std::cerr << "Failed to start worker processes." << std::endl;
+                return 1;
+            }
+        }
+    }
+
+    auto load_start = std::chrono::high_resolution_clock::now();
     std::vector<std::map<std::string, std::string>> customer_data, orders_data, lineitem_data, supplier_data, nation_data, region_data;
+    std::vector<TableLoadStats> load_stats;
 
-    if (!readTPCHData(table_path, customer_data, orders_data, lineitem_data, supplier_data, nation_data, region_data)) {
+    if (!coordinator && !readTPCHData(table_path, customer_data, orders_data, lineitem_data, supplier_data, nation_data, region_data, load_stats, streamed)) {
         std::cerr << "Failed to read TPCH data." << std::endl;
         return 1;
     }
@@ -31,20 +211,86 @@ int main(int argc, char* argv[]) {
     auto read_start = std::chrono::high_resolution_clock::now();
     std::map<std::string, double> results;
     
-    if (!executeQuery5(r_name, start_date, end_date, num_threads, customer_data, orders_data, lineitem_data, supplier_data, nation_data, region_data, results)) {
+    if (coordinator) {
+        if (!cluster->gather(workers, worker_timeout_s, results)) {
+            std::cerr << "Failed to gather partial results from the workers." << std::endl;
+            return 1;
+        }
+    } else if (!executeQuery5(r_name, start_date, end_date, num_threads, customer_data, orders_data, lineitem_data, supplier_data, nation_data, region_data, results, streamed)) {
         std::cerr << "Failed to execute TPCH Query 5." << std::endl;
         return 1;
     }
+    auto execute_end = std::chrono::high_resolution_clock::now();
 
-    if (!outputResults(result_path, results)) {
+    // A worker's results are partial, they go to the coordinator instead of result_path
+    if (worker_index >= 0) {
+        if (!Cluster::sendPartial(extra_options["coordinator"], worker_index, results)) {
+            std::cerr << "Failed to send partial results to " << extra_options["coordinator"] << std::endl;
+            return 1;
+        }
+    } else if (!outputResults(result_path, results)) {
         std::cerr << "Failed to output results." << std::endl;
         return 1;
     }
     auto read_end = std::chrono::high_resolution_clock::now();
     auto read_duration = std::chrono::duration_cast<std::chrono::milliseconds>(read_end - read_start);
+    auto load_duration = std::chrono::duration_cast<std::chrono::milliseconds>(read_start - load_start);
+
+    // Run report next to the results file; --report_path overrides the location, --report off skips it
+    if (!(extra_options.count("report") && extra_options["report"] == "off")) {
+        using ms = std::chrono::duration<double, std::milli>;
+        Report::RunReport report;
+        report.r_name = r_name;
+        report.start_date = start_date;
+        report.end_date = end_date;
+        report.num_threads = num_threads;
+        report.table_path = table_path;
+        report.result_path = result_path;
+        report.engine_options.insert(extra_options.begin(), extra_options.end());
+        report.phases.parse_args_ms = ms(load_start - run_start).count();
+        report.phases.load_ms = ms(read_start - load_start).count();
+        report.phases.execute_ms = ms(execute_end - read_start).count();
+        report.phases.output_ms = ms(read_end - execute_end).count();
+        report.phases.total_ms = ms(read_end - run_start).count();
+        report.tables = load_stats;
+        report.pipelines = Profiling::currentQuery().pipelines;
+        report.result_rows = results.size();
+        report.peak_rss_kb = Report::peakRssKb();
+        report.arena = Arena::lastQueryStats();
+        if (buffer_pool) report.buffer = buffer_pool->stats();
+
+        std::string report_name = worker_index >= 0 ? ".worker" + std::to_string(worker_index) + ".report.json" : ".report.json";
+        std::string report_path = extra_options.count("report_path") ? extra_options["report_path"] : result_path + report_name;
+        std::ofstream report_file(report_path);
+        if (!report_file.is_open()) {
+            std::cerr << "Failed to open report file: " << report_path << std::endl;
+            return 1;
+        }
+        report.writeJSON(report_file);
+    }
     
+    // Optional: --profile_path writes the per-operator profile as JSON
+    if (extra_options.count("profile_path")) {
+        if (!Profiling::enabled()) {
+            std::cerr << "Warning: built without TPCH_PROFILING, the profile is empty." << std::endl;
+        }
+        std::ofstream profile_file(extra_options["profile_path"]);
+        if (!profile_file.is_open()) {
+            std::cerr << "Failed to open profile file: " << extra_options["profile_path"] << std::endl;
+            return 1;
+        }
+        Profiling::currentQuery().writeJSON(profile_file);
+    }
+
+    // Optional: --trace_path writes the thread timelines as Chrome trace JSON
+    if (extra_options.count("trace_path") && !Tracing::writeChromeTrace(extra_options["trace_path"])) {
+        std::cerr << "Failed to write trace file: " << extra_options["trace_path"] << std::endl;
+        return 1;
+    }
+
 
     std::cout << "TPCH Query 5 implementation completed." << std::endl;
+    std::cout << "Duration to load : " << load_duration.count() << std::endl;
     std::cout << "Duration to execute : " << read_duration.count() << std::endl;
     return 0;
 } 
\ No newline at end of file
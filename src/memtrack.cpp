@@ -0,0 +1,167 @@
+#include "../include/memtrack.hpp"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace MemTrack {
+
+namespace {
+// Slot 0 collects untagged allocations and is never reported
+constexpr uint32_t NUM_TAGS = 1024;
+
+struct alignas(64) Slot {
+    std::atomic<uint32_t> generation{0};
+    std::atomic<uint64_t> allocated_bytes{0};
+    std::atomic<uint64_t> allocations{0};
+    std::atomic<uint64_t> frees{0};
+    std::atomic<int64_t> live_bytes{0};
+    std::atomic<int64_t> peak_bytes{0};
+};
+
+// Constant initialized, so allocations during static initialization are safe
+Slot slots[NUM_TAGS];
+Slot process_slot;
+std::atomic<uint32_t> next_tag{0};
+thread_local uint32_t current_tag = 0;
+
+Counts snapshot(const Slot& slot) {
+    Counts counts;
+    counts.allocated_bytes = slot.allocated_bytes.load(std::memory_order_relaxed);
+    counts.allocations = slot.allocations.load(std::memory_order_relaxed);
+    counts.frees = slot.frees.load(std::memory_order_relaxed);
+    counts.live_bytes = slot.live_bytes.load(std::memory_order_relaxed);
+    counts.peak_bytes = slot.peak_bytes.load(std::memory_order_relaxed);
+    return counts;
+}
+}
+
+uint32_t openTag() {
+    if (!enabled()) return 0;
+    uint32_t tag = 1 + next_tag.fetch_add(1, std::memory_order_relaxed) % (NUM_TAGS - 1);
+    Slot& slot = slots[tag];
+    // Blocks still carrying the old generation are no longer charged to this slot
+    slot.generation.fetch_add(1, std::memory_order_relaxed);
+    slot.allocated_bytes.store(0, std::memory_order_relaxed);
+    slot.allocations.store(0, std::memory_order_relaxed);
+    slot.frees.store(0, std::memory_order_relaxed);
+    slot.live_bytes.store(0, std::memory_order_relaxed);
+    slot.peak_bytes.store(0, std::memory_order_relaxed);
+    return tag;
+}
+
+Counts read(uint32_t tag) {
+    return tag == 0 || tag >= NUM_TAGS ? Counts() : snapshot(slots[tag]);
+}
+
+uint32_t setCurrentTag(uint32_t tag) {
+    uint32_t previous = current_tag;
+    current_tag = tag;
+    return previous;
+}
+
+Counts process() {
+    return snapshot(process_slot);
+}
+
+void resetPeak() {
+    process_slot.peak_bytes.store(process_slot.live_bytes.load(std::memory_order_relaxed),
+                                  std::memory_order_relaxed);
+}
+
+void Counts::writeJSON(std::ostream& out, uint64_t rows) const {
+    if (!enabled()) {
+        out << "null";
+        return;
+    }
+    out << "{\"allocated_bytes\": " << allocated_bytes
+        << ", \"allocations\": " << allocations
+        << ", \"frees\": " << frees
+        << ", \"live_bytes\": " << live_bytes
+        << ", \"peak_bytes\": " << peak_bytes
+        << ", \"allocs_per_row\": " << (rows > 0 ? static_cast<double>(allocations) / rows : 0.0) << "}";
+}
+
+#ifdef TPCH_ENABLE_PROFILING
+namespace {
+// Keeps the user block 16 byte aligned, like malloc
+struct Header {
+    uint64_t size;
+    uint32_t tag;
+    uint32_t generation;
+};
+static_assert(sizeof(Header) == 16, "allocation header must preserve malloc alignment");
+
+void raisePeak(std::atomic<int64_t>& peak, int64_t value) {
+    int64_t seen = peak.load(std::memory_order_relaxed);
+    while (value > seen && !peak.compare_exchange_weak(seen, value, std::memory_order_relaxed)) {}
+}
+
+void charge(Slot& slot, uint64_t size) {
+    slot.allocated_bytes.fetch_add(size, std::memory_order_relaxed);
+    slot.allocations.fetch_add(1, std::memory_order_relaxed);
+    raisePeak(slot.peak_bytes, slot.live_bytes.fetch_add(size, std::memory_order_relaxed) + size);
+}
+
+void release(Slot& slot, uint64_t size) {
+    slot.frees.fetch_add(1, std::memory_order_relaxed);
+    slot.live_bytes.fetch_sub(size, std::memory_order_relaxed);
+}
+
+void* trackedAlloc(std::size_t size) noexcept {
+    void* raw = std::malloc(size + sizeof(Header));
+    if (!raw) return nullptr;
+    Header* header = static_cast<Header*>(raw);
+    uint32_t tag = current_tag;
+    header->size = size;
+    header->tag = tag;
+    header->generation = slots[tag].generation.load(std::memory_order_relaxed);
+    charge(process_slot, size);
+    if (tag != 0) charge(slots[tag], size);
+    return header + 1;
+}
+
+void trackedFree(void* ptr) noexcept {
+    if (!ptr) return;
+    Header* header = static_cast<Header*>(ptr) - 1;
+    release(process_slot, header->size);
+    Slot& slot = slots[header->tag % NUM_TAGS];
+    if (header->tag != 0 && slot.generation.load(std::memory_order_relaxed) == header->generation)
+        release(slot, header->size);
+    std::free(header);
+}
+}
+#endif
+
+}
+
+#ifdef TPCH_ENABLE_PROFILING
+void* operator new(std::size_t size) {
+    for (;;) {
+        if (void* ptr = MemTrack::trackedAlloc(size)) return ptr;
+        std::new_handler handler = std::get_new_handler();
+        if (!handler) throw std::bad_alloc();
+        handler();
+    }
+}
+
+void* operator new[](std::size_t size) {
+    return ::operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    try { return ::operator new(size); }
+    catch (...) { return nullptr; }
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+    try { return ::operator new(size); }
+    catch (...) { return nullptr; }
+}
+
+void operator delete(void* ptr) noexcept { MemTrack::trackedFree(ptr); }
+void operator delete[](void* ptr) noexcept { MemTrack::trackedFree(ptr); }
+void operator delete(void* ptr, std::size_t) noexcept { MemTrack::trackedFree(ptr); }
+void operator delete[](void* ptr, std::size_t) noexcept { MemTrack::trackedFree(ptr); }
+void operator delete(void* ptr, const std::nothrow_t&) noexcept { MemTrack::trackedFree(ptr); }
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept { MemTrack::trackedFree(ptr); }
+#endif
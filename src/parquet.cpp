@@ -0,0 +1,947 @@
+#include "../include/parquet.hpp"
+#include "../include/fastparse.hpp"
+#include "../include/progress.hpp"
+#include "../include/trace.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <iterator>
+#include <thread>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace Parquet {
+
+namespace {
+
+const char MAGIC[4] = {'P', 'A', 'R', '1'};
+
+// parquet.thrift enums
+enum Repetition : int32_t { REQUIRED = 0, OPTIONAL = 1, REPEATED = 2 };
+enum ConvertedType : int32_t { CONVERTED_DECIMAL = 5, CONVERTED_DATE = 6 };
+enum PageType : int32_t { DATA_PAGE = 0, INDEX_PAGE = 1, DICTIONARY_PAGE = 2, DATA_PAGE_V2 = 3 };
+enum Encoding : int32_t { PLAIN = 0, PLAIN_DICTIONARY = 2, RLE = 3, RLE_DICTIONARY = 8 };
+
+template <typename T>
+T load(const char* p) {
+    T value;
+    std::memcpy(&value, p, sizeof(T));
+    return value;
+}
+
+// Reader of the Thrift compact protocol. Every read is bounds-checked; after
+// an error the reader stays failed and returns zeros.
+class Thrift {
+public:
+    enum FieldType : uint8_t {
+        STOP = 0, BOOL_TRUE = 1, BOOL_FALSE = 2, BYTE = 3, I16 = 4, I32 = 5, I64 = 6, DOUBLE = 7,
+        BINARY = 8, LIST = 9, SET = 10, MAP = 11, STRUCT = 12
+    };
+
+    Thrift(const char* data, size_t size) : data_(data), size_(size) {}
+
+    bool failed() const { return failed_; }
+    size_t position() const { return position_; }
+
+    void beginStruct() {
+        last_ids_.push_back(last_id_);
+        last_id_ = 0;
+    }
+    // Next field of the current struct; false at its end (or after an error)
+    bool field(int16_t& id, uint8_t& type) {
+        uint8_t header = byte();
+        type = header & 0x0F;
+        if (failed_ || type == STOP) {
+            endStruct();
+            return false;
+        }
+        uint8_t delta = header >> 4;
+        id = delta ? static_cast<int16_t>(last_id_ + delta) : static_cast<int16_t>(zigzag(varint()));
+        last_id_ = id;
+        return !failed_;
+    }
+    int64_t integer() { return zigzag(varint()); }
+    std::string binary() {
+        uint64_t length = varint();
+        if (failed_ || length > size_ - position_) {
+            fail();
+            return std::string();
+        }
+        std::string value(data_ + position_, static_cast<size_t>(length));
+        position_ += static_cast<size_t>(length);
+        return value;
+    }
+    bool list(uint8_t& element_type, size_t& count) {
+        uint8_t header = byte();
+        element_type = header & 0x0F;
+        count = header >> 4;
+        if (count == 15) count = static_cast<size_t>(varint());
+        // Every element takes at least a byte
+        if (count > size_ - position_) fail();
+        return !failed_;
+    }
+    void skip(uint8_t type, int depth = 0) {
+        if (depth > 32) return fail();
+        switch (type) {
+        case BOOL_TRUE:
+        case BOOL_FALSE: return;
+        case BYTE: byte(); return;
+        case I16:
+        case I32:
+        case I64: varint(); return;
+        case DOUBLE: advance(8); return;
+        case BINARY: advance(varint()); return;
+        case LIST:
+        case SET: {
+            uint8_t element_type = 0;
+            size_t count = 0;
+            if (!list(element_type, count)) return;
+            for (size_t i = 0; i < count && !failed_; i++) {
+                if (element_type == BOOL_TRUE || element_type == BOOL_FALSE) byte();
+                else skip(element_type, depth + 1);
+            }
+            return;
+        }
+        case MAP: {
+            uint64_t count = varint();
+            uint8_t types = count ? byte() : 0;
+            for (uint64_t i = 0; i < count && !failed_; i++) {
+                skip(types >> 4, depth + 1);
+                skip(types & 0x0F, depth + 1);
+            }
+            return;
+        }
+        case STRUCT: {
+            beginStruct();
+            int16_t id = 0;
+            uint8_t field_type = 0;
+            while (field(id, field_type)) skip(field_type, depth + 1);
+            return;
+        }
+        default: fail();
+        }
+    }
+
+private:
+    void fail() { failed_ = true; }
+    void endStruct() {
+        if (last_ids_.empty()) return fail();
+        last_id_ = last_ids_.back();
+        last_ids_.pop_back();
+    }
+    uint8_t byte() {
+        if (failed_ || position_ >= size_) {
+            fail();
+            return 0;
+        }
+        return static_cast<uint8_t>(data_[position_++]);
+    }
+    void advance(uint64_t bytes) {
+        if (bytes > size_ - position_) return fail();
+        position_ += static_cast<size_t>(bytes);
+    }
+    uint64_t varint() {
+        uint64_t value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            uint8_t b = byte();
+            value |= uint64_t(b & 0x7F) << shift;
+            if (!(b & 0x80)) return value;
+        }
+        fail();
+        return 0;
+    }
+    static int64_t zigzag(uint64_t value) { return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1); }
+
+    const char* data_;
+    size_t size_;
+    size_t position_ = 0;
+    bool failed_ = false;
+    int16_t last_id_ = 0;
+    std::vector<int16_t> last_ids_;
+};
+
+struct SchemaElement {
+    int32_t type = -1;
+    int32_t type_length = 0;
+    int32_t repetition = REQUIRED;
+    std::string name;
+    int32_t children = 0;
+    int32_t converted = -1;
+    int32_t scale = 0;
+    bool decimal = false, date = false;   // from the logical type
+};
+
+// Both (deprecated) min / max and min_value / max_value of a Statistics struct
+struct Bounds {
+    std::string min, max, min_value, max_value;
+    bool has_min = false, has_max = false, has_min_value = false, has_max_value = false;
+};
+
+struct ColumnMetaData {
+    int32_t type = -1;
+    int32_t codec = 0;
+    int64_t values = 0;
+    int64_t bytes = 0;
+    int64_t data_page_offset = 0;
+    int64_t dictionary_page_offset = 0;
+    std::vector<std::string> path;
+    Bounds bounds;
+};
+
+void parseLogicalType(Thrift& in, SchemaElement& element) {
+    in.beginStruct();
+    int16_t id = 0;
+    uint8_t type = 0;
+    while (in.field(id, type)) {
+        if (id == 6) element.date = true;
+        if (id == 5 && type == Thrift::STRUCT) {
+            element.decimal = true;
+            in.beginStruct();
+            int16_t decimal_id = 0;
+            uint8_t decimal_type = 0;
+            while (in.field(decimal_id, decimal_type)) {
+                if (decimal_id == 1) element.scale = static_cast<int32_t>(in.integer());
+                else in.skip(decimal_type);
+            }
+        } else {
+            in.skip(type);
+        }
+    }
+}
+
+void parseSchemaElement(Thrift& in, SchemaElement& element) {
+    in.beginStruct();
+    int16_t id = 0;
+    uint8_t type = 0;
+    while (in.field(id, type)) {
+        switch (id) {
+        case 1: element.type = static_cast<int32_t>(in.integer()); break;
+        case 2: element.type_length = static_cast<int32_t>(in.integer()); break;
+        case 3: element.repetition = static_cast<int32_t>(in.integer()); break;
+        case 4: element.name = in.binary(); break;
+        case 5: element.children = static_cast<int32_t>(in.integer()); break;
+        case 6: element.converted = static_cast<int32_t>(in.integer()); break;
+        case 7: element.scale = static_cast<int32_t>(in.integer()); break;
+        case 10:
+            if (type == Thrift::STRUCT) parseLogicalType(in, element);
+            else in.skip(type);
+            break;
+        default: in.skip(type);
+        }
+    }
+}
+
+void parseStatistics(Thrift& in, Bounds& bounds) {
+    in.beginStruct();
+    int16_t id = 0;
+    uint8_t type = 0;
+    while (in.field(id, type)) {
+        switch (id) {
+        case 1: bounds.max = in.binary(); bounds.has_max = true; break;
+        case 2: bounds.min = in.binary(); bounds.has_min = true; break;
+        case 5: bounds.max_value = in.binary(); bounds.has_max_value = true; break;
+        case 6: bounds.min_value = in.binary(); bounds.has_min_value = true; break;
+        default: in.skip(type);
+        }
+    }
+}
+
+void parseColumnMetaData(Thrift& in, ColumnMetaData& meta) {
+    in.beginStruct();
+    int16_t id = 0;
+    uint8_t type = 0;
+    while (in.field(id, type)) {
+        switch (id) {
+        case 1: meta.type = static_cast<int32_t>(in.integer()); break;
+        case 3: {
+            uint8_t element_type = 0;
+            size_t count = 0;
+            if (!in.list(element_type, count)) break;
+            for (size_t i = 0; i < count && !in.failed(); i++) meta.path.push_back(in.binary());
+            break;
+        }
+        case 4: meta.codec = static_cast<int32_t>(in.integer()); break;
+        case 5: meta.values = in.integer(); break;
+        case 7: meta.bytes = in.integer(); break;
+        case 9: meta.data_page_offset = in.integer(); break;
+        case 11: meta.dictionary_page_offset = in.integer(); break;
+        case 12:
+            if (type == Thrift::STRUCT) parseStatistics(in, meta.bounds);
+            else in.skip(type);
+            break;
+        default: in.skip(type);
+        }
+    }
+}
+
+// A ColumnChunk; false when its data lives in another file
+bool parseColumnChunk(Thrift& in, ColumnMetaData& meta) {
+    in.beginStruct();
+    int16_t id = 0;
+    uint8_t type = 0;
+    bool local = true;
+    while (in.field(id, type)) {
+        if (id == 3 && type == Thrift::STRUCT) {
+            parseColumnMetaData(in, meta);
+        } else {
+            local = local && id != 1;   // file_path
+            in.skip(type);
+        }
+    }
+    return local;
+}
+
+struct PageHeader {
+    int32_t type = -1;
+    int32_t bytes = 0;            // compressed_page_size
+    int32_t values = 0;
+    int32_t encoding = PLAIN;
+    int32_t level_encoding = RLE;   // v1 definition levels
+    int32_t definition_bytes = 0;  // v2
+    int32_t repetition_bytes = 0;  // v2
+};
+
+void parsePageHeader(Thrift& in, PageHeader& page) {
+    in.beginStruct();
+    int16_t id = 0;
+    uint8_t type = 0;
+    while (in.field(id, type)) {
+        if (id == 1) {
+            page.type = static_cast<int32_t>(in.integer());
+        } else if (id == 3) {
+            page.bytes = static_cast<int32_t>(in.integer());
+        } else if ((id == 5 || id == 7 || id == 8) && type == Thrift::STRUCT) {
+            // DataPageHeader, DictionaryPageHeader, DataPageHeaderV2
+            in.beginStruct();
+            int16_t header_id = 0;
+            uint8_t header_type = 0;
+            while (in.field(header_id, header_type)) {
+                if (header_id == 1) page.values = static_cast<int32_t>(in.integer());
+                else if (header_id == 2 && id != 8) page.encoding = static_cast<int32_t>(in.integer());
+                else if (header_id == 3 && id == 5) page.level_encoding = static_cast<int32_t>(in.integer());
+                else if (header_id == 4 && id == 8) page.encoding = static_cast<int32_t>(in.integer());
+                else if (header_id == 5 && id == 8) page.definition_bytes = static_cast<int32_t>(in.integer());
+                else if (header_id == 6 && id == 8) page.repetition_bytes = static_cast<int32_t>(in.integer());
+                else in.skip(header_type);
+            }
+        } else {
+            in.skip(type);
+        }
+    }
+}
+
+// RLE / bit-packed hybrid runs of `width`-bit values
+class RleDecoder {
+public:
+    RleDecoder(const char* data, size_t size, uint32_t width) : data_(data), size_(size), width_(width) {}
+
+    bool next(uint32_t& value) {
+        if (repeat_ == 0 && packed_ == 0 && !readRun()) return false;
+        if (repeat_ > 0) {
+            repeat_--;
+            value = value_;
+            return true;
+        }
+        // Bit-packed values, least significant bit first
+        if (bit_ + width_ > uint64_t(size_) * 8) return false;
+        value = 0;
+        for (uint32_t i = 0; i < width_; i++, bit_++)
+            value |= uint32_t((static_cast<uint8_t>(data_[bit_ >> 3]) >> (bit_ & 7)) & 1) << i;
+        packed_--;
+        return true;
+    }
+
+private:
+    bool readRun() {
+        uint64_t header = 0;
+        size_t position = static_cast<size_t>((bit_ + 7) / 8);
+        for (int shift = 0;; shift += 7) {
+            if (position >= size_ || shift > 63) return false;
+            uint8_t b = static_cast<uint8_t>(data_[position++]);
+            header |= uint64_t(b & 0x7F) << shift;
+            if (!(b & 0x80)) break;
+        }
+        if (header & 1) {
+            packed_ = (header >> 1) * 8;
+            bit_ = uint64_t(position) * 8;
+            return packed_ > 0;
+        }
+        repeat_ = header >> 1;
+        size_t value_bytes = (width_ + 7) / 8;
+        if (repeat_ == 0 || value_bytes > size_ - position) return false;
+        value_ = 0;
+        for (size_t i = 0; i < value_bytes; i++) value_ |= uint32_t(static_cast<uint8_t>(data_[position + i])) << (8 * i);
+        bit_ = uint64_t(position + value_bytes) * 8;
+        return true;
+    }
+
+    const char* data_;
+    size_t size_;
+    uint32_t width_;
+    uint64_t bit_ = 0;       // next bit-packed value, or where the next run starts
+    uint64_t repeat_ = 0;    // values left in the current RLE run
+    uint64_t packed_ = 0;    // values left in the current bit-packed run
+    uint32_t value_ = 0;
+};
+
+std::string decimalText(int64_t value, int32_t scale) {
+    uint64_t magnitude = value < 0 ? 0 - static_cast<uint64_t>(value) : static_cast<uint64_t>(value);
+    std::string digits = std::to_string(magnitude);
+    if (scale > 0) {
+        if (digits.size() <= static_cast<size_t>(scale)) digits.insert(0, static_cast<size_t>(scale) + 1 - digits.size(), '0');
+        digits.insert(digits.size() - static_cast<size_t>(scale), 1, '.');
+    }
+    return value < 0 ? "-" + digits : digits;
+}
+
+// Big-endian two's complement (DECIMAL in a byte array) as an int64
+bool bigEndianInteger(const char* bytes, size_t size, int64_t& value) {
+    if (size == 0) return false;
+    // Bytes beyond eight must only extend the sign
+    uint8_t sign = static_cast<uint8_t>(bytes[0]) & 0x80 ? 0xFF : 0x00;
+    for (size_t i = 0; i + 8 < size; i++)
+        if (static_cast<uint8_t>(bytes[i]) != sign) return false;
+    uint64_t bits = sign ? ~uint64_t(0) : 0;
+    for (size_t i = size > 8 ? size - 8 : 0; i < size; i++) bits = (bits << 8) | static_cast<uint8_t>(bytes[i]);
+    if (size > 8 && ((bits >> 63) ? 0xFF : 0x00) != sign) return false;
+    value = static_cast<int64_t>(bits);
+    return true;
+}
+
+// Shortest of 15 or 17 significant digits (6 or 9 for a float) that reads
+// back as the same value
+std::string numberText(double value, bool single) {
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%.*g", single ? 6 : 15, value);
+    double back = FastParse::toDouble(buffer);
+    if (single ? static_cast<float>(back) != static_cast<float>(value) : back != value)
+        std::snprintf(buffer, sizeof(buffer), "%.*g", single ? 9 : 17, value);
+    return buffer;
+}
+
+// Text of one PLAIN-encoded value of `size` bytes (a BYTE_ARRAY without its
+// length), as the tables hold it
+bool valueText(const ColumnInfo& column, const char* p, size_t size, std::string& out) {
+    switch (column.type) {
+    case Type::INT32: {
+        int32_t value = load<int32_t>(p);
+        if (column.date) {
+            int32_t year = 0;
+            uint32_t month = 0, day = 0;
+            FastParse::civilFromDays(value, year, month, day);
+            char buffer[32];
+            std::snprintf(buffer, sizeof(buffer), "%04d-%02u-%02u", year, month, day);
+            out = buffer;
+        } else {
+            out = column.scale >= 0 ? decimalText(value, column.scale) : std::to_string(value);
+        }
+        return true;
+    }
+    case Type::INT64: {
+        int64_t value = load<int64_t>(p);
+        out = column.scale >= 0 ? decimalText(value, column.scale) : std::to_string(value);
+        return true;
+    }
+    case Type::FLOAT: out = numberText(load<float>(p), true); return true;
+    case Type::DOUBLE: out = numberText(load<double>(p), false); return true;
+    case Type::BYTE_ARRAY:
+    case Type::FIXED_LEN_BYTE_ARRAY: {
+        if (column.scale < 0) {
+            out.assign(p, size);
+            return true;
+        }
+        int64_t value = 0;
+        if (!bigEndianInteger(p, size, value)) return false;
+        out = decimalText(value, column.scale);
+        return true;
+    }
+    case Type::BOOLEAN: out = (*p & 1) ? "true" : "false"; return true;
+    case Type::INT96: break;
+    }
+    return false;
+}
+
+size_t fixedBytes(const ColumnInfo& column) {
+    switch (column.type) {
+    case Type::INT32:
+    case Type::FLOAT: return 4;
+    case Type::INT64:
+    case Type::DOUBLE: return 8;
+    case Type::FIXED_LEN_BYTE_ARRAY: return static_cast<size_t>(column.type_length);
+    default: return 0;
+    }
+}
+
+// Appends `count` PLAIN-encoded values from [data, data + size) to `out`
+bool decodePlain(const ColumnInfo& column, const char* data, size_t size, size_t count, std::vector<std::string>& out) {
+    std::string text;
+    if (column.type == Type::BOOLEAN) {
+        if (count > uint64_t(size) * 8) return false;
+        for (size_t i = 0; i < count; i++) out.push_back((data[i >> 3] >> (i & 7)) & 1 ? "true" : "false");
+        return true;
+    }
+    size_t position = 0;
+    const size_t width = fixedBytes(column);
+    for (size_t i = 0; i < count; i++) {
+        size_t length = width;
+        if (column.type == Type::BYTE_ARRAY) {
+            if (size - position < 4) return false;
+            length = load<uint32_t>(data + position);
+            position += 4;
+        }
+        if (length > size - position || !valueText(column, data + position, length, text)) return false;
+        out.push_back(std::move(text));
+        position += length;
+    }
+    return true;
+}
+
+// Bit width of the levels of a column whose maximum level is 1
+constexpr uint32_t LEVEL_WIDTH = 1;
+
+// Decodes the `rows` values of one column chunk (nulls as "") into `out`
+bool decodeChunk(const char* file, uint64_t file_bytes, const ColumnInfo& column, const ChunkInfo& chunk,
+                 int64_t rows, std::vector<std::string>& out, std::string& error) {
+    if (chunk.codec != 0) {
+        error = "column " + column.name + " is compressed";
+        return false;
+    }
+    if (chunk.offset < 4 || chunk.bytes < 0 || uint64_t(chunk.offset) + uint64_t(chunk.bytes) > file_bytes) {
+        error = "column " + column.name + " lies outside the file";
+        return false;
+    }
+    out.clear();
+    out.reserve(static_cast<size_t>(rows));
+    std::vector<std::string> dictionary, values;
+    std::vector<uint8_t> defined;
+    const char* position = file + chunk.offset;
+    const char* end = position + chunk.bytes;
+    auto malformed = [&]() {
+        error = "column " + column.name + " has a malformed or unsupported page";
+        return false;
+    };
+    while (out.size() < static_cast<size_t>(rows)) {
+        Thrift in(position, static_cast<size_t>(end - position));
+        PageHeader page;
+        parsePageHeader(in, page);
+        if (in.failed() || page.bytes < 0 || page.values < 0 ||
+            static_cast<size_t>(page.bytes) > static_cast<size_t>(end - position) - in.position()) {
+            return malformed();
+        }
+        const char* data = position + in.position();
+        size_t size = static_cast<size_t>(page.bytes);
+        position = data + size;
+
+        if (page.type == DICTIONARY_PAGE) {
+            dictionary.clear();
+            if ((page.encoding != PLAIN && page.encoding != PLAIN_DICTIONARY) ||
+                !decodePlain(column, data, size, static_cast<size_t>(page.values), dictionary)) {
+                return malformed();
+            }
+            continue;
+        }
+        if (page.type != DATA_PAGE && page.type != DATA_PAGE_V2) continue;   // index pages
+        const size_t count = static_cast<size_t>(page.values);
+        if (count > static_cast<size_t>(rows) - out.size()) return malformed();
+
+        // Definition levels: 1 for a value, 0 for a null
+        defined.assign(count, 1);
+        size_t present = count;
+        if (page.type == DATA_PAGE_V2) {
+            if (page.repetition_bytes != 0 || page.definition_bytes < 0 ||
+                static_cast<size_t>(page.definition_bytes) > size) {
+                return malformed();
+            }
+            size_t level_bytes = static_cast<size_t>(page.definition_bytes);
+            if (column.optional) {
+                RleDecoder levels(data, level_bytes, LEVEL_WIDTH);
+                present = 0;
+                for (size_t i = 0; i < count; i++) {
+                    uint32_t level = 0;
+                    if (!levels.next(level)) return malformed();
+                    defined[i] = static_cast<uint8_t>(level);
+                    present += level;
+                }
+            }
+            data += level_bytes;
+            size -= level_bytes;
+        } else if (column.optional) {
+            if (page.level_encoding != RLE || size < 4 || load<uint32_t>(data) > size - 4) return malformed();
+            size_t level_bytes = load<uint32_t>(data);
+            RleDecoder levels(data + 4, level_bytes, LEVEL_WIDTH);
+            present = 0;
+            for (size_t i = 0; i < count; i++) {
+                uint32_t level = 0;
+                if (!levels.next(level)) return malformed();
+                defined[i] = static_cast<uint8_t>(level);
+                present += level;
+            }
+            data += 4 + level_bytes;
+            size -= 4 + level_bytes;
+        }
+
+        values.clear();
+        if (page.encoding == PLAIN) {
+            if (!decodePlain(column, data, size, present, values)) return malformed();
+        } else if (page.encoding == PLAIN_DICTIONARY || page.encoding == RLE_DICTIONARY) {
+            // Bit width, then the codes
+            if (present > 0 && (size < 1 || static_cast<uint8_t>(data[0]) > 32)) return malformed();
+            RleDecoder codes(data + (size > 0), size - (size > 0), size > 0 ? static_cast<uint8_t>(data[0]) : 0);
+            for (size_t i = 0; i < present; i++) {
+                uint32_t code = 0;
+                if (!codes.next(code) || code >= dictionary.size()) return malformed();
+                values.push_back(dictionary[code]);
+            }
+        } else if (page.encoding == RLE && column.type == Type::BOOLEAN) {
+            if (size < 4 || load<uint32_t>(data) > size - 4) return malformed();
+            RleDecoder bits(data + 4, load<uint32_t>(data), 1);
+            for (size_t i = 0; i < present; i++) {
+                uint32_t bit = 0;
+                if (!bits.next(bit)) return malformed();
+                values.push_back(bit ? "true" : "false");
+            }
+        } else {
+            return malformed();
+        }
+        size_t next = 0;
+        for (size_t i = 0; i < count; i++) out.push_back(defined[i] ? std::move(values[next++]) : std::string());
+    }
+    return true;
+}
+
+// Whether values in [min, max] may pass `filter`
+bool boundsMayMatch(const Columnar::Filter& filter, const std::string& min, const std::string& max) {
+    if (filter.kind == Columnar::Filter::Kind::TEST) return true;
+    if (filter.numeric) {
+        double low = FastParse::toDouble(min), high = FastParse::toDouble(max);
+        if (filter.kind == Columnar::Filter::Kind::IN) {
+            return std::any_of(filter.values.begin(), filter.values.end(), [&](const std::string& v) {
+                double x = FastParse::toDouble(v);
+                return x >= low && x <= high;
+            });
+        }
+        return (filter.low.empty() || high >= FastParse::toDouble(filter.low)) &&
+               (filter.high.empty() || low < FastParse::toDouble(filter.high));
+    }
+    if (filter.kind == Columnar::Filter::Kind::IN) {
+        return std::any_of(filter.values.begin(), filter.values.end(),
+                           [&](const std::string& v) { return v >= min && v <= max; });
+    }
+    return (filter.low.empty() || max >= filter.low) && (filter.high.empty() || min < filter.high);
+}
+
+}
+
+File::~File() {
+    unmap();
+}
+
+void File::unmap() {
+    if (!data_) return;
+#ifdef _WIN32
+    UnmapViewOfFile(data_);
+    CloseHandle(reinterpret_cast<HANDLE>(handle_));
+#else
+    munmap(const_cast<char*>(data_), bytes_);
+#endif
+    data_ = nullptr;
+    bytes_ = 0;
+    handle_ = -1;
+}
+
+bool File::open(const std::string& path, std::string& error) {
+    unmap();
+    info_ = FileInfo();
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL, nullptr);
+    LARGE_INTEGER size = {};
+    if (file == INVALID_HANDLE_VALUE || !GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+        if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+        error = "cannot open " + path;
+        return false;
+    }
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(file);
+    void* base = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+    if (!base) {
+        if (mapping) CloseHandle(mapping);
+        error = "cannot map " + path;
+        return false;
+    }
+    handle_ = reinterpret_cast<intptr_t>(mapping);
+    bytes_ = static_cast<uint64_t>(size.QuadPart);
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    struct stat st;
+    void* base = MAP_FAILED;
+    if (fd >= 0 && fstat(fd, &st) == 0 && st.st_size > 0) {
+        bytes_ = static_cast<uint64_t>(st.st_size);
+        base = mmap(nullptr, bytes_, PROT_READ, MAP_SHARED, fd, 0);
+    }
+    if (fd >= 0) ::close(fd);
+    if (base == MAP_FAILED) {
+        bytes_ = 0;
+        error = "cannot map " + path;
+        return false;
+    }
+#endif
+    data_ = static_cast<const char*>(base);
+
+    auto reject = [&](const std::string& reason) {
+        error = path + ": " + reason;
+        unmap();
+        return false;
+    };
+    if (bytes_ < 12 || std::memcmp(data_, MAGIC, 4) != 0 || std::memcmp(data_ + bytes_ - 4, MAGIC, 4) != 0)
+        return reject("not a Parquet file");
+    uint32_t metadata_bytes = load<uint32_t>(data_ + bytes_ - 8);
+    if (metadata_bytes > bytes_ - 12) return reject("malformed footer");
+
+    // FileMetaData: schema (2), num_rows (3), row_groups (4)
+    Thrift in(data_ + bytes_ - 8 - metadata_bytes, metadata_bytes);
+    std::vector<SchemaElement> schema;
+    std::vector<std::vector<ColumnMetaData>> chunks;
+    std::vector<int64_t> group_rows;
+    bool local = true;
+    in.beginStruct();
+    int16_t id = 0;
+    uint8_t type = 0;
+    while (in.field(id, type)) {
+        uint8_t element_type = 0;
+        size_t count = 0;
+        if (id == 2 && type == Thrift::LIST && in.list(element_type, count)) {
+            schema.resize(count);
+            for (auto& element : schema) parseSchemaElement(in, element);
+        } else if (id == 3) {
+            info_.total_rows = in.integer();
+        } else if (id == 4 && type == Thrift::LIST && in.list(element_type, count)) {
+            for (size_t g = 0; g < count && !in.failed(); g++) {
+                // RowGroup: columns (1), num_rows (3)
+                chunks.emplace_back();
+                group_rows.push_back(0);
+                in.beginStruct();
+                int16_t group_id = 0;
+                uint8_t group_type = 0;
+                while (in.field(group_id, group_type)) {
+                    uint8_t chunk_type = 0;
+                    size_t chunk_count = 0;
+                    if (group_id == 1 && group_type == Thrift::LIST && in.list(chunk_type, chunk_count)) {
+                        chunks.back().resize(chunk_count);
+                        for (auto& meta : chunks.back()) local = parseColumnChunk(in, meta) && local;
+                    } else if (group_id == 3) {
+                        group_rows.back() = in.integer();
+                    } else {
+                        in.skip(group_type);
+                    }
+                }
+            }
+        } else {
+            in.skip(type);
+        }
+    }
+    if (in.failed() || schema.empty()) return reject("malformed metadata");
+    if (!local) return reject("column chunks in other files are not supported");
+
+    // A flat schema: the root and one leaf per column
+    if (schema[0].children != static_cast<int32_t>(schema.size()) - 1) return reject("nested columns are not supported");
+    static const Type TYPES[] = {Type::BOOLEAN, Type::INT32, Type::INT64, Type::INT96,
+                                 Type::FLOAT, Type::DOUBLE, Type::BYTE_ARRAY, Type::FIXED_LEN_BYTE_ARRAY};
+    for (size_t i = 1; i < schema.size(); i++) {
+        const SchemaElement& element = schema[i];
+        if (element.children != 0 || element.repetition == REPEATED) return reject("nested columns are not supported");
+        if (element.type < 0 || element.type > 7 || TYPES[element.type] == Type::INT96)
+            return reject("column " + element.name + " has an unsupported type");
+        ColumnInfo column;
+        column.name = element.name;
+        column.type = TYPES[element.type];
+        column.type_length = element.type_length;
+        column.optional = element.repetition == OPTIONAL;
+        column.date = column.type == Type::INT32 && (element.converted == CONVERTED_DATE || element.date);
+        if (element.converted == CONVERTED_DECIMAL || element.decimal) column.scale = std::max(0, element.scale);
+        if (column.type == Type::FIXED_LEN_BYTE_ARRAY && column.type_length <= 0)
+            return reject("column " + element.name + " has no length");
+        info_.columns.push_back(column);
+    }
+
+    int64_t rows = 0;
+    for (size_t g = 0; g < chunks.size(); g++) {
+        if (chunks[g].size() != info_.columns.size() || group_rows[g] < 0)
+            return reject("row group " + std::to_string(g) + " does not match the schema");
+        RowGroupInfo group;
+        group.rows = group_rows[g];
+        for (size_t c = 0; c < chunks[g].size(); c++) {
+            const ColumnMetaData& meta = chunks[g][c];
+            const ColumnInfo& column = info_.columns[c];
+            if (meta.path.size() != 1 || meta.path[0] != column.name || meta.values != group.rows)
+                return reject("column " + column.name + " of row group " + std::to_string(g) + " is malformed");
+            ChunkInfo chunk;
+            chunk.offset = meta.dictionary_page_offset > 0 && meta.dictionary_page_offset < meta.data_page_offset
+                               ? meta.dictionary_page_offset : meta.data_page_offset;
+            chunk.bytes = meta.bytes;
+            chunk.values = meta.values;
+            chunk.codec = meta.codec;
+            // min_value / max_value order byte arrays unsigned, as strings
+            // compare; the deprecated min / max only hold for numbers
+            const Bounds& b = meta.bounds;
+            bool ordered = column.type != Type::BYTE_ARRAY && column.type != Type::FIXED_LEN_BYTE_ARRAY;
+            const std::string* min = b.has_min_value ? &b.min_value : ordered && b.has_min ? &b.min : nullptr;
+            const std::string* max = b.has_max_value ? &b.max_value : ordered && b.has_max ? &b.max : nullptr;
+            size_t width = fixedBytes(column);
+            if (min && max && (width == 0 || (min->size() == width && max->size() == width)) &&
+                column.type != Type::BOOLEAN) {
+                chunk.has_bounds = valueText(column, min->data(), min->size(), chunk.min) &&
+                                   valueText(column, max->data(), max->size(), chunk.max);
+            }
+            group.columns.push_back(std::move(chunk));
+        }
+        rows += group.rows;
+        info_.row_groups.push_back(std::move(group));
+    }
+    if (rows != info_.total_rows) return reject("row counts do not add up");
+    return true;
+}
+
+bool File::mayMatch(size_t group, const std::vector<Columnar::Filter>& filters) const {
+    const RowGroupInfo& info = info_.row_groups.at(group);
+    for (const auto& filter : filters) {
+        for (size_t c = 0; c < info_.columns.size(); c++) {
+            const ColumnInfo& column = info_.columns[c];
+            const ChunkInfo& chunk = info.columns[c];
+            if (column.name != filter.column || !chunk.has_bounds) continue;
+            // Text compares in value order only for strings and dates; numeric
+            // filters need numbers
+            bool text_order = (column.type == Type::BYTE_ARRAY && column.scale < 0) || column.date;
+            bool number_order = !column.date && column.type != Type::BYTE_ARRAY &&
+                                (column.type != Type::FIXED_LEN_BYTE_ARRAY || column.scale >= 0);
+            if ((filter.numeric ? number_order : text_order) && !boundsMayMatch(filter, chunk.min, chunk.max))
+                return false;
+        }
+    }
+    return true;
+}
+
+bool File::readRowGroup(size_t group, const std::vector<size_t>& columns, const std::vector<std::string>& names,
+                        const std::vector<Columnar::Filter>& filters,
+                        std::vector<std::map<std::string, std::string>>& out, std::string& error) const {
+    const RowGroupInfo& info = info_.row_groups.at(group);
+    const uint64_t chunk_end = bytes_ - 8 - load<uint32_t>(data_ + bytes_ - 8);
+    // Decoded chunks by schema position: the output columns and the filtered ones
+    std::map<size_t, std::vector<std::string>> decoded;
+    auto decode = [&](size_t c) {
+        if (decoded.count(c)) return true;
+        return decodeChunk(data_, chunk_end, info_.columns[c], info.columns[c], info.rows, decoded[c], error);
+    };
+    std::vector<std::pair<const Columnar::Filter*, size_t>> filter_columns;
+    for (const auto& filter : filters) {
+        size_t c = 0;
+        while (c < info_.columns.size() && info_.columns[c].name != filter.column) c++;
+        if (c == info_.columns.size()) {
+            error = "no column " + filter.column;
+            return false;
+        }
+        if (!decode(c)) return false;
+        filter_columns.emplace_back(&filter, c);
+    }
+    for (size_t c : columns)
+        if (!decode(c)) return false;
+
+    std::vector<std::vector<std::string>*> sources;
+    for (size_t c : columns) sources.push_back(&decoded[c]);
+    for (int64_t r = 0; r < info.rows; r++) {
+        bool keep = true;
+        for (const auto& [filter, c] : filter_columns) keep = keep && filter->matches(decoded[c][r]);
+        if (!keep) continue;
+        std::map<std::string, std::string> row;
+        for (size_t i = 0; i < columns.size(); i++) row.emplace(names[i], (*sources[i])[r]);
+        out.push_back(std::move(row));
+    }
+    return true;
+}
+
+bool scan(const std::string& path, const std::vector<std::string>& columns,
+          const std::vector<Columnar::Filter>& filters, int threads,
+          const std::function<void(std::vector<std::map<std::string, std::string>>&)>& consume, std::string& error) {
+    Tracing::Scope trace_scope(Tracing::intern("read " + path), "io");
+    File file;
+    if (!file.open(path, error)) return false;
+    std::vector<size_t> wanted;
+    for (const auto& column : columns) {
+        size_t c = 0;
+        while (c < file.info().columns.size() && file.info().columns[c].name != column) c++;
+        if (c == file.info().columns.size()) {
+            error = path + " has no column " + column;
+            return false;
+        }
+        wanted.push_back(c);
+    }
+    // Row groups to decode; the others count as done right away
+    std::vector<size_t> groups;
+    auto groupBytes = [&](size_t g) {
+        uint64_t bytes = 0;
+        for (const auto& chunk : file.info().row_groups[g].columns) bytes += static_cast<uint64_t>(chunk.bytes);
+        return bytes;
+    };
+    for (size_t g = 0; g < file.info().row_groups.size(); g++) {
+        if (file.mayMatch(g, filters)) groups.push_back(g);
+        else Progress::advance(groupBytes(g), static_cast<uint64_t>(file.info().row_groups[g].rows));
+    }
+
+    // Waves of one row group per thread, consumed in file order
+    const size_t num_threads = static_cast<size_t>(std::max(1, threads));
+    std::vector<std::vector<std::map<std::string, std::string>>> tables(num_threads);
+    std::vector<std::string> errors(num_threads);
+    std::vector<char> ok(num_threads);
+    for (size_t first = 0; first < groups.size(); first += num_threads) {
+        size_t count = std::min(num_threads, groups.size() - first);
+        auto worker = [&](size_t t) {
+            Tracing::Scope group_trace("row group", "io");
+            tables[t].clear();
+            ok[t] = file.readRowGroup(groups[first + t], wanted, columns, filters, tables[t], errors[t]);
+            group_trace.setArg(tables[t].size());
+        };
+        std::vector<std::thread> workers;
+        for (size_t t = 1; t < count; t++) {
+            workers.emplace_back([&, t] {
+                Tracing::setThreadName("parquet-worker");
+                worker(t);
+            });
+        }
+        worker(0);
+        for (auto& w : workers) w.join();
+        for (size_t t = 0; t < count; t++) {
+            if (!ok[t]) {
+                error = path + ": " + errors[t];
+                return false;
+            }
+            const size_t g = groups[first + t];
+            consume(tables[t]);
+            Progress::advance(groupBytes(g), static_cast<uint64_t>(file.info().row_groups[g].rows));
+        }
+    }
+    trace_scope.setArg(static_cast<uint64_t>(file.info().total_rows));
+    return true;
+}
+
+bool readTable(const std::string& path, const std::vector<std::string>& columns,
+               std::vector<std::map<std::string, std::string>>& out, int threads,
+               const std::vector<Columnar::Filter>& filters) {
+    std::string error;
+    bool ok = scan(path, columns, filters, threads, [&](std::vector<std::map<std::string, std::string>>& group) {
+        if (out.empty()) out.swap(group);
+        else out.insert(out.end(), std::make_move_iterator(group.begin()), std::make_move_iterator(group.end()));
+    }, error);
+    if (!ok) std::cerr << error << std::endl;
+    return ok;
+}
+
+}
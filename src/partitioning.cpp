@@ -0,0 +1,73 @@
+#include "../include/partitioning.hpp"
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+namespace Partitioning {
+
+size_t Layout::dateRange(const std::string& date) const {
+    return std::upper_bound(date_bounds.begin(), date_bounds.end(), date) - date_bounds.begin();
+}
+
+bool Layout::overlaps(size_t r, const std::string& start, const std::string& end) const {
+    // Range r is [bounds[r - 1], bounds[r])
+    bool below_end = r == 0 || date_bounds[r - 1] < end;
+    bool above_start = r == date_bounds.size() || date_bounds[r] > start;
+    return below_end && above_start;
+}
+
+bool Layout::within(size_t r, const std::string& start, const std::string& end) const {
+    return r > 0 && r < dateRanges() - 1 && date_bounds[r - 1] >= start && date_bounds[r] <= end;
+}
+
+std::string Layout::ordersFile(const std::string& directory, int h, size_t r) {
+    return directory + "/orders/h" + std::to_string(h) + "_r" + std::to_string(r) + ".col";
+}
+
+std::string Layout::lineitemFile(const std::string& directory, int h) {
+    return directory + "/lineitem/h" + std::to_string(h) + ".col";
+}
+
+bool readLayout(const std::string& directory, Layout& layout) {
+    std::ifstream in(directory + "/" + MANIFEST);
+    if (!in) return false;
+    layout = Layout();
+    std::string line, key;
+    int version = 0;
+    while (std::getline(in, line)) {
+        std::istringstream fields(line);
+        if (!(fields >> key)) continue;
+        if (key == "tpch-partitions") fields >> version;
+        else if (key == "hash_partitions") fields >> layout.hash_partitions;
+        else if (key == "orders_date_bounds") {
+            std::string bound;
+            while (fields >> bound) layout.date_bounds.push_back(bound);
+        }
+    }
+    return version >= 1 && version <= VERSION && layout.hash_partitions >= 1 &&
+           std::is_sorted(layout.date_bounds.begin(), layout.date_bounds.end());
+}
+
+bool writeLayout(const std::string& directory, const Layout& layout) {
+    std::ofstream out(directory + "/" + MANIFEST);
+    out << "tpch-partitions " << VERSION << "\n";
+    out << "hash_partitions " << layout.hash_partitions << "\n";
+    out << "orders_date_bounds";
+    for (const auto& bound : layout.date_bounds) out << " " << bound;
+    out << "\n";
+    return out.good();
+}
+
+std::shared_ptr<PartitionedTables> openPartitioned(const std::string& table_path, const std::string& start_date,
+                                                   const std::string& end_date) {
+    std::string directory = table_path;
+    while (directory.size() > 1 && directory.back() == '/') directory.pop_back();
+    auto tables = std::make_shared<PartitionedTables>();
+    if (!readLayout(directory, tables->layout)) return nullptr;
+    tables->directory = directory;
+    tables->start_date = start_date;
+    tables->end_date = end_date;
+    return tables;
+}
+
+}
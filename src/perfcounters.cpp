@@ -0,0 +1,181 @@
+#include "../include/perfcounters.hpp"
+#include <atomic>
+#include <cstring>
+#include <cerrno>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace PerfCounters {
+
+namespace {
+std::atomic<bool> counters_enabled{true};
+
+#ifdef __linux__
+struct EventConfig {
+    uint32_t type;
+    uint64_t config;
+};
+
+const EventConfig event_configs[NUM_EVENTS] = {
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+    {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_LL | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                         (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+    {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                         (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+};
+
+int openEvent(int event, int group_fd) {
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = event_configs[event].type;
+    attr.config = event_configs[event].config;
+    attr.disabled = group_fd < 0 ? 1 : 0;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_ID |
+                       PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    // pid 0, cpu -1: the calling thread on any CPU
+    return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, 0));
+}
+#endif
+}
+
+const char* eventName(int event) {
+    static const char* names[NUM_EVENTS] = {
+        "cycles", "instructions", "cache_misses", "llc_misses", "dtlb_misses", "branch_misses"
+    };
+    return event >= 0 && event < NUM_EVENTS ? names[event] : "unknown";
+}
+
+bool Counts::any() const {
+    for (int i = 0; i < NUM_EVENTS; i++)
+        if (valid[i]) return true;
+    return false;
+}
+
+double Counts::ipc() const {
+    if (!valid[CYCLES] || !valid[INSTRUCTIONS] || values[CYCLES] == 0) return 0.0;
+    return static_cast<double>(values[INSTRUCTIONS]) / values[CYCLES];
+}
+
+Counts& Counts::operator+=(const Counts& other) {
+    for (int i = 0; i < NUM_EVENTS; i++) {
+        if (!other.valid[i]) continue;
+        values[i] += other.values[i];
+        valid[i] = true;
+    }
+    return *this;
+}
+
+void Counts::writeJSON(std::ostream& out) const {
+    if (!any()) {
+        out << "null";
+        return;
+    }
+    out << "{";
+    bool first = true;
+    for (int i = 0; i < NUM_EVENTS; i++) {
+        if (!valid[i]) continue;
+        out << (first ? "" : ", ") << "\"" << eventName(i) << "\": " << values[i];
+        first = false;
+    }
+    if (valid[CYCLES] && valid[INSTRUCTIONS]) out << ", \"ipc\": " << ipc();
+    out << "}";
+}
+
+CounterGroup::CounterGroup() {
+    for (int i = 0; i < NUM_EVENTS; i++) fds_[i] = -1;
+#ifdef __linux__
+    if (!isEnabled()) return;
+    fds_[CYCLES] = openEvent(CYCLES, -1);
+    if (fds_[CYCLES] < 0) return;
+    for (int i = 0; i < NUM_EVENTS; i++) {
+        if (i != CYCLES) fds_[i] = openEvent(i, fds_[CYCLES]);
+        if (fds_[i] >= 0) ioctl(fds_[i], PERF_EVENT_IOC_ID, &ids_[i]);
+    }
+#endif
+}
+
+CounterGroup::~CounterGroup() {
+#ifdef __linux__
+    for (int i = 0; i < NUM_EVENTS; i++)
+        if (fds_[i] >= 0) close(fds_[i]);
+#endif
+}
+
+void CounterGroup::start() {
+#ifdef __linux__
+    if (!available()) return;
+    ioctl(fds_[CYCLES], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(fds_[CYCLES], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+#endif
+}
+
+Counts CounterGroup::stop() {
+    Counts counts;
+#ifdef __linux__
+    if (!available()) return counts;
+    ioctl(fds_[CYCLES], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+
+    // Layout: nr, time_enabled, time_running, then {value, id} per event
+    uint64_t buffer[3 + 2 * NUM_EVENTS];
+    ssize_t bytes = read(fds_[CYCLES], buffer, sizeof(buffer));
+    if (bytes < static_cast<ssize_t>(3 * sizeof(uint64_t))) return counts;
+
+    uint64_t nr = buffer[0];
+    uint64_t time_enabled = buffer[1];
+    uint64_t time_running = buffer[2];
+    // The group was multiplexed with other users of the PMU: extrapolate
+    double scale = time_running > 0 ? static_cast<double>(time_enabled) / time_running : 1.0;
+
+    for (uint64_t n = 0; n < nr && n < NUM_EVENTS; n++) {
+        uint64_t value = buffer[3 + 2 * n];
+        uint64_t id = buffer[4 + 2 * n];
+        for (int i = 0; i < NUM_EVENTS; i++) {
+            if (fds_[i] >= 0 && ids_[i] == id) {
+                counts.values[i] = static_cast<uint64_t>(value * scale);
+                counts.valid[i] = time_running > 0;
+            }
+        }
+    }
+#endif
+    return counts;
+}
+
+void setEnabled(bool enabled) {
+    counters_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+bool isEnabled() {
+    return counters_enabled.load(std::memory_order_relaxed);
+}
+
+bool probe(std::string& reason) {
+#ifdef __linux__
+    if (!isEnabled()) {
+        reason = "disabled";
+        return false;
+    }
+    int fd = openEvent(CYCLES, -1);
+    if (fd < 0) {
+        reason = std::string("perf_event_open: ") + std::strerror(errno);
+        return false;
+    }
+    close(fd);
+    return true;
+#else
+    reason = "perf_event_open requires Linux";
+    return false;
+#endif
+}
+
+}
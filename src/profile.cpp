@@ -0,0 +1,130 @@
+#include "../include/profile.hpp"
+#include "../include/json.hpp"
+#include <mutex>
+
+namespace Profiling {
+
+namespace {
+QueryProfile current_query;
+std::mutex profile_mutex;
+}
+
+QueryProfile& currentQuery() {
+    return current_query;
+}
+
+void recordOperator(OperatorProfile&& op) {
+    std::lock_guard<std::mutex> lock(profile_mutex);
+    current_query.hw += op.hw;
+    current_query.operators.push_back(std::move(op));
+}
+
+void recordPipeline(PipelineProfile&& pipeline) {
+    std::lock_guard<std::mutex> lock(profile_mutex);
+    current_query.pipelines.push_back(std::move(pipeline));
+}
+
+#ifdef TPCH_ENABLE_PROFILING
+size_t operatorCount() {
+    std::lock_guard<std::mutex> lock(profile_mutex);
+    return current_query.operators.size();
+}
+
+PerfCounters::Counts otherThreadCounts(size_t first_operator, std::thread::id thread) {
+    std::lock_guard<std::mutex> lock(profile_mutex);
+    PerfCounters::Counts counts;
+    for (size_t i = first_operator; i < current_query.operators.size(); i++) {
+        const OperatorProfile& op = current_query.operators[i];
+        if (op.thread != thread) {
+            counts += op.hw;
+            continue;
+        }
+        for (const auto& thread_counts : op.thread_hw) counts += thread_counts;
+    }
+    return counts;
+}
+
+QueryScope::QueryScope(const std::string& query, int num_threads) : start_ns_(nowNs()) {
+    std::string hw_status = "profiling disabled";
+    bool hw_available = enabled() && PerfCounters::probe(hw_status);
+    MemTrack::resetPeak();
+    memory_start_ = MemTrack::process();
+
+    std::lock_guard<std::mutex> lock(profile_mutex);
+    current_query = QueryProfile();
+    current_query.query = query;
+    current_query.num_threads = num_threads;
+    current_query.hw_available = hw_available;
+    current_query.hw_status = hw_status;
+}
+
+QueryScope::~QueryScope() {
+    MemTrack::Counts memory = MemTrack::process();
+    memory.allocated_bytes -= memory_start_.allocated_bytes;
+    memory.allocations -= memory_start_.allocations;
+    memory.frees -= memory_start_.frees;
+
+    std::lock_guard<std::mutex> lock(profile_mutex);
+    current_query.total_ns = nowNs() - start_ns_;
+    current_query.memory = memory;
+}
+#endif
+
+void QueryProfile::writeJSON(std::ostream& out) const {
+    out << "{\n";
+    out << "  \"query\": " << jsonQuote(query) << ",\n";
+    out << "  \"profiling_enabled\": " << (enabled() ? "true" : "false") << ",\n";
+    out << "  \"threads\": " << num_threads << ",\n";
+    out << "  \"total_ns\": " << total_ns << ",\n";
+    out << "  \"hw_counters\": {\"available\": " << (hw_available ? "true" : "false")
+        << ", \"status\": " << jsonQuote(hw_available ? "ok" : hw_status) << "},\n";
+    out << "  \"hw\": ";
+    hw.writeJSON(out);
+    out << ",\n";
+    out << "  \"memory\": ";
+    memory.writeJSON(out, 0);
+    out << ",\n";
+    out << "  \"pipelines\": [";
+    for (size_t i = 0; i < pipelines.size(); i++) {
+        out << (i == 0 ? "\n" : ",\n");
+        out << "    {\"name\": " << jsonQuote(pipelines[i].name)
+            << ", \"total_ns\": " << pipelines[i].total_ns
+            << ", \"rows_out\": " << pipelines[i].rows_out << ", \"hw\": ";
+        pipelines[i].hw.writeJSON(out);
+        out << "}";
+    }
+    out << (pipelines.empty() ? "],\n" : "\n  ],\n");
+    out << "  \"operators\": [";
+    for (size_t i = 0; i < operators.size(); i++) {
+        const OperatorProfile& op = operators[i];
+        out << (i == 0 ? "\n" : ",\n");
+        out << "    {\"id\": " << i
+            << ", \"name\": " << jsonQuote(op.name)
+            << ", \"detail\": " << jsonQuote(op.detail)
+            << ", \"rows_in\": " << op.rows_in
+            << ", \"rows_out\": " << op.rows_out
+            << ", \"build_ns\": " << op.build_ns
+            << ", \"probe_ns\": " << op.probe_ns
+            << ", \"total_ns\": " << op.total_ns
+            << ", \"peak_rows\": " << op.peak_rows
+            << ", \"thread_busy_ns\": [";
+        for (size_t t = 0; t < op.thread_busy_ns.size(); t++) {
+            if (t > 0) out << ", ";
+            out << op.thread_busy_ns[t];
+        }
+        out << "], \"hw\": ";
+        op.hw.writeJSON(out);
+        out << ", \"thread_hw\": [";
+        for (size_t t = 0; t < op.thread_hw.size(); t++) {
+            if (t > 0) out << ", ";
+            op.thread_hw[t].writeJSON(out);
+        }
+        out << "], \"memory\": ";
+        op.memory.writeJSON(out, op.rows_in);
+        out << "}";
+    }
+    out << (operators.empty() ? "]\n" : "\n  ]\n");
+    out << "}\n";
+}
+
+}
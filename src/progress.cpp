@@ -0,0 +1,225 @@
+#include "../include/progress.hpp"
+#include "../include/json.hpp"
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+namespace Progress {
+
+namespace {
+constexpr int MAX_TABLES = 32;
+
+struct Frame {
+    std::string label;
+    int table;
+    uint64_t total;
+    Unit unit;
+    uint64_t done;          // saved while a nested step runs
+    std::chrono::steady_clock::time_point start;
+};
+
+const auto origin = std::chrono::steady_clock::now();
+
+// Step bookkeeping is rare and takes the mutex; advance() only touches atomics
+std::mutex state_mutex;
+std::string current_phase;
+std::vector<Frame> frames;
+std::string table_names[MAX_TABLES] = {"other"};
+int table_count = 1;
+
+std::atomic<uint64_t> current_done{0};
+std::atomic<int> current_table{0};
+std::atomic<uint64_t> step_counter{0};
+std::atomic<uint64_t> table_rows[MAX_TABLES];
+
+thread_local int quiet_depth = 0;
+
+double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Slot of a table name, called with state_mutex held
+int tableSlot(const std::string& table) {
+    if (table.empty()) return 0;
+    for (int i = 1; i < table_count; i++)
+        if (table_names[i] == table) return i;
+    if (table_count == MAX_TABLES) return 0;
+    table_names[table_count] = table;
+    return table_count++;
+}
+
+std::string humanCount(double value) {
+    const char* suffixes[] = {"", "K", "M", "G", "T"};
+    int i = 0;
+    while (value >= 1000 && i < 4) {
+        value /= 1000;
+        i++;
+    }
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), i == 0 ? "%.0f%s" : "%.1f%s", value, suffixes[i]);
+    return buffer;
+}
+
+std::string humanDuration(double seconds) {
+    char buffer[32];
+    if (seconds < 60) std::snprintf(buffer, sizeof(buffer), "%.1fs", seconds);
+    else if (seconds < 3600) std::snprintf(buffer, sizeof(buffer), "%dm%02ds", int(seconds) / 60, int(seconds) % 60);
+    else std::snprintf(buffer, sizeof(buffer), "%dh%02dm", int(seconds) / 3600, int(seconds) % 3600 / 60);
+    return buffer;
+}
+}
+
+void setPhase(const std::string& phase) {
+    std::lock_guard<std::mutex> lock(state_mutex);
+    current_phase = phase;
+}
+
+Step::Step(const std::string& label, const std::string& table, uint64_t total, Unit unit)
+    : active_(quiet_depth == 0) {
+    if (!active_) return;
+    std::lock_guard<std::mutex> lock(state_mutex);
+    if (!frames.empty()) frames.back().done = current_done.load(std::memory_order_relaxed);
+    int slot = tableSlot(table);
+    frames.push_back({label, slot, total, unit, 0, std::chrono::steady_clock::now()});
+    current_done.store(0, std::memory_order_relaxed);
+    current_table.store(slot, std::memory_order_relaxed);
+    step_counter.fetch_add(1, std::memory_order_relaxed);
+}
+
+Step::~Step() {
+    if (!active_) return;
+    std::lock_guard<std::mutex> lock(state_mutex);
+    frames.pop_back();
+    current_done.store(frames.empty() ? 0 : frames.back().done, std::memory_order_relaxed);
+    current_table.store(frames.empty() ? 0 : frames.back().table, std::memory_order_relaxed);
+    step_counter.fetch_add(1, std::memory_order_relaxed);
+}
+
+void advance(uint64_t units, uint64_t rows) {
+    if (quiet_depth) return;
+    current_done.fetch_add(units, std::memory_order_relaxed);
+    table_rows[current_table.load(std::memory_order_relaxed)].fetch_add(rows, std::memory_order_relaxed);
+}
+
+Quiet::Quiet(bool enable) : enabled_(enable) {
+    if (enabled_) quiet_depth++;
+}
+
+Quiet::~Quiet() {
+    if (enabled_) quiet_depth--;
+}
+
+bool quiet() {
+    return quiet_depth > 0;
+}
+
+Status snapshot() {
+    Status status;
+    std::lock_guard<std::mutex> lock(state_mutex);
+    status.elapsed_s = secondsSince(origin);
+    status.phase = current_phase;
+    status.step_id = step_counter.load(std::memory_order_relaxed);
+    if (!frames.empty()) {
+        const Frame& frame = frames.back();
+        status.step = frame.label;
+        status.unit = frame.unit;
+        status.total = frame.total;
+        status.done = current_done.load(std::memory_order_relaxed);
+        status.step_elapsed_s = secondsSince(frame.start);
+    }
+    for (int i = 0; i < table_count; i++) {
+        uint64_t rows = table_rows[i].load(std::memory_order_relaxed);
+        if (rows > 0) status.rows_scanned.emplace_back(table_names[i], rows);
+    }
+    return status;
+}
+
+Reporter::Reporter(double interval_s, bool print, std::string status_path)
+    : interval_s_(interval_s > 0 ? interval_s : 1.0), print_(print), status_path_(std::move(status_path)),
+      thread_(&Reporter::run, this) {}
+
+Reporter::~Reporter() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    wake_.notify_all();
+    thread_.join();
+}
+
+void Reporter::run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!wake_.wait_for(lock, std::chrono::duration<double>(interval_s_), [this] { return stop_; }))
+        report();
+    // Leave the final state in the status file
+    print_ = false;
+    report();
+}
+
+void Reporter::report() {
+    Status s = snapshot();
+    if (s.step_id != last_step_id_ || s.done != last_done_) last_change_s_ = s.elapsed_s;
+    double stalled_s = s.step.empty() ? 0 : s.elapsed_s - last_change_s_;
+    last_step_id_ = s.step_id;
+    last_done_ = s.done;
+
+    // Average rate over the whole step gives a steadier estimate than the last interval
+    double rate = s.step_elapsed_s > 0 ? s.done / s.step_elapsed_s : 0;
+    double eta_s = rate > 0 && s.total > s.done ? (s.total - s.done) / rate : (s.total <= s.done ? 0 : -1);
+    double percent = s.total > 0 ? 100.0 * s.done / s.total : 0;
+    bool stalled = stalled_s >= 2 * interval_s_;
+    const char* unit = s.unit == Unit::BYTES ? "bytes" : "rows";
+
+    if (print_) {
+        std::ostringstream line;
+        line << "[progress " << humanDuration(s.elapsed_s) << "] " << (s.phase.empty() ? "-" : s.phase);
+        if (s.step.empty()) {
+            line << " | idle";
+        } else {
+            char pct[16];
+            std::snprintf(pct, sizeof(pct), "%.1f%%", percent);
+            line << " | " << s.step << ": " << pct << " of " << humanCount(s.total) << " " << unit
+                 << ", " << humanCount(rate) << " " << unit << "/s";
+            line << ", eta " << (eta_s < 0 ? "?" : humanDuration(eta_s));
+        }
+        if (!s.rows_scanned.empty()) {
+            line << " | scanned";
+            for (size_t i = 0; i < s.rows_scanned.size(); i++)
+                line << (i ? ", " : " ") << s.rows_scanned[i].first << " " << humanCount(s.rows_scanned[i].second);
+        }
+        if (stalled) line << " | NO PROGRESS for " << humanDuration(stalled_s);
+        std::cerr << line.str() << std::endl;
+    }
+
+    if (!status_path_.empty()) {
+        // Write then rename, so readers never see a half-written file
+        std::string temp_path = status_path_ + ".tmp";
+        {
+            std::ofstream out(temp_path, std::ios::trunc);
+            if (!out.is_open()) return;
+            out << "{\"elapsed_s\": " << s.elapsed_s
+                << ", \"phase\": " << jsonQuote(s.phase)
+                << ", \"step\": " << jsonQuote(s.step)
+                << ", \"unit\": " << jsonQuote(unit)
+                << ", \"done\": " << s.done
+                << ", \"total\": " << s.total
+                << ", \"percent\": " << percent
+                << ", \"rate_per_s\": " << rate
+                << ", \"eta_s\": " << eta_s
+                << ", \"stalled_s\": " << stalled_s
+                << ", \"stalled\": " << (stalled ? "true" : "false")
+                << ", \"rows_scanned\": {";
+            for (size_t i = 0; i < s.rows_scanned.size(); i++)
+                out << (i ? ", " : "") << jsonQuote(s.rows_scanned[i].first) << ": " << s.rows_scanned[i].second;
+            out << "}}\n";
+        }
+#ifdef _WIN32
+        std::remove(status_path_.c_str());
+#endif
+        std::rename(temp_path.c_str(), status_path_.c_str());
+    }
+}
+
+}
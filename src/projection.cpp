@@ -0,0 +1,116 @@
+#include "../include/projection.hpp"
+#include "../include/columnar.hpp"
+#include "../include/query5.hpp"
+#include "../include/tpch_schema.hpp"
+#include <algorithm>
+#include <filesystem>
+#include <numeric>
+#include <unordered_map>
+
+namespace Projection {
+
+using Table = std::vector<std::map<std::string, std::string>>;
+
+static std::string pathPrefix(const std::string& table_path) {
+    return !table_path.empty() && table_path.back() != '/' ? table_path + "/" : table_path;
+}
+
+// The newest of the .tbl, .col, .arrow and .parquet files of a base table
+static std::filesystem::file_time_type modified(const std::string& path_prefix, const std::string& name) {
+    namespace fs = std::filesystem;
+    fs::file_time_type newest = fs::file_time_type::min();
+    for (const char* extension : {".tbl", ".col", ".arrow", ".parquet"}) {
+        std::error_code ec;
+        auto time = fs::last_write_time(path_prefix + name + extension, ec);
+        if (!ec) newest = std::max(newest, time);
+    }
+    return newest;
+}
+
+const std::vector<std::string>& lineitemColumns() {
+    static const std::vector<std::string> columns = [] {
+        std::vector<std::string> result = TPCH::LINEITEM_COLUMNS;
+        result.push_back("O_ORDERDATE");
+        return result;
+    }();
+    return columns;
+}
+
+bool build(const std::string& table_path, std::string& error) {
+    std::string path_prefix = pathPrefix(table_path);
+    Table orders, lineitem;
+    if (!readBaseTable(table_path, "orders", TPCH::ORDERS_COLUMNS, orders) ||
+        !readBaseTable(table_path, "lineitem", TPCH::LINEITEM_COLUMNS, lineitem)) {
+        error = "failed to read orders and lineitem from " + table_path;
+        return false;
+    }
+
+    // Stable sorts keep the base (order key) order within a date
+    std::stable_sort(orders.begin(), orders.end(), [](const auto& a, const auto& b) {
+        return a.at("O_ORDERDATE") < b.at("O_ORDERDATE");
+    });
+    std::unordered_map<std::string, size_t> position;
+    position.reserve(orders.size());
+    for (size_t i = 0; i < orders.size(); i++) position.emplace(orders[i].at("O_ORDERKEY"), i);
+
+    // lineitem follows its orders; lineitems without an order (never joined)
+    // go first with an empty date so the file stays sorted by O_ORDERDATE
+    std::vector<size_t> order_of(lineitem.size());
+    for (size_t i = 0; i < lineitem.size(); i++) {
+        auto it = position.find(lineitem[i].at("L_ORDERKEY"));
+        order_of[i] = it == position.end() ? 0 : it->second + 1;
+    }
+    std::vector<size_t> permutation(lineitem.size());
+    std::iota(permutation.begin(), permutation.end(), 0);
+    std::stable_sort(permutation.begin(), permutation.end(),
+                     [&](size_t a, size_t b) { return order_of[a] < order_of[b]; });
+    Table sorted_lineitem;
+    sorted_lineitem.reserve(lineitem.size());
+    for (size_t i : permutation) {
+        auto row = std::move(lineitem[i]);
+        row["O_ORDERDATE"] = order_of[i] == 0 ? "" : orders[order_of[i] - 1].at("O_ORDERDATE");
+        sorted_lineitem.push_back(std::move(row));
+    }
+
+    // orders is written last: a projection is only current once both files are
+    if (!Columnar::writeTable(path_prefix + LINEITEM_BY_DATE + ".col", lineitemColumns(), sorted_lineitem) ||
+        !Columnar::writeTable(path_prefix + ORDERS_BY_DATE + ".col", TPCH::ORDERS_COLUMNS, orders)) {
+        error = "failed to write the projection to " + table_path;
+        return false;
+    }
+    return true;
+}
+
+bool current(const std::string& table_path) {
+    namespace fs = std::filesystem;
+    std::string path_prefix = pathPrefix(table_path);
+    std::error_code ec;
+    auto orders_time = fs::last_write_time(path_prefix + ORDERS_BY_DATE + ".col", ec);
+    if (ec) return false;
+    auto lineitem_time = fs::last_write_time(path_prefix + LINEITEM_BY_DATE + ".col", ec);
+    if (ec) return false;
+    auto base_time = std::max(modified(path_prefix, "orders"), modified(path_prefix, "lineitem"));
+    return std::min(orders_time, lineitem_time) >= base_time && orders_time >= lineitem_time;
+}
+
+bool choose(const std::string& table_path, const std::string& mode, Layout& layout, std::string& error) {
+    if (mode == "base") {
+        layout = Layout::BASE;
+        return true;
+    }
+    if (mode != "auto" && mode != "order_date") {
+        error = "unknown projection " + mode;
+        return false;
+    }
+    // A date range never selects more rows from the date-clustered
+    // projection than from the base tables, so a current one always wins
+    bool available = current(table_path);
+    if (mode == "order_date" && !available) {
+        error = "no current order date projection in " + table_path;
+        return false;
+    }
+    layout = available ? Layout::ORDER_DATE : Layout::BASE;
+    return true;
+}
+
+}
@@ -0,0 +1,100 @@
+#include "../include/report.hpp"
+#include "../include/json.hpp"
+#include <ctime>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
+
+namespace Report {
+
+long peakRssKb() {
+#if defined(__unix__) || defined(__APPLE__)
+    rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+#if defined(__APPLE__)
+    return usage.ru_maxrss / 1024;  // bytes on macOS
+#else
+    return usage.ru_maxrss;
+#endif
+#else
+    return 0;
+#endif
+}
+
+void RunReport::writeJSON(std::ostream& out) const {
+    char timestamp[32];
+    std::time_t now = std::time(nullptr);
+    std::strftime(timestamp, sizeof(timestamp), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+
+    out << "{\n";
+    out << "  \"query\": " << jsonQuote(query) << ",\n";
+    out << "  \"timestamp\": " << jsonQuote(timestamp) << ",\n";
+    out << "  \"config\": {\"r_name\": " << jsonQuote(r_name)
+        << ", \"start_date\": " << jsonQuote(start_date)
+        << ", \"end_date\": " << jsonQuote(end_date)
+        << ", \"threads\": " << num_threads
+        << ", \"table_path\": " << jsonQuote(table_path)
+        << ", \"result_path\": " << jsonQuote(result_path)
+        << ", \"profiling_build\": " << (Profiling::enabled() ? "true" : "false")
+        << ", \"engine_options\": {";
+    bool first = true;
+    for (const auto& [key, value] : engine_options) {
+        out << (first ? "" : ", ") << jsonQuote(key) << ": " << jsonQuote(value);
+        first = false;
+    }
+    out << "}},\n";
+
+    out << "  \"phases_ms\": {\"parse_args\": " << phases.parse_args_ms
+        << ", \"load\": " << phases.load_ms
+        << ", \"execute\": " << phases.execute_ms
+        << ", \"output\": " << phases.output_ms
+        << ", \"total\": " << phases.total_ms << "},\n";
+
+    uint64_t total_rows = 0, total_bytes = 0;
+    out << "  \"tables\": [";
+    for (size_t i = 0; i < tables.size(); i++) {
+        const TableLoadStats& t = tables[i];
+        double seconds = t.load_ms / 1000.0;
+        total_rows += t.rows;
+        total_bytes += t.bytes;
+        out << (i == 0 ? "\n" : ",\n");
+        out << "    {\"name\": " << jsonQuote(t.name)
+            << ", \"path\": " << jsonQuote(t.path)
+            << ", \"format\": " << jsonQuote(t.format)
+            << ", \"rows\": " << t.rows
+            << ", \"bytes\": " << t.bytes
+            << ", \"load_ms\": " << t.load_ms
+            << ", \"mb_per_s\": " << (seconds > 0 ? t.bytes / seconds / 1e6 : 0.0)
+            << ", \"rows_per_s\": " << (seconds > 0 ? t.rows / seconds : 0.0)
+            << ", \"memory\": ";
+        t.memory.writeJSON(out, t.rows);
+        out << "}";
+    }
+    out << (tables.empty() ? "],\n" : "\n  ],\n");
+    double load_seconds = phases.load_ms / 1000.0;
+    out << "  \"load\": {\"rows\": " << total_rows << ", \"bytes\": " << total_bytes
+        << ", \"mb_per_s\": " << (load_seconds > 0 ? total_bytes / load_seconds / 1e6 : 0.0) << "},\n";
+
+    out << "  \"pipelines\": [";
+    for (size_t i = 0; i < pipelines.size(); i++) {
+        out << (i == 0 ? "\n" : ",\n");
+        out << "    {\"name\": " << jsonQuote(pipelines[i].name)
+            << ", \"ms\": " << pipelines[i].total_ns / 1e6
+            << ", \"rows_out\": " << pipelines[i].rows_out << "}";
+    }
+    out << (pipelines.empty() ? "],\n" : "\n  ],\n");
+
+    out << "  \"arena\": {\"used\": " << (arena.used ? "true" : "false")
+        << ", \"bytes\": " << arena.bytes
+        << ", \"blocks\": " << arena.blocks
+        << ", \"fallback_allocations\": " << arena.fallback_allocations << "},\n";
+    out << "  \"buffer\": ";
+    buffer.writeJSON(out);
+    out << ",\n";
+    out << "  \"result_rows\": " << result_rows << ",\n";
+    out << "  \"peak_rss_kb\": " << peak_rss_kb << "\n";
+    out << "}\n";
+}
+
+}
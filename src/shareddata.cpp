@@ -0,0 +1,323 @@
+#include "../include/shareddata.hpp"
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/statvfs.h>
+#include <unistd.h>
+#endif
+
+namespace SharedData {
+
+namespace {
+const char MAGIC[8] = {'T', 'P', 'C', 'H', 'S', 'H', 'M', '1'};
+constexpr size_t NAME_BYTES = 32;
+constexpr size_t SOURCE_BYTES = 1024;
+constexpr uint64_t IMAGE_ALIGNMENT = 64;
+
+struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t table_count;
+    uint64_t total_bytes;
+    uint64_t ready;
+    char source[SOURCE_BYTES];
+};
+
+struct Entry {
+    char name[NAME_BYTES];
+    uint64_t offset;
+    uint64_t bytes;
+    int64_t modified;
+};
+
+uint64_t alignUp(uint64_t value, uint64_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+// Names containing '/' are files (hugetlbfs, /dev/shm, ...), others POSIX shm objects
+bool isPath(const std::string& name) {
+    return name.find('/') != std::string::npos;
+}
+
+#ifdef _WIN32
+std::string mappingName(const std::string& name) {
+    return "Local\\tpch." + name;
+}
+#else
+std::string shmName(const std::string& name) {
+    return "/tpch." + name;
+}
+#endif
+
+// Canonical form of a table directory, so "dir", "dir/" and "./dir" compare equal
+std::string canonicalDirectory(const std::string& path) {
+    std::error_code ec;
+    auto canonical = std::filesystem::canonical(path, ec);
+    return ec ? path : canonical.string();
+}
+
+int64_t modifiedTime(const std::string& path) {
+    std::error_code ec;
+    auto time = std::filesystem::last_write_time(path, ec);
+    return ec ? 0 : static_cast<int64_t>(time.time_since_epoch().count());
+}
+
+std::unique_ptr<Segment>& processSegment() {
+    static std::unique_ptr<Segment> segment;
+    return segment;
+}
+}
+
+Segment::~Segment() {
+    unmap();
+}
+
+void Segment::unmap() {
+#ifdef _WIN32
+    if (base_) UnmapViewOfFile(base_);
+    if (handle_ != -1) CloseHandle(reinterpret_cast<HANDLE>(handle_));
+#else
+    if (base_) munmap(base_, bytes_);
+#endif
+    base_ = nullptr;
+    handle_ = -1;
+    bytes_ = 0;
+    tables_.clear();
+}
+
+bool Segment::publish(const std::string& name, const std::string& table_path, const std::vector<std::string>& tables,
+                      std::string& error) {
+    unmap();
+    std::string source = canonicalDirectory(table_path);
+    if (source.size() >= SOURCE_BYTES) {
+        error = "table path too long";
+        return false;
+    }
+
+    // Directory, then the images
+    std::vector<Entry> entries;
+    std::vector<std::string> paths;
+    uint64_t total = alignUp(sizeof(Header) + tables.size() * sizeof(Entry), IMAGE_ALIGNMENT);
+    for (const auto& table : tables) {
+        std::string path = source + "/" + table + ".col";
+        std::error_code ec;
+        uint64_t file_bytes = std::filesystem::file_size(path, ec);
+        if (ec) {
+            error = "cannot read " + path;
+            return false;
+        }
+        if (table.size() >= NAME_BYTES) {
+            error = "table name too long: " + table;
+            return false;
+        }
+        Entry entry = {};
+        std::memcpy(entry.name, table.data(), table.size());
+        entry.offset = total;
+        entry.bytes = file_bytes;
+        entry.modified = modifiedTime(path);
+        entries.push_back(entry);
+        paths.push_back(path);
+        total = alignUp(total + file_bytes, IMAGE_ALIGNMENT);
+    }
+
+#ifdef _WIN32
+    if (isPath(name)) {
+        error = "file-backed segments are not supported on Windows";
+        return false;
+    }
+    HANDLE mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, static_cast<DWORD>(total >> 32),
+                                        static_cast<DWORD>(total), mappingName(name).c_str());
+    if (!mapping || GetLastError() == ERROR_ALREADY_EXISTS) {
+        if (mapping) CloseHandle(mapping);
+        error = "cannot create mapping " + mappingName(name);
+        return false;
+    }
+    void* base = MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, 0);
+    if (!base) {
+        CloseHandle(mapping);
+        error = "cannot map " + mappingName(name);
+        return false;
+    }
+    handle_ = reinterpret_cast<intptr_t>(mapping);
+#else
+    int fd;
+    if (isPath(name)) {
+        ::unlink(name.c_str());
+        fd = ::open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    } else {
+        shm_unlink(shmName(name).c_str());
+        fd = shm_open(shmName(name).c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    }
+    if (fd < 0) {
+        error = "cannot create " + name + ": " + std::strerror(errno);
+        return false;
+    }
+    // hugetlbfs files must be sized in whole huge pages
+    struct statvfs fs_info;
+    if (isPath(name) && fstatvfs(fd, &fs_info) == 0 && fs_info.f_bsize > 0) total = alignUp(total, fs_info.f_bsize);
+    void* base = MAP_FAILED;
+    if (ftruncate(fd, static_cast<off_t>(total)) == 0)
+        base = mmap(nullptr, total, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (base == MAP_FAILED) {
+        error = "cannot size or map " + name + ": " + std::strerror(errno);
+        remove(name);
+        return false;
+    }
+#endif
+    base_ = base;
+    bytes_ = total;
+
+    char* bytes = static_cast<char*>(base);
+    for (size_t t = 0; t < entries.size(); t++) {
+        std::ifstream in(paths[t], std::ios::binary);
+        if (!in.read(bytes + entries[t].offset, static_cast<std::streamsize>(entries[t].bytes))) {
+            error = "cannot read " + paths[t];
+            unmap();
+            remove(name);
+            return false;
+        }
+        tables_.push_back({tables[t], bytes + entries[t].offset, entries[t].bytes, entries[t].modified});
+    }
+    std::memcpy(bytes + sizeof(Header), entries.data(), entries.size() * sizeof(Entry));
+    Header header = {};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.table_count = static_cast<uint32_t>(entries.size());
+    header.total_bytes = total;
+    std::memcpy(header.source, source.data(), source.size());
+    std::memcpy(bytes, &header, sizeof(Header));
+    // Readers check the flag before anything else, so it is set once the rest is visible
+    std::atomic_thread_fence(std::memory_order_release);
+    uint64_t ready = 1;
+    std::memcpy(bytes + offsetof(Header, ready), &ready, sizeof(ready));
+    source_ = source;
+    return true;
+}
+
+bool Segment::attach(const std::string& name, std::string& error) {
+    unmap();
+#ifdef _WIN32
+    HANDLE mapping = OpenFileMappingA(FILE_MAP_READ, FALSE, mappingName(name).c_str());
+    if (!mapping) {
+        error = "no shared dataset named " + name;
+        return false;
+    }
+    void* base = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    MEMORY_BASIC_INFORMATION region = {};
+    if (!base || !VirtualQuery(base, &region, sizeof(region))) {
+        if (base) UnmapViewOfFile(base);
+        CloseHandle(mapping);
+        error = "cannot map " + name;
+        return false;
+    }
+    handle_ = reinterpret_cast<intptr_t>(mapping);
+    uint64_t size = region.RegionSize;
+#else
+    int fd = isPath(name) ? ::open(name.c_str(), O_RDONLY) : shm_open(shmName(name).c_str(), O_RDONLY, 0);
+    if (fd < 0) {
+        error = "no shared dataset named " + name;
+        return false;
+    }
+    struct stat st;
+    void* base = MAP_FAILED;
+    uint64_t size = 0;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        size = static_cast<uint64_t>(st.st_size);
+        base = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    }
+    ::close(fd);
+    if (base == MAP_FAILED) {
+        error = "cannot map " + name;
+        return false;
+    }
+#endif
+    base_ = base;
+    bytes_ = size;
+
+    const char* bytes = static_cast<const char*>(base);
+    Header header;
+    if (size < sizeof(Header)) {
+        error = name + " is not a shared dataset";
+        unmap();
+        return false;
+    }
+    uint64_t ready;
+    std::memcpy(&ready, bytes + offsetof(Header, ready), sizeof(ready));
+    std::atomic_thread_fence(std::memory_order_acquire);
+    std::memcpy(&header, bytes, sizeof(Header));
+    if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION || ready != 1 ||
+        header.total_bytes > size || sizeof(Header) + uint64_t(header.table_count) * sizeof(Entry) > size) {
+        error = name + " is not a complete version " + std::to_string(VERSION) + " shared dataset";
+        unmap();
+        return false;
+    }
+    source_.assign(header.source, strnlen(header.source, SOURCE_BYTES));
+    for (uint32_t t = 0; t < header.table_count; t++) {
+        Entry entry;
+        std::memcpy(&entry, bytes + sizeof(Header) + t * sizeof(Entry), sizeof(Entry));
+        if (entry.offset > header.total_bytes || entry.bytes > header.total_bytes - entry.offset) {
+            error = name + " has a corrupt table directory";
+            unmap();
+            return false;
+        }
+        tables_.push_back({std::string(entry.name, strnlen(entry.name, NAME_BYTES)), bytes + entry.offset,
+                           entry.bytes, entry.modified});
+    }
+    return true;
+}
+
+const TableImage* Segment::find(const std::string& table_path, const std::string& table) const {
+    if (canonicalDirectory(table_path) != source_) return nullptr;
+    for (const auto& image : tables_) {
+        if (image.name != table) continue;
+        // A regenerated .col file makes the image stale
+        std::string path = source_ + "/" + table + ".col";
+        std::error_code ec;
+        if (std::filesystem::exists(path, ec) && modifiedTime(path) != image.modified) return nullptr;
+        return &image;
+    }
+    return nullptr;
+}
+
+bool remove(const std::string& name) {
+#ifdef _WIN32
+    (void)name;
+    return true;
+#else
+    return isPath(name) ? ::unlink(name.c_str()) == 0 : shm_unlink(shmName(name).c_str()) == 0;
+#endif
+}
+
+bool persistsAfterExit() {
+#ifdef _WIN32
+    return false;
+#else
+    return true;
+#endif
+}
+
+bool attach(const std::string& name, std::string& error) {
+    auto segment = std::make_unique<Segment>();
+    if (!segment->attach(name, error)) return false;
+    processSegment() = std::move(segment);
+    return true;
+}
+
+const Segment* attached() {
+    return processSegment().get();
+}
+
+}
@@ -0,0 +1,421 @@
+#include "../include/statistics.hpp"
+#include "../include/json.hpp"
+#include "../include/fastparse.hpp"
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <thread>
+#include <unordered_map>
+
+namespace Statistics {
+
+namespace {
+uint64_t mix(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xBF58476D1CE4E5B9ULL;
+    x ^= x >> 27;
+    x *= 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+uint64_t hashValue(std::string_view value) {
+    uint64_t hash = 1469598103934665603ULL;
+    for (unsigned char c : value) hash = (hash ^ c) * 1099511628211ULL;
+    return mix(hash);
+}
+
+int leadingZeros(uint64_t x) {
+    int count = 0;
+    for (uint64_t bit = uint64_t(1) << 63; bit && !(x & bit); bit >>= 1) count++;
+    return count;
+}
+
+bool parseNumber(std::string_view value, double& number) {
+    if (value.empty() || value.size() > 64) return false;
+    char buffer[65];
+    std::memcpy(buffer, value.data(), value.size());
+    buffer[value.size()] = '\0';
+    char* end = nullptr;
+    number = std::strtod(buffer, &end);
+    return end == buffer + value.size() && std::isfinite(number);
+}
+
+// Position of a string on a number line that keeps its order, from its first
+// 8 bytes, for interpolating inside a histogram bucket of strings
+double stringPosition(const std::string& value) {
+    double position = 0;
+    for (size_t i = 0; i < 8; i++) position = position * 256 + (i < value.size() ? static_cast<unsigned char>(value[i]) : 0);
+    return position;
+}
+
+std::string hex(uint64_t value) {
+    char buffer[17];
+    std::snprintf(buffer, sizeof(buffer), "%016llx", static_cast<unsigned long long>(value));
+    return buffer;
+}
+
+// Inverse of hex() (and of the register digits): false unless `text` is
+// nothing but hex digits that fit `value`
+template <typename T>
+bool parseHex(std::string_view text, T& value) {
+    const char* end = text.data() + text.size();
+    auto [last, error] = std::from_chars(text.data(), end, value, 16);
+    return !text.empty() && error == std::errc() && last == end;
+}
+
+// Exact (17 digits) for the saved state, shortest usual form (15) for display
+std::string number(double value, int digits = 17) {
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%.*g", digits, value);
+    return buffer;
+}
+}
+
+void ColumnStats::add(std::string_view value, uint64_t position) {
+    rows++;
+    if (value.empty()) {
+        nulls++;
+        return;
+    }
+    bool first = rows - nulls == 1;
+    if (first || value < min_text) min_text = value;
+    if (first || value > max_text) max_text = value;
+    double parsed = 0;
+    if (numeric && parseNumber(value, parsed)) {
+        if (first || parsed < min_number) min_number = parsed;
+        if (first || parsed > max_number) max_number = parsed;
+    } else {
+        numeric = false;
+    }
+
+    uint64_t hash = hashValue(value);
+    uint64_t rest = hash << HLL_BITS;
+    uint8_t rank = static_cast<uint8_t>(rest == 0 ? 64 - HLL_BITS + 1 : leadingZeros(rest) + 1);
+    uint8_t& reg = registers[hash >> (64 - HLL_BITS)];
+    reg = std::max(reg, rank);
+
+    // Bottom-k sample on a hash of the row position
+    uint64_t key = mix(position * 0x9E3779B97F4A7C15ULL + hashValue(name));
+    if (sample.size() < SAMPLE_SIZE) {
+        sample.emplace_back(key, std::string(value));
+        std::push_heap(sample.begin(), sample.end());
+    } else if (key < sample.front().first) {
+        std::pop_heap(sample.begin(), sample.end());
+        sample.back() = {key, std::string(value)};
+        std::push_heap(sample.begin(), sample.end());
+    }
+}
+
+void ColumnStats::summarize() {
+    histogram.clear();
+    most_common.clear();
+    if (rows == nulls) {
+        min.clear();
+        max.clear();
+        return;
+    }
+    min = numeric ? number(min_number, 15) : min_text;
+    max = numeric ? number(max_number, 15) : max_text;
+
+    std::vector<std::pair<double, std::string>> values;
+    values.reserve(sample.size());
+    for (const auto& [key, value] : sample) {
+        double parsed = 0;
+        if (numeric) parseNumber(value, parsed);
+        values.emplace_back(parsed, value);
+    }
+    if (numeric) std::sort(values.begin(), values.end());
+    else std::sort(values.begin(), values.end(), [](const auto& a, const auto& b) { return a.second < b.second; });
+
+    const uint64_t present = rows - nulls;
+    const size_t n = values.size();
+    const size_t buckets = std::min(HISTOGRAM_BUCKETS, n);
+    size_t start = 0;
+    for (size_t b = 0; b < buckets; b++) {
+        size_t end = (b + 1) * n / buckets;
+        if (end <= start) continue;
+        // A run of equal values stays in one bucket
+        while (end < n && values[end].second == values[end - 1].second) end++;
+        uint64_t bucket_rows = static_cast<uint64_t>(std::llround(double(end - start) * present / n));
+        histogram.push_back({values[end - 1].second, bucket_rows});
+        start = end;
+        if (start == n) break;
+    }
+    if (!histogram.empty()) histogram.back().upper = max;
+
+    // Every value when the sample holds all rows or all distinct values;
+    // otherwise the values sampled clearly more often than the average value
+    // (a few repeats of a key in the sample are noise). Frequencies are
+    // scaled to the table.
+    std::unordered_map<std::string, uint64_t> counts;
+    for (const auto& [parsed, value] : values) counts[value]++;
+    const bool complete = n == present || counts.size() + 0.5 >= distinct();
+    const double min_count = std::max(10.0, 1.5 * n / std::max(1.0, distinct()));
+    std::vector<std::pair<std::string, uint64_t>> frequent;
+    for (const auto& [value, count] : counts) {
+        if (complete || count >= min_count) frequent.emplace_back(value, count);
+    }
+    std::sort(frequent.begin(), frequent.end(), [](const auto& a, const auto& b) {
+        return a.second != b.second ? a.second > b.second : a.first < b.first;
+    });
+    if (frequent.size() > MOST_COMMON_VALUES) frequent.resize(MOST_COMMON_VALUES);
+    for (auto& [value, count] : frequent) {
+        most_common.emplace_back(value, static_cast<uint64_t>(std::llround(double(count) * present / n)));
+    }
+}
+
+double ColumnStats::distinct() const {
+    const double m = static_cast<double>(registers.size());
+    double sum = 0;
+    size_t zeros = 0;
+    for (uint8_t reg : registers) {
+        sum += std::ldexp(1.0, -reg);
+        if (reg == 0) zeros++;
+    }
+    double estimate = 0.7213 / (1 + 1.079 / m) * m * m / sum;
+    if (estimate <= 2.5 * m && zeros > 0) estimate = m * std::log(m / zeros);
+    return std::min(estimate, static_cast<double>(rows - nulls));
+}
+
+double ColumnStats::equalSelectivity(const std::string& value) const {
+    if (rows == 0 || rows == nulls) return 0;
+    double parsed = 0;
+    if (numeric && parseNumber(value, parsed) ? (parsed < min_number || parsed > max_number)
+                                              : (!numeric && (value < min_text || value > max_text))) {
+        return 0;
+    }
+    double common_rows = 0;
+    for (const auto& [common, common_count] : most_common) {
+        if (common == value) return double(common_count) / rows;
+        common_rows += common_count;
+    }
+    double other_rows = std::max(0.0, double(rows - nulls) - common_rows);
+    double other_values = std::max(1.0, distinct() - most_common.size());
+    return other_rows / other_values / rows;
+}
+
+double ColumnStats::rangeSelectivity(const std::string& low, const std::string& high) const {
+    if (rows == 0 || histogram.empty()) return 0;
+    // Dates interpolate by day number, other strings by their leading bytes
+    int32_t min_day = 0, max_day = 0;
+    const bool dates = !numeric && FastParse::parseDate(min, min_day) && FastParse::parseDate(max, max_day);
+    auto position = [this, dates](const std::string& value) {
+        double parsed = 0;
+        if (numeric) return parseNumber(value, parsed) ? parsed : 0.0;
+        int32_t day = 0;
+        if (dates && FastParse::parseDate(value, day)) return static_cast<double>(day);
+        return stringPosition(value);
+    };
+    auto less = [&](const std::string& a, const std::string& b) {
+        return numeric ? position(a) < position(b) : a < b;
+    };
+    // Estimated rows with a value below x
+    auto below = [&](const std::string& x) {
+        double total = 0;
+        std::string lower = min;
+        for (const auto& bucket : histogram) {
+            if (!less(lower, x)) break;
+            if (less(bucket.upper, x)) {
+                total += bucket.rows;
+            } else {
+                double span = position(bucket.upper) - position(lower);
+                double fraction = span > 0 ? (position(x) - position(lower)) / span : 0.5;
+                total += bucket.rows * std::clamp(fraction, 0.0, 1.0);
+                break;
+            }
+            lower = bucket.upper;
+        }
+        return total;
+    };
+    return std::max(0.0, below(high) - below(low)) / rows;
+}
+
+TableStats::TableStats(const std::string& table, const std::vector<std::string>& columns) : table(table) {
+    for (const auto& column : columns) {
+        ColumnStats stats;
+        stats.name = column;
+        this->columns.push_back(std::move(stats));
+    }
+}
+
+const ColumnStats* TableStats::find(const std::string& column) const {
+    for (const auto& stats : columns)
+        if (stats.name == column) return &stats;
+    return nullptr;
+}
+
+namespace {
+// Runs `work(c)` for every column c on up to `threads` threads
+template <typename Work>
+void forEachColumn(size_t columns, int threads, Work work) {
+    std::atomic<size_t> next{0};
+    auto worker = [&] {
+        for (size_t c = next++; c < columns; c = next++) work(c);
+    };
+    std::vector<std::thread> pool;
+    size_t count = std::min<size_t>(std::max(threads, 1), columns);
+    for (size_t t = 1; t < count; t++) pool.emplace_back(worker);
+    worker();
+    for (auto& t : pool) t.join();
+}
+}
+
+void TableStats::appendRowGroup(const std::vector<std::string>& fields, size_t count, int threads) {
+    const size_t num_columns = columns.size();
+    forEachColumn(num_columns, threads, [&](size_t c) {
+        for (size_t r = 0; r < count; r++) columns[c].add(fields[r * num_columns + c], rows + r);
+        columns[c].summarize();
+    });
+    rows += count;
+}
+
+void TableStats::append(const std::vector<std::map<std::string, std::string>>& table, int threads) {
+    forEachColumn(columns.size(), threads, [&](size_t c) {
+        ColumnStats& stats = columns[c];
+        for (size_t r = 0; r < table.size(); r++) {
+            auto it = table[r].find(stats.name);
+            stats.add(it == table[r].end() ? std::string_view() : std::string_view(it->second), rows + r);
+        }
+        stats.summarize();
+    });
+    rows += table.size();
+}
+
+TableStats collect(const std::string& name, const std::vector<std::string>& columns,
+                   const std::vector<std::map<std::string, std::string>>& table, int threads) {
+    TableStats stats(name, columns);
+    stats.append(table, threads);
+    return stats;
+}
+
+bool writeStats(const std::string& path, const TableStats& stats) {
+    std::ostringstream out;
+    out << "{\n  \"version\": " << VERSION << ",\n  \"table\": " << jsonQuote(stats.table)
+        << ",\n  \"rows\": " << stats.rows << ",\n  \"columns\": [";
+    for (size_t c = 0; c < stats.columns.size(); c++) {
+        const ColumnStats& column = stats.columns[c];
+        out << (c ? ",\n" : "\n") << "    {\"name\": " << jsonQuote(column.name) << ", \"rows\": " << column.rows
+            << ", \"nulls\": " << column.nulls << ", \"numeric\": " << (column.numeric ? "true" : "false")
+            << ", \"min\": " << jsonQuote(column.min) << ", \"max\": " << jsonQuote(column.max)
+            << ", \"distinct\": " << std::llround(column.distinct()) << ",\n     \"histogram\": [";
+        for (size_t b = 0; b < column.histogram.size(); b++) {
+            out << (b ? ", " : "") << "{\"upper\": " << jsonQuote(column.histogram[b].upper)
+                << ", \"rows\": " << column.histogram[b].rows << "}";
+        }
+        out << "],\n     \"most_common\": [";
+        for (size_t v = 0; v < column.most_common.size(); v++) {
+            out << (v ? ", " : "") << "{\"value\": " << jsonQuote(column.most_common[v].first)
+                << ", \"rows\": " << column.most_common[v].second << "}";
+        }
+        // What appends and the summaries above are computed from
+        out << "],\n     \"state\": {\"min_text\": " << jsonQuote(column.min_text)
+            << ", \"max_text\": " << jsonQuote(column.max_text) << ", \"min_number\": " << number(column.min_number)
+            << ", \"max_number\": " << number(column.max_number) << ",\n       \"registers\": \"";
+        static const char* DIGITS = "0123456789abcdef";
+        for (uint8_t reg : column.registers) out << DIGITS[reg >> 4] << DIGITS[reg & 15];
+        out << "\",\n       \"sample\": [";
+        for (size_t i = 0; i < column.sample.size(); i++) {
+            out << (i ? ", " : "") << "[\"" << hex(column.sample[i].first) << "\", "
+                << jsonQuote(column.sample[i].second) << "]";
+        }
+        out << "]}}";
+    }
+    out << "\n  ]\n}\n";
+
+    // Renamed into place like the bitmap indexes, so readers never see a partial file
+    std::string temporary = path + "." + std::to_string(std::random_device()()) + ".tmp";
+    {
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+        const std::string text = out.str();
+        if (!file.write(text.data(), text.size())) return false;
+    }
+    std::remove(path.c_str());
+    if (std::rename(temporary.c_str(), path.c_str()) != 0) {
+        std::remove(temporary.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool readStats(const std::string& path, TableStats& stats) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) return false;
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    JsonValue document;
+    if (!parseJson(buffer.str(), document)) return false;
+    const JsonValue* version = document.find("version");
+    const JsonValue* table = document.find("table");
+    const JsonValue* rows = document.find("rows");
+    const JsonValue* columns = document.find("columns");
+    if (!version || version->number != VERSION || !table || !rows || !columns || columns->type != JsonValue::ARRAY)
+        return false;
+
+    TableStats loaded;
+    loaded.table = table->string;
+    loaded.rows = static_cast<uint64_t>(rows->number);
+    for (const auto& entry : columns->array) {
+        const JsonValue* name = entry.find("name");
+        const JsonValue* column_rows = entry.find("rows");
+        const JsonValue* nulls = entry.find("nulls");
+        const JsonValue* numeric = entry.find("numeric");
+        const JsonValue* state = entry.find("state");
+        if (!name || !column_rows || !nulls || !numeric || !state) return false;
+        const JsonValue* min_text = state->find("min_text");
+        const JsonValue* max_text = state->find("max_text");
+        const JsonValue* min_number = state->find("min_number");
+        const JsonValue* max_number = state->find("max_number");
+        const JsonValue* registers = state->find("registers");
+        const JsonValue* sample = state->find("sample");
+        if (!min_text || !max_text || !min_number || !max_number || !registers || !sample ||
+            sample->type != JsonValue::ARRAY || registers->string.size() != (size_t(2) << HLL_BITS)) {
+            return false;
+        }
+        ColumnStats column;
+        column.name = name->string;
+        column.rows = static_cast<uint64_t>(column_rows->number);
+        column.nulls = static_cast<uint64_t>(nulls->number);
+        column.numeric = numeric->boolean;
+        column.min_text = min_text->string;
+        column.max_text = max_text->string;
+        column.min_number = min_number->number;
+        column.max_number = max_number->number;
+        for (size_t i = 0; i < column.registers.size(); i++) {
+            if (!parseHex(std::string_view(registers->string).substr(2 * i, 2), column.registers[i])) return false;
+        }
+        for (const auto& item : sample->array) {
+            uint64_t hash = 0;
+            if (item.type != JsonValue::ARRAY || item.array.size() != 2 || !parseHex(item.array[0].string, hash))
+                return false;
+            column.sample.emplace_back(hash, item.array[1].string);
+        }
+        std::make_heap(column.sample.begin(), column.sample.end());
+        column.summarize();
+        loaded.columns.push_back(std::move(column));
+    }
+    stats = std::move(loaded);
+    return true;
+}
+
+const TableStats* Catalog::table(const std::string& name) const {
+    auto it = tables.find(name);
+    return it == tables.end() ? nullptr : &it->second;
+}
+
+const ColumnStats* Catalog::column(const std::string& table_name, const std::string& column) const {
+    const TableStats* stats = table(table_name);
+    return stats ? stats->find(column) : nullptr;
+}
+
+double joinRows(double left_rows, const ColumnStats& left, double right_rows, const ColumnStats& right) {
+    return left_rows * right_rows / std::max({1.0, left.distinct(), right.distinct()});
+}
+
+}
@@ -0,0 +1,111 @@
+#include "../include/trace.hpp"
+#include "../include/json.hpp"
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <vector>
+
+namespace Tracing {
+
+std::atomic<bool> tracing_enabled{true};
+
+namespace {
+std::mutex registry_mutex;
+std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+std::vector<ThreadBuffer*> free_buffers;
+std::set<std::string> interned;
+
+// Reference point to convert clock ticks to microseconds at export time
+const uint64_t start_ticks = readClock();
+const auto start_time = std::chrono::steady_clock::now();
+
+// Returns the buffer to the free list when its thread exits
+struct BufferHandle {
+    ThreadBuffer* buffer = nullptr;
+    ~BufferHandle() {
+        if (!buffer) return;
+        std::lock_guard<std::mutex> lock(registry_mutex);
+        free_buffers.push_back(buffer);
+    }
+};
+
+thread_local BufferHandle thread_handle;
+
+ThreadBuffer* acquireBuffer() {
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    if (!free_buffers.empty()) {
+        ThreadBuffer* buffer = free_buffers.back();
+        free_buffers.pop_back();
+        return buffer;
+    }
+    buffers.push_back(std::make_unique<ThreadBuffer>());
+    buffers.back()->lane = static_cast<int>(buffers.size());
+    return buffers.back().get();
+}
+}
+
+ThreadBuffer* threadBuffer() {
+    if (!thread_handle.buffer) thread_handle.buffer = acquireBuffer();
+    return thread_handle.buffer;
+}
+
+void setEnabled(bool enabled) {
+    tracing_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+void setThreadName(const char* name) {
+    threadBuffer()->thread_name = name;
+}
+
+const char* intern(const std::string& str) {
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    return interned.insert(str).first->c_str();
+}
+
+bool writeChromeTrace(const std::string& path) {
+    std::ofstream out(path);
+    if (!out.is_open()) return false;
+
+    uint64_t end_ticks = readClock();
+    auto end_time = std::chrono::steady_clock::now();
+    double elapsed_us = std::chrono::duration<double, std::micro>(end_time - start_time).count();
+    double us_per_tick = end_ticks > start_ticks ? elapsed_us / (end_ticks - start_ticks) : 0.0;
+
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    out << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [";
+    bool first = true;
+    for (const auto& buffer : buffers) {
+        out << (first ? "\n" : ",\n");
+        first = false;
+        out << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << buffer->lane
+            << ", \"args\": {\"name\": " << jsonQuote(buffer->thread_name) << "}}";
+
+        uint64_t head = buffer->head.load(std::memory_order_acquire);
+        uint64_t first_event = head > BUFFER_EVENTS ? head - BUFFER_EVENTS : 0;
+        // After a wrap-around the oldest begin events are gone: drop the
+        // end events they would have matched
+        int depth = 0;
+        for (uint64_t i = first_event; i < head; i++) {
+            const Event& event = buffer->events[i & (BUFFER_EVENTS - 1)];
+            if (event.phase == 'B') depth++;
+            if (event.phase == 'E' && depth-- == 0) {
+                depth = 0;
+                continue;
+            }
+            double ts = (event.tsc - start_ticks) * us_per_tick;
+            out << ",\n{\"name\": " << jsonQuote(event.name)
+                << ", \"cat\": " << jsonQuote(event.category)
+                << ", \"ph\": \"" << event.phase << "\"";
+            if (event.phase == 'i') out << ", \"s\": \"t\"";
+            out << ", \"ts\": " << std::fixed << ts << std::defaultfloat
+                << ", \"pid\": 1, \"tid\": " << buffer->lane;
+            if (event.arg != 0) out << ", \"args\": {\"count\": " << event.arg << "}";
+            out << "}";
+        }
+    }
+    out << "\n]}\n";
+    return out.good();
+}
+
+}
@@ -0,0 +1,133 @@
+#include "../include/validation.hpp"
+#include "../include/utilities.hpp"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+
+namespace Validation {
+
+namespace {
+struct BuiltinAnswer {
+    const char* query;
+    double scale_factor;
+    std::vector<std::pair<const char*, const char*>> rows;
+};
+
+// Answer set shipped with the TPC-H specification (dbgen data, validation parameters)
+const std::vector<BuiltinAnswer>& builtinAnswers() {
+    static const std::vector<BuiltinAnswer> answers = {
+        {"q5", 1.0, {{"INDONESIA", "55502041.1697"},
+                     {"VIETNAM", "55295086.9967"},
+                     {"CHINA", "53724494.2566"},
+                     {"INDIA", "52035512.0002"},
+                     {"JAPAN", "45410175.6954"}}},
+    };
+    return answers;
+}
+}
+
+bool parseDecimal(const std::string& text, int64_t& value) {
+    std::string digits = trim(text);
+    bool negative = !digits.empty() && digits[0] == '-';
+    if (negative || (!digits.empty() && digits[0] == '+')) digits.erase(0, 1);
+
+    int64_t result = 0;
+    int fraction_digits = -1;        // -1 until the decimal point
+    bool any = false, round_up = false;
+    for (size_t i = 0; i < digits.size(); i++) {
+        char c = digits[i];
+        if (c == '.' && fraction_digits < 0) {
+            fraction_digits = 0;
+            continue;
+        }
+        if (c < '0' || c > '9') return false;
+        any = true;
+        if (fraction_digits >= DECIMAL_DIGITS) {
+            // First dropped digit decides the rounding
+            if (fraction_digits++ == DECIMAL_DIGITS) round_up = c >= '5';
+            continue;
+        }
+        if (result > (INT64_MAX - 9) / 10) return false;
+        result = result * 10 + (c - '0');
+        if (fraction_digits >= 0) fraction_digits++;
+    }
+    if (!any) return false;
+    for (int d = std::max(fraction_digits, 0); d < DECIMAL_DIGITS; d++) result *= 10;
+    if (round_up) result++;
+    value = negative ? -result : result;
+    return true;
+}
+
+std::string formatDecimal(int64_t value) {
+    std::string sign = value < 0 ? "-" : "";
+    uint64_t magnitude = value < 0 ? -static_cast<uint64_t>(value) : value;
+    std::string fraction = std::to_string(magnitude % 10000);
+    fraction.insert(0, DECIMAL_DIGITS - fraction.size(), '0');
+    return sign + std::to_string(magnitude / 10000) + "." + fraction;
+}
+
+Answer fromResults(const std::map<std::string, double>& results) {
+    Answer answer;
+    for (const auto& [name, revenue] : results)
+        answer.rows.emplace_back(name, std::llround(revenue * 10000.0));
+    std::stable_sort(answer.rows.begin(), answer.rows.end(),
+                     [](const auto& a, const auto& b) { return a.second > b.second; });
+    return answer;
+}
+
+bool readAnswer(const std::string& path, Answer& answer) {
+    std::ifstream file(path);
+    if (!file.is_open()) return false;
+    answer.rows.clear();
+    std::string line;
+    bool header = true;
+    while (std::getline(file, line)) {
+        if (trim(line).empty()) continue;
+        std::vector<std::string> fields = split(line, '|');
+        if (fields.size() < 2) return false;
+        int64_t revenue;
+        if (!parseDecimal(fields[1], revenue)) {
+            // Only the first line may be a header
+            if (!header) return false;
+            header = false;
+            continue;
+        }
+        header = false;
+        answer.rows.emplace_back(trim(fields[0]), revenue);
+    }
+    return true;
+}
+
+bool builtinAnswer(const std::string& query, double scale_factor, Answer& answer) {
+    for (const auto& builtin : builtinAnswers()) {
+        if (query != builtin.query || std::fabs(scale_factor - builtin.scale_factor) > 1e-9) continue;
+        answer.rows.clear();
+        for (const auto& [name, revenue] : builtin.rows) {
+            int64_t value;
+            if (!parseDecimal(revenue, value)) return false;
+            answer.rows.emplace_back(name, value);
+        }
+        return true;
+    }
+    return false;
+}
+
+std::vector<std::string> compare(const Answer& expected, const Answer& actual) {
+    std::vector<std::string> mismatches;
+    if (expected.rows.size() != actual.rows.size()) {
+        mismatches.push_back("expected " + std::to_string(expected.rows.size()) + " rows, got " +
+                             std::to_string(actual.rows.size()));
+    }
+    size_t rows = std::max(expected.rows.size(), actual.rows.size());
+    for (size_t i = 0; i < rows; i++) {
+        std::string want = i < expected.rows.size()
+            ? expected.rows[i].first + "|" + formatDecimal(expected.rows[i].second) : "(none)";
+        std::string got = i < actual.rows.size()
+            ? actual.rows[i].first + "|" + formatDecimal(actual.rows[i].second) : "(none)";
+        if (want != got)
+            mismatches.push_back("row " + std::to_string(i + 1) + ": expected " + want + ", got " + got);
+    }
+    return mismatches;
+}
+
+}
@@ -0,0 +1,40 @@
+#ifndef TESTS_CHECK_HPP
+#define TESTS_CHECK_HPP
+
+#include <iostream>
+
+// Minimal assertions for the test executables: a failed CHECK reports the
+// expression and location and the executable exits with status 1 at the end.
+
+namespace Check {
+inline int failures = 0;
+}
+
+#define CHECK(condition)                                                                            \
+    do {                                                                                            \
+        if (!(condition)) {                                                                         \
+            Check::failures++;                                                                      \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": CHECK(" #condition ") failed" << std::endl; \
+        }                                                                                           \
+    } while (0)
+
+// Like CHECK, naming the case (e.g. the encoding or truncation length) that failed
+#define CHECK_CASE(condition, what)                                                                \
+    do {                                                                                            \
+        if (!(condition)) {                                                                         \
+            Check::failures++;                                                                      \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": CHECK(" #condition ") failed for " << what \
+                      << std::endl;                                                                 \
+        }                                                                                           \
+    } while (0)
+
+inline int checkResult(const char* name) {
+    if (Check::failures) {
+        std::cerr << name << ": " << Check::failures << " check(s) failed" << std::endl;
+        return 1;
+    }
+    std::cout << name << ": all checks passed" << std::endl;
+    return 0;
+}
+
+#endif // TESTS_CHECK_HPP
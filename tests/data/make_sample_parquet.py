@@ -0,0 +1,35 @@
+#!/usr/bin/env python3
+# Regenerates sample.parquet, the Parquet fixture of test_formats. The reader
+# has no writer to round-trip through, so the file comes from pyarrow; the
+# test rebuilds the same rows with the formulas below and compares.
+#
+#   python3 make_sample_parquet.py   (needs pyarrow)
+
+import datetime
+import decimal
+import os
+
+import pyarrow as pa
+import pyarrow.parquet as pq
+
+ROWS = 1000
+
+keys = [r + 1 for r in range(ROWS)]
+names = ["Supplier#%03d" % (r % 7) for r in range(ROWS)]
+prices = [decimal.Decimal(r * 137 % 100000).scaleb(-2) for r in range(ROWS)]
+dates = [datetime.date(1992, 1, 1) + datetime.timedelta(days=r) for r in range(ROWS)]
+comments = [None if r % 5 == 0 else "comment %d" % r for r in range(ROWS)]
+
+table = pa.table({
+    "K": pa.array(keys, pa.int64()),
+    "NAME": pa.array(names, pa.string()),
+    "PRICE": pa.array(prices, pa.decimal128(12, 2)),
+    "SHIPDATE": pa.array(dates, pa.date32()),
+    "COMMENT": pa.array(comments, pa.string()),
+})
+schema = pa.schema([table.schema.field(i).with_nullable(i == 4) for i in range(5)])
+table = table.cast(schema)
+
+pq.write_table(table, os.path.join(os.path.dirname(os.path.abspath(__file__)), "sample.parquet"),
+               row_group_size=400, compression="NONE", use_dictionary=["NAME", "COMMENT"],
+               data_page_version="1.0")
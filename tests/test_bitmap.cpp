@@ -0,0 +1,79 @@
+// WHERE_IN through a bitmap index against the row-at-a-time fallback, on
+// views whose selections are unsorted or repeat rows, and bitmap index files
+// holding positions past the table, which read() must reject.
+
+#include "../include/bitmap.hpp"
+#include "../include/sqlhelper.hpp"
+#include "check.hpp"
+#include <string>
+#include <vector>
+
+using namespace SQLEngine;
+
+namespace {
+
+Table nations(size_t rows) {
+    Table table;
+    const char* names[] = {"ALGERIA", "BRAZIL", "CANADA", "EGYPT", "FRANCE"};
+    for (size_t r = 0; r < rows; r++) table.push_back({{"N", names[r * 7 % 5]}});
+    return table;
+}
+
+std::vector<size_t> positions(const TableView& view) {
+    std::vector<size_t> result;
+    for (size_t i = 0; i < view.size(); i++) result.push_back(view.baseIndex(i));
+    return result;
+}
+
+void checkWhereIn() {
+    // Over one container, so positions span several
+    const Table table = nations(70000);
+    const BitmapIndex index(table, "N");
+    const Table copy = table;
+    const BitmapIndex other_table(copy, "N");   // an index of another table: the fallback
+    const std::vector<std::string> values = {"BRAZIL", "EGYPT", "NOWHERE"};
+
+    std::pmr::vector<size_t> descending;
+    for (size_t r = table.size(); r-- > 0;) descending.push_back(r);
+    std::pmr::vector<size_t> repeated = {5, 3, 5, 69999, 1, 3, 65536, 2};
+    for (const auto& selection : {descending, repeated}) {
+        TableView view(table, selection);
+        TableView indexed = WHERE_IN(view, index, values);
+        TableView scanned = WHERE_IN(view, other_table, values);
+        CHECK(!scanned.empty() && positions(indexed) == positions(scanned));
+    }
+    TableView whole(table);
+    CHECK(positions(WHERE_IN(whole, index, values)) == positions(WHERE_IN(whole, other_table, values)));
+}
+
+void checkRead() {
+    const Table table = nations(1000);
+    const BitmapIndex index(table, "N");
+    std::string bytes;
+    index.write(bytes);
+
+    BitmapIndex read;
+    const char* data = bytes.data();
+    CHECK(read.read(data, bytes.data() + bytes.size(), &table, table.size()) && read.distinctValues() == 5);
+    // The same bitmaps for a shorter table point past its end
+    data = bytes.data();
+    CHECK(!read.read(data, bytes.data() + bytes.size(), &table, 999));
+    data = bytes.data();
+    CHECK(!read.read(data, bytes.data() + bytes.size(), &table, 10));
+
+    RoaringBitmap bitmap;
+    CHECK(bitmap.extent() == 0);
+    bitmap.add(3);
+    bitmap.add(70000);
+    CHECK(bitmap.extent() == 70001);
+    for (uint32_t p = 0; p < 5000; p++) bitmap.add(131072 + p * 3);   // a bitset container
+    CHECK(bitmap.extent() == 131072 + 4999 * 3 + 1);
+}
+
+}
+
+int main() {
+    checkWhereIn();
+    checkRead();
+    return checkResult("test_bitmap");
+}
@@ -0,0 +1,218 @@
+// Round-trips every .col chunk encoding through encodeChunk / decodeChunk /
+// decodeRows, checks the encoded filter and sum kernels against the reference
+// semantics on decoded values, and feeds truncated and corrupted chunks to
+// the decoders.
+
+#include "../include/encoding.hpp"
+#include "check.hpp"
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace Columnar;
+
+namespace {
+
+std::string cents(long long value) {
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "%s%lld.%02lld", value < 0 ? "-" : "", std::llabs(value) / 100, std::llabs(value) % 100);
+    return buf;
+}
+
+struct Case {
+    const char* name;
+    Encoding encoding;   // the encoding encodeChunk must pick; PLAIN for "negative", which is not checked
+    bool numeric;
+    std::vector<std::string> values;
+};
+
+std::vector<Case> cases() {
+    const size_t rows = 3000;
+    std::vector<Case> result;
+
+    Case plain{"PLAIN", Encoding::PLAIN, false, {}};
+    for (size_t r = 0; r < rows; r++) plain.values.push_back("customer " + std::to_string(r * 7919 % 10007) + " note");
+    plain.values[17] = "";
+    result.push_back(plain);
+
+    Case dict{"DICT", Encoding::DICT, false, {}};
+    const char* nations[] = {"ALGERIA", "ARGENTINA", "BRAZIL", "CANADA", "EGYPT", ""};
+    for (size_t r = 0; r < rows; r++) dict.values.push_back(nations[r * r % 6]);
+    result.push_back(dict);
+
+    Case ints{"INT", Encoding::INT, true, {}};
+    for (size_t r = 0; r < rows; r++) ints.values.push_back(cents(static_cast<long long>(r * 7919 % 100000) + 90000));
+    result.push_back(ints);
+
+    Case runs{"RLE", Encoding::RLE, true, {}};
+    for (size_t r = 0; r < rows; r++) runs.values.push_back(std::to_string(100000 + r / 50));
+    result.push_back(runs);
+
+    // Negative decimals round-trip whichever encoding they get
+    Case negative{"negative", Encoding::PLAIN, true, {}};
+    for (size_t r = 0; r < rows; r++) negative.values.push_back(cents(static_cast<long long>(r * 7919 % 100000) - 50000));
+    result.push_back(negative);
+    return result;
+}
+
+std::vector<Filter> filtersFor(const Case& c) {
+    std::vector<Filter> filters;
+    Filter range;
+    range.column = "V";
+    range.low = c.values[10];
+    range.high = c.values[20];
+    if (range.high < range.low) std::swap(range.low, range.high);
+    filters.push_back(range);
+
+    Filter open_low = range;
+    open_low.low.clear();
+    filters.push_back(open_low);
+
+    Filter in;
+    in.column = "V";
+    in.kind = Filter::Kind::IN;
+    in.values = {c.values[3], c.values[1500], "no such value"};
+    filters.push_back(in);
+
+    Filter test;
+    test.column = "V";
+    test.kind = Filter::Kind::TEST;
+    test.test = [](std::string_view v) { return !v.empty() && v.back() == '5'; };
+    filters.push_back(test);
+
+    if (c.numeric) {
+        Filter numeric = range;
+        numeric.numeric = true;
+        numeric.low = "950.5";
+        numeric.high = "1500";
+        filters.push_back(numeric);
+        numeric.low = c.values[0];
+        numeric.high.clear();
+        filters.push_back(numeric);
+    }
+    return filters;
+}
+
+void checkCase(const Case& c) {
+    const uint64_t rows = c.values.size();
+    std::vector<char> chunk;
+    CHECK_CASE(encodeChunk(c.values, 0, 1, rows, chunk), c.name);
+    if (std::strcmp(c.name, "negative") != 0)
+        CHECK_CASE(chunkEncoding(chunk.data(), chunk.size()) == c.encoding, c.name);
+
+    std::vector<std::string> decoded;
+    CHECK_CASE(decodeChunk(chunk.data(), chunk.size(), rows, decoded) && decoded == c.values, c.name);
+
+    std::vector<uint32_t> every_third;
+    std::vector<std::string> expected_rows;
+    for (uint32_t r = 0; r < rows; r += 3) {
+        every_third.push_back(r);
+        expected_rows.push_back(c.values[r]);
+    }
+    decoded.clear();
+    CHECK_CASE(decodeRows(chunk.data(), chunk.size(), rows, every_third, decoded) && decoded == expected_rows, c.name);
+
+    // Encoded filters against Filter::matches, from all rows and from a selection
+    for (const auto& filter : filtersFor(c)) {
+        std::vector<uint32_t> expected_all, expected_some;
+        for (uint32_t r = 0; r < rows; r++) {
+            if (!filter.matches(c.values[r])) continue;
+            expected_all.push_back(r);
+            if (r % 3 == 0) expected_some.push_back(r);
+        }
+        std::vector<uint32_t> selection;
+        CHECK_CASE(filterChunk(chunk.data(), chunk.size(), rows, filter, true, selection) && selection == expected_all,
+                   c.name << " filter on [" << filter.low << ", " << filter.high << ")");
+        selection = every_third;
+        CHECK_CASE(filterChunk(chunk.data(), chunk.size(), rows, filter, false, selection) && selection == expected_some,
+                   c.name << " filter on [" << filter.low << ", " << filter.high << ") of a selection");
+    }
+
+    if (c.numeric) {
+        double expected = 0, expected_some = 0;
+        for (uint32_t r = 0; r < rows; r++) {
+            double v = std::strtod(c.values[r].c_str(), nullptr);
+            expected += v;
+            if (r % 3 == 0) expected_some += v;
+        }
+        double sum = 0, sum_some = 0;
+        CHECK_CASE(sumChunk(chunk.data(), chunk.size(), rows, nullptr, sum), c.name);
+        CHECK_CASE(std::fabs(sum - expected) <= 1e-9 * std::fabs(expected), c.name << " sum " << sum);
+        CHECK_CASE(sumChunk(chunk.data(), chunk.size(), rows, &every_third, sum_some), c.name);
+        CHECK_CASE(std::fabs(sum_some - expected_some) <= 1e-9 * std::fabs(expected_some), c.name << " sum " << sum_some);
+    }
+
+    // Every truncation is rejected, not read past the end
+    for (uint64_t bytes = 0; bytes < chunk.size(); bytes++) {
+        std::vector<char> truncated(chunk.begin(), chunk.begin() + static_cast<std::ptrdiff_t>(bytes));
+        decoded.clear();
+        CHECK_CASE(!decodeChunk(truncated.data(), bytes, rows, decoded), c.name << " truncated to " << bytes);
+    }
+    // So is a row count the chunk does not hold
+    decoded.clear();
+    CHECK_CASE(!decodeChunk(chunk.data(), chunk.size(), rows + 1000, decoded), c.name << " with extra rows");
+    CHECK_CASE(!decodeRows(chunk.data(), chunk.size(), rows, {static_cast<uint32_t>(rows)}, decoded),
+               c.name << " selecting past the end");
+}
+
+// Damaged section headers: bit widths over 64, offsets past the data,
+// dictionaries larger than the chunk, runs that do not cover the rows
+void checkCorrupt() {
+    auto header = [](std::vector<char>& chunk, size_t word) -> char* { return chunk.data() + word * sizeof(uint32_t); };
+    auto put = [](char* p, uint32_t value) { std::memcpy(p, &value, sizeof(value)); };
+    std::vector<std::string> decoded;
+    for (const auto& c : cases()) {
+        const uint64_t rows = c.values.size();
+        std::vector<char> chunk;
+        encodeChunk(c.values, 0, 1, rows, chunk);
+        std::vector<char> bad = chunk;
+        switch (chunkEncoding(chunk.data(), chunk.size())) {
+        case Encoding::PLAIN:
+            put(header(bad, 1 + rows), UINT32_MAX);   // last offset far past the data
+            break;
+        case Encoding::DICT:
+            put(header(bad, 1), UINT32_MAX);   // entry count
+            break;
+        case Encoding::INT:
+            put(header(bad, 2), 65);   // bit width
+            break;
+        case Encoding::RLE:
+            put(header(bad, 5), UINT32_MAX);   // run count
+            break;
+        }
+        decoded.clear();
+        CHECK_CASE(!decodeChunk(bad.data(), bad.size(), rows, decoded), c.name << " with a damaged header");
+        double sum = 0;
+        CHECK_CASE(!sumChunk(bad.data(), bad.size(), rows, nullptr, sum), c.name << " summed with a damaged header");
+    }
+}
+
+// A chunk holding several columns picks each column's encoding independently
+void checkStride() {
+    std::vector<std::string> fields;
+    const size_t rows = 500;
+    for (size_t r = 0; r < rows; r++) {
+        fields.push_back(std::to_string(r));
+        fields.push_back(r % 2 ? "odd" : "even");
+    }
+    for (size_t column = 0; column < 2; column++) {
+        std::vector<char> chunk;
+        CHECK(encodeChunk(fields, column, 2, rows, chunk));
+        std::vector<std::string> decoded;
+        CHECK(decodeChunk(chunk.data(), chunk.size(), rows, decoded));
+        bool same = decoded.size() == rows;
+        for (size_t r = 0; same && r < rows; r++) same = decoded[r] == fields[r * 2 + column];
+        CHECK_CASE(same, "column " << column);
+    }
+}
+
+}
+
+int main() {
+    for (const auto& c : cases()) checkCase(c);
+    checkCorrupt();
+    checkStride();
+    return checkResult("test_encoding");
+}
@@ -0,0 +1,308 @@
+// Write / read round-trips of .col and .arrow tables, reads of the Parquet
+// fixture (tests/data/sample.parquet, see make_sample_parquet.py) against the
+// rows it was written from, and truncated or damaged copies of each format,
+// which every reader must reject instead of returning rows.
+//
+//   test_formats <tests/data directory>
+
+#include "../include/arrow.hpp"
+#include "../include/buffer.hpp"
+#include "../include/columnar.hpp"
+#include "../include/fastparse.hpp"
+#include "../include/parquet.hpp"
+#include "check.hpp"
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace {
+
+using Row = std::map<std::string, std::string>;
+using Table = std::vector<Row>;
+
+std::string temp_dir;
+
+std::string tempPath(const std::string& name) {
+    return temp_dir + "/" + name;
+}
+
+std::string cents(long long value) {
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "%lld.%02lld", value / 100, value % 100);
+    return buf;
+}
+
+std::string date(int32_t days) {
+    int32_t year = 0;
+    uint32_t month = 0, day = 0;
+    FastParse::civilFromDays(days, year, month, day);
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "%04d-%02u-%02u", year, month, day);
+    return buf;
+}
+
+const std::vector<std::string> COLUMNS = {"K", "NAME", "PRICE", "SHIPDATE", "COMMENT"};
+
+// The rows of sample.parquet; the .col and .arrow round-trips use them too
+Table sampleRows(size_t rows) {
+    Table table;
+    const int32_t start = FastParse::daysFromCivil(1992, 1, 1);
+    for (size_t r = 0; r < rows; r++) {
+        Row row;
+        row["K"] = std::to_string(r + 1);
+        char name[32];
+        std::snprintf(name, sizeof(name), "Supplier#%03zu", r % 7);
+        row["NAME"] = name;
+        row["PRICE"] = cents(static_cast<long long>(r * 137 % 100000));
+        row["SHIPDATE"] = date(start + static_cast<int32_t>(r));
+        row["COMMENT"] = r % 5 == 0 ? "" : "comment " + std::to_string(r);
+        table.push_back(std::move(row));
+    }
+    return table;
+}
+
+Table filtered(const Table& table, const std::vector<Columnar::Filter>& filters) {
+    Table result;
+    for (const auto& row : table) {
+        bool keep = true;
+        for (const auto& filter : filters) keep = keep && filter.matches(row.at(filter.column));
+        if (keep) result.push_back(row);
+    }
+    return result;
+}
+
+std::vector<Columnar::Filter> sampleFilters() {
+    Columnar::Filter dates;
+    dates.column = "SHIPDATE";
+    dates.low = "1992-06-01";
+    dates.high = "1993-01-01";
+    Columnar::Filter names;
+    names.column = "NAME";
+    names.kind = Columnar::Filter::Kind::IN;
+    names.values = {"Supplier#002", "Supplier#005"};
+    Columnar::Filter price;
+    price.column = "PRICE";
+    price.numeric = true;
+    price.low = "100";
+    return {dates, names, price};
+}
+
+std::string readFile(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+void writeFile(const std::string& path, const std::string& bytes) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+}
+
+// Truncations (a spread of lengths, always including the last byte) and a
+// copy with a block cut out of the middle, so the trailer is intact but the
+// offsets it holds are stale
+std::vector<std::pair<std::string, std::string>> damagedCopies(const std::string& bytes) {
+    std::vector<std::pair<std::string, std::string>> copies;
+    for (size_t length : {size_t(0), size_t(1), size_t(7), size_t(16), bytes.size() / 3, bytes.size() / 2,
+                          bytes.size() - 10, bytes.size() - 1}) {
+        if (length < bytes.size()) copies.emplace_back("truncated to " + std::to_string(length), bytes.substr(0, length));
+    }
+    size_t cut = bytes.size() / 2;
+    copies.emplace_back("cut in the middle", bytes.substr(0, cut) + bytes.substr(cut + 100));
+    return copies;
+}
+
+void checkColumnar() {
+    const Table table = sampleRows(2500);
+    const std::string path = tempPath("sample.col");
+    CHECK(Columnar::writeTable(path, COLUMNS, table, 1000));
+
+    Table read;
+    CHECK(Columnar::readTable(path, COLUMNS, read) && read == table);
+    read.clear();
+    CHECK(Columnar::readTable(path, COLUMNS, read, sampleFilters()) && read == filtered(table, sampleFilters()));
+
+    // The streaming scanner, through a pool smaller than the file
+    Buffer::Pool pool(64 * 1024, 4096);
+    Columnar::Scanner scanner;
+    CHECK(scanner.open(path, COLUMNS, pool, sampleFilters()));
+    Table scanned, group;
+    while (scanner.next(group)) scanned.insert(scanned.end(), group.begin(), group.end());
+    CHECK(!scanner.failed() && scanned == filtered(table, sampleFilters()));
+
+    // Every truncation of a small file, read from memory
+    const Table small = sampleRows(300);
+    CHECK(Columnar::writeTable(path, COLUMNS, small, 100));
+    const std::string bytes = readFile(path);
+    read.clear();
+    CHECK(Columnar::readTable(bytes.data(), bytes.size(), COLUMNS, read) && read == small);
+    for (size_t length = 0; length < bytes.size(); length++) {
+        read.clear();
+        CHECK_CASE(!Columnar::readTable(bytes.data(), length, COLUMNS, read), ".col truncated to " << length);
+    }
+
+    // Damaged files, through both readers
+    std::string bad_footer = bytes;
+    bad_footer[bad_footer.size() - 9] = '\x7f';   // footer offset past the end
+    auto copies = damagedCopies(bytes);
+    copies.emplace_back("with a bad footer offset", bad_footer);
+    std::string bad_version = bytes;
+    bad_version[8] = '\x09';
+    copies.emplace_back("with an unknown version", bad_version);
+    for (const auto& [what, copy] : copies) {
+        writeFile(path, copy);
+        read.clear();
+        CHECK_CASE(!Columnar::readTable(path, COLUMNS, read), ".col " << what);
+        Columnar::Scanner damaged;
+        bool rejected = !damaged.open(path, COLUMNS, pool);
+        if (!rejected) {
+            while (damaged.next(group)) {}
+            rejected = damaged.failed();
+        }
+        CHECK_CASE(rejected, ".col scanned " << what);
+    }
+    std::filesystem::remove(path);
+}
+
+void checkArrow() {
+    const Table table = sampleRows(2500);
+    const std::string path = tempPath("sample.arrow");
+    CHECK(Arrow::writeTable(path, COLUMNS, table, 1000));
+
+    Table read;
+    CHECK(Arrow::readTable(path, COLUMNS, read) && read == table);
+    read.clear();
+    CHECK(Arrow::readTable(path, COLUMNS, read, sampleFilters()) && read == filtered(table, sampleFilters()));
+
+    // Typed columns: integers, doubles and dates are stored as such, "" is null
+    const std::vector<Arrow::Field> fields = {{"K", Arrow::Type::INT64, false},
+                                              {"PRICE", Arrow::Type::FLOAT64, true},
+                                              {"SHIPDATE", Arrow::Type::DATE32, true},
+                                              {"COMMENT", Arrow::Type::UTF8, true}};
+    std::vector<std::string> batch_fields;
+    for (size_t r = 0; r < 100; r++) {
+        const Row& row = table[r];
+        batch_fields.push_back(row.at("K"));
+        batch_fields.push_back(r % 9 == 0 ? "" : row.at("PRICE"));
+        batch_fields.push_back(r % 11 == 0 ? "" : row.at("SHIPDATE"));
+        batch_fields.push_back(row.at("COMMENT"));
+    }
+    Arrow::Writer writer;
+    CHECK(writer.open(path, fields) && writer.appendBatch(batch_fields, 100) && writer.close());
+    {
+        Arrow::File file;
+        std::string error;
+        Arrow::RecordBatch batch;
+        CHECK(file.open(path, error) && file.rows() == 100 && file.batch(0, batch, error));
+        CHECK(file.schema().size() == fields.size() && file.schema()[1].type == Arrow::Type::FLOAT64);
+        if (batch.columns.size() == fields.size()) {
+            for (int64_t r = 0; r < 100; r++) {
+                const Row& row = table[static_cast<size_t>(r)];
+                CHECK_CASE(batch.columns[0].integer(r) == static_cast<int64_t>(r + 1), "row " << r);
+                CHECK_CASE(batch.columns[1].isNull(r) == (r % 9 == 0), "row " << r);
+                if (r % 9) CHECK_CASE(batch.columns[1].number(r) == FastParse::toDouble(row.at("PRICE")), "row " << r);
+                CHECK_CASE(batch.columns[2].value(r) == (r % 11 == 0 ? "" : row.at("SHIPDATE")), "row " << r);
+                CHECK_CASE(batch.columns[3].text(r) == row.at("COMMENT"), "row " << r);
+            }
+        }
+    }
+
+    // Typed columns copied as they are, doubles bit for bit
+    const std::vector<std::string_view> names = {"ALGERIA", "", "BRAZIL"};
+    const std::vector<double> numbers = {0.1 + 0.2, -1e300, 5.0 / 3.0};
+    const std::vector<int64_t> days = {0, -1, 19000};
+    Arrow::ColumnValues name_values, number_values, day_values;
+    name_values.text = names.data();
+    number_values.numbers = numbers.data();
+    day_values.integers = days.data();
+    CHECK(writer.open(path, {{"NAME", Arrow::Type::UTF8, false}, {"NUMBER", Arrow::Type::FLOAT64, false},
+                             {"DAY", Arrow::Type::DATE32, false}}) &&
+          writer.appendBatch({name_values, number_values, day_values}, 3) && writer.close());
+    {
+        Arrow::File file;
+        std::string error;
+        Arrow::RecordBatch batch;
+        CHECK(file.open(path, error) && file.rows() == 3 && file.batch(0, batch, error) && batch.columns.size() == 3);
+        for (int64_t r = 0; r < 3 && batch.columns.size() == 3; r++) {
+            CHECK_CASE(batch.columns[0].text(r) == names[r], "row " << r);
+            CHECK_CASE(batch.columns[1].number(r) == numbers[r], "row " << r);
+            CHECK_CASE(batch.columns[2].integer(r) == days[r], "row " << r);
+        }
+    }
+    // Integers that do not fit an INT32 column are refused
+    const std::vector<int64_t> too_large = {int64_t(1) << 40};
+    day_values.integers = too_large.data();
+    CHECK(writer.open(path, {{"DAY", Arrow::Type::INT32, false}}) && !writer.appendBatch({day_values}, 1));
+    writer.close();
+
+    CHECK(Arrow::writeTable(path, COLUMNS, sampleRows(300), 100));
+    const std::string bytes = readFile(path);
+    auto copies = damagedCopies(bytes);
+    std::string bad_footer = bytes;
+    bad_footer[bad_footer.size() - 7] = '\x7f';   // footer size
+    copies.emplace_back("with a bad footer size", bad_footer);
+    for (const auto& [what, copy] : copies) {
+        writeFile(path, copy);
+        read.clear();
+        CHECK_CASE(!Arrow::readTable(path, COLUMNS, read), ".arrow " << what);
+    }
+    std::filesystem::remove(path);
+}
+
+void checkParquet(const std::string& data_dir) {
+    const std::string fixture = data_dir + "/sample.parquet";
+    const Table table = sampleRows(1000);
+
+    {
+        Parquet::File file;
+        std::string error;
+        CHECK_CASE(file.open(fixture, error), error);
+        CHECK(file.info().row_groups.size() == 3);
+    }
+
+    Table read;
+    CHECK(Parquet::readTable(fixture, COLUMNS, read) && read == table);
+    for (int threads : {1, 3}) {
+        read.clear();
+        CHECK_CASE(Parquet::readTable(fixture, COLUMNS, read, threads, sampleFilters()) &&
+                       read == filtered(table, sampleFilters()),
+                   threads << " threads");
+    }
+
+    const std::string bytes = readFile(fixture);
+    const std::string path = tempPath("sample.parquet");
+    auto copies = damagedCopies(bytes);
+    std::string bad_footer = bytes;
+    bad_footer[bad_footer.size() - 5] = '\x7f';   // metadata size
+    copies.emplace_back("with a bad metadata size", bad_footer);
+    for (const auto& [what, copy] : copies) {
+        writeFile(path, copy);
+        read.clear();
+        CHECK_CASE(!Parquet::readTable(path, COLUMNS, read), ".parquet " << what);
+    }
+    std::filesystem::remove(path);
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    if (argc != 2) {
+        std::cerr << "Usage: test_formats <tests/data directory>" << std::endl;
+        return 2;
+    }
+    std::error_code ec;
+    std::filesystem::path directory = std::filesystem::temp_directory_path(ec) / "tpch_test_formats";
+    if (ec || (std::filesystem::create_directories(directory, ec), ec)) {
+        std::cerr << "No temporary directory: " << ec.message() << std::endl;
+        return 2;
+    }
+    temp_dir = directory.string();
+    checkColumnar();
+    checkArrow();
+    checkParquet(argv[1]);
+    std::filesystem::remove_all(directory, ec);
+    return checkResult("test_formats");
+}
@@ -0,0 +1,200 @@
+// TPC-H data generator for the tables Query 5 reads.
+//
+// Example:
+//   ./tpch_datagen --scale 2 --output_dir /path/to/tables --format columnar --threads 4
+//   ./tpch_datagen --convert /path/to/dbgen/tables --output_dir /path/to/tables
+//   ./tpch_datagen --project /path/to/tables
+//   ./tpch_datagen --analyze /path/to/tables --threads 4
+//
+// --format tbl writes dbgen style .tbl files, --format columnar (default)
+// writes the binary .col files readTPCHData prefers and --format arrow Arrow
+// IPC files (.arrow, Utf8 columns) that other tools can map. --convert turns
+// existing .tbl files (e.g. from the external dbgen), or .parquet files where
+// there is no .tbl file, into .col files instead, or .arrow files with
+// --format arrow.
+// --projection order_date also writes the date-clustered projection of orders
+// and lineitem; --project writes it for an existing directory.
+// --statistics on also writes the column statistics of every table
+// (<table>.stats.json), kept current as row groups are generated; --analyze
+// collects them for an existing directory, one table at a time with the
+// columns spread over --threads threads.
+
+#include "../include/datagen.hpp"
+#include "../include/arrow.hpp"
+#include "../include/columnar.hpp"
+#include "../include/parquet.hpp"
+#include "../include/projection.hpp"
+#include "../include/statistics.hpp"
+#include "../include/tpch_schema.hpp"
+#include "../include/utilities.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+
+int main(int argc, char* argv[]) {
+    std::unordered_map<std::string, std::string> options = {
+        {"scale", "1"}, {"format", "columnar"}, {"threads", "1"}, {"seed", "19920101"},
+    };
+    if ((argc - 1) % 2 != 0) {
+        std::cerr << "Options must be given as --key value pairs." << std::endl;
+        return 1;
+    }
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string key(argv[i]);
+        if (key.size() < 3 || key.substr(0, 2) != "--") {
+            std::cerr << "Unexpected argument: " << key << std::endl;
+            return 1;
+        }
+        options[key.substr(2)] = argv[i + 1];
+    }
+    if (options.count("project")) {
+        auto start = std::chrono::steady_clock::now();
+        std::string error;
+        if (!Projection::build(options["project"], error)) {
+            std::cerr << "Failed to write the projection: " << error << std::endl;
+            return 1;
+        }
+        auto end = std::chrono::steady_clock::now();
+        std::cout << "Projection written in " << std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count()
+                  << " ms" << std::endl;
+        return 0;
+    }
+    if (options.count("analyze")) {
+        auto start = std::chrono::steady_clock::now();
+        std::string prefix = options["analyze"];
+        if (!prefix.empty() && prefix.back() != '/') prefix += "/";
+        int threads = 1;
+        try { threads = std::max(1, std::stoi(options["threads"])); }
+        catch (...) {
+            std::cerr << "Invalid --threads: " << options["threads"] << std::endl;
+            return 1;
+        }
+        // The base tables and, when present, the projection
+        std::vector<std::pair<std::string, std::vector<std::string>>> tables;
+        for (const auto& table : TPCH::TABLE_NAMES) tables.emplace_back(table, TPCH::columnsOf(table));
+        tables.emplace_back(Projection::ORDERS_BY_DATE, TPCH::ORDERS_COLUMNS);
+        tables.emplace_back(Projection::LINEITEM_BY_DATE, Projection::lineitemColumns());
+        for (const auto& [name, columns] : tables) {
+            std::error_code ec;
+            std::string col_path = prefix + name + ".col";
+            std::string arrow_path = prefix + name + ".arrow";
+            std::string parquet_path = prefix + name + ".parquet";
+            std::string tbl_path = prefix + name + ".tbl";
+            bool columnar = std::filesystem::exists(col_path, ec);
+            bool arrow = !columnar && std::filesystem::exists(arrow_path, ec);
+            bool parquet = !columnar && !arrow && std::filesystem::exists(parquet_path, ec);
+            if (!columnar && !arrow && !parquet && !std::filesystem::exists(tbl_path, ec)) continue;
+            std::vector<std::map<std::string, std::string>> rows;
+            if (!(columnar ? Columnar::readTable(col_path, columns, rows)
+                  : arrow ? Arrow::readTable(arrow_path, columns, rows)
+                  : parquet ? Parquet::readTable(parquet_path, columns, rows, threads)
+                  : readTable(tbl_path, columns, rows))) {
+                std::cerr << "Failed to read " << name << std::endl;
+                return 1;
+            }
+            std::string table = name.substr(0, name.find('.'));
+            if (!Statistics::writeStats(prefix + name + ".stats.json", Statistics::collect(table, columns, rows, threads))) {
+                std::cerr << "Failed to write the statistics of " << name << std::endl;
+                return 1;
+            }
+            std::cout << name << ": " << rows.size() << " rows analyzed" << std::endl;
+        }
+        auto end = std::chrono::steady_clock::now();
+        std::cout << "Statistics written in " << std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count()
+                  << " ms" << std::endl;
+        return 0;
+    }
+    if (options.count("statistics") && options["statistics"] != "on" && options["statistics"] != "off") {
+        std::cerr << "Unknown --statistics: " << options["statistics"] << std::endl;
+        return 1;
+    }
+    if (options.count("projection") && options["projection"] != "order_date" && options["projection"] != "none") {
+        std::cerr << "Unknown --projection: " << options["projection"] << std::endl;
+        return 1;
+    }
+    if (options.count("output_dir") == 0) {
+        std::cerr << "Missing --output_dir." << std::endl;
+        return 1;
+    }
+    const std::string output_dir = options["output_dir"];
+    DataGen::OutputFormat format;
+    if (options["format"] == "tbl") format = DataGen::OutputFormat::TBL;
+    else if (options["format"] == "columnar") format = DataGen::OutputFormat::COLUMNAR;
+    else if (options["format"] == "arrow") format = DataGen::OutputFormat::ARROW;
+    else {
+        std::cerr << "Unknown --format: " << options["format"] << std::endl;
+        return 1;
+    }
+    if (options.count("convert") && format == DataGen::OutputFormat::TBL) {
+        std::cerr << "--convert writes columnar or arrow files." << std::endl;
+        return 1;
+    }
+    auto start = std::chrono::steady_clock::now();
+
+    if (options.count("convert")) {
+        std::string source = options["convert"];
+        if (!source.empty() && source.back() != '/') source += "/";
+        std::error_code ec;
+        std::filesystem::create_directories(output_dir, ec);
+        for (const auto& table : TPCH::TABLE_NAMES) {
+            std::vector<std::map<std::string, std::string>> rows;
+            bool arrow = format == DataGen::OutputFormat::ARROW;
+            std::string tbl_path = source + table + ".tbl";
+            std::string parquet_path = source + table + ".parquet";
+            bool parquet = !std::filesystem::exists(tbl_path, ec) && std::filesystem::exists(parquet_path, ec);
+            if (!(parquet ? Parquet::readTable(parquet_path, TPCH::columnsOf(table), rows,
+                                               std::max(1, std::atoi(options["threads"].c_str())))
+                          : readTable(tbl_path, TPCH::columnsOf(table), rows)) ||
+                !(arrow ? Arrow::writeTable(output_dir + "/" + table + ".arrow", TPCH::columnsOf(table), rows)
+                        : Columnar::writeTable(output_dir + "/" + table + ".col", TPCH::columnsOf(table), rows))) {
+                std::cerr << "Failed to convert " << table << (parquet ? ".parquet" : ".tbl") << std::endl;
+                return 1;
+            }
+            if (options.count("statistics") && options["statistics"] == "on" &&
+                !Statistics::writeStats(output_dir + "/" + table + ".stats.json",
+                                        Statistics::collect(table, TPCH::columnsOf(table), rows,
+                                                            std::max(1, std::atoi(options["threads"].c_str()))))) {
+                std::cerr << "Failed to write the statistics of " << table << std::endl;
+                return 1;
+            }
+            std::cout << table << ": " << rows.size() << " rows" << std::endl;
+        }
+    } else {
+        DataGen::Options gen;
+        try {
+            gen.scale_factor = std::stod(options["scale"]);
+            gen.num_threads = std::stoi(options["threads"]);
+            gen.seed = std::stoull(options["seed"]);
+            gen.statistics = options.count("statistics") && options["statistics"] == "on";
+        } catch (...) {
+            std::cerr << "Invalid numeric option." << std::endl;
+            return 1;
+        }
+        if (gen.scale_factor <= 0 || gen.num_threads <= 0) {
+            std::cerr << "--scale and --threads must be positive." << std::endl;
+            return 1;
+        }
+        if (!DataGen::generateFiles(gen, output_dir, format)) {
+            std::cerr << "Failed to write tables to " << output_dir << std::endl;
+            return 1;
+        }
+    }
+
+    if (options.count("projection") && options["projection"] == "order_date") {
+        std::string error;
+        if (!Projection::build(output_dir, error)) {
+            std::cerr << "Failed to write the projection: " << error << std::endl;
+            return 1;
+        }
+        std::cout << "order date projection written" << std::endl;
+    }
+
+    auto end = std::chrono::steady_clock::now();
+    std::cout << "Done in " << std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count()
+              << " ms" << std::endl;
+    return 0;
+}
@@ -0,0 +1,158 @@
+// Writes a partitioned copy of a table directory for partition-wise joins.
+//
+// Example:
+//   ./tpch_partition --table_path /data/sf10 --output_dir /data/sf10-part --partitions 8
+//   ./tpch_partition --table_path /data/sf10 --output_dir /data/sf10-part --date_bounds 1994-01-01,1995-01-01
+//
+// orders and lineitem are hash partitioned on the order key into --partitions
+// partitions (default: hardware threads), orders further on O_ORDERDATE at
+// --date_bounds (default: every January 1st inside the data). The other
+// tables are copied as .col files. tpch_query5 --table_path on the output
+// directory loads the partitions and joins them partition by partition; see
+// partitioning.hpp for the layout.
+
+#include "../include/partitioning.hpp"
+#include "../include/cluster.hpp"
+#include "../include/columnar.hpp"
+#include "../include/query5.hpp"
+#include "../include/tpch_schema.hpp"
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+using Table = std::vector<std::map<std::string, std::string>>;
+
+// January 1st of every year after the first order date up to the last one
+static std::vector<std::string> yearlyBounds(const Table& orders) {
+    std::vector<std::string> bounds;
+    if (orders.empty()) return bounds;
+    auto [first, last] = std::minmax_element(orders.begin(), orders.end(), [](const auto& a, const auto& b) {
+        return a.at("O_ORDERDATE") < b.at("O_ORDERDATE");
+    });
+    int first_year = std::stoi(first->at("O_ORDERDATE").substr(0, 4));
+    int last_year = std::stoi(last->at("O_ORDERDATE").substr(0, 4));
+    for (int year = first_year + 1; year <= last_year; year++) bounds.push_back(std::to_string(year) + "-01-01");
+    return bounds;
+}
+
+int main(int argc, char* argv[]) {
+    std::unordered_map<std::string, std::string> options;
+    if ((argc - 1) % 2 != 0) {
+        std::cerr << "Options must be given as --key value pairs." << std::endl;
+        return 1;
+    }
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string key(argv[i]);
+        if (key.size() < 3 || key.substr(0, 2) != "--") {
+            std::cerr << "Unexpected argument: " << key << std::endl;
+            return 1;
+        }
+        options[key.substr(2)] = argv[i + 1];
+    }
+    if (!options.count("table_path") || !options.count("output_dir")) {
+        std::cerr << "Usage: tpch_partition --table_path DIR --output_dir DIR [--partitions N] [--date_bounds d1,d2,...]"
+                  << std::endl;
+        return 1;
+    }
+    const std::string table_path = options["table_path"];
+    const std::string output_dir = options["output_dir"];
+    if (std::filesystem::exists(output_dir + "/" + Partitioning::MANIFEST)) {
+        std::cerr << output_dir << " is already partitioned." << std::endl;
+        return 1;
+    }
+    Partitioning::Layout layout;
+    layout.hash_partitions = std::max(1u, std::thread::hardware_concurrency());
+    try {
+        if (options.count("partitions")) layout.hash_partitions = std::stoi(options["partitions"]);
+    } catch (...) {
+        std::cerr << "Invalid --partitions: " << options["partitions"] << std::endl;
+        return 1;
+    }
+    if (layout.hash_partitions < 1) {
+        std::cerr << "--partitions must be positive." << std::endl;
+        return 1;
+    }
+    auto start = std::chrono::steady_clock::now();
+
+    std::error_code ec;
+    std::filesystem::create_directories(output_dir + "/orders", ec);
+    std::filesystem::create_directories(output_dir + "/lineitem", ec);
+    if (ec) {
+        std::cerr << "Failed to create " << output_dir << ": " << ec.message() << std::endl;
+        return 1;
+    }
+
+    for (const auto& table : TPCH::TABLE_NAMES) {
+        Table rows;
+        if (!readBaseTable(table_path, table, TPCH::columnsOf(table), rows)) {
+            std::cerr << "Failed to read " << table << " from " << table_path << std::endl;
+            return 1;
+        }
+        const auto& columns = TPCH::columnsOf(table);
+        if (table == "orders") {
+            if (options.count("date_bounds")) {
+                std::stringstream list(options["date_bounds"]);
+                std::string bound;
+                while (std::getline(list, bound, ',')) {
+                    if (!bound.empty()) layout.date_bounds.push_back(bound);
+                }
+                std::sort(layout.date_bounds.begin(), layout.date_bounds.end());
+                layout.date_bounds.erase(std::unique(layout.date_bounds.begin(), layout.date_bounds.end()),
+                                         layout.date_bounds.end());
+            } else {
+                layout.date_bounds = yearlyBounds(rows);
+            }
+            std::vector<std::vector<Table>> parts(layout.hash_partitions, std::vector<Table>(layout.dateRanges()));
+            for (auto& row : rows) {
+                int h = Cluster::Partition::indexOf(row.at("O_ORDERKEY"), layout.hash_partitions);
+                parts[h][layout.dateRange(row.at("O_ORDERDATE"))].push_back(std::move(row));
+            }
+            for (int h = 0; h < layout.hash_partitions; h++) {
+                for (size_t r = 0; r < layout.dateRanges(); r++) {
+                    std::string path = Partitioning::Layout::ordersFile(output_dir, h, r);
+                    if (!Columnar::writeTable(path, columns, parts[h][r])) {
+                        std::cerr << "Failed to write " << path << std::endl;
+                        return 1;
+                    }
+                }
+            }
+            std::cout << table << ": " << rows.size() << " rows in " << layout.hash_partitions << " x "
+                      << layout.dateRanges() << " partitions" << std::endl;
+        } else if (table == "lineitem") {
+            std::vector<Table> parts(layout.hash_partitions);
+            for (auto& row : rows) {
+                parts[Cluster::Partition::indexOf(row.at("L_ORDERKEY"), layout.hash_partitions)].push_back(std::move(row));
+            }
+            for (int h = 0; h < layout.hash_partitions; h++) {
+                std::string path = Partitioning::Layout::lineitemFile(output_dir, h);
+                if (!Columnar::writeTable(path, columns, parts[h])) {
+                    std::cerr << "Failed to write " << path << std::endl;
+                    return 1;
+                }
+            }
+            std::cout << table << ": " << rows.size() << " rows in " << layout.hash_partitions << " partitions" << std::endl;
+        } else {
+            if (!Columnar::writeTable(output_dir + "/" + table + ".col", columns, rows)) {
+                std::cerr << "Failed to write " << table << ".col" << std::endl;
+                return 1;
+            }
+            std::cout << table << ": " << rows.size() << " rows" << std::endl;
+        }
+    }
+    // Written last, so an interrupted run leaves no directory that looks partitioned
+    if (!Partitioning::writeLayout(output_dir, layout)) {
+        std::cerr << "Failed to write " << output_dir << "/" << Partitioning::MANIFEST << std::endl;
+        return 1;
+    }
+
+    auto end = std::chrono::steady_clock::now();
+    std::cout << "Done in " << std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count()
+              << " ms" << std::endl;
+    return 0;
+}
@@ -0,0 +1,92 @@
+// Publishes the .col tables of a directory as a shared-memory dataset that
+// tpch_query5 --shm attaches to instead of reading the files. Only the disk
+// reads are saved; each process still decodes the tables into its own rows.
+//
+// Example:
+//   ./tpch_shm --publish sf10 --table_path /data/sf10
+//   ./tpch_shm --publish /dev/hugepages/sf10 --table_path /data/sf10
+//   ./tpch_shm --info sf10
+//   ./tpch_shm --remove sf10
+//
+// A name containing '/' is a file (e.g. on hugetlbfs), anything else a POSIX
+// shared-memory object. The dataset stays until it is removed or the host
+// restarts; on Windows it lives while tpch_shm --publish keeps running.
+
+#include "../include/shareddata.hpp"
+#include "../include/tpch_schema.hpp"
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+int main(int argc, char* argv[]) {
+    std::unordered_map<std::string, std::string> options;
+    if ((argc - 1) % 2 != 0) {
+        std::cerr << "Options must be given as --key value pairs." << std::endl;
+        return 1;
+    }
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string key(argv[i]);
+        if (key.size() < 3 || key.substr(0, 2) != "--") {
+            std::cerr << "Unexpected argument: " << key << std::endl;
+            return 1;
+        }
+        options[key.substr(2)] = argv[i + 1];
+    }
+
+    if (options.count("remove")) {
+        if (!SharedData::remove(options["remove"])) {
+            std::cerr << "Failed to remove " << options["remove"] << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+
+    if (options.count("info")) {
+        SharedData::Segment segment;
+        std::string error;
+        auto start = std::chrono::steady_clock::now();
+        if (!segment.attach(options["info"], error)) {
+            std::cerr << "Failed to attach: " << error << std::endl;
+            return 1;
+        }
+        double attach_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        std::cout << "source: " << segment.source() << std::endl;
+        std::cout << "bytes: " << segment.bytes() << " (attached in " << attach_ms << " ms)" << std::endl;
+        for (const auto& table : segment.tables()) {
+            bool current = segment.find(segment.source(), table.name) != nullptr;
+            std::cout << table.name << ": " << table.bytes << " bytes" << (current ? "" : " (stale)") << std::endl;
+        }
+        return 0;
+    }
+
+    if (!options.count("publish") || !options.count("table_path")) {
+        std::cerr << "Usage: tpch_shm --publish NAME --table_path DIR | --info NAME | --remove NAME" << std::endl;
+        return 1;
+    }
+    // Every table with a .col file; the others keep being read from their .tbl files
+    std::vector<std::string> tables;
+    for (const auto& table : TPCH::TABLE_NAMES) {
+        std::error_code ec;
+        if (std::filesystem::exists(options["table_path"] + "/" + table + ".col", ec)) tables.push_back(table);
+        else std::cerr << "Skipping " << table << ": no .col file" << std::endl;
+    }
+    SharedData::Segment segment;
+    std::string error;
+    auto start = std::chrono::steady_clock::now();
+    if (!segment.publish(options["publish"], options["table_path"], tables, error)) {
+        std::cerr << "Failed to publish: " << error << std::endl;
+        return 1;
+    }
+    auto end = std::chrono::steady_clock::now();
+    std::cout << "Published " << tables.size() << " tables (" << segment.bytes() << " bytes) as "
+              << options["publish"] << " in " << std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count()
+              << " ms" << std::endl;
+    if (!SharedData::persistsAfterExit()) {
+        std::cout << "Serving until Enter is pressed." << std::endl;
+        std::cin.get();
+    }
+    return 0;
+}